@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <span>
 
 namespace ur::assembler::arm64 {
 
@@ -53,6 +54,8 @@ enum class SystemRegister {
     FPCR,
     FPSR,
     TPIDR_EL0,
+    CNTFRQ_EL0,  // Generic timer frequency, read-only
+    CNTVCT_EL0,  // Generic timer virtual count, read-only
 };
 
 enum class BarrierOption {
@@ -60,11 +63,20 @@ enum class BarrierOption {
     NSH,
     ISH,
     SY,
+    ISHST, // Inner shareable, stores only (DMB)
+    ISHLD, // Inner shareable, loads only (DMB)
 };
 
 class AssemblerAArch64 {
 public:
     explicit AssemblerAArch64(uintptr_t start_address);
+    /**
+     * @brief Emits into caller-provided storage instead of a growing vector.
+     *
+     * Nothing is allocated; emitting past the end of `buffer` throws std::runtime_error.
+     * get_code()/get_code_mut() stay empty in this mode, use get_code_span().
+     */
+    AssemblerAArch64(uintptr_t start_address, std::span<uint32_t> buffer);
     virtual ~AssemblerAArch64() = default;
 
     AssemblerAArch64(const AssemblerAArch64&) = delete;
@@ -77,6 +89,19 @@ public:
     void gen_abs_call(uintptr_t destination, Register reg);
     void gen_load_address(Register dest, uintptr_t address);
 
+    // Range checks for PC-relative encodings; `from` is the address of the instruction.
+    static bool can_encode_b(uintptr_t from, uintptr_t to);      // B/BL, ±128MB
+    static bool can_encode_b_cond(uintptr_t from, uintptr_t to); // B.cond/CBZ/CBNZ/LDR literal, ±1MB
+    static bool can_encode_tbz(uintptr_t from, uintptr_t to);    // TBZ/TBNZ, ±32KB
+    static bool can_encode_adr(uintptr_t from, uintptr_t to);    // ±1MB, any byte
+    static bool can_encode_adrp(uintptr_t from, uintptr_t to);   // ±4GB, by 4KB page
+
+    // Non-throwing forms: emit and return true, or emit nothing and return false when out of range.
+    bool try_b(uintptr_t target_address);
+    bool try_b(Condition cond, uintptr_t target_address);
+    bool try_bl(uintptr_t target_address);
+    bool try_adrp(Register rd, uintptr_t target_address);
+
     // Branch instructions
     void b(uintptr_t target_address);
     void b(Condition cond, uintptr_t target_address);
@@ -195,6 +220,10 @@ public:
     void ldar(Register rt, Register rn);
     void stlr(Register rt, Register rn);
 
+    // Atomic memory operations (ARMv8.1 LSE); check for support before executing them
+    void ldadd(Register rs, Register rt, Register rn);
+    void stadd(Register rs, Register rn);
+
     // NEON Data Processing instructions
     void neon_add(Register rd, Register rn, Register rm, NeonArrangement arr);
     void neon_and(Register rd, Register rn, Register rm, NeonArrangement arr);
@@ -220,8 +249,18 @@ public:
     void pop(Register reg);
     void load_constant(Register dest, uint64_t value);
 
+    // Raw data emitted inline, e.g. literal slots read with LDR (literal)
+    void emit_word(uint32_t value);
+    void emit_quad(uint64_t value);
+
+    // Pre-sizes the internal vector; no effect when emitting into an external buffer.
+    void reserve(size_t instructions);
+
     const std::vector<uint32_t>& get_code() const;
     std::vector<uint32_t>& get_code_mut();
+    // The emitted words in either mode
+    std::span<const uint32_t> get_code_span() const;
+    std::span<uint32_t> get_code_span_mut();
     size_t get_code_size() const;
     uintptr_t get_current_address() const;
 
@@ -231,6 +270,9 @@ public:
 private:
     uintptr_t current_address_;
     std::vector<uint32_t> code_;
+    std::span<uint32_t> buffer_;
+    size_t buffer_size_ = 0;
+    bool external_ = false;
 
     void emit(uint32_t instruction);
     uint32_t to_reg(Register reg);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ur/inline_hook.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ur::inline_hook {
+
+/**
+ * @brief Options for AsyncInstaller.
+ */
+struct AsyncOptions {
+    // Threads that prepare trampolines and detour stubs (see HookBatch::prepare()).
+    size_t workers = 2;
+
+    // Most hooks committed by one batch.
+    size_t max_batch = 64;
+
+    // How long the committer waits for more prepared hooks before committing a partial batch.
+    std::chrono::milliseconds linger{1};
+
+    // Options for every commit, e.g. suspending threads while patching.
+    BatchOptions batch;
+};
+
+/**
+ * @brief Installs inline hooks in the background.
+ *
+ * install() only queues the request and returns a future, so the calling thread (typically
+ * the main thread during startup) never waits for decoding, near allocation or JIT. Worker
+ * threads prepare the targets in parallel; a committer thread collects prepared hooks and
+ * installs them with HookBatch, so many hooks share one patch pass and one cache flush.
+ *
+ * A hook that fails stores its exception in its future and does not affect the others in
+ * its batch. The hook lives in the future's shared state until get() moves it out, so
+ * dropping the future uninstalls it. The destructor installs everything still queued
+ * before it returns.
+ */
+class AsyncInstaller {
+public:
+    explicit AsyncInstaller(const AsyncOptions& options = {});
+    ~AsyncInstaller();
+
+    AsyncInstaller(const AsyncInstaller&) = delete;
+    AsyncInstaller& operator=(const AsyncInstaller&) = delete;
+
+    /**
+     * @brief Queues a hook; the future becomes ready once it is installed and enabled.
+     * @throws std::invalid_argument if `target` or `callback` is null.
+     */
+    std::future<Hook> install(uintptr_t target, Hook::Callback callback, const HookOptions& options = {});
+
+    /**
+     * @brief Blocks until every hook queued so far has been installed or has failed.
+     */
+    void flush();
+
+    // Hooks queued and not yet installed or failed.
+    size_t pending() const;
+
+private:
+    struct Request {
+        uintptr_t target;
+        Hook::Callback callback;
+        HookOptions options;
+        std::promise<Hook> promise;
+    };
+
+    void prepare_loop();
+    void commit_loop();
+    void commit(std::vector<Request>& batch);
+    void finish(size_t count);
+
+    AsyncOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable queued_cv_;   // Signals workers: a request was queued
+    std::condition_variable prepared_cv_; // Signals the committer: a request was prepared
+    std::condition_variable done_cv_;     // Signals flush(): requests were finished
+    std::deque<Request> queued_;
+    std::vector<Request> prepared_;
+    size_t preparing_ = 0;   // Requests taken by workers and not yet prepared
+    size_t outstanding_ = 0; // Requests not yet finished
+    bool stopping_ = false;
+
+    std::vector<std::thread> workers_;
+    std::thread committer_;
+};
+
+} // namespace ur::inline_hook
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ur::cache_maintenance {
+
+    // Cache geometry and coherence features from CTR_EL0, read once per process.
+    struct CacheInfo {
+        size_t dcache_line = 64; // Smallest data cache line (DminLine)
+        size_t icache_line = 64; // Smallest instruction cache line (IminLine)
+        bool idc = false;        // Data cache clean to PoU is not needed for instruction fetch to see stores
+        bool dic = false;        // Instruction cache invalidation to PoU is not needed
+    };
+
+    const CacheInfo& info();
+
+    /**
+     * @brief Makes code written at [write_address, write_address + size) visible to
+     * instruction fetch at [address, address + size).
+     *
+     * The two differ when the code was written through a writable alias (see
+     * ur::exec_pool::writable()). Data lines are cleaned by the data cache line size
+     * unless CTR_EL0.IDC is set, instruction lines are invalidated by the instruction
+     * cache line size unless CTR_EL0.DIC is set; the barriers are always issued.
+     */
+    void sync_code(uintptr_t address, uintptr_t write_address, size_t size);
+
+    inline void sync_code(uintptr_t address, size_t size) {
+        sync_code(address, address, size);
+    }
+
+    /**
+     * @brief Collects written code ranges and synchronizes them together.
+     *
+     * Ranges are kept sorted and merged as they are added, so overlapping or adjacent
+     * patches are cleaned and invalidated once, and the whole batch costs a single
+     * barrier sequence. flush() does not allocate.
+     */
+    class Batch {
+    public:
+        void reserve(size_t count);
+
+        void add(uintptr_t address, uintptr_t write_address, size_t size);
+        void add(uintptr_t address, size_t size) { add(address, address, size); }
+
+        bool empty() const { return code_ranges_.empty(); }
+
+        // Number of merged instruction ranges.
+        size_t size() const { return code_ranges_.size(); }
+
+        // Synchronizes every range added so far; the batch keeps its ranges.
+        void flush() const;
+
+        void clear();
+
+    private:
+        using Range = std::pair<uintptr_t, uintptr_t>; // [start, end)
+
+        static void insert(std::vector<Range>& ranges, uintptr_t start, uintptr_t end);
+
+        std::vector<Range> code_ranges_; // Executable addresses, invalidated in the instruction cache
+        std::vector<Range> data_ranges_; // Written addresses, cleaned in the data cache
+    };
+}
@@ -38,6 +38,21 @@ ur_status_t ur_inline_hook_unhook(ur_inline_hook_t* hook);
 void* ur_inline_hook_get_trampoline(const ur_inline_hook_t* hook);
 ur_status_t ur_inline_hook_set_detour(ur_inline_hook_t* hook, void* callback);
 
+/* 批量接口：句柄写入调用方提供的数组（长度至少为 count） */
+
+/* 作为一个事务安装 count 个 Hook（见 ur::inline_hook::HookBatch），安装后即启用。
+ * 全部成功时返回 OK；任一项失败时不安装任何 Hook，out_hooks 全部置空。
+ * suspend_threads 非 0 时在挂起其他线程期间打补丁 */
+ur_status_t ur_inline_hook_create_many(const uintptr_t* targets, void* const* callbacks, size_t count,
+                                       int suspend_threads, ur_inline_hook_t** out_hooks);
+/* 一次补丁写入启用/禁用全部 Hook（见 HookBatch::set_enabled），空句柄被跳过，已处于目标状态的
+ * Hook 不变；全部成功返回 OK，否则返回 ERROR。写入失败时所有 Hook 保持原状态。
+ * suspend_threads 含义同 ur_inline_hook_create_many */
+ur_status_t ur_inline_hook_enable_many(ur_inline_hook_t* const* hooks, size_t count, int suspend_threads);
+ur_status_t ur_inline_hook_disable_many(ur_inline_hook_t* const* hooks, size_t count, int suspend_threads);
+/* 按逆序销毁，空句柄被跳过 */
+void ur_inline_hook_destroy_many(ur_inline_hook_t* const* hooks, size_t count);
+
 /* Mid Hook */
 typedef struct ur_mid_hook ur_mid_hook_t;
 
@@ -78,6 +93,21 @@ void ur_plthook_destroy(ur_plthook_t* hook);
 int ur_plthook_is_valid(const ur_plthook_t* hook);
 ur_status_t ur_plthook_hook_symbol(ur_plthook_t* hook, const char* symbol, void* replacement, void** original_out);
 ur_status_t ur_plthook_unhook_symbol(ur_plthook_t* hook, const char* symbol);
+
+typedef struct ur_plthook_symbol_hook {
+    const char* symbol;
+    void* replacement;
+    void** original_out; /* 可为空 */
+} ur_plthook_symbol_hook_t;
+
+/* 批量安装符号 Hook，GOT 写入按页合并（见 ur::plthook::Hook::hook_symbols）。
+ * 未找到的符号与无效项被跳过；installed_out 可为空，输出成功安装的数量。
+ * 全部安装返回 OK，否则返回 ERROR */
+ur_status_t ur_plthook_hook_symbols(ur_plthook_t* hook, const ur_plthook_symbol_hook_t* hooks, size_t count,
+                                    size_t* installed_out);
+/* 批量卸载符号 Hook；removed_out 可为空，输出成功卸载的数量。全部卸载返回 OK，否则返回 ERROR */
+ur_status_t ur_plthook_unhook_symbols(ur_plthook_t* hook, const char* const* symbols, size_t count,
+                                      size_t* removed_out);
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -61,6 +61,21 @@ namespace ur {
             STXR,
             // Bitfield
             UBFM,
+            // More PC-relative loads
+            LDRSW_LIT,
+            PRFM_LIT,
+            // Narrow and sign-extending loads/stores (immediate and register offset)
+            LDRB,
+            LDRH,
+            LDRSB,
+            LDRSH,
+            LDRSW,
+            STRB,
+            STRH,
+            PRFM,
+            // SIMD&FP register loads/stores (immediate and register offset)
+            LDR_FP,
+            STR_FP,
         };
 
         enum class InstructionGroup {
@@ -106,6 +121,39 @@ namespace ur {
             assembler::Condition cond = assembler::Condition::AL;
         };
 
+        // Operand of a DecodedInsn. Only the member matching `type` is meaningful.
+        struct DecodedOperand {
+            OperandType type = OperandType::INVALID;
+            assembler::Register reg = assembler::Register::INVALID; // REGISTER
+            int64_t imm = 0;                                        // IMMEDIATE
+            MemOperand mem;                                         // MEMORY
+        };
+
+        // Compact, fixed-size decoded instruction. Produced by decode() without any
+        // heap allocation or text formatting; use format() to get text on demand.
+        struct DecodedInsn {
+            static constexpr size_t kMaxOperands = 4;
+
+            uint64_t address = 0;
+            uint32_t raw = 0;
+            InstructionId id = InstructionId::INVALID;
+            InstructionGroup group = InstructionGroup::INVALID;
+            assembler::Condition cond = assembler::Condition::AL;
+            bool is_pc_relative = false;
+            uint8_t operand_count = 0;
+            DecodedOperand operands[kMaxOperands];
+        };
+
+        // Decodes one instruction word located at `address`.
+        // @return false if the instruction is not recognized (out.id == INVALID).
+        bool decode(uint64_t address, uint32_t word, DecodedInsn& out);
+
+        // Formats a decoded instruction's mnemonic and operand text.
+        void format(const DecodedInsn& insn, std::string& mnemonic, std::string& op_str);
+
+        // Converts a decoded instruction to the full Instruction representation (including text).
+        Instruction to_instruction(const DecodedInsn& insn);
+
         // Abstract base class for a disassembler.
         class Disassembler {
         public:
@@ -1,12 +1,59 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <span>
 #include <vector>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <elf.h>
 
+namespace ur::symbol_cache {
+    class Cache;
+}
+
 namespace ur::elf_parser {
 
+    // DT_GNU_HASH 使用的哈希函数（DJB）
+    constexpr uint32_t gnu_hash(std::string_view name) {
+        uint32_t h = 5381;
+        for (char c : name) {
+            h = (h << 5) + h + static_cast<unsigned char>(c);
+        }
+        return h;
+    }
+
+    // DT_HASH 使用的 SysV ELF 哈希函数
+    constexpr uint32_t elf_hash(std::string_view name) {
+        uint32_t h = 0;
+        for (char c : name) {
+            h = (h << 4) + static_cast<unsigned char>(c);
+            uint32_t g = h & 0xf0000000;
+            if (g) {
+                h ^= g >> 24;
+            }
+            h &= ~g;
+        }
+        return h;
+    }
+
+    // 预先计算好哈希的符号名。可声明为 constexpr，重复查找同一符号时不必每次重新计算。
+    // name 指向的字符串必须在查找期间保持有效。
+    struct SymbolKey {
+        std::string_view name;
+        uint32_t gnu = 0;
+        uint32_t sysv = 0;
+
+        constexpr SymbolKey() = default;
+        constexpr SymbolKey(std::string_view symbol_name)
+            : name(symbol_name), gnu(gnu_hash(symbol_name)), sysv(elf_hash(symbol_name)) {}
+        constexpr SymbolKey(const char* symbol_name) : SymbolKey(std::string_view(symbol_name)) {}
+        SymbolKey(const std::string& symbol_name) : SymbolKey(std::string_view(symbol_name)) {}
+    };
+
     class ElfHeader {
     public:
         explicit ElfHeader(uintptr_t base_address);
@@ -62,6 +109,8 @@ namespace ur::elf_parser {
     class SectionHeaderTable {
     public:
         SectionHeaderTable(uintptr_t sh_table_addr, const ElfHeader& header, ElfParser* parser);
+        // 节头与节名字符串表已位于同一块内存（例如文件映射）中
+        SectionHeaderTable(uintptr_t sh_table_addr, const ElfHeader& header, const char* string_table);
         const SectionHeader* get_section_by_name(const std::string& name) const;
         const SectionHeader* get_section_by_index(uint16_t index) const;
         std::vector<SectionHeader>::const_iterator begin() const;
@@ -73,11 +122,65 @@ namespace ur::elf_parser {
         const char* m_string_table_data = nullptr;
     };
 
+    // 只读映射到内存的磁盘文件。同一路径（且为同一 inode）的所有解析器共享一份映射，
+    // 最后一个使用者释放时解除映射。
+    class ElfFile {
+    public:
+        static std::shared_ptr<const ElfFile> open(const std::string& path);
+        ~ElfFile();
+
+        ElfFile(const ElfFile&) = delete;
+        ElfFile& operator=(const ElfFile&) = delete;
+
+        const uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        const std::string& path() const { return m_path; }
+
+        // XZ 解压文件中 [offset, offset + size) 的数据（用于 .gnu_debugdata），结果按偏移缓存。
+        // 未启用 liblzma（UR_HAVE_LZMA）或数据无效时返回 nullptr
+        std::shared_ptr<const std::vector<uint8_t>> decompress_xz(uint64_t offset, size_t size) const;
+
+    private:
+        ElfFile() = default;
+
+        std::string m_path;
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+        uint64_t m_device = 0;
+        uint64_t m_inode = 0;
+
+        mutable std::mutex m_mutex;
+        mutable std::unordered_map<uint64_t, std::shared_ptr<const std::vector<uint8_t>>> m_decompressed;
+    };
+
     class ElfParser {
     public:
         explicit ElfParser(uintptr_t base_address);
+        // 文件回退模式：内存中没有节头或 .symtab 时（Android 上通常如此），从 file_path 的只读映射中
+        // 读取节头、.symtab 以及 .gnu_debugdata（MiniDebugInfo）。file_offset 为 ELF 在文件中的偏移
+        // （例如 APK 中未压缩的 so）
+        ElfParser(uintptr_t base_address, std::string file_path, uint64_t file_offset = 0);
         bool parse();
-        uintptr_t find_symbol(const std::string& symbol_name);
+        // 接受 std::string、const char*、std::string_view 或预先计算好的 SymbolKey
+        uintptr_t find_symbol(const SymbolKey& key);
+
+        // 批量查找：先对所有符号统一做一次 GNU 哈希布隆过滤，再只为可能存在的符号遍历哈希链，
+        // 动态符号表中未命中的再查 .symtab 索引。out[i] 写入 keys[i] 的地址（未找到为 0），
+        // out 的长度必须不小于 keys。返回找到的符号数量
+        size_t find_symbols(std::span<const SymbolKey> keys, std::span<uintptr_t> out);
+
+        // 查找包含 address 的函数符号（STT_FUNC/STT_GNU_IFUNC，st_size 不为 0），.dynsym 与 .symtab
+        // 都会参与。首次调用时建立按地址排序的索引，之后为 O(log n)。找到时写入函数的起始地址与大小
+        bool find_function(uintptr_t address, uintptr_t& start, size_t& size);
+
+        // PT_NOTE 中的 NT_GNU_BUILD_ID，没有时为空。parse() 之后可用
+        std::span<const uint8_t> get_build_id() const;
+
+        // 启用 directory 下按 build-id 的磁盘符号缓存：find_symbol/find_symbols 先查缓存，
+        // 未命中的结果（包括“不存在”）写入缓存。需先 parse()；模块没有 build-id 时返回 false。
+        // 新结果在 flush_symbol_cache() 或解析器销毁时写入文件
+        bool enable_symbol_cache(const std::string& directory);
+        bool flush_symbol_cache();
         uintptr_t file_offset_to_memory_addr(uint64_t offset);
         const std::unique_ptr<SectionHeaderTable>& get_section_header_table() const;
         uintptr_t get_load_bias() const;
@@ -89,9 +192,17 @@ namespace ur::elf_parser {
 
     private:
         friend class SectionHeaderTable;
-        uintptr_t find_symbol_by_gnu_hash(const std::string& symbol_name);
-        uintptr_t find_symbol_by_hash(const std::string& symbol_name);
-        uintptr_t find_symbol_in_table(const std::string& symbol_name, const Elf64_Sym* symtab, const char* strtab, size_t sym_count);
+        uintptr_t resolve_address(uint64_t value, bool ifunc) const;
+        const Elf64_Sym* lookup_symbol(const SymbolKey& key);
+        uintptr_t finish_lookup(const SymbolKey& key, const Elf64_Sym* sym);
+        bool gnu_bloom_may_contain(uint32_t hash) const;
+        const Elf64_Sym* find_symbol_by_gnu_hash(const SymbolKey& key) const;
+        const Elf64_Sym* find_symbol_by_hash(const SymbolKey& key) const;
+        const Elf64_Sym* find_symbol_in_symtab(const SymbolKey& key);
+        void build_symtab_index();
+        void build_function_index();
+        size_t dynamic_symbol_count() const;
+        bool load_file_symbols();
 
         uintptr_t m_base_address;
         uintptr_t m_load_bias = 0;
@@ -108,6 +219,35 @@ namespace ur::elf_parser {
         const char* m_strtab = nullptr;
         size_t m_symtab_count = 0;
 
+        // 文件回退模式：m_symtab/m_strtab 可能指向文件映射或解压后的 MiniDebugInfo，由这里保持有效
+        std::string m_file_path;
+        uint64_t m_file_offset = 0;
+        std::shared_ptr<const ElfFile> m_file;
+        std::shared_ptr<const std::vector<uint8_t>> m_debug_data;
+
+        std::vector<uint8_t> m_build_id;
+        std::shared_ptr<symbol_cache::Cache> m_symbol_cache;
+
+        // .symtab 的开放寻址哈希索引（按 GNU 哈希），首次查找本地符号时构建。
+        // 每个槽位保存哈希与符号下标 + 1（0 表示空槽）
+        struct SymtabSlot {
+            uint32_t hash = 0;
+            uint32_t index = 0;
+        };
+        std::vector<SymtabSlot> m_symtab_index;
+        std::atomic<bool> m_symtab_index_built{false};
+
+        // 函数符号的地址区间（st_value 与 st_size），按 st_value 排序，首次 find_function() 时构建
+        struct FunctionRange {
+            uint64_t value = 0;
+            uint64_t size = 0;
+        };
+        std::vector<FunctionRange> m_function_index;
+        std::atomic<bool> m_function_index_built{false};
+
+        // 解析器可能被多个线程共享（见 ur::module_registry），惰性索引在锁内建立一次
+        std::mutex m_index_mutex;
+
         uintptr_t m_plt_rel_location = 0;
         size_t m_plt_rel_size = 0;
         int m_plt_rel_entry_type = 0;
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace ur::exec_pool {
+
+    // Maximum distance reachable by a single B/BL instruction (±128MB).
+    constexpr size_t kBranchRange = 128ull * 1024 * 1024;
+
+    struct Stats {
+        size_t slab_count = 0;      // Number of live slabs (one mapping each)
+        size_t bytes_reserved = 0;  // Total bytes mapped by slabs and dedicated blocks
+        size_t bytes_in_use = 0;    // Bytes handed out to callers (after rounding)
+        size_t allocation_count = 0;
+        size_t dual_mapped_bytes = 0; // Part of bytes_reserved mapped as separate RX/RW views
+        size_t inherited_bytes = 0;   // Part of bytes_reserved shared with forked processes (see is_inherited())
+    };
+
+    /**
+     * @brief Allocates a block of executable memory from the shared pool.
+     *
+     * Small blocks (trampolines, detour stubs, JIT blobs) are sub-allocated from
+     * shared slabs so that many hooks share one mapping. When `near` is non-zero
+     * the returned block lies entirely within `max_distance` bytes of `near`;
+     * slabs are grouped per window so hooks in the same module reuse them.
+     *
+     * Pool memory is backed by a memfd mapped twice: the returned address is in the
+     * read-execute view and is never writable; write through writable() or write_code().
+     * If the process cannot map shared memory executable, the pool falls back to RWX
+     * mappings, where writable() returns the block itself.
+     *
+     * @param size Requested size in bytes (rounded up to 16 bytes).
+     * @param near Address the block should be reachable from, or 0 for anywhere.
+     * @param max_distance Maximum allowed distance between `near` and the block.
+     * @return Pointer to the block, or nullptr if no memory could be obtained.
+     */
+    void* allocate(size_t size, uintptr_t near = 0, size_t max_distance = kBranchRange);
+
+    /**
+     * @brief Returns a block obtained from allocate() to the pool.
+     *
+     * Empty slabs are unmapped. Passing nullptr is a no-op.
+     */
+    void free(void* ptr);
+
+    /**
+     * @brief Returns true if `ptr` lies in pool memory that is shared with a forked process.
+     *
+     * Dual mappings are shared memory. A fork() child always replaces them with private
+     * copies at the same addresses (a pthread_atfork handler installed with the pool),
+     * and marks any it could not copy as inherited. In the parent, ur::fork_safety marks
+     * the ones that exist at a fork as inherited. The blocks of an inherited mapping are
+     * never reused and free() of them does nothing.
+     */
+    bool is_inherited(const void* ptr);
+
+    /**
+     * @brief Returns the usable size of a block obtained from allocate(), or 0.
+     */
+    size_t block_size(const void* ptr);
+
+    /**
+     * @brief Returns true if [address, address + size) lies inside the executable view of the pool.
+     *
+     * Code patches inside the pool must go through writable() and must not change page
+     * protection: other blocks on the same pages (detour stubs, dispatch slots) are written at runtime.
+     */
+    bool contains(uintptr_t address, size_t size);
+
+    /**
+     * @brief Returns the writable alias of pool memory at `ptr` (any address inside a block).
+     *
+     * Stores through the alias are immediately visible at `ptr`; code written this way still
+     * needs instruction cache maintenance on the executable range. Returns nullptr if `ptr`
+     * is not pool memory.
+     */
+    void* writable(const void* ptr);
+
+    /**
+     * @brief Copies `size` bytes of code to `code` (pool memory) and makes them visible to
+     * instruction fetch. No page protection is changed.
+     */
+    void write_code(void* code, const void* data, size_t size);
+
+    struct Range {
+        uintptr_t start = 0;
+        uintptr_t end = 0; // Exclusive, page aligned
+    };
+
+    /**
+     * @brief Returns the executable views of all pool mappings (slabs and dedicated blocks),
+     * sorted by address. Used to keep the pool out of scans of the process's own code.
+     */
+    std::vector<Range> executable_ranges();
+
+    // true while new mappings use separate RX/RW views.
+    bool is_dual_mapped();
+
+    Stats get_stats();
+
+} // namespace ur::exec_pool
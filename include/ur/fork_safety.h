@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ur::fork_safety {
+
+/**
+ * @brief Options for enable().
+ */
+struct ForkOptions {
+    /**
+     * Mark every hook that exists at fork() as inherited (see mark_inherited()), in the
+     * parent as well as in the child. Without it the handlers only keep urhook's locks
+     * consistent, which is enough when the child never touches hooks (e.g. it calls exec).
+     */
+    bool mark_inherited = true;
+};
+
+/**
+ * @brief Makes the hook registries safe to use across fork().
+ *
+ * Installs pthread_atfork() handlers (once per process) that take every process-wide
+ * urhook lock before the fork — the plthook manager and hook objects, the inline hook
+ * registry, the thread suspender, the thunk and analysis caches, the module registry,
+ * the executable pool and the maps snapshot, in that order — and release them again in
+ * the parent and in the child. A child therefore never inherits a lock held by a thread
+ * that does not exist in it. Calling enable() again only replaces the options.
+ *
+ * This is meant for zygote-style processes: hooks are installed once before the first
+ * fork and every child starts with them already in place. Patched code and GOTs are
+ * private copy-on-write memory, but the executable pool's dual mappings are shared
+ * memory, so a trampoline, detour stub or dispatch slot written in one process would
+ * change it in all of them. See mark_inherited() for how that is prevented.
+ *
+ * Not covered: locks of individual objects the caller owns (ElfParser,
+ * trampoline_cache::Cache, SymbolCache, probes), and AsyncInstaller, whose worker
+ * threads do not survive fork(); flush and destroy installers before forking.
+ */
+void enable(const ForkOptions& options = {});
+
+/**
+ * @brief Makes the fork handlers do nothing. They stay registered; pthread_atfork()
+ * handlers cannot be removed.
+ */
+void disable();
+
+bool is_enabled();
+
+/**
+ * @brief Marks every hook that exists now as inherited.
+ *
+ * An inherited hook keeps working, but its state may be shared with other processes,
+ * so it is frozen:
+ *  - inline hooks (and mid hooks, which are built on them): enable() and disable()
+ *    return false, set_detour() does nothing, and no new hook can be added to the same
+ *    target (std::runtime_error). Removing the last hook on a target restores the
+ *    original code in the calling process only; removing any other leaves its callback
+ *    in the chain.
+ *  - PLT hooks stay fully usable, since the GOT is private; a counting thunk created
+ *    before the mark is replaced by a new one instead of being redirected.
+ *  - shared executable pool memory that exists at the mark is never reused or unmapped.
+ *
+ * Called by the fork handler when ForkOptions::mark_inherited is set; call it directly
+ * before the first fork when the handlers are not used.
+ */
+void mark_inherited();
+
+/**
+ * @brief Result of verify_inherited().
+ */
+struct InheritedState {
+    size_t targets = 0;      // Inline hook targets marked inherited
+    size_t intact = 0;       // ...whose code still jumps to the hook
+    size_t shared_bytes = 0; // Executable pool memory shared with other processes
+};
+
+/**
+ * @brief Checks the inherited hooks, typically first thing in a child.
+ *
+ * Every inherited inline hook target is re-read and compared with the patch that was
+ * installed; a target whose code was changed by someone else counts as not intact.
+ */
+InheritedState verify_inherited();
+
+/**
+ * @brief Lock levels, taken in this order before fork() and released in reverse.
+ *
+ * Must match the order in which the library nests its locks: a lock may only be taken
+ * while holding locks of lower rank.
+ */
+enum class Rank {
+    Managers,   // plthook::Manager
+    Registries, // Inline hook registry shards and targets, plthook::Hook objects
+    Suspend,    // thread_suspend scope
+    Caches,     // Trampoline caches, guard and counting thunks, function analysis
+    Modules,    // Module registry
+    Memory,     // Executable pool
+    Maps,       // Maps snapshot
+};
+
+/**
+ * @brief A process-wide lock (or set of locks) taken around fork().
+ *
+ * lock() and unlock() are required. mark_inherited() and verify() are optional and run
+ * while the participant's lock is held (mark_inherited) or not (verify).
+ */
+struct Participant {
+    Rank rank;
+    void (*lock)();
+    void (*unlock)();
+    void (*mark_inherited)() = nullptr;
+    void (*verify)(InheritedState& state) = nullptr;
+};
+
+/**
+ * @brief Registers a participant; meant for static initializers in the library's own
+ * translation units. Always returns true, so it can initialize a namespace-scope flag.
+ */
+bool add_participant(const Participant& participant);
+
+} // namespace ur::fork_safety
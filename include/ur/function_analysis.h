@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace ur::function_analysis {
+
+    // [start, end) 内的一段顺序执行的指令，只在末尾发生控制流转移
+    struct BasicBlock {
+        uintptr_t start = 0;
+        uintptr_t end = 0;
+        // 函数内的后继块起始地址：顺序执行的下一块和/或直接跳转的目标
+        uintptr_t successors[2] = {};
+        uint8_t successor_count = 0;
+        // 以 RET、BR 或跳出函数的 B（尾调用）结束
+        bool exits = false;
+    };
+
+    /**
+     * @brief Control flow graph of one function, built by a linear sweep with the built-in decoder.
+     *
+     * Bounds come from the ELF symbol covering the address when there is one. Without a
+     * symbol the sweep starts at the requested address and ends at the first RET/BR/B that
+     * no known branch reaches past, so the result errs towards a larger function.
+     * Words the decoder does not recognize are treated as ordinary instructions.
+     */
+    class Function {
+    public:
+        uintptr_t start() const { return m_start; }
+        uintptr_t end() const { return m_end; }
+        size_t size() const { return m_end - m_start; }
+
+        // true 表示边界来自符号表，否则是扫描推断出的
+        bool has_symbol_bounds() const { return m_symbol_bounds; }
+
+        // 含有寄存器间接跳转（BR，通常是跳转表），其目标不一定出现在 branch_targets() 中
+        bool has_indirect_branches() const { return m_indirect_branches; }
+
+        // Blocks sorted by address; together they cover [start, end).
+        const std::vector<BasicBlock>& blocks() const { return m_blocks; }
+
+        // Sorted, unique addresses inside the function that some instruction of the function
+        // branches to (B, B.cond, CBZ/CBNZ, TBZ/TBNZ, BL) or takes with ADR.
+        const std::vector<uintptr_t>& branch_targets() const { return m_branch_targets; }
+
+        bool contains(uintptr_t address) const { return address >= m_start && address < m_end; }
+        bool is_branch_target(uintptr_t address) const;
+
+        // The block containing `address`, or nullptr.
+        const BasicBlock* block_at(uintptr_t address) const;
+
+        /**
+         * @brief Largest number of bytes (a multiple of 4, at most `limit`) that can be overwritten at `address`.
+         *
+         * The region may not extend past the end of the function and no instruction inside it
+         * other than the first may be a branch target. Returns 0 if `address` lies outside the
+         * function or is not 4-byte aligned.
+         */
+        size_t max_patch_size(uintptr_t address, size_t limit) const;
+
+    private:
+        friend class Builder;
+
+        uintptr_t m_start = 0;
+        uintptr_t m_end = 0;
+        bool m_symbol_bounds = false;
+        bool m_indirect_branches = false;
+        std::vector<BasicBlock> m_blocks;
+        std::vector<uintptr_t> m_branch_targets;
+    };
+
+    /**
+     * @brief Analyzes the function containing `address`, reusing a cached result when possible.
+     *
+     * Results are cached per function and shared, so hooking, unhooking and hooking the same
+     * function again analyzes it once. The code is read from memory, so analyze before patching.
+     * Results found through a module's symbols are dropped once the module is unloaded, so a
+     * library loaded later at the same address is analyzed afresh.
+     *
+     * @return nullptr if `address` is not in a readable mapping.
+     */
+    std::shared_ptr<const Function> analyze(uintptr_t address);
+
+    // 使用给定边界 [start, start + size) 分析并缓存，适用于没有符号的代码（如 JIT 生成的函数）
+    std::shared_ptr<const Function> analyze(uintptr_t start, size_t size);
+
+    // 丢弃与 [start, start + size) 相交的缓存结果，例如模块卸载或代码被重新生成之后
+    void invalidate(uintptr_t start, size_t size);
+    void clear_cache();
+    size_t cache_size();
+
+} // namespace ur::function_analysis
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ur/jit.h"
+
+namespace ur::hook_stats {
+
+enum class HookKind {
+    Inline,
+    Mid,
+    Vmt,
+    Plt,
+};
+
+constexpr size_t kShardBits = 4;
+constexpr size_t kShards = size_t{1} << kShardBits;
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @brief A call counter incremented by generated hook code.
+ *
+ * The count is split into kShards cache-line sized shards. A thread picks its shard by
+ * hashing TPIDR_EL0, so threads rarely share a line and the increment is a single
+ * uncontended atomic add (STADD with LSE atomics, an LDXR/STXR loop otherwise). Reading
+ * sums the shards with relaxed loads and never blocks the threads that count.
+ *
+ * Counters are owned by the registry and recycled rather than freed, since generated
+ * code may still be about to increment one when its hook is removed.
+ */
+class Counter {
+public:
+    struct alignas(kCacheLineSize) Shard {
+        std::atomic<uint64_t> calls{0};
+    };
+
+    Counter() = default;
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    // Sum of all shards; concurrent increments may or may not be included.
+    uint64_t calls() const;
+    void reset();
+
+    HookKind kind() const { return kind_; }
+    uintptr_t address() const { return address_; }
+    const std::string& name() const { return name_; }
+
+    // Address of the shard array the generated code increments.
+    const Shard* shards() const { return shards_; }
+
+private:
+    friend class Registry;
+
+    Shard shards_[kShards];
+    HookKind kind_ = HookKind::Inline;
+    uintptr_t address_ = 0;
+    std::string name_;
+    bool active_ = false;
+};
+
+/**
+ * @brief The count of one live hook at the time of a snapshot.
+ */
+struct HookStats {
+    HookKind kind;
+    uintptr_t address; // Target, mid-hook address, vtable slot or GOT entry
+    std::string name;  // Symbol name for PLT hooks, empty otherwise
+    uint64_t calls;
+};
+
+/**
+ * @brief Reads the counters of every hook created with call counting enabled.
+ *
+ * Hooks keep running while the snapshot is taken; only creating or removing a counted
+ * hook waits for it. Entries are in creation order of their counters.
+ */
+std::vector<HookStats> snapshot();
+
+// Zeroes the counters of every live counted hook.
+void reset_all();
+
+// --- Building blocks for the hook implementations ---
+
+// Takes a zeroed counter from the registry and lists it in snapshot().
+Counter* acquire_counter(HookKind kind, uintptr_t address, std::string_view name = {});
+
+// Removes the counter from snapshot() and makes it available for reuse.
+void release_counter(Counter* counter);
+
+// True when the CPU implements the ARMv8.1 atomic instructions.
+bool has_lse_atomics();
+
+/**
+ * @brief Emits code that adds one to the calling thread's shard of `counter`.
+ *
+ * Only `address` and `scratch` are written and the flags are preserved. Without LSE
+ * atomics x14 is needed as well and is spilled below SP around the update, so
+ * `address` and `scratch` must not be x14 or x15.
+ */
+void emit_increment(jit::Jit& jit, const Counter& counter, assembler::Register address,
+                    assembler::Register scratch);
+
+/**
+ * @brief A counter with a thunk that increments it and jumps to a destination:
+ *
+ *     <increment, x16/x17>
+ *     ldr  x16, destination_slot
+ *     br   x16
+ *
+ * Only x16 and x17 are clobbered, so the thunk can be put in front of anything entered
+ * with a branch (a vtable slot, a GOT entry, a hook chain link). Thunks are recycled
+ * together with their counters.
+ */
+struct CountingThunk {
+    void* code = nullptr;
+    uint64_t* destination_slot = nullptr; // Writable view of the thunk's data slot
+    Counter* counter = nullptr;
+};
+
+CountingThunk acquire_counting_thunk(HookKind kind, uintptr_t address, uintptr_t destination,
+                                     std::string_view name = {});
+void set_destination(const CountingThunk& thunk, uintptr_t destination);
+
+// Call once nothing routes to the thunk any more; resets `thunk`. Thunks in memory shared
+// with a forked process (see ur::exec_pool::is_inherited()) are not reused.
+void release_counting_thunk(CountingThunk& thunk);
+
+} // namespace ur::hook_stats
@@ -3,12 +3,19 @@
 #include <cstdint>
 #include <functional>
 #include <stdexcept>
+#include <string>
 #include <memory>
+#include <span>
+#include <vector>
+
+#include "ur/thread_suspend.h"
 
 namespace ur::inline_hook {
 
 // Forward declaration
 class Hook;
+class HookBatch;
+struct HookInfo;
 
 /**
  * @brief Calls the original function (or the next hook in the chain).
@@ -23,11 +30,44 @@ class Hook;
  */
 
 
+/**
+ * @brief Per-hook installation options.
+ */
+struct HookOptions {
+    /**
+     * Keep the target patched even while no hook on it is enabled. Disabled hooks are
+     * bypassed through the detour stub's data slot instead of restoring the original
+     * instructions, so enable(), disable() and set_detour() become a single atomic
+     * store with no code modification or instruction cache maintenance.
+     * The option is sticky per target: once any hook on a target requests it, it stays on.
+     */
+    bool switchable = false;
+
+    /**
+     * Bypass this hook while the current thread is already inside a guarded detour, e.g.
+     * when a malloc hook's callback allocates. The hook is entered through a small thunk
+     * that checks a per-thread word at a fixed offset from TPIDR_EL0 (see
+     * ur::recursion_guard), calls the callback with the word set and clears it on return;
+     * when the word is already set the thunk continues with the rest of the chain. The
+     * guard is shared by all guarded inline and mid hooks on a thread, and a guarded
+     * callback must return normally (no exceptions or longjmp out of it).
+     */
+    bool recursion_guard = false;
+
+    /**
+     * Count the calls that reach this hook in a per-thread sharded counter (see
+     * ur::hook_stats). The hook is entered through a small thunk that increments the
+     * counter before the guard (if any) and the callback; the count is read with
+     * Hook::call_count() or ur::hook_stats::snapshot().
+     */
+    bool count_calls = false;
+};
+
 class Hook {
 public:
     using Callback = void*;
 
-    Hook(uintptr_t target, Callback callback, bool enable_now = true);
+    Hook(uintptr_t target, Callback callback, bool enable_now = true, const HookOptions& options = {});
     ~Hook();
 
     Hook(const Hook&) = delete;
@@ -40,8 +80,23 @@ public:
 
     uintptr_t get_trampoline() const;
 
+    /**
+     * @brief Returns this hook's dispatch link, the address call_original() calls.
+     *
+     * The link runs the next enabled hook in the chain, or the original function, so it
+     * can be cached in a slot and called directly without the checks of call_original().
+     * It stays valid until the hook is removed. Returns nullptr for an invalid hook.
+     */
+    void* get_original() const { return original_func_; }
+
     void set_detour(Callback callback);
 
+    /**
+     * @brief Number of calls that entered this hook since it was created.
+     * @return 0 unless the hook was created with HookOptions::count_calls.
+     */
+    uint64_t call_count() const;
+
     /**
      * @brief Manually unhooks the function, restoring the original code.
      */
@@ -59,6 +114,15 @@ public:
      */
     bool disable();
 
+    /**
+     * @brief Whether this hook existed when ur::fork_safety marked hooks as inherited.
+     *
+     * An inherited hook keeps running, but its state may be shared with forked processes:
+     * enable() and disable() return false, set_detour() does nothing, and unhook() only
+     * restores the target when this is the last hook on it.
+     */
+    bool is_inherited() const;
+
     // This is for calling the original function from OUTSIDE the hook chain.
     template<typename Ret, typename... Args>
     Ret call_original(Args... args) const {
@@ -71,13 +135,140 @@ public:
     }
 
 private:
+    friend class HookBatch;
+
+    Hook() = default;
+
     void do_unhook();
     void reset();
 
     uintptr_t target_address_{0};
     Callback callback_{nullptr};
-    void* original_func_{nullptr}; // Points to the trampoline
+    void* original_func_{nullptr}; // This hook's dispatch link: jumps to the next enabled hook or the trampoline
     bool is_enabled_{false};
+    std::shared_ptr<HookInfo> info_; // Per-target state shared with the registry
+};
+
+/**
+ * @brief Result of check_patch_region().
+ */
+enum class PatchRegionStatus {
+    Safe,             // The region can be overwritten and relocated.
+    EndsFunction,     // A RET/BR/unconditional B ends the code before the region does;
+                      // the patch would spill into whatever follows.
+    BranchIntoRegion, // A branch inside the region targets the middle of the region,
+                      // which would land in the patched bytes.
+};
+
+/**
+ * @brief Checks whether the first `patch_size` bytes at `target` are safe to patch.
+ *
+ * Only the instructions covered by the patch are decoded, so a 4-byte patch
+ * costs a single decode. Branches from outside the region cannot be detected.
+ */
+PatchRegionStatus check_patch_region(uintptr_t target, size_t patch_size);
+
+/**
+ * @brief Enables the persistent trampoline cache in `directory`; an empty string disables it.
+ *
+ * For targets inside ELF modules with a build-id, the relocation plan of the overwritten
+ * instructions and the safe patch limit from function analysis are stored per module,
+ * keyed by build-id and function offset. On a warm start hooks on the same targets are
+ * installed by re-emitting the cached plans for the new addresses, without decoding or
+ * analysing the functions. A plan is only used while the target still holds the
+ * instructions it was built from. Results are written by flush_trampoline_cache(), when
+ * the directory changes and when the process exits.
+ */
+void set_trampoline_cache_directory(const std::string& directory);
+
+/**
+ * @brief Writes the new results of every open trampoline cache.
+ * @return false if any cache file could not be written.
+ */
+bool flush_trampoline_cache();
+
+/**
+ * @brief Options for HookBatch::commit().
+ */
+struct BatchOptions {
+    /**
+     * Patch the targets while every other thread of the process is suspended (see
+     * ur::thread_suspend::ScopedSuspend). A thread stopped inside the bytes a patch
+     * overwrites continues at the same point of the relocated copy in the trampoline, and
+     * so does a return address still held in LR. One suspension covers the whole batch.
+     * Return addresses already spilled to the stack are not rewritten, so a target whose
+     * patched bytes contain a BL is only safe when its callee is not running.
+     */
+    bool suspend_threads = false;
+
+    thread_suspend::SuspendOptions suspend;
+};
+
+/**
+ * @brief Installs many hooks as a single transaction.
+ *
+ * All trampolines and detour stubs are prepared first, then every target is
+ * patched in one pass: page protections are changed once per page and the
+ * instruction cache is flushed once for the whole batch. If any step fails,
+ * nothing from the batch stays installed.
+ */
+class HookBatch {
+public:
+    HookBatch() = default;
+    explicit HookBatch(const BatchOptions& options) : options_(options) {}
+
+    /**
+     * @brief Queues a hook to be installed (enabled) on commit().
+     * @return *this, so calls can be chained.
+     */
+    HookBatch& add(uintptr_t target, Hook::Callback callback, const HookOptions& options = {});
+
+    size_t size() const { return requests_.size(); }
+    bool empty() const { return requests_.empty(); }
+
+    /**
+     * @brief Builds the trampoline and detour stub of `target` ahead of a commit.
+     *
+     * This is the expensive part of installing a hook (decoding, near allocation and
+     * relocation). A later commit() or Hook on the same target reuses the result. Safe to
+     * call from any thread; targets in different registry shards are prepared in parallel.
+     *
+     * @throws std::invalid_argument if `target` is null.
+     * @throws std::runtime_error if the target cannot be relocated or memory cannot be allocated.
+     */
+    static void prepare(uintptr_t target);
+
+    /**
+     * @brief Installs all queued hooks and clears the queue.
+     *
+     * @return The installed hooks, in the order they were added.
+     * @throws std::invalid_argument if a queued target or callback is null.
+     * @throws std::runtime_error if preparation or patching fails, or the threads cannot be
+     *         suspended with BatchOptions::suspend_threads; all changes are rolled back.
+     */
+    std::vector<Hook> commit();
+
+    /**
+     * @brief Enables or disables existing hooks with one patch pass (BatchOptions apply).
+     *
+     * Chains and detour stubs are updated first; the targets that have to be patched or
+     * restored are then written together, with one suspension if requested. Null, invalid
+     * and inherited hooks, and hooks without a callback when enabling, are skipped and make
+     * the result false; hooks already in the requested state are left alone. If the
+     * patches cannot be written, every hook keeps its previous state.
+     *
+     * @return true if every hook is now in the requested state.
+     */
+    bool set_enabled(std::span<Hook* const> hooks, bool enabled) const;
+
+private:
+    struct Request {
+        uintptr_t target;
+        Hook::Callback callback;
+        HookOptions options;
+    };
+    std::vector<Request> requests_;
+    BatchOptions options_;
 };
 
 } // namespace ur::inline_hook
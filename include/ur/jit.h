@@ -2,28 +2,27 @@
 
 #include <vector>
 #include <utility>
-#include <sys/mman.h>
-#include <unistd.h>
 #include <cstring>
 #include <map>
 #include "ur/assembler.h"
+#include "ur/exec_pool.h"
 #include "ur/memory.h"
 
 namespace ur::jit {
 
+    // A position in the code of one Jit. References to a label that is not bound yet are
+    // recorded in the Jit's fixup table and resolved by finish().
     class Label {
     public:
-        Label() : id_(next_id_++) {}
-        bool is_bound() const { return bound_; }
+        Label() = default;
+        bool is_bound() const { return offset_ >= 0; }
         int32_t offset() const { return offset_; }
 
     private:
         friend class Jit;
-        static uint32_t next_id_;
-        uint32_t id_;
-        bool bound_{false};
+        static constexpr uint32_t kNoId = UINT32_MAX;
+        uint32_t id_{kNoId}; // Index into the owning Jit's label table, assigned on first use
         int32_t offset_{-1};
-        std::vector<uint32_t> references_; // Instruction offsets that refer to this label
     };
 
 
@@ -43,6 +42,8 @@ namespace ur::jit {
 
         // Unconditional branches
         void b(Label& label);
+        void bl(Label& label);
+        using ur::assembler::Assembler::bl;
 
         // Conditional branches
         void b(assembler::Condition cond, Label& label);
@@ -63,35 +64,122 @@ namespace ur::jit {
         void b_gt(Label& label) { b(assembler::Condition::GT, label); }
         void b_le(Label& label) { b(assembler::Condition::LE, label); }
 
+        // Compare/test and branch to a label
+        using ur::assembler::Assembler::cbz;
+        using ur::assembler::Assembler::cbnz;
+        using ur::assembler::Assembler::tbz;
+        using ur::assembler::Assembler::tbnz;
+        void cbz(assembler::Register rt, Label& label);
+        void cbnz(assembler::Register rt, Label& label);
+        void tbz(assembler::Register rt, uint32_t bit, Label& label);
+        void tbnz(assembler::Register rt, uint32_t bit, Label& label);
+
+        // PC-relative address and literal load of a label
+        using ur::assembler::Assembler::adr;
+        using ur::assembler::Assembler::ldr_literal;
+        void adr(assembler::Register rd, Label& label);
+        void ldr_literal(assembler::Register rt, Label& label);
+
+        // Conditional branches to a bound label that is out of range are emitted as the
+        // inverted branch over a B. Forward branches with a short range (B.cond, CBZ/CBNZ,
+        // TBZ/TBNZ) are redirected through a veneer when they would go out of range: at
+        // the next Jit-level call (bind(), any label or literal operation) that comes within
+        // kIslandMargin bytes of the limit, a branch over an island of veneers and the
+        // pending literal pool is emitted. ADR and LDR (literal) references have no veneer;
+        // finish() throws std::runtime_error if one cannot be encoded.
+        static constexpr size_t kIslandMargin = 4096;
+
+        // Literal pool
+        //
+        // ldr_constant() loads a 64-bit value (or its low 32 bits into a W register) with a
+        // single LDR (literal) from a pool of constants; equal values share one 8-byte slot.
+        // place_literal_pool() emits the pending constants at the current position, which
+        // must not be reachable by execution (e.g. right after a BR or RET); finalize()
+        // places whatever is left at the end of the code. Pool loads are relative to the
+        // generated code itself, so they stay valid wherever the code ends up.
+        void ldr_constant(assembler::Register rt, uint64_t value);
+        void place_literal_pool();
+        size_t pending_literals() const { return literals_.size(); }
+
+        // Places the pending literal pool and resolves every recorded label reference in a
+        // single pass. finalize() calls it; code that is copied out with get_code_span()
+        // must call it first. Throws std::runtime_error for unbound or unreachable labels.
+        void finish();
+
+        // Address materialization and far branches. A Jit constructed with a non-zero
+        // address is assumed to run at that address, and uses ADR, ADRP+ADD, B or BL when
+        // the destination is in range; such code must be copied to that address by the
+        // caller rather than finalize()d. Otherwise, and when out of range, these load the
+        // destination from the literal pool (scratch is clobbered by jump() and call()).
+        void load_address(assembler::Register rd, uintptr_t address);
+        void jump(uintptr_t destination, assembler::Register scratch = assembler::Register::X16);
+        void call(uintptr_t destination, assembler::Register scratch = assembler::Register::X16);
+
 
         template<typename T>
         T finalize(uintptr_t hint = 0) {
-            const auto& code = get_code();
+            finish();
+            const auto code = get_code_span();
             auto size = get_code_size();
             if (size == 0) {
                 return nullptr;
             }
 
-            long page_size = sysconf(_SC_PAGESIZE);
-            size_t aligned_size = (size + page_size - 1) & -page_size;
-
-            mem_ = mmap(reinterpret_cast<void*>(hint), aligned_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-            if (mem_ == MAP_FAILED) {
+            // Small blobs share pooled slabs; a hint prefers memory within branch range of it.
+            mem_ = hint ? exec_pool::allocate(size, hint) : nullptr;
+            if (mem_ == nullptr) {
+                mem_ = exec_pool::allocate(size);
+            }
+            if (mem_ == nullptr) {
                 return nullptr;
             }
-            size_ = aligned_size;
+            size_ = exec_pool::block_size(mem_);
 
-            std::memcpy(mem_, code.data(), size);
-            __builtin___clear_cache(reinterpret_cast<char*>(mem_), reinterpret_cast<char*>(mem_) + size);
+            // Pool memory is executed from a read-only view; the code is copied through its writable alias.
+            exec_pool::write_code(mem_, code.data(), size);
 
             return reinterpret_cast<T>(mem_);
         }
 
+        // Transfers ownership of the finalized code; free it with ur::exec_pool::free().
         void* release();
 
     private:
         void* mem_{nullptr};
         size_t size_{0};
-        std::map<uint32_t, Label*> label_patches_;
+
+        enum class FixupKind : uint8_t {
+            kBranch26,  // B, BL
+            kBranch19,  // B.cond, CBZ, CBNZ
+            kBranch14,  // TBZ, TBNZ
+            kLiteral19, // LDR (literal)
+            kAdr21,     // ADR
+        };
+
+        struct Fixup {
+            uint32_t offset; // Byte offset of the referencing instruction
+            uint32_t label;  // Index into label_offsets_
+            FixupKind kind;
+        };
+
+        uint32_t label_id(Label& label);
+        uint32_t new_label_id();
+        uintptr_t label_address(uint32_t id) const;
+        void add_fixup(uint32_t label, FixupKind kind);
+        size_t pending_deadline(size_t* veneers) const;
+        void check_island(size_t upcoming);
+        void place_island();
+
+        bool fixed_address_{false};
+        std::vector<int32_t> label_offsets_; // Code offset of each label, -1 while unbound
+        std::vector<Fixup> fixups_;          // References resolved by finish()
+        size_t next_deadline_{SIZE_MAX};     // Lower bound of the offset by which a pending reference must be placed
+
+        struct Literal {
+            uint64_t value;
+            uint32_t label; // Bound to the slot when the pool is placed
+        };
+        std::vector<Literal> literals_;              // Pending pool, placed by place_literal_pool()
+        std::map<uint64_t, uint32_t> literal_index_; // Value -> index into literals_
     };
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <cstdint>
 #include "elf_parser.h"
 
@@ -12,6 +14,8 @@ namespace ur::maps_parser {
     public:
         MapInfo(std::uintptr_t start, std::uintptr_t end, std::string perms, std::size_t offset, std::string path);
 
+        // 每个 MapInfo 独占的解析器，可以对其调用 enable_symbol_cache()；
+        // 只做查找时用 ur::module_registry::get() 共享的解析器
         elf_parser::ElfParser* get_elf_parser() const;
 
         [[nodiscard]] std::uintptr_t get_start() const;
@@ -36,4 +40,70 @@ namespace ur::maps_parser {
         static const MapInfo* find_map_by_addr(const std::vector<MapInfo>& maps, std::uintptr_t addr);
     };
 
+    // A single line of /proc/self/maps. `path` points into the owning MapsSnapshot.
+    struct MapEntry {
+        std::uintptr_t start = 0;
+        std::uintptr_t end = 0;
+        std::uintptr_t offset = 0;
+        int prot = 0;              // PROT_READ / PROT_WRITE / PROT_EXEC bits
+        bool is_private = false;   // 'p' (copy-on-write) vs 's' (shared)
+        char perms[5] = {};        // e.g. "r-xp"
+        std::string_view path;
+
+        [[nodiscard]] bool contains(std::uintptr_t addr) const { return addr >= start && addr < end; }
+    };
+
+    // Immutable, indexed snapshot of /proc/self/maps.
+    //
+    // The file is read with plain read() calls into one buffer and parsed in
+    // place; paths are views into that buffer. Address lookups are a binary
+    // search over the (kernel-sorted) entries and path lookups go through a
+    // hash index. A process-wide snapshot is shared by memory and plthook;
+    // call invalidate() or refresh() after the address space changes.
+    class MapsSnapshot {
+    public:
+        // Parses the given maps text (mainly for tests and offline use).
+        explicit MapsSnapshot(std::string contents);
+
+        // Entries hold views into m_buffer, so snapshots are shared, never copied.
+        MapsSnapshot(const MapsSnapshot&) = delete;
+        MapsSnapshot& operator=(const MapsSnapshot&) = delete;
+
+        // Reads /proc/self/maps now. Returns an empty snapshot if it cannot be read.
+        static std::shared_ptr<const MapsSnapshot> capture();
+
+        // Returns the shared snapshot, capturing it first if there is none.
+        static std::shared_ptr<const MapsSnapshot> current();
+
+        // Captures a new shared snapshot and returns it.
+        static std::shared_ptr<const MapsSnapshot> refresh();
+
+        // Drops the shared snapshot; the next current() re-reads /proc/self/maps.
+        static void invalidate();
+
+        [[nodiscard]] const std::vector<MapEntry>& entries() const { return m_entries; }
+        [[nodiscard]] std::size_t size() const { return m_entries.size(); }
+        [[nodiscard]] bool empty() const { return m_entries.empty(); }
+
+        // O(log n): the mapping containing addr, or nullptr.
+        [[nodiscard]] const MapEntry* find_by_addr(std::uintptr_t addr) const;
+
+        // O(1): the lowest mapping whose path equals `path` exactly, or nullptr.
+        [[nodiscard]] const MapEntry* find_by_path(std::string_view path) const;
+
+        // All mappings whose path equals `path` exactly, in address order.
+        [[nodiscard]] std::vector<const MapEntry*> find_all_by_path(std::string_view path) const;
+
+        // Start of the unmapped, `alignment`-aligned range of `size` bytes closest to `near`
+        // that lies entirely within `max_distance` of it, or 0 if no hole between two
+        // mappings fits. Only as current as the snapshot; map it with MAP_FIXED_NOREPLACE.
+        [[nodiscard]] std::uintptr_t find_gap(std::uintptr_t near, std::size_t size, std::size_t max_distance,
+                                              std::size_t alignment) const;
+
+    private:
+        std::string m_buffer;
+        std::vector<MapEntry> m_entries;
+        std::unordered_map<std::string_view, std::vector<std::size_t>> m_path_index;
+    };
+
 }
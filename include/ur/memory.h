@@ -1,7 +1,11 @@
 #pragma once
 
+#include "ur/cache_maintenance.h"
 #include <cstdint>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 #include <sys/uio.h> // For process_vm_writev
 
 namespace ur {
@@ -23,13 +27,73 @@ namespace ur {
         // 写入内存
         bool write(uintptr_t address, const void* buffer, size_t size);
 
+        // 容错的读写：地址未映射或没有相应权限时返回 false，而不是触发 SIGSEGV。
+        // 通过对自身进程的 process_vm_readv / process_vm_writev 完成，不解析 maps；
+        // 系统调用不可用（如被 seccomp 拦截）时，读取改为经管道 write() 由内核探测源地址，
+        // 无法创建管道则返回 false；写入退回到 maps 快照检查加 memcpy。
+        // 写入遵守页保护属性，只读的代码页应使用 atomic_patch。
+        bool safe_read(uintptr_t address, void* buffer, size_t size);
+        bool safe_write(uintptr_t address, const void* buffer, size_t size);
+
+        // 向量化读写的一项，ok 记录该项是否完整传输
+        struct ReadRequest {
+            uintptr_t address = 0;
+            void* buffer = nullptr;
+            size_t size = 0;
+            bool ok = false;
+        };
+
+        struct WriteRequest {
+            uintptr_t address = 0;
+            const void* data = nullptr;
+            size_t size = 0;
+            bool ok = false;
+        };
+
+        // 每次系统调用最多携带的请求数
+        inline constexpr size_t kMaxIovecs = 256;
+
+        // 批量读写：多个请求合并进同一次系统调用，某项失败时跳过该项继续传输其余项。
+        // 返回成功的请求数。
+        size_t read_many(std::span<ReadRequest> requests);
+        size_t write_many(std::span<WriteRequest> requests);
+
         // 修改内存保护
         bool protect(uintptr_t address, size_t size, int prot);
 
-        // 刷新指令缓存
+        // 刷新指令缓存，见 cache_maintenance::sync_code
         void flush_instruction_cache(uintptr_t address, size_t size);
 
         // 原子地写入内存补丁
         bool atomic_patch(uintptr_t address, const uint8_t* patch_code, size_t patch_size);
+
+        // 批量补丁中的一项
+        struct PatchRequest {
+            uintptr_t address = 0;
+            const uint8_t* code = nullptr;
+            size_t size = 0;
+        };
+
+        // 批量写入补丁：每个页只修改一次保护属性，全部写入后统一刷新一次指令缓存。
+        // 任一页的保护属性修改失败时不写入任何补丁并返回 false。
+        bool batch_patch(const std::vector<PatchRequest>& patches);
+
+        // 预先解析好的批量补丁：页区间已合并，池内目标已换成可写别名
+        struct PatchPlan {
+            struct Write {
+                uintptr_t address = 0;       // 执行地址，用于刷新指令缓存
+                uintptr_t write_address = 0; // 实际写入的地址
+                const uint8_t* code = nullptr;
+                size_t size = 0;
+            };
+            std::vector<Write> writes;
+            std::vector<std::pair<uintptr_t, uintptr_t>> ranges; // 需要修改保护属性的页区间
+            cache_maintenance::Batch cache; // 所有写入区间，已合并，apply 时一次同步
+        };
+
+        // batch_patch 拆成两步：plan_batch_patch 完成所有内存分配与加锁的查询，
+        // apply_patch_plan 只调用 mprotect、写入与缓存维护，可以在其他线程被挂起时执行。
+        PatchPlan plan_batch_patch(const std::vector<PatchRequest>& patches);
+        bool apply_patch_plan(const PatchPlan& plan);
     }
 }
@@ -10,18 +10,56 @@ namespace ur::inline_hook {
 class Hook;
 }
 
+namespace ur::hook_stats {
+class Counter;
+}
+
 namespace ur::mid_hook {
 
 /**
- * @brief Represents the CPU context (general-purpose registers) at the time of the hook.
- * The layout is x0-x28, fp(x29), lr(x30).
+ * @brief Represents the CPU context at the time of the hook.
+ * The GPR layout is x0-x28, fp(x29), lr(x30). Only the state selected by
+ * MidHookOptions is captured; other fields hold unspecified values and
+ * writes to them are ignored.
  */
 struct CpuContext {
     uint64_t gpr[32];
+    uint64_t nzcv;          // Valid when MidHookOptions::save_flags is set
+    uint64_t reserved;
+    __uint128_t simd[32];   // q0-q31, valid when MidHookOptions::save_simd is set
 };
 
 using Callback = void (*)(CpuContext* context);
 
+/**
+ * @brief Selects which state the mid-hook detour saves into the CpuContext.
+ *
+ * Registers the callback may clobber under AAPCS64 (x0-x18 and lr) are always
+ * saved and restored, whatever the mask says; the mask only decides whether
+ * the callee-saved registers x19-x29 are captured as well.
+ */
+struct MidHookOptions {
+    static constexpr uint32_t kAllGprs = 0x7FFFFFFF;     // x0-x30
+    static constexpr uint32_t kArgumentGprs = 0x000000FF; // x0-x7
+    static constexpr uint32_t kCallerSavedGprs = 0x4007FFFF; // x0-x18, lr
+
+    uint32_t gpr_mask = kAllGprs; // Bit n selects xn
+    bool save_flags = false;      // Save and restore NZCV
+    bool save_simd = false;       // Save and restore q0-q31 (set this if the callback uses FP/NEON)
+    // Skip the callback while the thread is inside a guarded detour (see ur::recursion_guard),
+    // and mark the thread as such while the callback runs.
+    bool recursion_guard = false;
+    // Count the hits in a sharded counter (see ur::hook_stats), read with MidHook::call_count().
+    bool count_calls = false;
+
+    // Fast variant for callbacks that only look at the argument registers x0-x7.
+    static MidHookOptions arguments_only() {
+        MidHookOptions options;
+        options.gpr_mask = kArgumentGprs;
+        return options;
+    }
+};
+
 /**
  * @brief A class for creating a hook in the middle of a function (Mid-Hook).
  *
@@ -36,10 +74,11 @@ public:
      * @brief Constructs a MidHook.
      * @param target The address within a function to hook.
      * @param callback The callback function to be executed when the hook is hit.
+     * @param options The state the detour saves for the callback.
      * @throws std::invalid_argument if target or callback are null.
      * @throws std::runtime_error if memory operations or hooking fail.
      */
-    MidHook(uintptr_t target, Callback callback);
+    MidHook(uintptr_t target, Callback callback, const MidHookOptions& options = {});
 
     /**
      * @brief Destructor that automatically unhooks.
@@ -77,6 +116,12 @@ public:
      */
     bool disable();
 
+    /**
+     * @brief Number of times the hook was hit since it was created.
+     * @return 0 unless the hook was created with MidHookOptions::count_calls.
+     */
+    uint64_t call_count() const;
+
 private:
     void reset();
     static void dummy_callback(void*);
@@ -88,6 +133,9 @@ private:
     std::optional<ur::jit::Jit> detour_jit_;
     void* detour_{nullptr};
 
+    // Incremented by the detour when MidHookOptions::count_calls is set.
+    hook_stats::Counter* counter_{nullptr};
+
     // The underlying inline hook that redirects the target to our detour.
     std::unique_ptr<ur::inline_hook::Hook> inline_hook_;
 };
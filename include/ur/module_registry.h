@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ur/elf_parser.h"
+
+namespace ur::module_registry {
+
+    /**
+     * @brief 返回装载在 base_address 的 ELF 模块的进程级共享解析器。
+     *
+     * 每个模块在进程内只解析一次：第一次请求时按 maps 快照中的路径与偏移创建解析器
+     * （路径为绝对路径时允许回退到磁盘文件读取 .symtab），之后所有调用者共享同一个对象，
+     * 包括其动态段、哈希表以及惰性建立的 .symtab 与函数索引。plthook 与 function_analysis
+     * 都从这里取得解析器；MapInfo::get_elf_parser() 返回的是独占的解析器。
+     *
+     * 每次调用会检查装载器的卸载计数（dl_iterate_phdr 的 dlpi_subs），有模块被 dlclose
+     * 后丢弃已不在装载列表中的条目；基址被路径不同的新模块复用时重新解析。
+     * 已取得的 shared_ptr 在条目被丢弃后仍然有效，但其中指向模块内存的数据随模块一起失效。
+     *
+     * 返回的解析器可以在多个线程中同时查找；parse() 与 enable_symbol_cache() 会修改解析器，
+     * 不能在共享的对象上调用。
+     *
+     * @return 解析失败（不是 ELF 起始地址等）时返回 nullptr，失败不会被缓存。
+     */
+    std::shared_ptr<elf_parser::ElfParser> get(uintptr_t base_address);
+
+    // 丢弃某个模块的条目，下一次 get() 重新解析
+    void invalidate(uintptr_t base_address);
+
+    // 丢弃所有条目
+    void clear();
+
+    // 当前缓存的模块数量
+    std::size_t size();
+
+    // dl_iterate_phdr 报告的一个已装载模块。base 为装载偏移 + 最小 PT_LOAD 虚拟地址，
+    // 与 dladdr 的 dli_fbase 及 ElfParser 的 load bias 一致；主程序的 path 可能为空
+    struct LoadedModule {
+        uintptr_t base = 0;
+        std::string path;
+    };
+
+    struct LoadedModules {
+        std::vector<LoadedModule> modules;
+        // 装载器的装载/卸载计数（dlpi_adds/dlpi_subs），与 modules 取自同一次遍历
+        unsigned long long adds = 0;
+        unsigned long long subs = 0;
+        bool has_counters = false; // 装载器不提供计数时为 false
+    };
+
+    /**
+     * @brief 枚举当前装载的所有模块。
+     *
+     * bionic 的 dl_iterate_phdr 在回调期间持有装载器锁，而 dlopen 在同一把锁下运行库的构造函数，
+     * 构造函数又可能进入 urhook。因此不能在持有任何 urhook 内部锁时调用：先在锁外取得列表，
+     * 再加锁与缓存合并。
+     */
+    LoadedModules enumerate_loaded();
+
+    // 只读取装载器的计数，不遍历模块，调用约束与 enumerate_loaded() 相同。装载器不提供计数时返回 false
+    bool read_loader_counters(unsigned long long& adds, unsigned long long& subs);
+}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <span>
+#include <vector>
 #include <unordered_map>
 #include <mutex>
 #include <memory>
@@ -9,6 +12,7 @@
 #include "ur/elf_parser.h"
 #include "ur/maps_parser.h"
 #include "ur/memory.h"
+#include "ur/hook_stats.h"
 
 namespace ur::plthook {
 
@@ -22,29 +26,72 @@ public:
 
     // 安装符号 Hook：将符号的 GOT 指针替换为 replacement
     // original_out 输出原始函数指针（GOT 原值），可用于直接调用原始实现
-    bool hook_symbol(const std::string& symbol, void* replacement, void** original_out);
+    // count_calls 为 true 时 GOT 指向一个先计数再跳转到 replacement 的 thunk（见 ur::hook_stats），
+    // 计数一旦开启，对该符号的后续 Hook 保持开启
+    bool hook_symbol(const std::string& symbol, void* replacement, void** original_out, bool count_calls = false);
 
     // 卸载指定符号 Hook，恢复 GOT 原始值
     bool unhook_symbol(const std::string& symbol);
 
+    // 批量 Hook 中的一项
+    struct SymbolHook {
+        std::string symbol;
+        void* replacement = nullptr;
+        void** original_out = nullptr; // 可为空
+        bool count_calls = false;      // 同 hook_symbol 的 count_calls
+    };
+
+    // 批量安装符号 Hook：所有 GOT 写入按页合并，每个 GOT 页只修改一次保护属性。
+    // 未找到的符号和无效项会被跳过（其 original_out 不会被写入）。
+    // 返回成功安装的数量。
+    size_t hook_symbols(std::span<const SymbolHook> hooks);
+
+    // 批量卸载符号 Hook，GOT 写回同样按页合并。未安装的符号被跳过，返回成功卸载的数量
+    size_t unhook_symbols(std::span<const std::string> symbols);
+
     struct Entry {
         std::string symbol;
         uintptr_t got_addr = 0;
         void* original = nullptr;
         void* replacement = nullptr;
+        hook_stats::CountingThunk counter; // 开启计数时 GOT 指向 counter.code
+
+        // 开启计数后经过 GOT 的调用次数，未开启时为 0
+        uint64_t call_count() const { return counter.counter ? counter.counter->calls() : 0; }
+        // 当前写入 GOT 的值
+        void* installed() const { return counter.code ? counter.code : replacement; }
     };
 
     const Entry* get_entry(const std::string& symbol) const;
 
+    // 丢弃所有 Hook 记录但不写回 GOT，用于模块已被卸载、GOT 不可再访问的情况
+    void detach();
+
 private:
+    struct GotWrite {
+        uintptr_t got_addr = 0;
+        void* value = nullptr;
+        bool written = false;
+    };
+
     bool parse_elf();
-    bool write_got(uintptr_t got_addr, void* value, void** previous);
+    bool build_got_index();
+    uintptr_t find_got(std::string_view symbol) const;
+    // 按页分组写入 GOT：每页只查询一次映射权限；页已可写时不修改保护属性，
+    // 否则只切换为可写并恢复各一次。结果记录在各项的 written 中
+    void write_gots(std::vector<GotWrite>& writes);
+    // 释放条目的计数 thunk 并移除条目
+    void erase_entry(std::unordered_map<std::string, Entry>::iterator it);
 
     uintptr_t base_ = 0;
-    std::unique_ptr<elf_parser::ElfParser> elf_;
+    std::shared_ptr<elf_parser::ElfParser> elf_; // 由 ur::module_registry 共享
     bool parsed_ = false;
 
     std::unordered_map<std::string, Entry> entries_;
+
+    // 符号名 -> GOT 条目地址，首次使用时从 JUMP_SLOT 重定位表构建一次；键指向模块内的 dynstr
+    std::unordered_map<std::string_view, uintptr_t> got_index_;
+    bool got_index_built_ = false;
     mutable std::mutex mutex_;
 };
 
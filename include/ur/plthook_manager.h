@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ur/plthook.h"
+
+namespace ur::plthook {
+
+// 进程级 PLT Hook 管理器：一次枚举所有已加载的 ELF 模块，每个模块缓存一个 plthook::Hook
+// （及其 ElfParser 与 GOT 索引），将同一个符号 Hook 应用到所有导入它的模块。
+class Manager {
+public:
+    static Manager& instance();
+
+    Manager(const Manager&) = delete;
+    Manager& operator=(const Manager&) = delete;
+
+    // 重新枚举已加载模块（dl_iterate_phdr）：丢弃已卸载的模块，为新模块应用所有已注册的 Hook。
+    // 枚举与解析新模块时不持有管理器锁，可以在 dlopen 代理中调用。返回新发现的模块数量
+    size_t refresh();
+
+    // 在所有导入该符号的模块中安装 Hook，模块较多时并行处理。
+    // original_out 输出第一个被修改模块的 GOT 原值。返回被修改的模块数量
+    size_t hook_symbol(const std::string& symbol, void* replacement, void** original_out = nullptr);
+
+    // 在所有模块中卸载该符号的 Hook，并停止对新模块应用
+    bool unhook_symbol(const std::string& symbol);
+
+    // Hook 所有模块的 dlopen / android_dlopen_ext，之后加载的库会自动应用已注册的 Hook
+    bool enable_auto_apply();
+    void disable_auto_apply();
+    bool is_auto_apply_enabled() const;
+
+    size_t module_count() const;
+
+private:
+    Manager() = default;
+
+    struct Module {
+        uintptr_t base = 0;
+        std::string path;
+        std::unique_ptr<Hook> hook;
+    };
+
+    std::vector<Module*> sorted_modules_locked();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uintptr_t, Module> modules_;   // 基址 -> 模块
+    std::unordered_map<std::string, void*> symbols_;  // 已注册的符号 -> replacement
+    // dl_iterate_phdr 的装载/卸载计数，未变化时 refresh() 无需重新解析
+    unsigned long long loader_adds_ = 0;
+    unsigned long long loader_subs_ = 0;
+    bool enumerated_ = false;
+    bool auto_apply_ = false;
+};
+
+} // namespace ur::plthook
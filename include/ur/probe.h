@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include "ur/jit.h"
+
+namespace ur::inline_hook {
+class Hook;
+}
+
+namespace ur::probe {
+
+constexpr size_t kMaxRegisters = 6;
+constexpr size_t kRingBits = 12;
+constexpr size_t kRingCapacity = size_t{1} << kRingBits; // Records per thread
+
+/**
+ * @brief One probe hit, exactly one cache line.
+ *
+ * `registers` holds the registers selected by ProbeOptions::register_mask in ascending
+ * order (lowest register first); the remaining entries are zero.
+ */
+struct alignas(64) Record {
+    uint64_t pc;        // Address of the probe
+    uint64_t timestamp; // CNTVCT_EL0 at the hit, see timer_frequency()
+    uint64_t registers[kMaxRegisters];
+};
+
+struct ProbeOptions {
+    static constexpr uint32_t kArgumentRegisters = 0x0000003F; // x0-x5
+
+    // Bit n records xn (x0-x30); at most kMaxRegisters bits may be set.
+    uint32_t register_mask = kArgumentRegisters;
+};
+
+/**
+ * @brief The records a drain() pass took from one thread's ring.
+ *
+ * `records` points into the ring and is only valid during the consumer call.
+ */
+struct Batch {
+    uint32_t thread_id;
+    std::span<const Record> records;
+};
+
+using Consumer = std::function<void(const Batch& batch)>;
+
+/**
+ * @brief A mid-function hook that records hits instead of calling user code.
+ *
+ * Like ur::mid_hook::MidHook, the probe routes an address to a JIT-generated detour
+ * and continues through the inline hook trampoline. The detour does not save a full
+ * CpuContext and calls nothing: it reads CNTVCT_EL0, finds the calling thread's ring
+ * through a table indexed by a hash of TPIDR_EL0 and appends a Record with plain
+ * stores, touching six scratch registers that it spills and restores, and neither
+ * the flags nor the SIMD registers.
+ *
+ * Each thread owns a single-producer ring of kRingCapacity records; drain() is the
+ * only consumer. A hit that finds the ring full is dropped and counted. The first hit
+ * of a thread, or one whose table slot is taken by another thread, takes a slow path
+ * that saves the whole register file and appends from C++ (registering the ring on
+ * the way). The slow path does not call the memory allocator, since rings are mapped
+ * with mmap, so allocator functions can be probed.
+ */
+class Probe {
+public:
+    /**
+     * @brief Constructs a Probe.
+     * @param address The instruction to probe.
+     * @param options The registers each record captures.
+     * @throws std::invalid_argument if address is null or the mask selects more than kMaxRegisters registers or sp.
+     * @throws std::runtime_error if memory operations or hooking fail.
+     */
+    explicit Probe(uintptr_t address, const ProbeOptions& options = {});
+    ~Probe();
+
+    Probe(const Probe&) = delete;
+    Probe& operator=(const Probe&) = delete;
+
+    Probe(Probe&& other) noexcept;
+    Probe& operator=(Probe&& other) noexcept;
+
+    bool is_valid() const;
+    void unhook();
+    bool enable();
+    bool disable();
+
+    // Address recorded as Record::pc.
+    uintptr_t address() const { return address_; }
+
+private:
+    struct Site;
+
+    uintptr_t address_ = 0;
+    std::unique_ptr<Site> site_;
+    std::unique_ptr<ur::jit::Jit> detour_jit_;
+    std::unique_ptr<ur::inline_hook::Hook> inline_hook_;
+};
+
+/**
+ * @brief Hands every recorded hit to `consumer`, one batch per thread ring.
+ *
+ * A ring that wrapped is passed as two batches. Records within a batch are in hit
+ * order; batches of different threads are not ordered with each other. The probes keep
+ * recording while a drain runs; concurrent drain() calls are serialized. Rings of
+ * threads that exited are freed once they are drained.
+ *
+ * @param max_records Upper bound on the records taken in this call.
+ * @return The number of records passed to `consumer`.
+ */
+size_t drain(const Consumer& consumer, size_t max_records = SIZE_MAX);
+
+// Hits lost so far because a ring was full (or its thread was exiting).
+uint64_t dropped();
+
+// Frequency of the CNTVCT_EL0 counter in Hz (CNTFRQ_EL0).
+uint64_t timer_frequency();
+
+// Reads CNTVCT_EL0, for timestamps comparable with Record::timestamp.
+uint64_t now();
+
+} // namespace ur::probe
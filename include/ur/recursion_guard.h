@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ur/jit.h"
+
+namespace ur::recursion_guard {
+
+/**
+ * @brief The per-thread guard word shared by all guarded detours.
+ *
+ * Every thread has one word at the same offset from TPIDR_EL0, so generated code
+ * reaches it with an MRS and a load, without __tls_get_addr. It is 0 while the thread
+ * runs no guarded detour; inside one it holds a non-zero value (the return address
+ * saved by an inline hook guard, 1 for a mid-hook or a Scope), and every guarded
+ * detour entered meanwhile is bypassed.
+ *
+ * On Android the word is bionic's TLS_SLOT_APP slot of the thread control block;
+ * elsewhere it is an initial-exec thread_local of this library.
+ */
+
+// Offset of the guard word from TPIDR_EL0; identical on every thread.
+intptr_t thread_offset();
+
+// True while the calling thread is inside a guarded detour or a Scope.
+bool active();
+
+/**
+ * @brief Emits code that points `base` at the calling thread's guard word area.
+ *
+ * After the emitted MRS (plus an ADD/SUB when the offset is too large for a load),
+ * the guard word is at [base, #returned displacement]. Only `base` is written.
+ */
+int32_t emit_guard_base(jit::Jit& jit, assembler::Register base);
+
+/**
+ * @brief Marks the calling thread as inside a guarded detour for the scope's lifetime.
+ *
+ * Guarded hooks hit inside the scope run the original function directly. Nested
+ * scopes, and scopes opened inside a guarded detour, leave the word untouched.
+ */
+class Scope {
+public:
+    Scope();
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    bool owner_ = false;
+};
+
+} // namespace ur::recursion_guard
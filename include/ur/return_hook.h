@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "ur/jit.h"
+
+namespace ur::inline_hook {
+class Hook;
+}
+
+namespace ur::return_hook {
+
+/**
+ * @brief Register state passed to the entry and exit callbacks.
+ *
+ * On entry gpr holds the arguments (x0-x7, and x8 for an indirect result); on exit it
+ * holds the return value (x0-x1, or x0-x7 for a composite). Changes to gpr and simd are
+ * written back to the registers when the callback returns.
+ */
+struct CallFrame {
+    uint64_t gpr[9];             // x0-x8
+    uint64_t return_address;     // Where the function returns to; may be changed on exit
+    uint64_t sp;                 // SP at function entry (equal to SP after it returns)
+    uint64_t reserved;
+    __uint128_t simd[8];         // q0-q7
+};
+
+// The value returned by the entry callback is passed to the exit callback of the same call.
+using EnterCallback = uint64_t (*)(CallFrame* frame, void* user_data);
+using LeaveCallback = void (*)(CallFrame* frame, uint64_t cookie, void* user_data);
+
+/**
+ * @brief Calls a callback when a function is entered and another when it returns.
+ *
+ * The target is hooked with a JIT-generated entry stub that saves the argument registers,
+ * runs the entry callback and pushes the caller's return address onto a per-thread shadow
+ * stack. It then sets LR to a shared exit thunk and jumps to the original function, so
+ * the function runs on the caller's stack frame, stack arguments and tail calls included.
+ * When it returns, the exit thunk pops the shadow stack, runs the exit callback and
+ * returns to the real caller.
+ *
+ * The shadow stack is a fixed array of kMaxDepth entries per thread, touched only by its
+ * own thread. A call made while it is full runs the entry callback but no exit callback,
+ * and is counted in dropped(). A return is matched to the innermost entry with the same
+ * SP, so calls on other stacks (sigaltstack handlers) nest correctly; entries above the
+ * match belong to calls skipped by longjmp and are discarded. C++ exceptions must not
+ * propagate out of a hooked function, since the unwinder cannot step through the exit thunk.
+ *
+ * Calls still in flight when the hook is removed return through the exit thunk and run
+ * the exit callback they were entered with.
+ */
+class ReturnHook {
+public:
+    static constexpr size_t kMaxDepth = 128;
+
+    /**
+     * @brief Constructs a ReturnHook.
+     * @param target The function to hook.
+     * @param on_enter Called on entry; may be null.
+     * @param on_leave Called on return; may be null, in which case LR is left alone.
+     * @param user_data Passed to both callbacks.
+     * @throws std::invalid_argument if target is null or both callbacks are null.
+     * @throws std::runtime_error if memory operations or hooking fail.
+     */
+    ReturnHook(uintptr_t target, EnterCallback on_enter, LeaveCallback on_leave, void* user_data = nullptr);
+    ~ReturnHook();
+
+    ReturnHook(const ReturnHook&) = delete;
+    ReturnHook& operator=(const ReturnHook&) = delete;
+
+    ReturnHook(ReturnHook&& other) noexcept;
+    ReturnHook& operator=(ReturnHook&& other) noexcept;
+
+    bool is_valid() const;
+    void unhook();
+    bool enable();
+    bool disable();
+
+    // Number of hooked calls the calling thread is currently inside.
+    static size_t depth();
+
+    // Number of calls, across all threads, whose exit was not tracked because the shadow stack was full.
+    static uint64_t dropped();
+
+private:
+    struct State;
+
+    std::unique_ptr<State> state_;
+    std::unique_ptr<ur::jit::Jit> entry_jit_;
+    std::unique_ptr<ur::inline_hook::Hook> inline_hook_;
+};
+
+} // namespace ur::return_hook
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ur/disassembler.h"
+#include "ur/inline_hook.h"
+
+namespace ur::scanner {
+
+/**
+ * @brief A byte signature with per-byte wildcards.
+ *
+ * IDA-style text form: hex bytes separated by spaces, `?` or `??` for a wildcard byte,
+ * e.g. "FD 7B BF A9 ?? ?? 00 94". Candidates are located with a SIMD search for one
+ * fixed "anchor" byte (preferring bytes that are uncommon in AArch64 code), so at
+ * least one byte must be fixed.
+ */
+class Pattern {
+public:
+    /**
+     * @throws std::invalid_argument if the text is malformed or contains only wildcards.
+     */
+    explicit Pattern(std::string_view ida_pattern);
+
+    /**
+     * @brief Builds a pattern from raw bytes; a zero mask byte marks a wildcard.
+     * @throws std::invalid_argument on size mismatch or if every byte is a wildcard.
+     */
+    Pattern(std::span<const uint8_t> bytes, std::span<const uint8_t> mask);
+
+    size_t size() const { return bytes_.size(); }
+    std::span<const uint8_t> bytes() const { return bytes_; }
+    std::span<const uint8_t> mask() const { return mask_; } // 0xFF = fixed, 0x00 = wildcard
+
+    // Index of the fixed byte used to find candidate positions.
+    size_t anchor() const { return anchor_; }
+
+    // Returns true if the pattern matches the bytes at `data` (at least size() bytes).
+    bool matches(const uint8_t* data) const;
+
+private:
+    void choose_anchor();
+
+    std::vector<uint8_t> bytes_;
+    std::vector<uint8_t> mask_;
+    size_t anchor_ = 0;
+};
+
+/**
+ * @brief An instruction-level signature matched through the built-in disassembler.
+ *
+ * Text form: instructions separated by `;` (or newlines), each a mnemonic followed by
+ * comma-separated operands, e.g. "ADRP x?, *; ADD x?, x?, #*; BL *". Operand tokens:
+ *   `*`                 any operand
+ *   `x?` `w?` `s?` ...  any register of that class; `x3`, `sp`, `lr` match one register
+ *   `#*` / `#0x10`      any / one immediate (branch and ADR/ADRP targets are absolute)
+ *   `[x?, #*]`          memory operand, base register and optional displacement
+ * A lone `*` or `?` in place of an instruction matches any word. Operands the pattern
+ * does not list are not checked, so "MOVZ x0, #1" ignores the shift operand.
+ *
+ * The text is compiled once into one step per instruction. Every step carries 32-bit
+ * mask/value filters derived from the encodings of its mnemonic, so most words are
+ * rejected with a single AND/compare and only survivors are decoded. The scan walks
+ * the step with the most selective filter and checks the remaining steps around it.
+ */
+class InsnPattern {
+public:
+    struct WordFilter {
+        uint32_t mask = 0;
+        uint32_t value = 0;
+    };
+
+    struct Operand {
+        enum class Kind : uint8_t { ANY, REG_CLASS, REG, ANY_IMM, IMM, MEM };
+        Kind kind = Kind::ANY;
+        assembler::Register reg = assembler::Register::INVALID; // REG, or first register of REG_CLASS
+        int64_t imm = 0;                                        // IMM
+        // MEM: base is matched like a register operand (ANY, REG_CLASS or REG)
+        Kind base_kind = Kind::ANY;
+        assembler::Register base = assembler::Register::INVALID;
+        bool any_displacement = true;
+        int32_t displacement = 0;
+    };
+
+    struct Step {
+        static constexpr size_t kMaxIds = 3;
+        static constexpr size_t kMaxFilters = 6;
+
+        disassembler::InstructionId ids[kMaxIds] = {};
+        uint8_t id_count = 0;            // 0: wildcard, matches any word
+        bool any_condition = true;       // B.cond only
+        assembler::Condition condition = assembler::Condition::AL;
+        WordFilter filters[kMaxFilters]; // a word must satisfy at least one
+        uint8_t filter_count = 0;        // 0: no prefilter, always decode
+        std::vector<Operand> operands;
+    };
+
+    /**
+     * @throws std::invalid_argument on an unknown mnemonic, a malformed operand or an empty pattern.
+     */
+    explicit InsnPattern(std::string_view text);
+
+    // Number of instructions; the pattern covers size() * 4 bytes.
+    size_t size() const { return steps_.size(); }
+    size_t byte_size() const { return steps_.size() * 4; }
+    const std::vector<Step>& steps() const { return steps_; }
+
+    // Index of the step used to find candidate positions.
+    size_t anchor() const { return anchor_; }
+
+    // Returns true if the size() words at `words` match; `address` is where words[0] executes.
+    bool matches(uint64_t address, const uint32_t* words) const;
+
+private:
+    std::vector<Step> steps_;
+    size_t anchor_ = 0;
+};
+
+struct ScanOptions {
+    // Only scan mappings whose path contains this substring (empty = every r-x mapping).
+    std::string module;
+    // Worker threads; 0 uses std::thread::hardware_concurrency().
+    unsigned threads = 0;
+    // Stop after this many matches (0 = unlimited); returns the lowest-addressed ones.
+    size_t max_matches = 0;
+};
+
+/**
+ * @brief Scans [start, start + size) and returns the addresses of all matches in order.
+ */
+std::vector<uintptr_t> scan(uintptr_t start, size_t size, const Pattern& pattern);
+
+// Instruction-level scan; only 4-byte aligned addresses inside the range are considered.
+std::vector<uintptr_t> scan(uintptr_t start, size_t size, const InsnPattern& pattern);
+
+/**
+ * @brief Scans every readable and executable mapping of the process.
+ *
+ * Regions are taken from a freshly refreshed maps snapshot, without urhook's own
+ * exec_pool memory (trampolines copy the start of hooked functions), split into
+ * chunks and scanned in parallel. Matches are returned sorted by address.
+ */
+std::vector<uintptr_t> scan_executable(const Pattern& pattern, const ScanOptions& options = {});
+std::vector<uintptr_t> scan_executable(const InsnPattern& pattern, const ScanOptions& options = {});
+
+/**
+ * @brief Finds exactly one match of `pattern` and hooks `match + offset`.
+ *
+ * @throws std::runtime_error if the pattern matches nothing or more than one location.
+ */
+inline_hook::Hook hook_pattern(const Pattern& pattern, inline_hook::Hook::Callback callback,
+                               const ScanOptions& options = {}, ptrdiff_t offset = 0,
+                               const inline_hook::HookOptions& hook_options = {});
+inline_hook::Hook hook_pattern(const InsnPattern& pattern, inline_hook::Hook::Callback callback,
+                               const ScanOptions& options = {}, ptrdiff_t offset = 0,
+                               const inline_hook::HookOptions& hook_options = {});
+
+} // namespace ur::scanner
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ur::symbol_cache {
+
+    // 缓存中记录的一次查找结果。value 是符号的 st_value（链接时地址），与装载位置无关，
+    // 因此同一 build-id 的模块在不同进程中可以共用。
+    struct Result {
+        bool present = false; // false：已知模块中没有该符号，不必再查找
+        bool ifunc = false;   // STT_GNU_IFUNC：value 是解析函数的地址
+        uint64_t value = 0;
+    };
+
+    /**
+     * @brief On-disk symbol offset cache for one ELF module, keyed by its NT_GNU_BUILD_ID.
+     *
+     * The cache file is a flat open-addressing hash table (keyed by the GNU hash of the
+     * symbol name) followed by a string pool, and is used directly from a read-only mmap.
+     * New results are kept in memory and merged into a fresh file by flush(), which
+     * replaces the old file with an atomic rename so concurrent processes never observe
+     * a partially written cache. Corrupt or mismatching files are ignored and rewritten.
+     */
+    class Cache {
+    public:
+        /**
+         * @brief Opens the cache for `build_id` in `directory`, creating it on the first flush().
+         * @return nullptr if `build_id` is empty.
+         */
+        static std::shared_ptr<Cache> open(const std::string& directory, std::span<const uint8_t> build_id);
+
+        // Flushes pending results (best effort) and unmaps the file.
+        ~Cache();
+
+        Cache(const Cache&) = delete;
+        Cache& operator=(const Cache&) = delete;
+
+        /**
+         * @brief Looks `name` up; `hash` must be ur::elf_parser::gnu_hash(name).
+         * @return true on a hit (including a cached "not present" result).
+         */
+        bool lookup(std::string_view name, uint32_t hash, Result& result) const;
+
+        // Records a result; it is served from memory immediately and persisted by flush().
+        void record(std::string_view name, uint32_t hash, const Result& result);
+
+        /**
+         * @brief Writes mapped and pending entries to a new cache file and maps it.
+         * @return true if there was nothing to write or the file was replaced.
+         */
+        bool flush();
+
+        // Number of entries, mapped and pending.
+        size_t size() const;
+
+        const std::string& path() const { return m_path; }
+
+    private:
+        struct Pending {
+            uint32_t hash = 0;
+            Result result;
+        };
+
+        Cache() = default;
+
+        bool map_file();
+        void unmap_file();
+        bool lookup_mapped(std::string_view name, uint32_t hash, Result& result) const;
+
+        std::string m_path;
+        std::string m_build_id;
+
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, Pending> m_pending;
+    };
+
+} // namespace ur::symbol_cache
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace ur::thread_suspend {
+
+struct SuspendOptions {
+    // Signal that parks the threads. SIGURG is ignored by default, so a delivery that
+    // arrives after a timed-out scope has restored the previous handler is harmless.
+    int signal = SIGURG;
+    // How long all threads together may take to stop before the scope gives up.
+    std::chrono::milliseconds timeout{500};
+};
+
+/**
+ * @brief Suspends every other thread of the process for the scope's lifetime.
+ *
+ * The threads listed in /proc/self/task are sent `signal` with rt_tgsigqueueinfo; its
+ * handler publishes the interrupted context and parks on a futex until the scope ends.
+ * The task list is read again after each round until no new thread shows up, so threads
+ * created meanwhile are stopped as well. While the threads are parked their PC and LR can
+ * be read and changed; the changes take effect when they resume.
+ *
+ * Only one scope exists at a time; constructing a second one waits for the first.
+ * Parked threads may hold any lock, the allocator's included, so until the scope ends
+ * the calling thread must not allocate memory or take locks other threads may hold.
+ * The constructor does all of its own allocation before the first thread is stopped.
+ */
+class ScopedSuspend {
+public:
+    /**
+     * @throws std::runtime_error if a thread does not stop within the timeout (a thread
+     *         blocking the signal, for instance) or the signal handler cannot be installed;
+     *         threads already stopped are resumed first.
+     */
+    explicit ScopedSuspend(const SuspendOptions& options = {});
+    ~ScopedSuspend();
+
+    ScopedSuspend(const ScopedSuspend&) = delete;
+    ScopedSuspend& operator=(const ScopedSuspend&) = delete;
+
+    // Number of suspended threads.
+    size_t size() const { return count_; }
+
+    // Kernel thread id (tid) of the index-th suspended thread.
+    uint32_t thread_id(size_t index) const;
+
+    uintptr_t pc(size_t index) const;
+    void set_pc(size_t index, uintptr_t pc);
+
+    uintptr_t lr(size_t index) const;
+    void set_lr(size_t index, uintptr_t lr);
+
+    // Resumes all threads before the scope ends; later calls do nothing.
+    void resume();
+
+    // Per-thread record shared with the signal handler; defined in the implementation.
+    struct Slot;
+
+private:
+
+    void stop_all(const SuspendOptions& options);
+
+    std::unique_lock<std::mutex> lock_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_ = 0;
+    size_t count_ = 0;
+    int signal_ = 0;
+    struct sigaction previous_{};
+    bool handler_installed_ = false;
+};
+
+} // namespace ur::thread_suspend
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ur::trampoline_cache {
+
+    // 重定位计划中一步的种类，对应 relocate 时生成的一段代码
+    enum class StepKind : uint8_t {
+        Copy,        // 原样复制 raw
+        LoadAddress, // reg = 地址（ADR、ADRP、ADRP+ADD）
+        Load,        // reg = [地址]（LDR literal、ADRP+LDR，包括 SIMD&FP 寄存器）
+        Store,       // [地址] = reg（ADRP+STR，包括 SIMD&FP 寄存器）
+        Jump,        // B
+        Call,        // BL
+        BranchCond,  // B.cond，extra 为条件
+        Cbz,
+        Cbnz,
+        Tbz,         // extra 为测试的位
+        Tbnz,
+        LoadSigned,  // reg = 符号扩展的 32 位 [地址]（LDRSW literal、ADRP+LDRSW）
+        // ADRP 与窄访问组合，reg 为 W（有符号加载也可以是 X）
+        LoadByte,       // ADRP+LDRB
+        LoadHalf,       // ADRP+LDRH
+        LoadSignedByte, // ADRP+LDRSB
+        LoadSignedHalf, // ADRP+LDRSH
+        StoreByte,      // ADRP+STRB
+        StoreHalf,      // ADRP+STRH
+    };
+
+    // 一步重定位。地址保存为相对 Hook 目标的偏移，与模块的装载位置无关。
+    struct Step {
+        StepKind kind = StepKind::Copy;
+        uint8_t words = 1;  // 替换的原始指令数（ADRP 组合为 2）
+        uint8_t extra = 0;
+        uint8_t reserved = 0;
+        int32_t reg = -1;   // assembler::Register
+        uint32_t raw = 0;
+        uint32_t reserved2 = 0;
+        int64_t delta = 0;  // 引用的地址减去目标地址
+    };
+    static_assert(sizeof(Step) == 24, "Step is written to the cache file as is");
+
+    // 一个目标的位置无关重定位计划：按新的目标与跳板地址重新生成即可得到跳板代码，
+    // 不需要再反汇编。
+    struct Plan {
+        uint32_t required_size = 0;      // 生成计划时要求覆盖的补丁长度
+        uint32_t backup_size = 0;        // 实际重定位的原始字节数
+        bool uses_previous_word = false; // 第一步与目标前一条 ADRP 组合
+        uint32_t previous_word = 0;
+        std::vector<uint32_t> original;  // 生成计划时的原始指令，使用前用于校验
+        std::vector<Step> steps;
+    };
+
+    /**
+     * @brief On-disk cache of trampoline relocation results for one ELF module, keyed by its
+     * NT_GNU_BUILD_ID and the function offset from the module base.
+     *
+     * Besides relocation plans it keeps the safe patch limit from function analysis, so a
+     * warm start installs hooks without decoding or analysing the targets. The file is
+     * read once by open(); flush() merges it with the new results and replaces it with an
+     * atomic rename, like ur::symbol_cache::Cache. Corrupt or mismatching files are ignored.
+     */
+    class Cache {
+    public:
+        /**
+         * @brief Opens the cache for `build_id` in `directory`, creating it on the first flush().
+         * @return nullptr if `build_id` is empty.
+         */
+        static std::shared_ptr<Cache> open(const std::string& directory, std::span<const uint8_t> build_id);
+
+        // Flushes new results (best effort).
+        ~Cache();
+
+        Cache(const Cache&) = delete;
+        Cache& operator=(const Cache&) = delete;
+
+        bool lookup_limit(uint64_t offset, uint32_t& limit) const;
+        void record_limit(uint64_t offset, uint32_t limit);
+
+        bool lookup_plan(uint64_t offset, uint32_t required_size, Plan& plan) const;
+        void record_plan(uint64_t offset, const Plan& plan);
+
+        /**
+         * @brief Writes all entries to a new cache file.
+         * @return true if there was nothing to write or the file was replaced.
+         */
+        bool flush();
+
+        // Number of functions with cached results.
+        size_t size() const;
+
+        const std::string& path() const { return m_path; }
+
+    private:
+        struct Entry {
+            uint32_t limit = 0; // 0: not known
+            std::vector<Plan> plans;
+        };
+
+        Cache() = default;
+
+        bool load(std::unordered_map<uint64_t, Entry>& entries) const;
+
+        std::string m_path;
+        std::string m_build_id;
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<uint64_t, Entry> m_entries;
+        bool m_dirty = false;
+    };
+
+} // namespace ur::trampoline_cache
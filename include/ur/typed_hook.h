@@ -0,0 +1,311 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "ur/inline_hook.h"
+#include "ur/jit.h"
+
+namespace ur::inline_hook {
+
+namespace detail {
+
+template <typename T>
+struct signature_of;
+
+template <typename Ret, typename... Args>
+struct signature_of<Ret (*)(Args...)> {
+    using type = Ret(Args...);
+};
+
+template <typename Ret, typename... Args>
+struct signature_of<Ret (*)(Args...) noexcept> {
+    using type = Ret(Args...);
+};
+
+template <typename T>
+using signature_of_t = typename signature_of<T>::type;
+
+// 按 AAPCS64 占用一个通用寄存器的参数；浮点参数走 v 寄存器，不受移位影响
+template <typename T>
+constexpr bool is_gpr_argument_v =
+    std::is_reference_v<T> ||
+    ((std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> || std::is_null_pointer_v<T>) &&
+     sizeof(T) <= 8);
+
+template <typename T>
+constexpr bool is_fpr_argument_v = std::is_floating_point_v<T>;
+
+/**
+ * @brief Emits a context thunk into `jit` and finalizes it.
+ *
+ * The thunk shifts the first `gpr_arguments` integer argument registers up by one
+ * (x0 -> x1, ...), loads `context` into x0 and jumps to `invoker`, so the invoker
+ * runs as `invoker(context, args...)`. FP/SIMD arguments, the stack and x8 (the
+ * indirect result register) are left untouched.
+ */
+inline void* emit_context_thunk(jit::Jit& jit, const void* context, uintptr_t invoker, size_t gpr_arguments) {
+    using assembler::Register;
+    for (size_t i = gpr_arguments; i > 0; --i) {
+        jit.mov(static_cast<Register>(static_cast<int>(Register::X0) + i),
+                static_cast<Register>(static_cast<int>(Register::X0) + i - 1));
+    }
+    jit.ldr_constant(Register::X0, reinterpret_cast<uintptr_t>(context));
+    jit.jump(invoker, Register::X16);
+    return jit.finalize<void*>();
+}
+
+} // namespace detail
+
+template <auto Target, typename Signature = detail::signature_of_t<decltype(Target)>>
+class TypedHook;
+
+/**
+ * @brief An inline hook whose signature, detour and original slot are fixed at compile time.
+ *
+ * Every instantiation owns one static slot holding the address of the original function
+ * (this hook's dispatch link while installed), so original() is a load and a single
+ * indirect branch with no validity check or lookup. `Target` is either a function
+ * pointer constant, which is both the hooked address and the key of the slot:
+ *
+ *     int my_detour(int x) { return TypedHook<&some_function>::original(x) + 1; }
+ *     ur::inline_hook::TypedHook<&some_function> hook(&my_detour);
+ *
+ * or any other constant used only as a key, with the address supplied at runtime:
+ *
+ *     enum class Hooks { kOpen };
+ *     ur::inline_hook::TypedHook<Hooks::kOpen, int(const char*, int)> hook(address, &my_open);
+ *
+ * Since the slot is static, at most one instance of an instantiation may be installed
+ * at a time. While no instance is installed, original() calls `Target` itself for a
+ * function pointer target; for a key target it must not be called.
+ */
+template <auto Target, typename Ret, typename... Args>
+class TypedHook<Target, Ret(Args...)> {
+public:
+    using Function = Ret (*)(Args...);
+
+    static constexpr bool kHasAddress =
+        std::is_pointer_v<decltype(Target)> && std::is_function_v<std::remove_pointer_t<decltype(Target)>>;
+
+    /**
+     * @brief Hooks `Target` with `detour`.
+     * @throws std::invalid_argument if detour is null.
+     * @throws std::runtime_error if another instance is installed or hooking fails.
+     */
+    explicit TypedHook(Function detour, const HookOptions& options = {}) requires kHasAddress
+        : TypedHook(reinterpret_cast<uintptr_t>(default_original()), detour, options) {}
+
+    /**
+     * @brief Hooks the function at `target` with `detour`.
+     * @throws std::invalid_argument if target or detour is null.
+     * @throws std::runtime_error if another instance is installed or hooking fails.
+     */
+    TypedHook(uintptr_t target, Function detour, const HookOptions& options = {}) {
+        if (detour == nullptr) {
+            throw std::invalid_argument("Detour must not be null");
+        }
+        if (installed_.exchange(true, std::memory_order_acq_rel)) {
+            throw std::runtime_error("TypedHook is already installed for this target");
+        }
+        try {
+            // 先填好槽位再启用，detour 第一次被调用时 original() 就已可用
+            hook_ = std::make_unique<Hook>(target, reinterpret_cast<Hook::Callback>(detour), false, options);
+            original_.store(reinterpret_cast<Function>(hook_->get_original()), std::memory_order_release);
+            if (!hook_->enable()) {
+                throw std::runtime_error("Failed to enable hook");
+            }
+        } catch (...) {
+            hook_.reset();
+            original_.store(default_original(), std::memory_order_release);
+            installed_.store(false, std::memory_order_release);
+            throw;
+        }
+    }
+
+    ~TypedHook() { unhook(); }
+
+    TypedHook(const TypedHook&) = delete;
+    TypedHook& operator=(const TypedHook&) = delete;
+
+    TypedHook(TypedHook&& other) noexcept = default;
+    TypedHook& operator=(TypedHook&&) = delete;
+
+    /**
+     * @brief Calls the original function (the next hook in the chain while installed).
+     *
+     * Intended to be called from the detour. Compiles to a load of the static slot and
+     * an indirect branch.
+     */
+    static Ret original(Args... args) {
+        // 槽位只在安装和移除时改变，读取不需要顺序保证
+        return original_.load(std::memory_order_relaxed)(std::forward<Args>(args)...);
+    }
+
+    // The current value of the slot called by original().
+    static Function original_function() { return original_.load(std::memory_order_relaxed); }
+
+    bool is_valid() const { return hook_ != nullptr; }
+    bool enable() { return hook_ && hook_->enable(); }
+    bool disable() { return hook_ && hook_->disable(); }
+
+    // Removes the hook; original() falls back to calling `Target` directly.
+    void unhook() {
+        if (!hook_) return;
+        hook_.reset();
+        original_.store(default_original(), std::memory_order_release);
+        installed_.store(false, std::memory_order_release);
+    }
+
+private:
+    static constexpr Function default_original() {
+        if constexpr (kHasAddress) {
+            return Target;
+        } else {
+            return nullptr;
+        }
+    }
+
+    static inline std::atomic<Function> original_{default_original()};
+    static inline std::atomic<bool> installed_{false};
+
+    // 堆上分配：移动 TypedHook 不会改变 Hook 的地址
+    std::unique_ptr<Hook> hook_;
+};
+
+template <typename Signature>
+class LambdaHook;
+
+/**
+ * @brief An inline hook whose detour is a callable object, e.g. a capturing lambda.
+ *
+ * The callable is invoked as `fn(original, args...)`, where `original` is a plain
+ * `Ret (*)(Args...)` for the next hook in the chain. Each hook gets a small JIT thunk
+ * that passes a pointer to the callable as a hidden first argument (shifting the
+ * integer argument registers up by one) and jumps to a static invoker, so a call
+ * costs a few register moves and no TLS or map lookup:
+ *
+ *     int calls = 0;
+ *     ur::inline_hook::LambdaHook<int(int, int)> hook(address, [&](auto original, int a, int b) {
+ *         ++calls;
+ *         return original(a, b) + 1;
+ *     });
+ *
+ * The hidden argument needs a free integer register, so the signature may have at most
+ * seven integer/pointer/reference arguments plus any number of floating-point ones, and
+ * no by-value aggregates; this is checked at compile time. Variadic functions are not
+ * supported.
+ */
+template <typename Ret, typename... Args>
+class LambdaHook<Ret(Args...)> {
+public:
+    using Function = Ret (*)(Args...);
+
+    static constexpr size_t kGprArguments = (0 + ... + (detail::is_gpr_argument_v<Args> ? 1 : 0));
+
+    static_assert(((detail::is_gpr_argument_v<Args> || detail::is_fpr_argument_v<Args>) && ...),
+                  "LambdaHook arguments must be integers, enums, pointers, references or floating-point values");
+    static_assert(kGprArguments < 8, "LambdaHook needs a free integer argument register for the context");
+
+    /**
+     * @brief Hooks the function at `target` with a copy of `fn`.
+     * @throws std::invalid_argument if target is null.
+     * @throws std::runtime_error if the thunk cannot be generated or hooking fails.
+     */
+    template <typename F>
+    LambdaHook(uintptr_t target, F&& fn, const HookOptions& options = {}) {
+        using StateType = State<std::decay_t<F>>;
+        static_assert(std::is_invocable_r_v<Ret, std::decay_t<F>&, Function, Args...>,
+                      "The callable must accept (original, args...) and return the hooked function's type");
+
+        auto state = std::make_unique<StateType>(std::forward<F>(fn));
+        auto thunk_jit = std::make_unique<jit::Jit>();
+        void* thunk = detail::emit_context_thunk(*thunk_jit, state.get(),
+                                                 reinterpret_cast<uintptr_t>(&StateType::invoke), kGprArguments);
+        if (thunk == nullptr) {
+            throw std::runtime_error("Failed to allocate the context thunk");
+        }
+
+        auto hook = std::make_unique<Hook>(target, thunk, false, options);
+        state->original = reinterpret_cast<Function>(hook->get_original());
+        if (!hook->enable()) {
+            throw std::runtime_error("Failed to enable hook");
+        }
+
+        state_ = std::move(state);
+        jit_ = std::move(thunk_jit);
+        hook_ = std::move(hook);
+        thunk_ = thunk;
+    }
+
+    ~LambdaHook() { unhook(); }
+
+    LambdaHook(const LambdaHook&) = delete;
+    LambdaHook& operator=(const LambdaHook&) = delete;
+
+    LambdaHook(LambdaHook&& other) noexcept
+        : state_(std::move(other.state_)), jit_(std::move(other.jit_)), hook_(std::move(other.hook_)),
+          thunk_(std::exchange(other.thunk_, nullptr)) {}
+    LambdaHook& operator=(LambdaHook&& other) noexcept {
+        if (this != &other) {
+            unhook();
+            state_ = std::move(other.state_);
+            jit_ = std::move(other.jit_);
+            hook_ = std::move(other.hook_);
+            thunk_ = std::exchange(other.thunk_, nullptr);
+        }
+        return *this;
+    }
+
+    // Calls the original function (the next hook in the chain) from outside the detour.
+    Ret call_original(Args... args) const {
+        if (!state_) {
+            throw std::runtime_error("Hook is not valid or has been moved.");
+        }
+        return state_->original(std::forward<Args>(args)...);
+    }
+
+    bool is_valid() const { return hook_ != nullptr; }
+    bool enable() { return hook_ && hook_->enable(); }
+    bool disable() { return hook_ && hook_->disable(); }
+
+    // The generated thunk installed as the detour, or nullptr.
+    void* get_thunk() const { return thunk_; }
+
+    void unhook() {
+        // 先移除 Hook，再释放其引用的 thunk 与可调用对象
+        hook_.reset();
+        jit_.reset();
+        state_.reset();
+        thunk_ = nullptr;
+    }
+
+private:
+    struct StateBase {
+        virtual ~StateBase() = default;
+        Function original = nullptr;
+    };
+
+    template <typename F>
+    struct State : StateBase {
+        explicit State(F&& f) : fn(std::move(f)) {}
+        explicit State(const F& f) : fn(f) {}
+
+        static Ret invoke(State* state, Args... args) {
+            return state->fn(state->original, std::forward<Args>(args)...);
+        }
+
+        F fn;
+    };
+
+    std::unique_ptr<StateBase> state_;
+    std::unique_ptr<jit::Jit> jit_;
+    std::unique_ptr<Hook> hook_;
+    void* thunk_{nullptr};
+};
+
+} // namespace ur::inline_hook
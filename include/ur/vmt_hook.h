@@ -1,26 +1,85 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <functional>
+#include <span>
+#include <vector>
+
+#include "ur/hook_stats.h"
 
 namespace ur {
     class VmHook;
+    class VmMethodHooks;
+
+    struct VmHookOptions {
+        // Point the vtable slot at a thunk that counts the calls (see ur::hook_stats)
+        // before jumping to the hook function; read with VmHook::call_count().
+        bool count_calls = false;
+    };
+
+    enum class VmtMode {
+        // Patch the class's vtable in place; every instance of the class takes the hooks.
+        InPlace,
+        // Point the instance at a private copy of its vtable; only this instance takes the
+        // hooks, and hooking or toggling a method is a plain store into the copy.
+        Shadow,
+    };
 
     class VmtHook {
     public:
-                explicit VmtHook(void* instance);
+        /**
+         * In Shadow mode the vtable is copied once, together with the offset-to-top and
+         * RTTI words in front of it, so typeid and dynamic_cast keep working for classes
+         * without virtual bases. Its length is the run of entries pointing into executable
+         * mappings. The instance's vptr is swapped to the copy, and restored by the
+         * destructor if it still points there.
+         *
+         * Classes with virtual bases keep vbase and vcall offsets further in front of the
+         * vtable, which are not copied; Shadow mode throws std::runtime_error when the RTTI
+         * shows a virtual base. A class compiled without RTTI cannot be checked, and must
+         * not be shadowed if it has virtual bases.
+         */
+        explicit VmtHook(void* instance, VmtMode mode = VmtMode::InPlace);
         explicit VmtHook(void** vmt_address);
-        ~VmtHook() = default;
+        ~VmtHook();
 
         VmtHook(const VmtHook&) = delete;
         VmtHook& operator=(const VmtHook&) = delete;
         VmtHook(VmtHook&&) = delete;
         VmtHook& operator=(VmtHook&&) = delete;
 
-        [[nodiscard]] std::unique_ptr<VmHook> hook_method(std::size_t index, void* hook_function);
+        // Returns nullptr in Shadow mode if index is past the end of the copied vtable.
+        [[nodiscard]] std::unique_ptr<VmHook> hook_method(std::size_t index, void* hook_function,
+                                                          const VmHookOptions& options = {});
+
+        struct Method {
+            std::size_t index;
+            void* hook_function;
+        };
+
+        /**
+         * @brief Hooks several methods at once.
+         *
+         * All slots are written under a single protection change and restored the same way
+         * when the returned handle is destroyed or unhooked. Hooking the same index twice
+         * chains the later hook in front of the earlier one.
+         * In Shadow mode nothing is hooked and an empty handle is returned if any index is
+         * past the end of the copied vtable.
+         */
+        [[nodiscard]] VmMethodHooks hook_methods(std::span<const Method> methods, const VmHookOptions& options = {});
+
+        [[nodiscard]] bool is_shadow() const { return shadow_ != nullptr; }
+
+        // Number of methods in the shadow vtable, 0 in InPlace mode.
+        [[nodiscard]] std::size_t shadow_size() const { return shadow_size_; }
 
     private:
         void** vmt_address_;
+        void** instance_vptr_{nullptr};     // The instance's vptr while it points at the shadow copy
+        void** original_vmt_{nullptr};      // The vtable the instance pointed at before
+        std::shared_ptr<void*[]> shadow_;   // Header words followed by the copied entries; shared with its VmHooks
+        std::size_t shadow_size_{0};
     };
 
     class VmHook {
@@ -54,13 +113,74 @@ namespace ur {
          */
         bool disable();
 
+        /**
+         * @brief Number of calls through the vtable slot while the hook was enabled.
+         * @return 0 unless the hook was created with VmHookOptions::count_calls.
+         */
+        uint64_t call_count() const;
+
     private:
         friend class VmtHook;
-        VmHook(void** vmt_entry_address, void* hook_function, void* original_function);
+        VmHook(void** vmt_entry_address, void* hook_function, void* original_function,
+               std::shared_ptr<void*[]> shadow = nullptr);
+
+        // Stores `function` into the slot: a plain store for a shadow copy, otherwise
+        // with the page made writable around the write.
+        void write_slot(void* function);
+
+        // What the vtable slot points to while enabled: the counting thunk or the hook function.
+        void* installed_function() const;
 
         void** vmt_entry_address_{nullptr};
         void* hook_function_{nullptr};
         void* original_function_{nullptr};
         bool is_enabled_{false};
+        hook_stats::CountingThunk counter_;
+        std::shared_ptr<void*[]> shadow_; // Keeps a shadow vtable alive; null for in-place hooks
+    };
+
+    /**
+     * @brief Owns the hooks installed by VmtHook::hook_methods().
+     *
+     * The methods are kept in one contiguous array, in the order they were passed.
+     */
+    class VmMethodHooks {
+    public:
+        VmMethodHooks() = default;
+        ~VmMethodHooks();
+
+        VmMethodHooks(const VmMethodHooks&) = delete;
+        VmMethodHooks& operator=(const VmMethodHooks&) = delete;
+        VmMethodHooks(VmMethodHooks&& other) noexcept;
+        VmMethodHooks& operator=(VmMethodHooks&& other) noexcept;
+
+        [[nodiscard]] std::size_t size() const { return entries_.size(); }
+        [[nodiscard]] bool empty() const { return entries_.empty(); }
+
+        // The function the i-th method's slot held before it was hooked.
+        template <typename T>
+        T get_original(std::size_t i) const {
+            return reinterpret_cast<T>(entries_[i].original_function);
+        }
+
+        // Calls through the i-th method's slot; 0 unless hooked with VmHookOptions::count_calls.
+        uint64_t call_count(std::size_t i) const;
+
+        /**
+         * @brief Restores every slot under a single protection change; later calls do nothing.
+         */
+        void unhook();
+
+    private:
+        friend class VmtHook;
+
+        struct Entry {
+            void** slot = nullptr;
+            void* original_function = nullptr;
+            hook_stats::CountingThunk counter;
+        };
+
+        std::vector<Entry> entries_;
+        std::shared_ptr<void*[]> shadow_; // Keeps a shadow vtable alive; null for in-place hooks
     };
 }
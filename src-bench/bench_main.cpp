@@ -0,0 +1,4 @@
+#include <benchmark/benchmark.h>
+
+// Results can be exported with --benchmark_format=json or --benchmark_out=<file>.
+BENCHMARK_MAIN();
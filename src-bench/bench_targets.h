@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ur/jit.h"
+
+namespace bench {
+
+// A block of JIT-generated functions `int f(int x) { return x + 1; }`, each padded with
+// NOPs so that even the longest patch sequence fits. Used to install thousands of hooks
+// without needing thousands of compiled functions.
+class JitTargets {
+public:
+    static constexpr size_t kFunctionSize = 32;
+
+    explicit JitTargets(size_t count) {
+        using namespace ur::assembler;
+        for (size_t i = 0; i < count; ++i) {
+            jit_.add(Register::W0, Register::W0, 1);
+            for (size_t n = 0; n < kFunctionSize / 4 - 2; ++n) {
+                jit_.nop();
+            }
+            jit_.ret();
+        }
+        base_ = reinterpret_cast<uintptr_t>(jit_.finalize<void*>());
+        count_ = count;
+    }
+
+    size_t size() const { return count_; }
+    uintptr_t address(size_t index) const { return base_ + index * kFunctionSize; }
+
+private:
+    ur::jit::Jit jit_;
+    uintptr_t base_ = 0;
+    size_t count_ = 0;
+};
+
+} // namespace bench
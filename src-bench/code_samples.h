@@ -0,0 +1,77 @@
+#pragma once
+
+#include <dlfcn.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ur/maps_parser.h"
+
+namespace bench {
+
+// Real instruction streams for the decoder benchmarks, selected by benchmark argument.
+// The words are copied out of the module's r-x mapping; `base` is where they were mapped,
+// so PC-relative targets decode to the same addresses the code really uses.
+struct CodeSample {
+    std::string name;
+    uintptr_t base = 0;
+    std::vector<uint32_t> words;
+};
+
+enum CodeSampleId {
+    kSelfText = 0, // This binary, first 256KB
+    kLibcText = 1, // libc, whole r-x mapping
+    kLibartText = 2, // libart (Android runtime), whole r-x mapping
+    kRandomWords = 3, // 1M uniformly random words with a fixed seed, for differential fuzzing
+};
+
+inline constexpr size_t kMaxSampleBytes = 16 * 1024 * 1024;
+
+// Copies the first r-x mapping whose path contains `path_part` (the first one of all when
+// empty). Returns an empty sample when the module is not mapped.
+inline CodeSample load_code_sample(const char* name, const char* path_part, size_t max_bytes) {
+    CodeSample sample;
+    sample.name = name;
+    if (*path_part != '\0') {
+        // Already loaded in most processes; otherwise try once so a standalone run still has it
+        dlopen(name, RTLD_NOW);
+    }
+    auto snapshot = ur::maps_parser::MapsSnapshot::refresh();
+    for (const auto& entry : snapshot->entries()) {
+        if ((entry.prot & (PROT_READ | PROT_EXEC)) != (PROT_READ | PROT_EXEC)) continue;
+        if (*path_part != '\0' && entry.path.find(path_part) == std::string_view::npos) continue;
+        const size_t size = std::min<size_t>(entry.end - entry.start, max_bytes);
+        sample.base = entry.start;
+        sample.words.resize(size / 4);
+        memcpy(sample.words.data(), reinterpret_cast<const void*>(entry.start), sample.words.size() * 4);
+        break;
+    }
+    return sample;
+}
+
+inline CodeSample random_code_sample(size_t count) {
+    CodeSample sample;
+    sample.name = "random";
+    sample.base = 0x10000000;
+    std::mt19937 rng(0x5eed);
+    sample.words.resize(count);
+    for (auto& word : sample.words) word = static_cast<uint32_t>(rng());
+    return sample;
+}
+
+inline const CodeSample& code_sample(int id) {
+    static const CodeSample samples[] = {
+        load_code_sample("self", "", 256 * 1024),
+        load_code_sample("libc.so", "/libc.so", kMaxSampleBytes),
+        load_code_sample("libart.so", "/libart.so", kMaxSampleBytes),
+        random_code_sample(1 << 20),
+    };
+    return samples[id];
+}
+
+} // namespace bench
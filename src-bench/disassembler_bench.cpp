@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+#include <capstone/capstone.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "code_samples.h"
+#include "ur/disassembler.h"
+
+namespace {
+
+// Heap allocations made while decoding. urhook allocates through operator new, Capstone
+// through the allocator installed with CS_OPT_MEM below; both count here.
+std::atomic<uint64_t> g_allocations{0};
+
+void count_allocation() {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    count_allocation();
+    if (void* p = malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+void* counting_malloc(size_t size) {
+    count_allocation();
+    return malloc(size);
+}
+
+void* counting_calloc(size_t count, size_t size) {
+    count_allocation();
+    return calloc(count, size);
+}
+
+void* counting_realloc(void* p, size_t size) {
+    count_allocation();
+    return realloc(p, size);
+}
+
+// The allocator option is global and must be set before the first cs_open()
+csh open_capstone(bool detail) {
+    static const bool allocator_installed = [] {
+        cs_opt_mem mem{};
+        mem.malloc = counting_malloc;
+        mem.calloc = counting_calloc;
+        mem.realloc = counting_realloc;
+        mem.free = free;
+        mem.vsnprintf = vsnprintf;
+        return cs_option(0, CS_OPT_MEM, reinterpret_cast<size_t>(&mem)) == CS_ERR_OK;
+    }();
+    (void)allocator_installed;
+
+    csh handle = 0;
+    if (cs_open(CS_ARCH_ARM64, CS_MODE_LITTLE_ENDIAN, &handle) != CS_ERR_OK) return 0;
+    cs_option(handle, CS_OPT_DETAIL, detail ? CS_OPT_ON : CS_OPT_OFF);
+    return handle;
+}
+
+void report(benchmark::State& state, size_t words, uint64_t allocations) {
+    const double decoded = static_cast<double>(state.iterations()) * static_cast<double>(words);
+    state.SetItemsProcessed(static_cast<int64_t>(decoded));
+    state.counters["allocs_per_insn"] = decoded > 0 ? static_cast<double>(allocations) / decoded : 0;
+}
+
+// Argument: bench::CodeSampleId
+void BM_DecodeText(benchmark::State& state) {
+    const auto& sample = bench::code_sample(static_cast<int>(state.range(0)));
+    if (sample.words.empty()) {
+        state.SkipWithError((sample.name + " is not mapped").c_str());
+        return;
+    }
+    ur::disassembler::DecodedInsn insn;
+    const uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        for (size_t i = 0; i < sample.words.size(); ++i) {
+            ur::disassembler::decode(sample.base + i * 4, sample.words[i], insn);
+            benchmark::DoNotOptimize(insn.id);
+        }
+    }
+    report(state, sample.words.size(), g_allocations.load(std::memory_order_relaxed) - allocations);
+}
+BENCHMARK(BM_DecodeText)->Arg(bench::kSelfText)->Arg(bench::kLibcText)->Arg(bench::kLibartText)
+    ->Unit(benchmark::kMicrosecond);
+
+// Same streams through Capstone's cs_disasm_iter, the cheapest way to drive it: one
+// cs_insn is reused for every instruction. Arguments: bench::CodeSampleId, detail (0/1).
+// Detail is what gives operands, so /1 is the comparison point for decode().
+void BM_CapstoneDecodeText(benchmark::State& state) {
+    const auto& sample = bench::code_sample(static_cast<int>(state.range(0)));
+    if (sample.words.empty()) {
+        state.SkipWithError((sample.name + " is not mapped").c_str());
+        return;
+    }
+    csh handle = open_capstone(state.range(1) != 0);
+    if (handle == 0) {
+        state.SkipWithError("cs_open failed");
+        return;
+    }
+    cs_insn* insn = cs_malloc(handle);
+
+    const uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        for (size_t i = 0; i < sample.words.size(); ++i) {
+            // Invalid words would end the iteration, so every word is decoded on its own
+            const uint8_t* code = reinterpret_cast<const uint8_t*>(&sample.words[i]);
+            size_t size = 4;
+            uint64_t address = sample.base + i * 4;
+            benchmark::DoNotOptimize(cs_disasm_iter(handle, &code, &size, &address, insn));
+            benchmark::DoNotOptimize(insn->id);
+        }
+    }
+    report(state, sample.words.size(), g_allocations.load(std::memory_order_relaxed) - allocations);
+
+    cs_free(insn, 1);
+    cs_close(&handle);
+}
+BENCHMARK(BM_CapstoneDecodeText)
+    ->ArgsProduct({{bench::kSelfText, bench::kLibcText, bench::kLibartText}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_DecodeAndFormat(benchmark::State& state) {
+    const auto& sample = bench::code_sample(bench::kSelfText);
+    const size_t count = std::min<size_t>(sample.words.size(), 4096);
+    ur::disassembler::DecodedInsn insn;
+    std::string mnemonic, op_str;
+    const uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i) {
+            ur::disassembler::decode(sample.base + i * 4, sample.words[i], insn);
+            ur::disassembler::format(insn, mnemonic, op_str);
+            benchmark::DoNotOptimize(op_str.data());
+        }
+    }
+    report(state, count, g_allocations.load(std::memory_order_relaxed) - allocations);
+}
+BENCHMARK(BM_DecodeAndFormat)->Unit(benchmark::kMicrosecond);
+
+} // namespace
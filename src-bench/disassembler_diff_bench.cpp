@@ -0,0 +1,278 @@
+#include <benchmark/benchmark.h>
+#include <capstone/capstone.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+
+#include "code_samples.h"
+#include "ur/disassembler.h"
+
+// Differential check of ur::disassembler::decode() against Capstone over the same
+// instruction streams as the throughput benchmarks. Not a timing benchmark: each sample
+// runs once and the mismatch counts are reported as counters, with the first few words of
+// every kind printed to stderr.
+//
+// Relocation only depends on PC-relative instructions, so those are compared in full (ID,
+// registers, bit number and target); any difference there is reported as relocation
+// relevant. For other instructions the ID (accepting Capstone's aliases) and the first
+// register operand are compared, and words Capstone does not decode are skipped.
+
+namespace {
+
+using ur::disassembler::DecodedInsn;
+using ur::disassembler::InstructionId;
+using ur::disassembler::OperandType;
+
+// A register as (class, number): 'x', 'w', 's', 'd' or 'q'; SP and ZR are both number 31,
+// as they share the encoding.
+struct Reg {
+    char kind = 0;
+    int number = -1;
+    bool operator==(const Reg&) const = default;
+};
+
+Reg from_capstone(csh handle, unsigned reg) {
+    const char* name = cs_reg_name(handle, reg);
+    if (name == nullptr) return {};
+    if (strcmp(name, "sp") == 0 || strcmp(name, "xzr") == 0) return {'x', 31};
+    if (strcmp(name, "wsp") == 0 || strcmp(name, "wzr") == 0) return {'w', 31};
+    return {name[0], atoi(name + 1)};
+}
+
+Reg from_ur(ur::assembler::Register reg) {
+    const int value = static_cast<int>(reg);
+    if (value >= 0 && value <= 32) return {'x', value > 31 ? 31 : value};
+    if (value >= 64 && value <= 96) return {'w', value - 64 > 31 ? 31 : value - 64};
+    if (value >= 100 && value < 132) return {'s', value - 100};
+    if (value >= 150 && value < 182) return {'d', value - 150};
+    if (value >= 200 && value < 232) return {'q', value - 200};
+    return {};
+}
+
+bool is_one_of(unsigned id, std::initializer_list<unsigned> ids) {
+    for (unsigned candidate : ids) {
+        if (candidate == id) return true;
+    }
+    return false;
+}
+
+// Capstone instruction IDs (including aliases) that describe the same instruction as `id`
+bool same_instruction(InstructionId id, const cs_insn& insn) {
+    const cs_arm64& detail = insn.detail->arm64;
+    const bool conditional = detail.cc != ARM64_CC_INVALID;
+    switch (id) {
+        case InstructionId::ADD: return is_one_of(insn.id, {ARM64_INS_ADD, ARM64_INS_MOV});
+        case InstructionId::SUB: return is_one_of(insn.id, {ARM64_INS_SUB, ARM64_INS_NEG});
+        case InstructionId::SUBS: return is_one_of(insn.id, {ARM64_INS_SUBS, ARM64_INS_CMP, ARM64_INS_NEGS});
+        case InstructionId::ADDS: return is_one_of(insn.id, {ARM64_INS_ADDS, ARM64_INS_CMN});
+        case InstructionId::AND: return insn.id == ARM64_INS_AND;
+        case InstructionId::ORR: return is_one_of(insn.id, {ARM64_INS_ORR, ARM64_INS_MOV});
+        case InstructionId::EOR: return insn.id == ARM64_INS_EOR;
+        case InstructionId::ANDS: return is_one_of(insn.id, {ARM64_INS_ANDS, ARM64_INS_TST});
+        case InstructionId::MOV: return is_one_of(insn.id, {ARM64_INS_MOV, ARM64_INS_ORR, ARM64_INS_ADD});
+        case InstructionId::MOVZ: return is_one_of(insn.id, {ARM64_INS_MOVZ, ARM64_INS_MOV});
+        case InstructionId::MOVN: return is_one_of(insn.id, {ARM64_INS_MOVN, ARM64_INS_MOV});
+        case InstructionId::MOVK: return insn.id == ARM64_INS_MOVK;
+        case InstructionId::ADR: return insn.id == ARM64_INS_ADR;
+        case InstructionId::ADRP: return insn.id == ARM64_INS_ADRP;
+        case InstructionId::B: return insn.id == ARM64_INS_B && !conditional;
+        case InstructionId::B_COND: return insn.id == ARM64_INS_B && conditional;
+        case InstructionId::BL: return insn.id == ARM64_INS_BL;
+        case InstructionId::BR: return insn.id == ARM64_INS_BR;
+        case InstructionId::BLR: return insn.id == ARM64_INS_BLR;
+        case InstructionId::CBZ: return insn.id == ARM64_INS_CBZ;
+        case InstructionId::CBNZ: return insn.id == ARM64_INS_CBNZ;
+        case InstructionId::TBZ: return insn.id == ARM64_INS_TBZ;
+        case InstructionId::TBNZ: return insn.id == ARM64_INS_TBNZ;
+        case InstructionId::RET: return insn.id == ARM64_INS_RET;
+        case InstructionId::LDR:
+            return is_one_of(insn.id, {ARM64_INS_LDR, ARM64_INS_LDRB, ARM64_INS_LDRH, ARM64_INS_LDRSB,
+                                       ARM64_INS_LDRSH, ARM64_INS_LDRSW});
+        case InstructionId::STR: return is_one_of(insn.id, {ARM64_INS_STR, ARM64_INS_STRB, ARM64_INS_STRH});
+        case InstructionId::LDP: return is_one_of(insn.id, {ARM64_INS_LDP, ARM64_INS_LDPSW, ARM64_INS_LDNP});
+        case InstructionId::STP: return is_one_of(insn.id, {ARM64_INS_STP, ARM64_INS_STNP});
+        case InstructionId::LDR_LIT: return is_one_of(insn.id, {ARM64_INS_LDR, ARM64_INS_LDRSW});
+        case InstructionId::NOP: return insn.id == ARM64_INS_NOP;
+        case InstructionId::FMOV: return insn.id == ARM64_INS_FMOV;
+        case InstructionId::FADD: return insn.id == ARM64_INS_FADD;
+        case InstructionId::FSUB: return insn.id == ARM64_INS_FSUB;
+        case InstructionId::FMUL: return insn.id == ARM64_INS_FMUL;
+        case InstructionId::FDIV: return insn.id == ARM64_INS_FDIV;
+        case InstructionId::SCVTF: return insn.id == ARM64_INS_SCVTF;
+        case InstructionId::FCVTZS: return insn.id == ARM64_INS_FCVTZS;
+        case InstructionId::LDXR:
+            return is_one_of(insn.id, {ARM64_INS_LDXR, ARM64_INS_LDXRB, ARM64_INS_LDXRH, ARM64_INS_LDAXR,
+                                       ARM64_INS_LDAXRB, ARM64_INS_LDAXRH, ARM64_INS_LDAR, ARM64_INS_LDARB,
+                                       ARM64_INS_LDARH, ARM64_INS_LDXP, ARM64_INS_LDAXP});
+        case InstructionId::STXR:
+            return is_one_of(insn.id, {ARM64_INS_STXR, ARM64_INS_STXRB, ARM64_INS_STXRH, ARM64_INS_STLXR,
+                                       ARM64_INS_STLXRB, ARM64_INS_STLXRH, ARM64_INS_STLR, ARM64_INS_STLRB,
+                                       ARM64_INS_STLRH, ARM64_INS_STXP, ARM64_INS_STLXP});
+        case InstructionId::UBFM:
+            return is_one_of(insn.id, {ARM64_INS_UBFM, ARM64_INS_LSL, ARM64_INS_LSR, ARM64_INS_UBFX,
+                                       ARM64_INS_UBFIZ, ARM64_INS_UXTB, ARM64_INS_UXTH});
+        case InstructionId::INVALID:
+            return false;
+    }
+    return false;
+}
+
+// Whether Capstone's decoding reads the PC: direct branches, ADR/ADRP and the literal loads
+// (an immediate address operand instead of a memory operand).
+bool capstone_pc_relative(const cs_insn& insn) {
+    if (is_one_of(insn.id, {ARM64_INS_B, ARM64_INS_BL, ARM64_INS_CBZ, ARM64_INS_CBNZ, ARM64_INS_TBZ,
+                            ARM64_INS_TBNZ, ARM64_INS_ADR, ARM64_INS_ADRP})) {
+        return true;
+    }
+    if (!is_one_of(insn.id, {ARM64_INS_LDR, ARM64_INS_LDRSW, ARM64_INS_PRFM})) return false;
+    const cs_arm64& detail = insn.detail->arm64;
+    bool has_imm = false;
+    for (uint8_t i = 0; i < detail.op_count; ++i) {
+        if (detail.operands[i].type == ARM64_OP_MEM) return false;
+        has_imm = has_imm || detail.operands[i].type == ARM64_OP_IMM;
+    }
+    return has_imm;
+}
+
+// Registers, TBZ bit number and target of a PC-relative instruction. Capstone lists the
+// operands in the same order as decode(): registers and bit number first, address last.
+bool same_pc_relative_operands(csh handle, const cs_insn& insn, const DecodedInsn& decoded) {
+    const cs_arm64& detail = insn.detail->arm64;
+    if (detail.op_count != decoded.operand_count) return false;
+    for (uint8_t i = 0; i < detail.op_count; ++i) {
+        const cs_arm64_op& op = detail.operands[i];
+        const auto& ours = decoded.operands[i];
+        if (op.type == ARM64_OP_REG) {
+            if (ours.type != OperandType::REGISTER) return false;
+            const Reg expected = from_capstone(handle, op.reg);
+            const Reg actual = from_ur(ours.reg);
+            // TBZ/TBNZ name a W register for bits below 32; only the number is encoded
+            const bool number_only = is_one_of(insn.id, {ARM64_INS_TBZ, ARM64_INS_TBNZ});
+            if (number_only ? expected.number != actual.number : !(expected == actual)) return false;
+        } else if (op.type == ARM64_OP_IMM) {
+            if (ours.type != OperandType::IMMEDIATE || ours.imm != op.imm) return false;
+        } else {
+            return false; // e.g. the prefetch operation of PRFM
+        }
+    }
+    return true;
+}
+
+// The first operand when both decoders have it as a register. CMP/CMN/TST drop the
+// destination, so their first Capstone operand is a source and is not compared.
+bool same_first_register(csh handle, const cs_insn& insn, const DecodedInsn& decoded) {
+    const cs_arm64& detail = insn.detail->arm64;
+    if (detail.op_count == 0 || decoded.operand_count == 0) return true;
+    if (detail.operands[0].type != ARM64_OP_REG || decoded.operands[0].type != OperandType::REGISTER) return true;
+    if (is_one_of(insn.id, {ARM64_INS_CMP, ARM64_INS_CMN, ARM64_INS_TST})) return true;
+    return from_capstone(handle, detail.operands[0].reg) == from_ur(decoded.operands[0].reg);
+}
+
+enum Kind {
+    kMissedPcRelative,  // Capstone: PC-relative; urhook: not decoded or not PC-relative
+    kFalsePcRelative,   // urhook: PC-relative; Capstone: something else
+    kPcRelativeOperand, // Both PC-relative, different ID, registers or target
+    kId,                // Different instruction
+    kOperand,           // Same instruction, different first register
+    kUrOnly,            // urhook decodes a word Capstone rejects
+    kKindCount,
+};
+
+constexpr const char* kKindNames[kKindCount] = {
+    "missed_pc_relative", "false_pc_relative", "pc_relative_operand", "id_mismatch", "operand_mismatch", "ur_only",
+};
+
+constexpr size_t kPrintedPerKind = 8;
+
+void BM_DiffCapstone(benchmark::State& state) {
+    const auto& sample = bench::code_sample(static_cast<int>(state.range(0)));
+    if (sample.words.empty()) {
+        state.SkipWithError((sample.name + " is not mapped").c_str());
+        return;
+    }
+    csh handle = 0;
+    if (cs_open(CS_ARCH_ARM64, CS_MODE_LITTLE_ENDIAN, &handle) != CS_ERR_OK) {
+        state.SkipWithError("cs_open failed");
+        return;
+    }
+    cs_option(handle, CS_OPT_DETAIL, CS_OPT_ON);
+    cs_insn* insn = cs_malloc(handle);
+
+    size_t counts[kKindCount] = {};
+    size_t capstone_decoded = 0;
+    size_t ur_decoded = 0;
+    size_t pc_relative = 0;
+
+    auto flag = [&](Kind kind, uint64_t address, uint32_t word, bool capstone_ok, const DecodedInsn& decoded) {
+        if (counts[kind]++ >= kPrintedPerKind) return;
+        std::string mnemonic, op_str;
+        if (decoded.id != InstructionId::INVALID) ur::disassembler::format(decoded, mnemonic, op_str);
+        fprintf(stderr, "[%s] %s 0x%llx %08x: capstone \"%s %s\", urhook \"%s %s\"\n", sample.name.c_str(),
+                kKindNames[kind], static_cast<unsigned long long>(address), word,
+                capstone_ok ? insn->mnemonic : "(invalid)", capstone_ok ? insn->op_str : "",
+                decoded.id != InstructionId::INVALID ? mnemonic.c_str() : "(invalid)", op_str.c_str());
+    };
+
+    for (auto _ : state) {
+        DecodedInsn decoded;
+        for (size_t i = 0; i < sample.words.size(); ++i) {
+            const uint32_t word = sample.words[i];
+            const uint64_t pc = sample.base + i * 4;
+            const bool ours = ur::disassembler::decode(pc, word, decoded);
+
+            const uint8_t* code = reinterpret_cast<const uint8_t*>(&word);
+            size_t size = 4;
+            uint64_t address = pc;
+            const bool theirs = cs_disasm_iter(handle, &code, &size, &address, insn);
+
+            ur_decoded += ours;
+            capstone_decoded += theirs;
+            const bool theirs_pc_relative = theirs && capstone_pc_relative(*insn);
+            pc_relative += theirs_pc_relative;
+
+            if (theirs_pc_relative) {
+                if (!ours || !decoded.is_pc_relative) {
+                    flag(kMissedPcRelative, pc, word, theirs, decoded);
+                } else if (!same_instruction(decoded.id, *insn) ||
+                           !same_pc_relative_operands(handle, *insn, decoded)) {
+                    flag(kPcRelativeOperand, pc, word, theirs, decoded);
+                }
+            } else if (ours && decoded.is_pc_relative) {
+                flag(kFalsePcRelative, pc, word, theirs, decoded);
+            } else if (ours && !theirs) {
+                flag(kUrOnly, pc, word, theirs, decoded);
+            } else if (ours) {
+                if (!same_instruction(decoded.id, *insn)) {
+                    flag(kId, pc, word, theirs, decoded);
+                } else if (!same_first_register(handle, *insn, decoded)) {
+                    flag(kOperand, pc, word, theirs, decoded);
+                }
+            }
+        }
+    }
+
+    state.counters["words"] = static_cast<double>(sample.words.size());
+    state.counters["capstone_decoded"] = static_cast<double>(capstone_decoded);
+    state.counters["ur_decoded"] = static_cast<double>(ur_decoded);
+    state.counters["pc_relative"] = static_cast<double>(pc_relative);
+    for (size_t kind = 0; kind < kKindCount; ++kind) {
+        state.counters[kKindNames[kind]] = static_cast<double>(counts[kind]);
+    }
+    const size_t relocation_relevant =
+        counts[kMissedPcRelative] + counts[kFalsePcRelative] + counts[kPcRelativeOperand];
+    if (relocation_relevant != 0) {
+        fprintf(stderr, "[%s] %zu relocation-relevant mismatches\n", sample.name.c_str(), relocation_relevant);
+    }
+
+    cs_free(insn, 1);
+    cs_close(&handle);
+}
+BENCHMARK(BM_DiffCapstone)
+    ->Arg(bench::kSelfText)->Arg(bench::kLibcText)->Arg(bench::kLibartText)->Arg(bench::kRandomWords)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
@@ -0,0 +1,212 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "bench_targets.h"
+#include "ur/inline_hook.h"
+
+namespace {
+
+using ur::inline_hook::Hook;
+using ur::inline_hook::HookBatch;
+
+int replacement(int x) {
+    return x + 2;
+}
+
+__attribute__((noinline)) int call_target(int x) {
+    asm volatile("nop\n nop\n nop\n nop\n nop");
+    return x + 1;
+}
+
+// Targets are shared by all install benchmarks; every benchmark removes its hooks again.
+bench::JitTargets& targets() {
+    static bench::JitTargets instance(10000);
+    return instance;
+}
+
+// --- Install / uninstall latency ---
+
+void BM_InstallHooks(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    auto& pool = targets();
+    std::vector<Hook> hooks;
+    for (auto _ : state) {
+        hooks.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            hooks.emplace_back(pool.address(i), reinterpret_cast<Hook::Callback>(&replacement));
+        }
+        state.PauseTiming();
+        hooks.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_InstallHooks)->Arg(1)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+void BM_BatchInstallHooks(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    auto& pool = targets();
+    std::vector<Hook> hooks;
+    for (auto _ : state) {
+        HookBatch batch;
+        for (size_t i = 0; i < count; ++i) {
+            batch.add(pool.address(i), reinterpret_cast<Hook::Callback>(&replacement));
+        }
+        hooks = batch.commit();
+        state.PauseTiming();
+        hooks.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_BatchInstallHooks)->Arg(1)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+void BM_UninstallHooks(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    auto& pool = targets();
+    std::vector<Hook> hooks;
+    for (auto _ : state) {
+        state.PauseTiming();
+        hooks.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            hooks.emplace_back(pool.address(i), reinterpret_cast<Hook::Callback>(&replacement));
+        }
+        state.ResumeTiming();
+        hooks.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_UninstallHooks)->Arg(1)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// range(0): 0 = default hook, 1 = HookOptions::switchable
+void BM_ToggleHook(benchmark::State& state) {
+    ur::inline_hook::HookOptions options;
+    options.switchable = state.range(0) != 0;
+    Hook hook(targets().address(0), reinterpret_cast<Hook::Callback>(&replacement), true, options);
+    for (auto _ : state) {
+        hook.disable();
+        hook.enable();
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_ToggleHook)->Arg(0)->Arg(1);
+
+// --- Call overhead ---
+
+void BM_CallUnhooked(benchmark::State& state) {
+    int value = 0;
+    for (auto _ : state) {
+        value = call_target(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_CallUnhooked)->ThreadRange(1, 8);
+
+Hook* g_call_hook = nullptr;
+
+int forwarding_callback(int x) {
+    return g_call_hook->call_original<int>(x);
+}
+
+// Installed once and shared by all threads; never removed while benchmarks run.
+struct CallHook {
+    Hook hook;
+    CallHook() : hook(reinterpret_cast<uintptr_t>(&call_target),
+                      reinterpret_cast<Hook::Callback>(&forwarding_callback)) {
+        g_call_hook = &hook;
+    }
+};
+
+Hook& call_hook() {
+    static CallHook instance;
+    return instance.hook;
+}
+
+void BM_CallHooked(benchmark::State& state) {
+    call_hook();
+    int value = 0;
+    for (auto _ : state) {
+        value = call_target(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_CallHooked)->ThreadRange(1, 8);
+
+void BM_CallTrampoline(benchmark::State& state) {
+    auto original = reinterpret_cast<int (*)(int)>(call_hook().get_trampoline());
+    int value = 0;
+    for (auto _ : state) {
+        value = original(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_CallTrampoline);
+
+// --- Call counting ---
+
+// One hook per variant, installed once and shared by all threads.
+// 0 = plain hook, 1 = HookOptions::count_calls
+Hook& counted_hook(bool count_calls) {
+    static std::array<Hook, 2> hooks = [] {
+        ur::inline_hook::HookOptions options;
+        options.count_calls = true;
+        return std::array<Hook, 2>{
+            Hook(targets().address(2), reinterpret_cast<Hook::Callback>(&replacement)),
+            Hook(targets().address(3), reinterpret_cast<Hook::Callback>(&replacement), true, options)};
+    }();
+    return hooks[count_calls ? 1 : 0];
+}
+
+void BM_CallCounted(benchmark::State& state) {
+    const bool count_calls = state.range(0) != 0;
+    auto func = reinterpret_cast<int (*)(int)>(targets().address(count_calls ? 3 : 2));
+    counted_hook(count_calls);
+    int value = 0;
+    for (auto _ : state) {
+        value = func(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_CallCounted)->Arg(0)->Arg(1)->ThreadRange(1, 8);
+
+// --- Chain depth ---
+
+constexpr size_t kMaxChainDepth = 10;
+std::array<Hook*, kMaxChainDepth> g_chain{};
+
+template <size_t I>
+int chain_callback(int x) {
+    return g_chain[I]->call_original<int>(x) + 1;
+}
+
+template <size_t... I>
+constexpr std::array<Hook::Callback, sizeof...(I)> make_chain_callbacks(std::index_sequence<I...>) {
+    return {reinterpret_cast<Hook::Callback>(&chain_callback<I>)...};
+}
+
+void BM_CallChain(benchmark::State& state) {
+    static const auto callbacks = make_chain_callbacks(std::make_index_sequence<kMaxChainDepth>{});
+    const auto depth = static_cast<size_t>(state.range(0));
+    const uintptr_t target = targets().address(1);
+
+    std::vector<Hook> hooks;
+    hooks.reserve(depth);
+    for (size_t i = 0; i < depth; ++i) {
+        hooks.emplace_back(target, callbacks[i]);
+        g_chain[i] = &hooks.back();
+    }
+
+    auto func = reinterpret_cast<int (*)(int)>(target);
+    int value = 0;
+    for (auto _ : state) {
+        value = func(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.counters["depth"] = static_cast<double>(depth);
+}
+BENCHMARK(BM_CallChain)->DenseRange(1, kMaxChainDepth, 3);
+
+} // namespace
@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+
+#include "ur/maps_parser.h"
+#include "ur/memory.h"
+
+namespace {
+
+void BM_MapsParserParse(benchmark::State& state) {
+    for (auto _ : state) {
+        auto maps = ur::maps_parser::MapsParser::parse();
+        benchmark::DoNotOptimize(maps.data());
+    }
+}
+BENCHMARK(BM_MapsParserParse)->Unit(benchmark::kMicrosecond);
+
+void BM_MapsSnapshotCapture(benchmark::State& state) {
+    for (auto _ : state) {
+        auto snapshot = ur::maps_parser::MapsSnapshot::capture();
+        benchmark::DoNotOptimize(snapshot.get());
+    }
+}
+BENCHMARK(BM_MapsSnapshotCapture)->Unit(benchmark::kMicrosecond);
+
+void BM_FindMappedRegion(benchmark::State& state) {
+    const auto address = reinterpret_cast<uintptr_t>(&BM_FindMappedRegion);
+    for (auto _ : state) {
+        ur::memory::MappedRegion region;
+        benchmark::DoNotOptimize(ur::memory::find_mapped_region(address, region));
+    }
+}
+BENCHMARK(BM_FindMappedRegion);
+
+} // namespace
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+
+#include "ur/mid_hook.h"
+
+namespace {
+
+__attribute__((noinline)) int mid_target(int x) {
+    asm volatile("nop\n nop\n nop\n nop\n nop");
+    return x + 1;
+}
+
+void empty_callback(ur::mid_hook::CpuContext* context) {
+    benchmark::DoNotOptimize(context->gpr[0]);
+}
+
+// range(0): 0 = all GPRs (default), 1 = arguments_only(), 2 = arguments_only() + flags + SIMD
+ur::mid_hook::MidHookOptions options_for(int64_t variant) {
+    if (variant == 0) return {};
+    auto options = ur::mid_hook::MidHookOptions::arguments_only();
+    if (variant == 2) {
+        options.save_flags = true;
+        options.save_simd = true;
+    }
+    return options;
+}
+
+void BM_MidHookCall(benchmark::State& state) {
+    ur::mid_hook::MidHook hook(reinterpret_cast<uintptr_t>(&mid_target), &empty_callback,
+                               options_for(state.range(0)));
+    int value = 0;
+    for (auto _ : state) {
+        value = mid_target(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_MidHookCall)->Arg(0)->Arg(1)->Arg(2);
+
+void BM_MidHookInstall(benchmark::State& state) {
+    for (auto _ : state) {
+        ur::mid_hook::MidHook hook(reinterpret_cast<uintptr_t>(&mid_target), &empty_callback);
+        benchmark::DoNotOptimize(hook.is_valid());
+    }
+}
+BENCHMARK(BM_MidHookInstall)->Unit(benchmark::kMicrosecond);
+
+} // namespace
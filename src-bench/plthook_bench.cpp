@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include "ur/plthook.h"
+
+namespace {
+
+pid_t my_getpid() {
+    return 0;
+}
+
+// 用于 dladdr 获取主可执行文件基址
+int local_marker() {
+    return 0;
+}
+
+uintptr_t main_base() {
+    Dl_info info{};
+    dladdr(reinterpret_cast<const void*>(&local_marker), &info);
+    return reinterpret_cast<uintptr_t>(info.dli_fbase);
+}
+
+void BM_PltHookConstruct(benchmark::State& state) {
+    const uintptr_t base = main_base();
+    for (auto _ : state) {
+        ur::plthook::Hook hook(base);
+        benchmark::DoNotOptimize(hook.is_valid());
+    }
+}
+BENCHMARK(BM_PltHookConstruct)->Unit(benchmark::kMicrosecond);
+
+void BM_PltHookSymbol(benchmark::State& state) {
+    // The direct call makes sure the executable imports getpid through its PLT.
+    benchmark::DoNotOptimize(getpid());
+
+    ur::plthook::Hook hook(main_base());
+    if (!hook.is_valid()) {
+        state.SkipWithError("Failed to parse the main executable");
+        return;
+    }
+    for (auto _ : state) {
+        void* original = nullptr;
+        bool ok = hook.hook_symbol("getpid", reinterpret_cast<void*>(&my_getpid), &original);
+        benchmark::DoNotOptimize(ok);
+        hook.unhook_symbol("getpid");
+    }
+}
+BENCHMARK(BM_PltHookSymbol);
+
+} // namespace
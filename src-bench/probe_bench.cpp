@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+#include "ur/probe.h"
+
+namespace {
+
+__attribute__((noinline)) int probe_target(int x) {
+    asm volatile("nop\n nop\n nop\n nop\n nop");
+    return x + 1;
+}
+
+// Installed once and shared by all threads.
+void install_probe() {
+    static ur::probe::Probe probe(reinterpret_cast<uintptr_t>(&probe_target));
+}
+
+// range(0): 0 = nothing drains, so once a thread's ring is full every hit takes the
+// drop path; 1 = a consumer thread drains all rings while the threads record.
+void BM_ProbeHit(benchmark::State& state) {
+    install_probe();
+    static std::atomic<bool> stop{false};
+    static std::thread consumer;
+    if (state.thread_index() == 0 && state.range(0) != 0) {
+        stop = false;
+        consumer = std::thread([] {
+            while (!stop) ur::probe::drain([](const ur::probe::Batch& batch) { benchmark::DoNotOptimize(batch); });
+        });
+    }
+
+    int value = 0;
+    for (auto _ : state) {
+        value = probe_target(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0 && state.range(0) != 0) {
+        stop = true;
+        consumer.join();
+    }
+}
+BENCHMARK(BM_ProbeHit)->Arg(0)->Arg(1)->ThreadRange(1, 8);
+
+void BM_ProbeDrain(benchmark::State& state) {
+    install_probe();
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t i = 0; i < ur::probe::kRingCapacity; ++i) benchmark::DoNotOptimize(probe_target(0));
+        state.ResumeTiming();
+        ur::probe::drain([](const ur::probe::Batch& batch) { benchmark::DoNotOptimize(batch.records.data()); });
+    }
+    state.SetItemsProcessed(state.iterations() * ur::probe::kRingCapacity);
+}
+BENCHMARK(BM_ProbeDrain);
+
+} // namespace
@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 #include "ur/assembler.h"
 #include <capstone/capstone.h>
+#include <array>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -193,6 +194,35 @@ TEST(AssemblerTest, LoadStorePairInstructions) {
     EXPECT_EQ(instructions[3], "ldp x6, x7, [sp, #-0x20]");
 }
 
+TEST(AssemblerTest, SimdLoadStorePairInstructions) {
+    using namespace ur::assembler;
+    Assembler assembler(0);
+    assembler.stp(Register::Q0, Register::Q1, Register::SP, 272);
+    assembler.ldp(Register::Q30, Register::Q31, Register::SP, 752);
+    assembler.stp(Register::D8, Register::D9, Register::SP, 16);
+    auto instructions = disassemble(assembler.get_code(), 0);
+    ASSERT_EQ(instructions.size(), 3);
+    EXPECT_EQ(instructions[0], "stp q0, q1, [sp, #0x110]");
+    EXPECT_EQ(instructions[1], "ldp q30, q31, [sp, #0x2f0]");
+    EXPECT_EQ(instructions[2], "stp d8, d9, [sp, #0x10]");
+    EXPECT_THROW(assembler.stp(Register::X0, Register::X1, Register::SP, 512), std::runtime_error);
+}
+
+TEST(AssemblerTest, SimdStoreInstructions) {
+    using namespace ur::assembler;
+    Assembler assembler(0);
+    assembler.str(Register::Q2, Register::X3, 32);
+    assembler.str(Register::D0, Register::X1, 16);
+    assembler.str(Register::S4, Register::X5, -4); // STUR
+    assembler.str(Register::X0, Register::X1, 8);
+    const auto& code = assembler.get_code();
+    ASSERT_EQ(code.size(), 4);
+    EXPECT_EQ(code[0], 0x3D800862u);
+    EXPECT_EQ(code[1], 0xFD000820u);
+    EXPECT_EQ(code[2], 0xBC1FC0A4u);
+    EXPECT_EQ(code[3], 0xF9000420u);
+}
+
 TEST(AssemblerTest, LoadLiteralInstruction) {
     using namespace ur::assembler;
     Assembler assembler(0x1000);
@@ -588,6 +618,18 @@ TEST(AssemblerTest, SystemInstructionsMrsMsr) {
     EXPECT_EQ(instructions[7], "msr tpidr_el0, x3");
 }
 
+TEST(AssemblerTest, SystemInstructionsGenericTimer) {
+    using namespace ur::assembler;
+    Assembler assembler(0);
+    assembler.mrs(Register::X4, SystemRegister::CNTVCT_EL0);
+    assembler.mrs(Register::X5, SystemRegister::CNTFRQ_EL0);
+
+    auto instructions = disassemble(assembler.get_code(), 0);
+    ASSERT_EQ(instructions.size(), 2);
+    EXPECT_EQ(instructions[0], "mrs x4, cntvct_el0");
+    EXPECT_EQ(instructions[1], "mrs x5, cntfrq_el0");
+}
+
 TEST(AssemblerTest, IsbInstruction) {
     using namespace ur::assembler;
     Assembler assembler(0);
@@ -630,6 +672,8 @@ TEST(AssemblerTest, AllMemoryBarrierOptionsForDMB) {
         { BarrierOption::NSH,  "dmb nsh" },
         { BarrierOption::ISH,  "dmb ish" },
         { BarrierOption::SY,   "dmb sy"  },
+        { BarrierOption::ISHST, "dmb ishst" },
+        { BarrierOption::ISHLD, "dmb ishld" },
     };
 
     for (const auto& tc : test_cases) {
@@ -656,6 +700,21 @@ TEST(AssemblerTest, ExclusiveAccessInstructions) {
     EXPECT_EQ(instructions[3], "stlxr w7, w8, [x9]");
 }
 
+TEST(AssemblerTest, AtomicMemoryInstructions) {
+    using namespace ur::assembler;
+    Assembler assembler(0);
+    assembler.ldadd(Register::X0, Register::X1, Register::X2);
+    assembler.ldadd(Register::W3, Register::W4, Register::X5);
+    assembler.stadd(Register::X6, Register::X7);
+    assembler.stadd(Register::W8, Register::SP);
+    auto instructions = disassemble(assembler.get_code(), 0);
+    ASSERT_EQ(instructions.size(), 4);
+    EXPECT_EQ(instructions[0], "ldadd x0, x1, [x2]");
+    EXPECT_EQ(instructions[1], "ldadd w3, w4, [x5]");
+    EXPECT_EQ(instructions[2], "stadd x6, [x7]");
+    EXPECT_EQ(instructions[3], "stadd w8, [sp]");
+}
+
 TEST(AssemblerTest, LoadAcquireStoreReleaseInstructions) {
     using namespace ur::assembler;
     Assembler assembler(0);
@@ -696,3 +755,70 @@ TEST(AssemblerTest, HalfwordAndByteLoadStoreInstructions) {
     EXPECT_EQ(instructions[7], "strh w14, [x15, #4]");
     EXPECT_EQ(instructions[8], "strb w16, [x17, #2]");
 }
+
+TEST(AssemblerTest, EmitIntoExternalBuffer) {
+    using namespace ur::assembler;
+    std::array<uint32_t, 7> buffer{};
+    Assembler assembler(0x1000, buffer);
+    assembler.gen_abs_jump(0x123456789ABCDEF0, Register::X16);
+    assembler.emit_quad(0x1122334455667788);
+    EXPECT_TRUE(assembler.get_code().empty());
+    EXPECT_EQ(assembler.get_code_size(), 28);
+    EXPECT_EQ(assembler.get_current_address(), 0x101C);
+
+    auto code = assembler.get_code_span();
+    ASSERT_EQ(code.data(), buffer.data());
+    auto instructions = disassemble(std::vector<uint32_t>(code.begin(), code.begin() + 5), 0x1000);
+    ASSERT_EQ(instructions.size(), 5);
+    EXPECT_EQ(instructions[0], "mov x16, #0xdef0");
+    EXPECT_EQ(instructions[4], "br x16");
+    EXPECT_EQ(buffer[5], 0x55667788u);
+    EXPECT_EQ(buffer[6], 0x11223344u);
+
+    ASSERT_THROW(assembler.nop(), std::runtime_error);
+    EXPECT_EQ(assembler.get_code_size(), 28);
+}
+
+TEST(AssemblerTest, RangeChecksMatchEncoders) {
+    using namespace ur::assembler;
+    EXPECT_TRUE(Assembler::can_encode_b(0x10000000, 0x10000000 + 134217724));
+    EXPECT_TRUE(Assembler::can_encode_b(0x10000000, 0x10000000 - 134217728));
+    EXPECT_FALSE(Assembler::can_encode_b(0x10000000, 0x10000000 + 134217728));
+    EXPECT_FALSE(Assembler::can_encode_b(0x1000, 0x1002));
+    EXPECT_TRUE(Assembler::can_encode_b_cond(0x200000, 0x100000));
+    EXPECT_FALSE(Assembler::can_encode_b_cond(0x200000, 0x300000));
+    EXPECT_TRUE(Assembler::can_encode_tbz(0x10000, 0x10000 - 32768));
+    EXPECT_FALSE(Assembler::can_encode_tbz(0x10000, 0x10000 + 32768));
+    EXPECT_TRUE(Assembler::can_encode_adr(0x1000, 0x1001));
+    EXPECT_TRUE(Assembler::can_encode_adrp(0x100000000, 0x1FFFFFFFF));
+    EXPECT_FALSE(Assembler::can_encode_adrp(0x100000000, 0x200000000));
+
+    // 反向的 CBZ/CBNZ 与 B.cond 范围相同
+    Assembler assembler(0x2000);
+    assembler.cbz(Register::X0, 0x1000);
+    assembler.cbnz(Register::X1, 0x1004);
+    auto instructions = disassemble(assembler.get_code(), 0x2000);
+    ASSERT_EQ(instructions.size(), 2);
+    EXPECT_EQ(instructions[0], "cbz x0, #0x1000");
+    EXPECT_EQ(instructions[1], "cbnz x1, #0x1004");
+}
+
+TEST(AssemblerTest, TryFormsEmitNothingWhenOutOfRange) {
+    using namespace ur::assembler;
+    Assembler assembler(0x1000);
+    EXPECT_FALSE(assembler.try_b(0x100000000));
+    EXPECT_FALSE(assembler.try_bl(0x100000000));
+    EXPECT_FALSE(assembler.try_b(Condition::EQ, 0x200000));
+    EXPECT_FALSE(assembler.try_adrp(Register::X0, 0x1000000000));
+    EXPECT_EQ(assembler.get_code_size(), 0);
+    EXPECT_EQ(assembler.get_current_address(), 0x1000);
+
+    EXPECT_TRUE(assembler.try_b(0x2000));
+    EXPECT_TRUE(assembler.try_b(Condition::NE, 0x1000));
+    EXPECT_TRUE(assembler.try_adrp(Register::X16, 0x80001234));
+    auto instructions = disassemble(assembler.get_code(), 0x1000);
+    ASSERT_EQ(instructions.size(), 3);
+    EXPECT_EQ(instructions[0], "b #0x2000");
+    EXPECT_EQ(instructions[1], "b.ne #0x1000");
+    EXPECT_EQ(instructions[2], "adrp x16, #0x80001000");
+}
@@ -0,0 +1,75 @@
+#include "ur/cache_maintenance.h"
+#include "ur/exec_pool.h"
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace {
+    // mov w0, #imm; ret
+    void emit_return(uint32_t* code, uint32_t value) {
+        code[0] = 0x52800000 | (value << 5);
+        code[1] = 0xd65f03c0;
+    }
+}
+
+TEST(CacheMaintenanceTest, ReadsLineSizesFromCtr) {
+    const auto& cache = ur::cache_maintenance::info();
+    EXPECT_GE(cache.icache_line, 4u);
+    EXPECT_GE(cache.dcache_line, 4u);
+    EXPECT_EQ(cache.icache_line & (cache.icache_line - 1), 0u);
+    EXPECT_EQ(cache.dcache_line & (cache.dcache_line - 1), 0u);
+    // Read once
+    EXPECT_EQ(&cache, &ur::cache_maintenance::info());
+}
+
+TEST(CacheMaintenanceTest, SyncCodeThroughWritableAlias) {
+    void* code = ur::exec_pool::allocate(8);
+    ASSERT_NE(code, nullptr);
+    auto* view = static_cast<uint32_t*>(ur::exec_pool::writable(code));
+    ASSERT_NE(view, nullptr);
+    const auto address = reinterpret_cast<uintptr_t>(code);
+    auto fn = reinterpret_cast<int (*)()>(code);
+
+    emit_return(view, 1);
+    ur::cache_maintenance::sync_code(address, reinterpret_cast<uintptr_t>(view), 8);
+    EXPECT_EQ(fn(), 1);
+
+    // Rewriting code that has already run must not leave stale instructions behind
+    emit_return(view, 2);
+    ur::cache_maintenance::sync_code(address, reinterpret_cast<uintptr_t>(view), 8);
+    EXPECT_EQ(fn(), 2);
+
+    ur::exec_pool::free(code);
+}
+
+TEST(CacheMaintenanceTest, BatchMergesRanges) {
+    ur::cache_maintenance::Batch batch;
+    EXPECT_TRUE(batch.empty());
+    batch.add(0x1000, 16);
+    batch.add(0x2000, 16);
+    batch.add(0x1010, 8);  // Adjacent to the first
+    batch.add(0x1008, 4);  // Inside the first
+    EXPECT_EQ(batch.size(), 2u);
+    batch.add(0x1018, 0x1000 - 0x18); // Bridges the gap
+    EXPECT_EQ(batch.size(), 1u);
+    batch.clear();
+    EXPECT_TRUE(batch.empty());
+}
+
+TEST(CacheMaintenanceTest, BatchFlushesEveryRange) {
+    constexpr size_t kFunctions = 4;
+    void* code[kFunctions];
+    ur::cache_maintenance::Batch batch;
+    for (size_t i = 0; i < kFunctions; ++i) {
+        code[i] = ur::exec_pool::allocate(8);
+        ASSERT_NE(code[i], nullptr);
+        auto* view = static_cast<uint32_t*>(ur::exec_pool::writable(code[i]));
+        emit_return(view, static_cast<uint32_t>(10 + i));
+        batch.add(reinterpret_cast<uintptr_t>(code[i]), reinterpret_cast<uintptr_t>(view), 8);
+    }
+    batch.flush();
+    for (size_t i = 0; i < kFunctions; ++i) {
+        EXPECT_EQ(reinterpret_cast<int (*)()>(code[i])(), static_cast<int>(10 + i));
+        ur::exec_pool::free(code[i]);
+    }
+}
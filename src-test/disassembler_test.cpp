@@ -543,3 +543,151 @@ TEST(DisassemblerTest, FloatAndExclusiveInstructions) {
     EXPECT_EQ(std::get<ur::assembler::Register>(instrs[6].operands[0].value), ur::assembler::Register::X14);
     EXPECT_EQ(std::get<ur::assembler::Register>(instrs[6].operands[1].value), ur::assembler::Register::X15);
 }
+
+TEST(DisassemblerTest, FastDecodeAndLazyFormat) {
+    ur::assembler::Assembler assembler(0x6000);
+    assembler.adrp(ur::assembler::Register::X16, 0x9000);
+    assembler.add(ur::assembler::Register::X16, ur::assembler::Register::X16, 0x123);
+    assembler.b(ur::assembler::Condition::NE, 0x6100);
+    const auto& code = assembler.get_code();
+    ASSERT_EQ(code.size(), 3);
+
+    ur::disassembler::DecodedInsn adrp;
+    ASSERT_TRUE(ur::disassembler::decode(0x6000, code[0], adrp));
+    EXPECT_EQ(adrp.id, ur::disassembler::InstructionId::ADRP);
+    EXPECT_TRUE(adrp.is_pc_relative);
+    EXPECT_EQ(adrp.raw, code[0]);
+    ASSERT_EQ(adrp.operand_count, 2);
+    EXPECT_EQ(adrp.operands[0].reg, ur::assembler::Register::X16);
+    EXPECT_EQ(adrp.operands[1].imm, 0x9000);
+
+    ur::disassembler::DecodedInsn add;
+    ASSERT_TRUE(ur::disassembler::decode(0x6004, code[1], add));
+    EXPECT_EQ(add.id, ur::disassembler::InstructionId::ADD);
+    ASSERT_EQ(add.operand_count, 3);
+    EXPECT_EQ(add.operands[2].type, ur::disassembler::OperandType::IMMEDIATE);
+    EXPECT_EQ(add.operands[2].imm, 0x123);
+
+    ur::disassembler::DecodedInsn bne;
+    ASSERT_TRUE(ur::disassembler::decode(0x6008, code[2], bne));
+    EXPECT_EQ(bne.id, ur::disassembler::InstructionId::B_COND);
+    EXPECT_EQ(bne.cond, ur::assembler::Condition::NE);
+    EXPECT_EQ(bne.operands[0].imm, 0x6100);
+
+    // Text is only produced on request and matches the full Disassemble() output.
+    std::string mnemonic, op_str;
+    ur::disassembler::format(bne, mnemonic, op_str);
+    EXPECT_EQ(mnemonic, "b.ne");
+    EXPECT_EQ(op_str, format_address(0x6100));
+
+    auto disassembler = ur::disassembler::CreateAArch64Disassembler();
+    auto instructions = disassembler->Disassemble(0x6000, reinterpret_cast<const uint8_t*>(code.data()),
+                                                  code.size() * sizeof(uint32_t), code.size());
+    ASSERT_EQ(instructions.size(), 3);
+    auto converted = ur::disassembler::to_instruction(add);
+    EXPECT_EQ(converted.mnemonic, instructions[1].mnemonic);
+    EXPECT_EQ(converted.op_str, instructions[1].op_str);
+    EXPECT_EQ(converted.bytes, instructions[1].bytes);
+    ASSERT_EQ(converted.operands.size(), instructions[1].operands.size());
+    EXPECT_EQ(std::get<int64_t>(converted.operands[2].value), 0x123);
+
+    ur::disassembler::DecodedInsn unknown;
+    EXPECT_FALSE(ur::disassembler::decode(0x6010, 0x00000000, unknown));
+    EXPECT_EQ(unknown.id, ur::disassembler::InstructionId::INVALID);
+}
+
+TEST(DisassemblerTest, LiteralLoadVariants) {
+    using ur::disassembler::InstructionId;
+
+    ur::disassembler::DecodedInsn insn;
+    ASSERT_TRUE(ur::disassembler::decode(0x7000, 0x98000041, insn)); // ldrsw x1, #+8
+    EXPECT_EQ(insn.id, InstructionId::LDRSW_LIT);
+    EXPECT_TRUE(insn.is_pc_relative);
+    EXPECT_EQ(insn.operands[0].reg, ur::assembler::Register::X1);
+    EXPECT_EQ(insn.operands[1].imm, 0x7008);
+
+    ASSERT_TRUE(ur::disassembler::decode(0x7004, 0xD8000080, insn)); // prfm pldl1keep, #+16
+    EXPECT_EQ(insn.id, InstructionId::PRFM_LIT);
+    EXPECT_TRUE(insn.is_pc_relative);
+    EXPECT_EQ(insn.operands[0].type, ur::disassembler::OperandType::IMMEDIATE);
+    EXPECT_EQ(insn.operands[1].imm, 0x7014);
+
+    ASSERT_TRUE(ur::disassembler::decode(0x7008, 0x5CFFFFE2, insn)); // ldr d2, #-4
+    EXPECT_EQ(insn.id, InstructionId::LDR_LIT);
+    EXPECT_EQ(insn.operands[0].reg, ur::assembler::Register::D2);
+    EXPECT_EQ(insn.operands[1].imm, 0x7004);
+
+    ASSERT_TRUE(ur::disassembler::decode(0x700c, 0x9C000023, insn)); // ldr q3, #+4
+    EXPECT_EQ(insn.operands[0].reg, ur::assembler::Register::Q3);
+    EXPECT_EQ(insn.operands[1].imm, 0x7010);
+
+    ASSERT_TRUE(ur::disassembler::decode(0x7010, 0x18000024, insn)); // ldr w4, #+4
+    EXPECT_EQ(insn.id, InstructionId::LDR_LIT);
+    EXPECT_EQ(insn.operands[0].reg, ur::assembler::Register::W4);
+
+    std::string mnemonic, op_str;
+    ASSERT_TRUE(ur::disassembler::decode(0x7000, 0x98000041, insn));
+    ur::disassembler::format(insn, mnemonic, op_str);
+    EXPECT_EQ(mnemonic, "ldrsw");
+    EXPECT_EQ(op_str, "x1, " + format_address(0x7008));
+
+    EXPECT_FALSE(ur::disassembler::decode(0x7014, 0xDC000000, insn)); // SIMD&FP opc 11 is unallocated
+}
+
+TEST(DisassemblerTest, LoadStoreAccessForms) {
+    using ur::assembler::Register;
+    using ur::disassembler::InstructionId;
+
+    struct Case {
+        uint32_t word;
+        InstructionId id;
+        Register rt;
+        int32_t displacement;
+        const char* text;
+    };
+    const Case cases[] = {
+        {0xF9400420, InstructionId::LDR, Register::X0, 8, "ldr x0, [x1, #8]"},
+        {0x39400C41, InstructionId::LDRB, Register::W1, 3, "ldrb w1, [x2, #3]"},
+        {0x79400C41, InstructionId::LDRH, Register::W1, 6, "ldrh w1, [x2, #6]"},
+        {0xB9800883, InstructionId::LDRSW, Register::X3, 8, "ldrsw x3, [x4, #8]"},
+        {0x398004C5, InstructionId::LDRSB, Register::X5, 1, "ldrsb x5, [x6, #1]"},
+        {0x79C00507, InstructionId::LDRSH, Register::W7, 2, "ldrsh w7, [x8, #2]"},
+        {0x39001149, InstructionId::STRB, Register::W9, 4, "strb w9, [x10, #4]"},
+        {0x7900098B, InstructionId::STRH, Register::W11, 4, "strh w11, [x12, #4]"},
+        {0xBD4004A4, InstructionId::LDR_FP, Register::S4, 4, "ldr s4, [x5, #4]"},
+        {0xFD400820, InstructionId::LDR_FP, Register::D0, 16, "ldr d0, [x1, #16]"},
+        {0x3D800862, InstructionId::STR_FP, Register::Q2, 32, "str q2, [x3, #32]"},
+    };
+    for (const auto& c : cases) {
+        SCOPED_TRACE(c.text);
+        ur::disassembler::DecodedInsn insn;
+        ASSERT_TRUE(ur::disassembler::decode(0x8000, c.word, insn));
+        EXPECT_EQ(insn.id, c.id);
+        EXPECT_FALSE(insn.is_pc_relative);
+        ASSERT_EQ(insn.operand_count, 2u);
+        EXPECT_EQ(insn.operands[0].reg, c.rt);
+        EXPECT_EQ(insn.operands[1].mem.displacement, c.displacement);
+        EXPECT_EQ(insn.operands[1].mem.index, Register::INVALID);
+
+        std::string mnemonic, op_str;
+        ur::disassembler::format(insn, mnemonic, op_str);
+        EXPECT_EQ(mnemonic + " " + op_str, c.text);
+    }
+
+    // PRFM's Rt is the prefetch operation, not a register
+    ur::disassembler::DecodedInsn insn;
+    ASSERT_TRUE(ur::disassembler::decode(0x8000, 0xF9800400, insn)); // prfm pldl1keep, [x0, #8]
+    EXPECT_EQ(insn.id, InstructionId::PRFM);
+    EXPECT_EQ(insn.operands[0].type, ur::disassembler::OperandType::IMMEDIATE);
+    EXPECT_EQ(insn.operands[1].mem.displacement, 8);
+
+    // The register-offset form records its index, so it is never taken for a plain offset
+    ASSERT_TRUE(ur::disassembler::decode(0x8000, 0x38626820, insn)); // ldrb w0, [x1, x2]
+    EXPECT_EQ(insn.id, InstructionId::LDRB);
+    EXPECT_EQ(insn.operands[0].reg, Register::W0);
+    EXPECT_EQ(insn.operands[1].mem.base, Register::X1);
+    EXPECT_EQ(insn.operands[1].mem.index, Register::X2);
+
+    EXPECT_FALSE(ur::disassembler::decode(0x8000, 0xB9C00000, insn)); // opc 11 with a 32-bit size is unallocated
+    EXPECT_FALSE(ur::disassembler::decode(0x8000, 0x3D400020, insn)); // ldr b0, [x1]: no B register operand
+}
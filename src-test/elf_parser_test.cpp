@@ -3,6 +3,11 @@
 #include <dlfcn.h>
 #include <string>
 
+// 仅存在于 .symtab 中的本地符号，用于测试文件回退模式
+extern "C" {
+__attribute__((noinline, used)) static int urhook_elf_parser_local_marker() { return 42; }
+}
+
 // A base fixture providing common functionality for setting up a parser for a given library.
 class ElfParserTestBase : public ::testing::Test {
 protected:
@@ -80,6 +85,24 @@ TEST_F(ElfParserLibcTest, FindNonExistentSymbol) {
     EXPECT_EQ(non_existent_symbol, 0);
 }
 
+TEST_F(ElfParserLibcTest, FindFunctionContainingAddress) {
+    const auto fopen_addr = reinterpret_cast<uintptr_t>(dlsym(handle, "fopen"));
+    ASSERT_NE(fopen_addr, 0u);
+
+    uintptr_t start = 0;
+    size_t size = 0;
+    ASSERT_TRUE(parser->find_function(fopen_addr + 4, start, size));
+    EXPECT_EQ(start, fopen_addr);
+    EXPECT_GT(size, 4u);
+
+    // 函数末尾之后不再属于 fopen
+    uintptr_t next_start = 0;
+    size_t next_size = 0;
+    if (parser->find_function(fopen_addr + size, next_start, next_size)) {
+        EXPECT_NE(next_start, fopen_addr);
+    }
+}
+
 // Test fixture specifically for the math library, libm.so
 class ElfParserLibmTest : public ElfParserTestBase {
 protected:
@@ -93,4 +116,42 @@ TEST_F(ElfParserLibmTest, FindMathFunctionSymbols) {
     VerifySymbol("sin");
     VerifySymbol("sqrt");
     VerifySymbol("log10");
-}
\ No newline at end of file
+}
+TEST_F(ElfParserLibcTest, FindSymbolsInBatch) {
+    static constexpr ur::elf_parser::SymbolKey kStrlen("strlen");
+    const ur::elf_parser::SymbolKey keys[] = {
+        kStrlen, "memcpy", "this_symbol_is_so_non_existent_it_has_its_own_zip_code", std::string("stdout"),
+    };
+    uintptr_t addresses[std::size(keys)] = {};
+
+    EXPECT_EQ(parser->find_symbols(keys, addresses), 3u);
+    EXPECT_EQ(addresses[0], reinterpret_cast<uintptr_t>(dlsym(handle, "strlen")));
+    EXPECT_EQ(addresses[1], reinterpret_cast<uintptr_t>(dlsym(handle, "memcpy")));
+    EXPECT_EQ(addresses[2], 0u);
+    EXPECT_EQ(addresses[3], reinterpret_cast<uintptr_t>(dlsym(handle, "stdout")));
+
+    // 单个查找与预先计算的哈希得到相同结果
+    EXPECT_EQ(parser->find_symbol(kStrlen), addresses[0]);
+}
+
+TEST(ElfParserFileTest, FileBackedSymtabLookup) {
+    Dl_info info{};
+    ASSERT_NE(dladdr(reinterpret_cast<const void*>(&urhook_elf_parser_local_marker), &info), 0);
+    const auto base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+
+    // 两个解析器共享同一份文件映射
+    auto first = ur::elf_parser::ElfFile::open("/proc/self/exe");
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(ur::elf_parser::ElfFile::open("/proc/self/exe"), first);
+
+    ur::elf_parser::ElfParser parser(base, "/proc/self/exe");
+    ASSERT_TRUE(parser.parse());
+    ASSERT_NE(parser.get_section_header_table(), nullptr);
+    EXPECT_NE(parser.get_section_header_table()->get_section_by_name(".text"), nullptr);
+
+    if (parser.get_section_header_table()->get_section_by_name(".symtab") == nullptr) {
+        GTEST_SKIP() << "test binary is stripped";
+    }
+    EXPECT_EQ(parser.find_symbol("urhook_elf_parser_local_marker"),
+              reinterpret_cast<uintptr_t>(&urhook_elf_parser_local_marker));
+}
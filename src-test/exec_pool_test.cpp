@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstring>
+#include "ur/exec_pool.h"
+#include "ur/jit.h"
+#include "ur/maps_parser.h"
+
+TEST(ExecPoolTest, SmallBlocksShareSlab) {
+    auto before = ur::exec_pool::get_stats();
+
+    void* a = ur::exec_pool::allocate(20);
+    void* b = ur::exec_pool::allocate(20);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 16, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 16, 0u);
+    EXPECT_EQ(ur::exec_pool::block_size(a), 32u);
+
+    auto during = ur::exec_pool::get_stats();
+    EXPECT_EQ(during.allocation_count, before.allocation_count + 2);
+    EXPECT_LE(during.slab_count, before.slab_count + 1);
+
+    ur::exec_pool::free(a);
+    ur::exec_pool::free(b);
+    EXPECT_EQ(ur::exec_pool::block_size(a), 0u);
+
+    auto after = ur::exec_pool::get_stats();
+    EXPECT_EQ(after.allocation_count, before.allocation_count);
+    EXPECT_EQ(after.bytes_in_use, before.bytes_in_use);
+}
+
+TEST(ExecPoolTest, FreedBlockIsReused) {
+    void* keep = ur::exec_pool::allocate(64);
+    void* a = ur::exec_pool::allocate(64);
+    void* b = ur::exec_pool::allocate(64);
+    ASSERT_NE(keep, nullptr);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+
+    auto before = ur::exec_pool::get_stats();
+    ur::exec_pool::free(a);
+    void* c = ur::exec_pool::allocate(32);
+    ASSERT_NE(c, nullptr);
+    // The hole left by `a` (or other free space) is reused instead of mapping new memory.
+    EXPECT_EQ(ur::exec_pool::get_stats().bytes_reserved, before.bytes_reserved);
+
+    ur::exec_pool::free(c);
+    ur::exec_pool::free(b);
+    ur::exec_pool::free(keep);
+}
+
+TEST(ExecPoolTest, NearAllocationIsWithinRange) {
+    auto target = reinterpret_cast<uintptr_t>(&ur::exec_pool::allocate);
+    void* mem = ur::exec_pool::allocate(20, target);
+    ASSERT_NE(mem, nullptr);
+
+    auto addr = reinterpret_cast<uintptr_t>(mem);
+    uintptr_t dist = addr > target ? addr - target : target - addr;
+    EXPECT_LE(dist, ur::exec_pool::kBranchRange);
+
+    ur::exec_pool::free(mem);
+}
+
+TEST(ExecPoolTest, NearAllocationsFillGapsInRange) {
+    // Dedicated mappings, so every one needs a fresh placement in the window
+    constexpr size_t kCount = 8;
+    constexpr size_t kSize = 256 * 1024;
+    auto target = reinterpret_cast<uintptr_t>(&ur::exec_pool::free);
+    void* blocks[kCount];
+    for (size_t i = 0; i < kCount; ++i) {
+        blocks[i] = ur::exec_pool::allocate(kSize, target);
+        ASSERT_NE(blocks[i], nullptr);
+        auto addr = reinterpret_cast<uintptr_t>(blocks[i]);
+        EXPECT_LE(addr > target ? addr + kSize - target : target - addr, ur::exec_pool::kBranchRange);
+    }
+    for (void* block : blocks) {
+        ur::exec_pool::free(block);
+    }
+}
+
+TEST(ExecPoolTest, LargeBlockAndExecution) {
+    void* large = ur::exec_pool::allocate(64 * 1024);
+    ASSERT_NE(large, nullptr);
+    EXPECT_GE(ur::exec_pool::block_size(large), 64u * 1024);
+    ur::exec_pool::free(large);
+
+    // Several JIT blobs should all be executable from pooled memory.
+    ur::jit::Jit jit1;
+    jit1.mov(ur::assembler::Register::W0, 1);
+    jit1.ret();
+    ur::jit::Jit jit2;
+    jit2.mov(ur::assembler::Register::W0, 2);
+    jit2.ret();
+
+    auto f1 = jit1.finalize<int(*)()>();
+    auto f2 = jit2.finalize<int(*)()>();
+    ASSERT_NE(f1, nullptr);
+    ASSERT_NE(f2, nullptr);
+    EXPECT_EQ(f1(), 1);
+    EXPECT_EQ(f2(), 2);
+}
+
+TEST(ExecPoolTest, FreeNullIsNoop) {
+    ur::exec_pool::free(nullptr);
+    EXPECT_EQ(ur::exec_pool::block_size(nullptr), 0u);
+    EXPECT_EQ(ur::exec_pool::allocate(0), nullptr);
+}
+
+TEST(ExecPoolTest, WritableAliasSharesMemoryWithExecutableView) {
+    void* block = ur::exec_pool::allocate(32);
+    ASSERT_NE(block, nullptr);
+    void* view = ur::exec_pool::writable(static_cast<char*>(block) + 8);
+    ASSERT_NE(view, nullptr);
+
+    const uint64_t value = 0x1122334455667788ull;
+    std::memcpy(view, &value, sizeof(value));
+    uint64_t read_back = 0;
+    std::memcpy(&read_back, static_cast<char*>(block) + 8, sizeof(read_back));
+    EXPECT_EQ(read_back, value);
+
+    if (ur::exec_pool::is_dual_mapped()) {
+        // 执行视图只读可执行，写入只能经由另一个地址上的别名
+        EXPECT_NE(view, static_cast<char*>(block) + 8);
+        EXPECT_GT(ur::exec_pool::get_stats().dual_mapped_bytes, 0u);
+        auto snapshot = ur::maps_parser::MapsSnapshot::capture();
+        const auto* exec_entry = snapshot->find_by_addr(reinterpret_cast<uintptr_t>(block));
+        ASSERT_NE(exec_entry, nullptr);
+        EXPECT_EQ(exec_entry->prot & PROT_WRITE, 0);
+        EXPECT_NE(exec_entry->prot & PROT_EXEC, 0);
+    } else {
+        EXPECT_EQ(view, static_cast<char*>(block) + 8);
+    }
+
+    int stack_value = 0;
+    EXPECT_EQ(ur::exec_pool::writable(&stack_value), nullptr);
+    EXPECT_EQ(ur::exec_pool::writable(nullptr), nullptr);
+    ur::exec_pool::free(block);
+}
+
+TEST(ExecPoolTest, WriteCodeUpdatesCodeInPlace) {
+    ur::jit::Jit jit;
+    jit.mov(ur::assembler::Register::W0, 1);
+    jit.ret();
+    auto func = jit.finalize<int(*)()>();
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func(), 1);
+
+    // 不修改页保护属性，直接改写已发布的代码
+    ur::assembler::Assembler replacement(reinterpret_cast<uintptr_t>(func));
+    replacement.mov(ur::assembler::Register::W0, 2);
+    ur::exec_pool::write_code(reinterpret_cast<void*>(func), replacement.get_code().data(), replacement.get_code_size());
+    EXPECT_EQ(func(), 2);
+}
+
+TEST(ExecPoolTest, ForkedChildGetsPrivateCopy) {
+    // Without fork_safety: a child writing pool memory must not change the parent's
+    void* block = ur::exec_pool::allocate(16);
+    ASSERT_NE(block, nullptr);
+    const uint32_t original[4] = {0xd503201f, 0xd503201f, 0xd503201f, 0xd65f03c0};
+    ur::exec_pool::write_code(block, original, sizeof(original));
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        alarm(10);
+        // The child sees the parent's code, then overwrites its own copy
+        if (std::memcmp(block, original, sizeof(original)) != 0) _exit(1);
+        if (ur::exec_pool::is_inherited(block)) _exit(2);
+        const uint32_t changed = 0xd4200000; // brk #0
+        ur::exec_pool::write_code(block, &changed, sizeof(changed));
+        _exit(*static_cast<const uint32_t*>(block) == changed ? 0 : 3);
+    }
+    ASSERT_GT(pid, 0);
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    EXPECT_EQ(std::memcmp(block, original, sizeof(original)), 0);
+    ur::exec_pool::free(block);
+}
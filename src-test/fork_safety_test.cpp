@@ -0,0 +1,150 @@
+#include "ur/fork_safety.h"
+#include "ur/exec_pool.h"
+#include "ur/inline_hook.h"
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+__attribute__((noinline)) int fork_target(int x) {
+    asm volatile("");
+    return x + 1;
+}
+
+__attribute__((noinline)) int fork_second_target(int x) {
+    asm volatile("");
+    return x + 2;
+}
+
+__attribute__((noinline)) int fork_child_target(int x) {
+    asm volatile("");
+    return x + 3;
+}
+
+// 通过 volatile 指针调用，防止编译器内联
+template <typename T>
+T opaque(T function) {
+    T volatile pointer = function;
+    return pointer;
+}
+
+int fork_callback(int x) {
+    return x * 100;
+}
+
+int fork_other_callback(int x) {
+    return x * 1000;
+}
+
+// 在子进程中运行 body，返回其退出码；子进程超时（如死锁）时返回 -1
+template <typename Body>
+int run_in_child(Body body) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        alarm(10);
+        _exit(body());
+    }
+    if (pid < 0) return -1;
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+class ForkSafetyTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        ur::fork_safety::disable();
+    }
+};
+
+} // namespace
+
+TEST_F(ForkSafetyTest, ChildInheritsHooks) {
+    ur::fork_safety::enable();
+    ASSERT_TRUE(ur::fork_safety::is_enabled());
+
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&fork_target),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_callback));
+    ASSERT_EQ(opaque(&fork_target)(2), 200);
+    EXPECT_FALSE(hook.is_inherited());
+
+    const int child = run_in_child([&] {
+        if (opaque(&fork_target)(3) != 300) return 1;
+        if (!hook.is_inherited()) return 2;
+        if (hook.disable()) return 3;
+        const auto state = ur::fork_safety::verify_inherited();
+        if (state.targets == 0 || state.intact != state.targets) return 4;
+        // 子进程中可以在其他目标上安装新 Hook
+        ur::inline_hook::Hook child_hook(reinterpret_cast<uintptr_t>(&fork_child_target),
+                                         reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_callback));
+        if (opaque(&fork_child_target)(4) != 400) return 5;
+        return 0;
+    });
+    EXPECT_EQ(child, 0);
+
+    // 父进程中 fork 时已存在的 Hook 同样被冻结，但继续生效
+    EXPECT_TRUE(hook.is_inherited());
+    EXPECT_EQ(opaque(&fork_target)(5), 500);
+    EXPECT_FALSE(hook.disable());
+    hook.set_detour(reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_other_callback));
+    EXPECT_EQ(opaque(&fork_target)(5), 500);
+
+    // 目标上的最后一个 Hook 被移除时只在本进程恢复原始代码
+    hook.unhook();
+    EXPECT_EQ(opaque(&fork_target)(5), 6);
+}
+
+TEST_F(ForkSafetyTest, InheritedTargetRejectsNewHooks) {
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&fork_second_target),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_callback));
+    ur::fork_safety::mark_inherited();
+    ASSERT_TRUE(hook.is_inherited());
+
+    EXPECT_THROW(ur::inline_hook::Hook(reinterpret_cast<uintptr_t>(&fork_second_target),
+                                       reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_other_callback)),
+                 std::runtime_error);
+    ur::inline_hook::HookBatch batch;
+    batch.add(reinterpret_cast<uintptr_t>(&fork_second_target),
+              reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_other_callback));
+    EXPECT_THROW(batch.commit(), std::runtime_error);
+    EXPECT_EQ(opaque(&fork_second_target)(1), 100);
+
+    if (ur::exec_pool::is_dual_mapped()) {
+        EXPECT_TRUE(ur::exec_pool::is_inherited(reinterpret_cast<void*>(hook.get_trampoline())));
+        EXPECT_GT(ur::exec_pool::get_stats().inherited_bytes, 0u);
+    }
+
+    hook.unhook();
+    EXPECT_EQ(opaque(&fork_second_target)(1), 3);
+}
+
+TEST_F(ForkSafetyTest, ForkDuringHookChurn) {
+    ur::fork_safety::enable();
+
+    // 另一个线程不断安装和移除 Hook，fork 可能发生在它持有注册表或内存池锁时
+    std::atomic<bool> stop{false};
+    std::thread churn([&] {
+        while (!stop.load()) {
+            ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&fork_second_target),
+                                       reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_callback));
+        }
+    });
+
+    for (int i = 0; i < 20; ++i) {
+        const int child = run_in_child([] {
+            ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&fork_child_target),
+                                       reinterpret_cast<ur::inline_hook::Hook::Callback>(&fork_callback));
+            return opaque(&fork_child_target)(1) == 100 ? 0 : 1;
+        });
+        EXPECT_EQ(child, 0) << "iteration " << i;
+    }
+
+    stop.store(true);
+    churn.join();
+}
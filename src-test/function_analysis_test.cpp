@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "ur/function_analysis.h"
+#include "ur/assembler.h"
+
+#include <dlfcn.h>
+
+#include <cstring>
+
+using ur::assembler::Register;
+
+// 带循环的函数，用于验证按符号大小确定的边界
+extern "C" __attribute__((noinline, used)) int urhook_function_analysis_marker(int count) {
+    int sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += i * i;
+        asm volatile("" : "+r"(sum));
+    }
+    return sum;
+}
+
+namespace {
+
+// 把汇编结果复制到 buffer 中，返回字节数
+size_t emit(ur::assembler::Assembler& assembler, uint32_t* buffer, size_t capacity) {
+    const auto& code = assembler.get_code();
+    EXPECT_LE(code.size(), capacity);
+    std::memcpy(buffer, code.data(), assembler.get_code_size());
+    return assembler.get_code_size();
+}
+
+} // namespace
+
+TEST(FunctionAnalysisTest, BuildsBlocksAndBranchTargets) {
+    uint32_t code[8] = {};
+    const auto base = reinterpret_cast<uintptr_t>(code);
+
+    //  0: mov x1, #0
+    //  4: cbz x0, done
+    //  8: loop: add x1, x1, #1
+    // 12: cmp x0, x1
+    // 16: b.ne loop
+    // 20: done: mov x0, x1
+    // 24: ret
+    ur::assembler::Assembler a(base);
+    a.mov(Register::X1, 0);
+    a.cbz(Register::X0, base + 20);
+    a.add(Register::X1, Register::X1, 1);
+    a.cmp(Register::X0, Register::X1);
+    a.b(ur::assembler::Condition::NE, base + 8);
+    a.mov(Register::X0, Register::X1);
+    a.ret();
+    const size_t size = emit(a, code, 8);
+    ASSERT_EQ(size, 28u);
+
+    auto function = ur::function_analysis::analyze(base, size);
+    ASSERT_NE(function, nullptr);
+    EXPECT_EQ(function->start(), base);
+    EXPECT_EQ(function->end(), base + 28);
+    EXPECT_FALSE(function->has_symbol_bounds());
+    EXPECT_FALSE(function->has_indirect_branches());
+
+    ASSERT_EQ(function->branch_targets().size(), 2u);
+    EXPECT_EQ(function->branch_targets()[0], base + 8);
+    EXPECT_EQ(function->branch_targets()[1], base + 20);
+
+    const auto& blocks = function->blocks();
+    ASSERT_EQ(blocks.size(), 3u);
+    EXPECT_EQ(blocks[0].start, base);
+    EXPECT_EQ(blocks[0].end, base + 8);
+    ASSERT_EQ(blocks[0].successor_count, 2);
+    EXPECT_EQ(blocks[0].successors[0], base + 8);
+    EXPECT_EQ(blocks[0].successors[1], base + 20);
+    EXPECT_EQ(blocks[1].start, base + 8);
+    EXPECT_EQ(blocks[1].end, base + 20);
+    ASSERT_EQ(blocks[1].successor_count, 2);
+    EXPECT_EQ(blocks[1].successors[1], base + 8);
+    EXPECT_EQ(blocks[2].start, base + 20);
+    EXPECT_EQ(blocks[2].successor_count, 0);
+    EXPECT_TRUE(blocks[2].exits);
+
+    EXPECT_EQ(function->block_at(base + 12), &blocks[1]);
+    EXPECT_EQ(function->block_at(base + 28), nullptr);
+
+    // 循环头位于 +8，入口只能覆盖 8 字节；循环体到 done 之前有 12 字节
+    EXPECT_EQ(function->max_patch_size(base, 20), 8u);
+    EXPECT_EQ(function->max_patch_size(base + 8, 20), 12u);
+    EXPECT_EQ(function->max_patch_size(base + 20, 20), 8u);
+    EXPECT_EQ(function->max_patch_size(base + 2, 20), 0u);
+
+    // 相同的边界直接命中缓存，按函数内地址查找也能找到
+    EXPECT_EQ(ur::function_analysis::analyze(base, size), function);
+    EXPECT_EQ(ur::function_analysis::analyze(base + 12), function);
+
+    ur::function_analysis::invalidate(base, size);
+    EXPECT_NE(ur::function_analysis::analyze(base, size), function);
+    ur::function_analysis::invalidate(base, size);
+}
+
+TEST(FunctionAnalysisTest, SweepWithoutSymbolStopsAfterLastReachedExit) {
+    uint32_t code[8] = {};
+    const auto base = reinterpret_cast<uintptr_t>(code);
+    ur::function_analysis::invalidate(base, sizeof(code));
+
+    //  0: cbz x0, +8
+    //  4: ret
+    //  8: mov x0, #1
+    // 12: ret
+    // 16: nop (not part of the function)
+    ur::assembler::Assembler a(base);
+    a.cbz(Register::X0, base + 8);
+    a.ret();
+    a.mov(Register::X0, 1);
+    a.ret();
+    a.nop();
+    emit(a, code, 8);
+
+    const size_t cached = ur::function_analysis::cache_size();
+    auto function = ur::function_analysis::analyze(base);
+    ASSERT_NE(function, nullptr);
+    EXPECT_FALSE(function->has_symbol_bounds());
+    EXPECT_EQ(function->start(), base);
+    EXPECT_EQ(function->size(), 16u);
+    EXPECT_EQ(function->blocks().size(), 3u);
+    EXPECT_EQ(function->max_patch_size(base, 20), 8u);
+
+    // 栈上的代码地址会被复用，扫描结果不进入缓存
+    EXPECT_EQ(ur::function_analysis::cache_size(), cached);
+}
+
+TEST(FunctionAnalysisTest, SymbolBoundsAreCachedPerFunction) {
+    const auto address = reinterpret_cast<uintptr_t>(&urhook_function_analysis_marker);
+    auto function = ur::function_analysis::analyze(address);
+    ASSERT_NE(function, nullptr);
+    if (!function->has_symbol_bounds()) {
+        GTEST_SKIP() << "no symbol for the test function";
+    }
+    EXPECT_EQ(function->start(), address);
+    EXPECT_GT(function->size(), 4u);
+    EXPECT_FALSE(function->blocks().empty());
+
+    // 函数中间的地址与重复分析都复用同一个结果
+    EXPECT_EQ(ur::function_analysis::analyze(address + 4), function);
+    EXPECT_EQ(ur::function_analysis::analyze(address), function);
+
+    // 入口不是循环头，可以放下至少一条 B
+    EXPECT_GE(function->max_patch_size(address, 20), 4u);
+    EXPECT_EQ(urhook_function_analysis_marker(4), 14);
+}
+
+TEST(FunctionAnalysisTest, UnloadedModuleIsDropped) {
+#if defined(__ANDROID__)
+    const char* library = "libz.so";
+#else
+    const char* library = "libz.so.1";
+#endif
+    // 只有由本测试加载的库才能确定会被卸载
+    if (void* loaded = dlopen(library, RTLD_NOW | RTLD_NOLOAD)) {
+        dlclose(loaded);
+        GTEST_SKIP() << library << " is already loaded";
+    }
+    void* handle = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        GTEST_SKIP() << library << " is not available";
+    }
+    const auto address = reinterpret_cast<uintptr_t>(dlsym(handle, "zlibVersion"));
+    ASSERT_NE(address, 0u);
+    auto function = ur::function_analysis::analyze(address);
+    ASSERT_NE(function, nullptr);
+    if (!function->has_symbol_bounds()) {
+        dlclose(handle);
+        GTEST_SKIP() << "no symbol for zlibVersion";
+    }
+    const auto marker = reinterpret_cast<uintptr_t>(&urhook_function_analysis_marker);
+    ASSERT_NE(ur::function_analysis::analyze(marker), nullptr);
+    const size_t cached = ur::function_analysis::cache_size();
+
+    dlclose(handle);
+    if (void* still_loaded = dlopen(library, RTLD_NOW | RTLD_NOLOAD)) {
+        dlclose(still_loaded);
+        GTEST_SKIP() << library << " was not unloaded";
+    }
+
+    // 下一次分析时丢弃已卸载模块的结果，仍加载的模块不受影响
+    ASSERT_NE(ur::function_analysis::analyze(marker), nullptr);
+    EXPECT_EQ(ur::function_analysis::cache_size(), cached - 1);
+}
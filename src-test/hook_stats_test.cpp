@@ -0,0 +1,253 @@
+#include "ur/hook_stats.h"
+#include "ur/inline_hook.h"
+#include "ur/mid_hook.h"
+#include "ur/plthook.h"
+#include "ur/vmt_hook.h"
+#include <gtest/gtest.h>
+
+#include <dlfcn.h>
+
+#include <atomic>
+#include <cstdio>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+__attribute__((noinline)) int stats_target(int x) {
+    asm volatile("");
+    return x + 1;
+}
+
+__attribute__((noinline)) int stats_mid_target(int a, int b) {
+    asm volatile("nop\n nop\n nop\n nop\n nop");
+    return a * b;
+}
+
+// 通过 volatile 指针调用，防止编译器内联
+template <typename T>
+T opaque(T function) {
+    T volatile pointer = function;
+    return pointer;
+}
+
+ur::inline_hook::Hook* g_stats_hook = nullptr;
+
+int stats_callback(int x) {
+    return g_stats_hook->call_original<int>(x) * 10;
+}
+
+int reentering_callback(int x) {
+    return opaque(&stats_target)(x) * 10;
+}
+
+void empty_mid_callback(ur::mid_hook::CpuContext*) {}
+
+class StatsClass {
+public:
+    virtual int value(int x) { return x * 2; }
+};
+
+int stats_method(StatsClass*, int x) {
+    return x * 3;
+}
+
+int stats_puts(const char*) {
+    return 0;
+}
+
+std::optional<ur::hook_stats::HookStats> find_stats(ur::hook_stats::HookKind kind, uintptr_t address) {
+    for (const auto& stats : ur::hook_stats::snapshot()) {
+        if (stats.kind == kind && stats.address == address) return stats;
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+TEST(HookStatsTest, CounterSumsShardsAndIsRecycled) {
+    auto* counter = ur::hook_stats::acquire_counter(ur::hook_stats::HookKind::Inline, 0x1000, "first");
+    ASSERT_NE(counter, nullptr);
+    EXPECT_EQ(counter->calls(), 0u);
+
+    // 各分片独占缓存行，读取时求和
+    auto* shards = const_cast<ur::hook_stats::Counter::Shard*>(counter->shards());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(shards) % ur::hook_stats::kCacheLineSize, 0u);
+    shards[0].calls += 3;
+    shards[ur::hook_stats::kShards - 1].calls += 4;
+    EXPECT_EQ(counter->calls(), 7u);
+
+    auto stats = find_stats(ur::hook_stats::HookKind::Inline, 0x1000);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->name, "first");
+    EXPECT_EQ(stats->calls, 7u);
+
+    ur::hook_stats::release_counter(counter);
+    EXPECT_FALSE(find_stats(ur::hook_stats::HookKind::Inline, 0x1000).has_value());
+
+    // 复用的计数器从 0 开始
+    auto* reused = ur::hook_stats::acquire_counter(ur::hook_stats::HookKind::Mid, 0x2000);
+    EXPECT_EQ(reused, counter);
+    EXPECT_EQ(reused->calls(), 0u);
+    EXPECT_EQ(reused->kind(), ur::hook_stats::HookKind::Mid);
+    EXPECT_TRUE(reused->name().empty());
+    ur::hook_stats::release_counter(reused);
+}
+
+TEST(HookStatsTest, InlineHookCountsCalls) {
+    ur::inline_hook::HookOptions options;
+    options.count_calls = true;
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&stats_target),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&stats_callback), true, options);
+    g_stats_hook = &hook;
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(opaque(&stats_target)(i), (i + 1) * 10);
+    }
+    EXPECT_EQ(hook.call_count(), 5u);
+
+    auto stats = find_stats(ur::hook_stats::HookKind::Inline, reinterpret_cast<uintptr_t>(&stats_target));
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->calls, 5u);
+
+    // 禁用期间不经过计数 thunk；更换 detour 后继续计数
+    EXPECT_TRUE(hook.disable());
+    EXPECT_EQ(opaque(&stats_target)(1), 2);
+    EXPECT_TRUE(hook.enable());
+    hook.set_detour(reinterpret_cast<ur::inline_hook::Hook::Callback>(&stats_callback));
+    EXPECT_EQ(opaque(&stats_target)(1), 20);
+    EXPECT_EQ(hook.call_count(), 6u);
+
+    ur::hook_stats::reset_all();
+    EXPECT_EQ(hook.call_count(), 0u);
+
+    hook.unhook();
+    g_stats_hook = nullptr;
+    EXPECT_EQ(hook.call_count(), 0u);
+    EXPECT_FALSE(find_stats(ur::hook_stats::HookKind::Inline, reinterpret_cast<uintptr_t>(&stats_target)).has_value());
+}
+
+TEST(HookStatsTest, UncountedHookReportsZero) {
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&stats_target),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&stats_callback));
+    g_stats_hook = &hook;
+    EXPECT_EQ(opaque(&stats_target)(1), 20);
+    EXPECT_EQ(hook.call_count(), 0u);
+    g_stats_hook = nullptr;
+    EXPECT_FALSE(find_stats(ur::hook_stats::HookKind::Inline, reinterpret_cast<uintptr_t>(&stats_target)).has_value());
+}
+
+TEST(HookStatsTest, CountsIncludeGuardBypasses) {
+    ur::inline_hook::HookOptions options;
+    options.count_calls = true;
+    options.recursion_guard = true;
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&stats_target),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&reentering_callback), true, options);
+
+    // 回调中的重入被保护跳过，但仍然经过计数
+    EXPECT_EQ(opaque(&stats_target)(4), 50);
+    EXPECT_EQ(hook.call_count(), 2u);
+}
+
+TEST(HookStatsTest, ThreadsCountWithoutLosingCalls) {
+    ur::inline_hook::HookOptions options;
+    options.count_calls = true;
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&stats_target),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&stats_callback), true, options);
+    g_stats_hook = &hook;
+
+    constexpr int kThreads = 8;
+    constexpr int kIterations = 20000;
+    std::atomic<bool> stop{false};
+    std::atomic<int> snapshots{0};
+    // 计数期间持续读取快照
+    std::thread reader([&] {
+        while (!stop) {
+            (void)ur::hook_stats::snapshot();
+            ++snapshots;
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < kIterations; ++i) opaque(&stats_target)(i);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    stop = true;
+    reader.join();
+
+    EXPECT_EQ(hook.call_count(), static_cast<uint64_t>(kThreads) * kIterations);
+    EXPECT_GT(snapshots, 0);
+    g_stats_hook = nullptr;
+}
+
+TEST(HookStatsTest, MidHookCountsHits) {
+    ur::mid_hook::MidHookOptions options = ur::mid_hook::MidHookOptions::arguments_only();
+    options.count_calls = true;
+    ur::mid_hook::MidHook hook(reinterpret_cast<uintptr_t>(&stats_mid_target), &empty_mid_callback, options);
+    ASSERT_TRUE(hook.is_valid());
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(opaque(&stats_mid_target)(3, 4), 12);
+    }
+    EXPECT_EQ(hook.call_count(), 3u);
+    auto stats = find_stats(ur::hook_stats::HookKind::Mid, reinterpret_cast<uintptr_t>(&stats_mid_target));
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->calls, 3u);
+
+    hook.unhook();
+    EXPECT_EQ(hook.call_count(), 0u);
+}
+
+TEST(HookStatsTest, VmHookCountsCalls) {
+    StatsClass instance;
+    StatsClass* pointer = opaque(&instance); // 防止去虚化
+    ur::VmtHook vmt(pointer);
+    ur::VmHookOptions options;
+    options.count_calls = true;
+    auto hook = vmt.hook_method(0, reinterpret_cast<void*>(&stats_method), options);
+
+    EXPECT_EQ(pointer->value(2), 6);
+    EXPECT_EQ(pointer->value(3), 9);
+    EXPECT_EQ(hook->call_count(), 2u);
+
+    EXPECT_TRUE(hook->disable());
+    EXPECT_EQ(pointer->value(2), 4);
+    EXPECT_TRUE(hook->enable());
+    EXPECT_EQ(pointer->value(2), 6);
+    EXPECT_EQ(hook->call_count(), 3u);
+
+    hook.reset();
+    EXPECT_EQ(pointer->value(2), 4);
+}
+
+TEST(HookStatsTest, PltHookCountsCalls) {
+    Dl_info info{};
+    ASSERT_NE(dladdr(reinterpret_cast<const void*>(&stats_target), &info), 0);
+    ur::plthook::Hook hook(reinterpret_cast<uintptr_t>(info.dli_fbase));
+    ASSERT_TRUE(hook.is_valid());
+
+    void* original = nullptr;
+    ASSERT_TRUE(hook.hook_symbol("puts", reinterpret_cast<void*>(&stats_puts), &original, true));
+    const auto* entry = hook.get_entry("puts");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->replacement, reinterpret_cast<void*>(&stats_puts));
+    EXPECT_NE(entry->installed(), entry->replacement);
+
+    puts("counted");
+    puts("counted");
+    EXPECT_EQ(entry->call_count(), 2u);
+    auto stats = find_stats(ur::hook_stats::HookKind::Plt, entry->got_addr);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->name, "puts");
+
+    // 重新 Hook 时保留计数 thunk
+    ASSERT_TRUE(hook.hook_symbol("puts", reinterpret_cast<void*>(&stats_puts), &original));
+    puts("counted");
+    EXPECT_EQ(hook.get_entry("puts")->call_count(), 3u);
+
+    ASSERT_TRUE(hook.unhook_symbol("puts"));
+    EXPECT_FALSE(find_stats(ur::hook_stats::HookKind::Plt, stats->address).has_value());
+}
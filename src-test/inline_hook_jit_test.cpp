@@ -88,3 +88,91 @@ TEST_F(InlineHookJitTest, LongDistanceHook) {
 
     std::cout << "--- LongDistanceHook Test Finished ---" << std::endl;
 }
+
+static ur::inline_hook::Hook* g_branch_hook = nullptr;
+
+int branch_hook_callback(uint64_t value) {
+    return g_branch_hook->call_original<int>(value) + 10;
+}
+
+TEST_F(InlineHookJitTest, RelocatedConditionalBranchKeepsCondition) {
+    // The first instruction is a CBZ, so the trampoline has to rebuild the conditional branch.
+    using ur::assembler::Register;
+    ur::jit::Jit jit_compiler;
+    auto zero = jit_compiler.new_label();
+    jit_compiler.cbz(Register::X0, zero);
+    jit_compiler.mov(Register::W0, 1);
+    jit_compiler.ret();
+    jit_compiler.bind(zero);
+    jit_compiler.mov(Register::W0, 2);
+    jit_compiler.ret();
+
+    auto jit_func = jit_compiler.finalize<int (*)(uint64_t)>();
+    ASSERT_NE(jit_func, nullptr);
+    ASSERT_EQ(jit_func(0), 2);
+    ASSERT_EQ(jit_func(3), 1);
+
+    {
+        ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(jit_func),
+                                   reinterpret_cast<ur::inline_hook::Hook::Callback>(&branch_hook_callback));
+        g_branch_hook = &hook;
+        ASSERT_TRUE(hook.is_valid());
+        EXPECT_EQ(jit_func(0), 12);
+        EXPECT_EQ(jit_func(3), 11);
+    }
+    g_branch_hook = nullptr;
+    EXPECT_EQ(jit_func(0), 2);
+}
+
+static ur::inline_hook::Hook* g_literal_hook = nullptr;
+
+int64_t signed_literal_hook_callback() {
+    return g_literal_hook->call_original<int64_t>() + 10;
+}
+
+double fp_literal_hook_callback() {
+    return g_literal_hook->call_original<double>() * 2;
+}
+
+TEST_F(InlineHookJitTest, RelocatedLiteralLoadsKeepWidthAndSign) {
+    // LDRSW (literal) must sign-extend and LDR (literal) into a D register must load the
+    // FP register; both are the first instruction, so the trampoline rebuilds them.
+    ur::jit::Jit signed_compiler;
+    signed_compiler.emit_word(0x98000000 | (16 / 4) << 5 | 0); // ldrsw x0, #+16
+    signed_compiler.emit_word(0xD8000000 | (12 / 4) << 5 | 0); // prfm pldl1keep, #+12
+    signed_compiler.ret();
+    signed_compiler.nop();
+    signed_compiler.emit_word(0xFFFFFFFB); // -5
+    signed_compiler.emit_word(0x12345678); // Must not leak into the upper half
+    auto signed_func = signed_compiler.finalize<int64_t (*)()>();
+    ASSERT_NE(signed_func, nullptr);
+    ASSERT_EQ(signed_func(), -5);
+
+    ur::jit::Jit fp_compiler;
+    fp_compiler.emit_word(0x5C000000 | (16 / 4) << 5 | 0); // ldr d0, #+16
+    fp_compiler.ret();
+    fp_compiler.nop();
+    fp_compiler.nop();
+    fp_compiler.emit_quad(0x4004000000000000); // 2.5
+    auto fp_func = fp_compiler.finalize<double (*)()>();
+    ASSERT_NE(fp_func, nullptr);
+    ASSERT_EQ(fp_func(), 2.5);
+
+    {
+        ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(signed_func),
+                                   reinterpret_cast<ur::inline_hook::Hook::Callback>(&signed_literal_hook_callback));
+        g_literal_hook = &hook;
+        ASSERT_TRUE(hook.is_valid());
+        EXPECT_EQ(signed_func(), 5);
+    }
+    {
+        ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(fp_func),
+                                   reinterpret_cast<ur::inline_hook::Hook::Callback>(&fp_literal_hook_callback));
+        g_literal_hook = &hook;
+        ASSERT_TRUE(hook.is_valid());
+        EXPECT_EQ(fp_func(), 5.0);
+    }
+    g_literal_hook = nullptr;
+    EXPECT_EQ(signed_func(), -5);
+    EXPECT_EQ(fp_func(), 2.5);
+}
@@ -1,5 +1,13 @@
 #include "ur/inline_hook.h"
+#include "ur/async_installer.h"
+#include "ur/capi.h"
+#include "ur/assembler.h"
+#include "ur/exec_pool.h"
 #include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -7,6 +15,9 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <cstring>
+#include <memory>
+#include <future>
 
 // --- Test Target Functions ---
 
@@ -496,3 +507,374 @@ TEST_F(InlineHookTest, MultiThreadedRaceOnHook) {
 
     std::cout << "--- MultiThreadedRaceOnHook Test Finished ---" << std::endl;
 }
+
+TEST_F(InlineHookTest, BatchInstall) {
+    std::vector<ur::inline_hook::Hook> hooks;
+    {
+        ur::inline_hook::HookBatch batch;
+        batch.add(reinterpret_cast<uintptr_t>(&target_function_to_hook),
+                  reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1))
+             .add(reinterpret_cast<uintptr_t>(&short_target_function),
+                  reinterpret_cast<ur::inline_hook::Hook::Callback>(&short_hook_callback));
+        ASSERT_EQ(batch.size(), 2);
+
+        hooks = batch.commit();
+        EXPECT_TRUE(batch.empty());
+    }
+    ASSERT_EQ(hooks.size(), 2);
+    ASSERT_TRUE(hooks[0].is_valid());
+    ASSERT_TRUE(hooks[1].is_valid());
+    g_hook1 = &hooks[0];
+
+    EXPECT_EQ(target_function_to_hook(5, 3), (5 + 3) + 10);
+    EXPECT_EQ(short_target_function(4), 99);
+    ASSERT_EQ(g_hook_call_log.size(), 2);
+    EXPECT_EQ(g_hook_call_log[0], "Hook 1 called");
+    EXPECT_EQ(g_hook_call_log[1], "Short hook called");
+
+    // Batch hooks behave like regular hooks afterwards.
+    ASSERT_TRUE(hooks[1].disable());
+    EXPECT_EQ(short_target_function(4), 8);
+
+    hooks.clear();
+    EXPECT_EQ(target_function_to_hook(5, 3), 8);
+    EXPECT_EQ(short_target_function(4), 8);
+}
+
+// Unlike short_hook_callback it does not log, so it can run on several threads
+static int concurrent_short_hook(int) {
+    return 99;
+}
+
+TEST_F(InlineHookTest, BatchInstallWithSuspendedThreads) {
+    // Callers keep running through the target while the batch patches it
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> bad_results{0};
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 3; ++i) {
+        callers.emplace_back([&]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                int value = short_target_function(4);
+                if (value != 8 && value != 99) bad_results.fetch_add(1, std::memory_order_relaxed);
+                calls.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    while (calls.load() == 0) {
+        std::this_thread::yield();
+    }
+
+    ur::inline_hook::BatchOptions options;
+    options.suspend_threads = true;
+    ur::inline_hook::HookBatch batch(options);
+    batch.add(reinterpret_cast<uintptr_t>(&short_target_function),
+              reinterpret_cast<ur::inline_hook::Hook::Callback>(&concurrent_short_hook));
+    std::vector<ur::inline_hook::Hook> hooks = batch.commit();
+    ASSERT_EQ(hooks.size(), 1);
+
+    const uint64_t installed_at = calls.load();
+    while (calls.load() < installed_at + 1000) {
+        std::this_thread::yield();
+    }
+    stop = true;
+    for (auto& caller : callers) {
+        caller.join();
+    }
+
+    EXPECT_EQ(bad_results.load(), 0u);
+    EXPECT_EQ(short_target_function(4), 99);
+    hooks.clear();
+    EXPECT_EQ(short_target_function(4), 8);
+}
+
+TEST_F(InlineHookTest, BatchRejectsInvalidRequest) {
+    ur::inline_hook::HookBatch batch;
+    batch.add(reinterpret_cast<uintptr_t>(&target_function_to_hook),
+              reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1))
+         .add(reinterpret_cast<uintptr_t>(&short_target_function), nullptr);
+
+    EXPECT_THROW(batch.commit(), std::invalid_argument);
+
+    // Nothing from the failed batch is installed.
+    EXPECT_EQ(target_function_to_hook(5, 3), 8);
+    EXPECT_TRUE(g_hook_call_log.empty());
+}
+
+TEST_F(InlineHookTest, BatchSetEnabledTogglesChainsInOnePass) {
+    const auto target = reinterpret_cast<uintptr_t>(&target_function_to_hook);
+    ur::inline_hook::Hook hook1(target, reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1));
+    g_hook1 = &hook1;
+    ur::inline_hook::Hook hook2(target, reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_2));
+    g_hook2 = &hook2;
+    ur::inline_hook::Hook short_hook(reinterpret_cast<uintptr_t>(&short_target_function),
+                                     reinterpret_cast<ur::inline_hook::Hook::Callback>(&short_hook_callback));
+
+    ur::inline_hook::HookBatch batch;
+    ur::inline_hook::Hook* all[] = {&hook1, &hook2, &short_hook};
+    ASSERT_TRUE(batch.set_enabled(all, false));
+    EXPECT_EQ(target_function_to_hook(5, 3), 8);
+    EXPECT_EQ(short_target_function(4), 8);
+    EXPECT_TRUE(g_hook_call_log.empty());
+
+    // Only hook 1 comes back; hook 2 stays out of the chain
+    ur::inline_hook::Hook* first[] = {&hook1, &short_hook};
+    ASSERT_TRUE(batch.set_enabled(first, true));
+    EXPECT_EQ(target_function_to_hook(5, 3), (5 + 3) + 10);
+    ASSERT_EQ(g_hook_call_log.size(), 1);
+    EXPECT_EQ(g_hook_call_log[0], "Hook 1 called");
+    EXPECT_EQ(short_target_function(4), 99);
+
+    // A null hook fails the call but the others are still enabled
+    ur::inline_hook::Hook* with_null[] = {&hook2, nullptr};
+    EXPECT_FALSE(batch.set_enabled(with_null, true));
+    g_hook_call_log.clear();
+    EXPECT_EQ(target_function_to_hook(5, 3), ((5 + 3) + 10) * 2);
+    EXPECT_EQ(g_hook_call_log.size(), 2);
+}
+
+int capi_add_hook(int a, int b) {
+g_hook_call_log.push_back("C hook called");
+return -(a + b);
+}
+
+TEST_F(InlineHookTest, CApiBatch) {
+    const uintptr_t targets[] = {reinterpret_cast<uintptr_t>(&target_function_to_hook),
+                                 reinterpret_cast<uintptr_t>(&short_target_function)};
+    void* const callbacks[] = {reinterpret_cast<void*>(&capi_add_hook),
+                               reinterpret_cast<void*>(&short_hook_callback)};
+    ur_inline_hook_t* hooks[2] = {};
+    ASSERT_EQ(ur_inline_hook_create_many(targets, callbacks, 2, 0, hooks), UR_STATUS_OK);
+    ASSERT_TRUE(ur_inline_hook_is_valid(hooks[0]));
+    ASSERT_TRUE(ur_inline_hook_is_valid(hooks[1]));
+    EXPECT_EQ(target_function_to_hook(5, 3), -8);
+    EXPECT_EQ(short_target_function(4), 99);
+
+    EXPECT_EQ(ur_inline_hook_disable_many(hooks, 2, 0), UR_STATUS_OK);
+    EXPECT_EQ(target_function_to_hook(5, 3), 8);
+    EXPECT_EQ(short_target_function(4), 8);
+
+    EXPECT_EQ(ur_inline_hook_enable_many(hooks, 2, 1), UR_STATUS_OK);
+    EXPECT_EQ(short_target_function(4), 99);
+    // Already enabled hooks are left alone; a null handle is skipped
+    ur_inline_hook_t* with_null[] = {hooks[0], nullptr};
+    EXPECT_EQ(ur_inline_hook_enable_many(with_null, 2, 0), UR_STATUS_OK);
+    EXPECT_EQ(target_function_to_hook(5, 3), -8);
+
+    ur_inline_hook_destroy_many(hooks, 2);
+    EXPECT_EQ(target_function_to_hook(5, 3), 8);
+    EXPECT_EQ(short_target_function(4), 8);
+
+    // An invalid entry fails the whole call and leaves the handles empty
+    void* const partial[] = {reinterpret_cast<void*>(&capi_add_hook), nullptr};
+    EXPECT_EQ(ur_inline_hook_create_many(targets, partial, 2, 0, hooks), UR_STATUS_INVALID_ARG);
+    EXPECT_EQ(hooks[0], nullptr);
+    EXPECT_EQ(hooks[1], nullptr);
+    EXPECT_EQ(target_function_to_hook(5, 3), 8);
+}
+
+TEST_F(InlineHookTest, AsyncInstall) {
+    std::future<ur::inline_hook::Hook> first;
+    std::future<ur::inline_hook::Hook> second;
+    {
+        ur::inline_hook::AsyncOptions options;
+        options.workers = 2;
+        ur::inline_hook::AsyncInstaller installer(options);
+        first = installer.install(reinterpret_cast<uintptr_t>(&target_function_to_hook),
+                                  reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1));
+        second = installer.install(reinterpret_cast<uintptr_t>(&short_target_function),
+                                   reinterpret_cast<ur::inline_hook::Hook::Callback>(&short_hook_callback));
+        installer.flush();
+        EXPECT_EQ(installer.pending(), 0u);
+
+        EXPECT_THROW(installer.install(0, reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1)),
+                     std::invalid_argument);
+    }
+
+    ur::inline_hook::Hook hook1 = first.get();
+    ur::inline_hook::Hook hook2 = second.get();
+    ASSERT_TRUE(hook1.is_valid());
+    ASSERT_TRUE(hook2.is_valid());
+    g_hook1 = &hook1;
+
+    EXPECT_EQ(target_function_to_hook(5, 3), (5 + 3) + 10);
+    EXPECT_EQ(short_target_function(4), 99);
+
+    hook1.unhook();
+    hook2.unhook();
+    EXPECT_EQ(target_function_to_hook(5, 3), 8);
+    EXPECT_EQ(short_target_function(4), 8);
+}
+
+TEST_F(InlineHookTest, AsyncInstallerDrainsOnDestruction) {
+    std::future<ur::inline_hook::Hook> pending;
+    {
+        ur::inline_hook::AsyncInstaller installer;
+        pending = installer.install(reinterpret_cast<uintptr_t>(&short_target_function),
+                                    reinterpret_cast<ur::inline_hook::Hook::Callback>(&concurrent_short_hook));
+    }
+    // The destructor installs what is still queued
+    ASSERT_EQ(pending.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    ur::inline_hook::Hook hook = pending.get();
+    EXPECT_EQ(short_target_function(4), 99);
+    hook.unhook();
+    EXPECT_EQ(short_target_function(4), 8);
+}
+
+TEST_F(InlineHookTest, PatchRegionCheck) {
+    using ur::inline_hook::PatchRegionStatus;
+
+    // mov w0, #1; ret; nop; nop
+    ur::assembler::Assembler short_func(0);
+    short_func.mov(ur::assembler::Register::W0, 1);
+    short_func.ret();
+    short_func.nop();
+    short_func.nop();
+    auto short_addr = reinterpret_cast<uintptr_t>(short_func.get_code().data());
+    EXPECT_EQ(ur::inline_hook::check_patch_region(short_addr, 4), PatchRegionStatus::Safe);
+    EXPECT_EQ(ur::inline_hook::check_patch_region(short_addr, 8), PatchRegionStatus::Safe);
+    EXPECT_EQ(ur::inline_hook::check_patch_region(short_addr, 12), PatchRegionStatus::EndsFunction);
+
+    // cbz x0, +8; mov x1, #2; mov x2, #3; ret
+    uint32_t loop_code[8] = {};
+    auto loop_addr = reinterpret_cast<uintptr_t>(loop_code);
+    ur::assembler::Assembler loop_func(loop_addr);
+    loop_func.cbz(ur::assembler::Register::X0, loop_addr + 8);
+    loop_func.mov(ur::assembler::Register::X1, 2);
+    loop_func.mov(ur::assembler::Register::X2, 3);
+    loop_func.ret();
+    ASSERT_LE(loop_func.get_code().size(), 8);
+    std::memcpy(loop_code, loop_func.get_code().data(), loop_func.get_code_size());
+    EXPECT_EQ(ur::inline_hook::check_patch_region(loop_addr, 4), PatchRegionStatus::Safe);
+    EXPECT_EQ(ur::inline_hook::check_patch_region(loop_addr, 12), PatchRegionStatus::BranchIntoRegion);
+
+    // mov x1, #0; loop: add x1, x1, #1; cmp x0, x1; b.ne loop; ret
+    // The back edge lies outside the region and is found by the function analysis.
+    uint32_t back_edge_code[8] = {};
+    auto back_edge_addr = reinterpret_cast<uintptr_t>(back_edge_code);
+    ur::assembler::Assembler back_edge_func(back_edge_addr);
+    back_edge_func.mov(ur::assembler::Register::X1, 0);
+    back_edge_func.add(ur::assembler::Register::X1, ur::assembler::Register::X1, 1);
+    back_edge_func.cmp(ur::assembler::Register::X0, ur::assembler::Register::X1);
+    back_edge_func.b(ur::assembler::Condition::NE, back_edge_addr + 4);
+    back_edge_func.ret();
+    ASSERT_LE(back_edge_func.get_code().size(), 8);
+    std::memcpy(back_edge_code, back_edge_func.get_code().data(), back_edge_func.get_code_size());
+    EXPECT_EQ(ur::inline_hook::check_patch_region(back_edge_addr, 4), PatchRegionStatus::Safe);
+    EXPECT_EQ(ur::inline_hook::check_patch_region(back_edge_addr, 12), PatchRegionStatus::BranchIntoRegion);
+}
+
+TEST_F(InlineHookTest, ConcurrentToggleOnDifferentTargets) {
+    ur::inline_hook::Hook hook_a(
+        reinterpret_cast<uintptr_t>(&target_function_to_hook),
+        reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1), false);
+    ur::inline_hook::Hook hook_b(
+        reinterpret_cast<uintptr_t>(&short_target_function),
+        reinterpret_cast<ur::inline_hook::Hook::Callback>(&short_hook_callback), false);
+    ASSERT_TRUE(hook_a.is_valid());
+    ASSERT_TRUE(hook_b.is_valid());
+
+    // Each thread only mutates its own target; trampoline lookups run concurrently.
+    std::atomic<bool> failed{false};
+    auto toggle = [&failed](ur::inline_hook::Hook& hook) {
+        for (int i = 0; i < 200; ++i) {
+            if (!hook.enable() || hook.get_trampoline() == 0 || !hook.disable()) {
+                failed = true;
+            }
+        }
+    };
+    std::thread thread_a(toggle, std::ref(hook_a));
+    std::thread thread_b(toggle, std::ref(hook_b));
+    thread_a.join();
+    thread_b.join();
+
+    EXPECT_FALSE(failed);
+    EXPECT_EQ(short_target_function(4), 8);
+}
+
+TEST_F(InlineHookTest, SwitchableHookKeepsTargetPatched) {
+    const auto target = reinterpret_cast<uintptr_t>(&short_target_function);
+    uint32_t original_word = 0;
+    std::memcpy(&original_word, reinterpret_cast<const void*>(target), sizeof(original_word));
+
+    ur::inline_hook::HookOptions options;
+    options.switchable = true;
+    ur::inline_hook::Hook hook(target,
+        reinterpret_cast<ur::inline_hook::Hook::Callback>(&short_hook_callback), false, options);
+    ASSERT_TRUE(hook.is_valid());
+
+    // The target jumps to the stub even though the hook starts disabled.
+    uint32_t patched_word = 0;
+    std::memcpy(&patched_word, reinterpret_cast<const void*>(target), sizeof(patched_word));
+    EXPECT_NE(patched_word, original_word);
+    EXPECT_EQ(short_target_function(4), 8);
+
+    ASSERT_TRUE(hook.enable());
+    EXPECT_EQ(short_target_function(4), 99);
+    ASSERT_TRUE(hook.disable());
+    EXPECT_EQ(short_target_function(4), 8);
+
+    // Toggling never rewrote the target.
+    uint32_t current_word = 0;
+    std::memcpy(&current_word, reinterpret_cast<const void*>(target), sizeof(current_word));
+    EXPECT_EQ(current_word, patched_word);
+
+    hook.unhook();
+    std::memcpy(&current_word, reinterpret_cast<const void*>(target), sizeof(current_word));
+    EXPECT_EQ(current_word, original_word);
+}
+
+TEST_F(InlineHookTest, ChainFollowsDisabledAndRemovedLinks) {
+    const auto target = reinterpret_cast<uintptr_t>(&target_function_to_hook);
+    ur::inline_hook::Hook hook1(target, reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1));
+    g_hook1 = &hook1;
+    auto hook2 = std::make_unique<ur::inline_hook::Hook>(
+        target, reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_2));
+    g_hook2 = hook2.get();
+
+    // Disabling the tail hook: hook 2 calls straight through to the original.
+    ASSERT_TRUE(hook1.disable());
+    EXPECT_EQ(target_function_to_hook(5, 3), (5 + 3) * 2);
+    ASSERT_EQ(g_hook_call_log.size(), 1);
+    EXPECT_EQ(g_hook_call_log[0], "Hook 2 called");
+
+    g_hook_call_log.clear();
+    ASSERT_TRUE(hook1.enable());
+    EXPECT_EQ(target_function_to_hook(5, 3), ((5 + 3) + 10) * 2);
+    EXPECT_EQ(g_hook_call_log.size(), 2);
+
+    // Removing the head leaves hook 1 as the only link.
+    g_hook_call_log.clear();
+    hook2.reset();
+    g_hook2 = nullptr;
+    EXPECT_EQ(target_function_to_hook(5, 3), (5 + 3) + 10);
+    ASSERT_EQ(g_hook_call_log.size(), 1);
+    EXPECT_EQ(g_hook_call_log[0], "Hook 1 called");
+}
+
+TEST_F(InlineHookTest, ConstructorRollsBackWhenTargetCannotBePatched) {
+    // Code in a shared mapping of a read-only descriptor: mprotect() can never make it writable
+    int fd = static_cast<int>(syscall(__NR_memfd_create, "urhook-test", MFD_CLOEXEC));
+    if (fd < 0) GTEST_SKIP() << "memfd_create is not available";
+    const uint32_t code[] = {0x528000E0, 0xD503201F, 0xD503201F, 0xD503201F, 0xD65F03C0}; // mov w0, #7; nop x3; ret
+    ASSERT_EQ(write(fd, code, sizeof(code)), static_cast<ssize_t>(sizeof(code)));
+    const std::string path = "/proc/self/fd/" + std::to_string(fd);
+    int read_only = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    close(fd);
+    ASSERT_GE(read_only, 0);
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    void* mapping = mmap(nullptr, page_size, PROT_READ | PROT_EXEC, MAP_SHARED, read_only, 0);
+    close(read_only);
+    ASSERT_NE(mapping, MAP_FAILED);
+    const auto target = reinterpret_cast<uintptr_t>(mapping);
+
+    const size_t allocations = ur::exec_pool::get_stats().allocation_count;
+    EXPECT_THROW(ur::inline_hook::Hook(target, reinterpret_cast<ur::inline_hook::Hook::Callback>(&hook_callback_1)),
+                 std::runtime_error);
+    // Nothing of the failed hook stays behind, and the code is untouched
+    EXPECT_EQ(ur::exec_pool::get_stats().allocation_count, allocations);
+    EXPECT_EQ(memcmp(mapping, code, sizeof(code)), 0);
+    EXPECT_EQ(reinterpret_cast<int (*)()>(mapping)(), 7);
+
+    munmap(mapping, page_size);
+}
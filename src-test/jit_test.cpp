@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include "ur/jit.h"
+#include "ur/exec_pool.h"
 #include "ur/assembler.h"
 #include "ur/memory.h"
 #include "ur/inline_hook.h"
@@ -79,8 +80,8 @@ TEST(JitTest, ReleaseMemory) {
     auto released_func = reinterpret_cast<int(*)()>(mem);
     EXPECT_EQ(released_func(), 500);
 
-    // Manually free the memory
-    munmap(mem, jit.get_code_size());
+    // Manually return the memory to the pool
+    ur::exec_pool::free(mem);
 }
 
 TEST(JitTest, HelloWorld) {
@@ -109,3 +110,203 @@ TEST(JitTest, HelloWorld) {
 
     EXPECT_EQ(output, "Hello, World!\n");
 }
+
+TEST(JitTest, LiteralPoolSharesEqualConstants) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    jit.ldr_constant(Register::X0, 0x1122334455667788);
+    jit.ldr_constant(Register::X1, 0x1122334455667788);
+    jit.ldr_constant(Register::X2, 0xCAFE);
+    jit.ret();
+    EXPECT_EQ(jit.pending_literals(), 2u);
+
+    jit.finish();
+    EXPECT_EQ(jit.pending_literals(), 0u);
+    const auto code = jit.get_code_span();
+    ASSERT_EQ(code.size(), 8u); // 4 instructions, then two 8-byte slots
+
+    // LDR (literal) x<rt>, with imm19 counted in words from the instruction
+    EXPECT_EQ(code[0], 0x58000000u | (4u << 5) | 0);
+    EXPECT_EQ(code[1], 0x58000000u | (3u << 5) | 1);
+    EXPECT_EQ(code[2], 0x58000000u | (4u << 5) | 2);
+    EXPECT_EQ(code[4], 0x55667788u);
+    EXPECT_EQ(code[5], 0x11223344u);
+    EXPECT_EQ(code[6], 0xCAFEu);
+    EXPECT_EQ(code[7], 0u);
+}
+
+TEST(JitTest, LiteralPoolIsPlacedByFinalize) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    jit.ldr_constant(Register::X0, 0x123456789ABCDEF0);
+    jit.ret();
+
+    auto func = jit.finalize<uint64_t(*)()>();
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func(), 0x123456789ABCDEF0u);
+}
+
+TEST(JitTest, CallThroughLiteralPool) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    jit.stp(Register::FP, Register::LR, Register::SP, -16, true);
+    jit.call(reinterpret_cast<uintptr_t>(ur::test_target_functions::original_target_func));
+    jit.ldp(Register::FP, Register::LR, Register::SP, 16, true);
+    jit.add(Register::W0, Register::W0, 1);
+    jit.ret();
+    EXPECT_EQ(jit.pending_literals(), 1u);
+
+    auto func = jit.finalize<int(*)()>();
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func(), ur::test_target_functions::original_target_func() + 1);
+}
+
+TEST(JitTest, FixedAddressUsesShortForms) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit(0x10000);
+    jit.load_address(Register::X0, 0x10100);     // ADR
+    jit.load_address(Register::X1, 0x20000010);  // ADRP + ADD
+    jit.load_address(Register::X2, 0x7000000000); // pool
+    jit.jump(0x10200);                           // B
+    jit.finish();
+
+    const auto code = jit.get_code_span();
+    ASSERT_EQ(code.size(), 8u); // 5 instructions, padding, one slot
+    EXPECT_EQ(code[0] & 0x9F000000u, 0x10000000u);
+    EXPECT_EQ(code[1] & 0x9F000000u, 0x90000000u);
+    EXPECT_EQ(code[2] & 0xFF000000u, 0x91000000u);
+    EXPECT_EQ(code[3] & 0xFF00001Fu, 0x58000002u);
+    EXPECT_EQ(code[4], 0x14000000u | ((0x10200 - 0x10010) / 4));
+    EXPECT_EQ(code[5], 0xD503201Fu);
+}
+
+TEST(JitTest, CompareAndBranchToLabel) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    auto zero = jit.new_label();
+    jit.cbz(Register::X0, zero);
+    jit.mov(Register::W0, 1);
+    jit.ret();
+    jit.bind(zero);
+    jit.mov(Register::W0, 2);
+    jit.ret();
+
+    EXPECT_EQ(jit.get_code_span()[0], 0xB4000000u | (3u << 5));
+
+    auto func = jit.finalize<int(*)(uint64_t)>();
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func(0), 2);
+    EXPECT_EQ(func(7), 1);
+}
+
+TEST(JitTest, LabelsForLiteralAdrAndCall) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    auto data = jit.new_label();
+    auto callee = jit.new_label();
+    jit.stp(Register::FP, Register::LR, Register::SP, -16, true);
+    jit.bl(callee);                     // x0 = 7
+    jit.ldp(Register::FP, Register::LR, Register::SP, 16, true);
+    jit.adr(Register::X1, data);
+    jit.ldr(Register::X1, Register::X1, 0);
+    jit.ldr_literal(Register::X2, data);
+    jit.sub(Register::X1, Register::X1, Register::X2); // 0
+    jit.add(Register::X0, Register::X0, Register::X1);
+    jit.ret();
+    jit.bind(callee);
+    jit.mov(Register::X0, 7);
+    jit.ret();
+    jit.bind(data);
+    jit.emit_quad(0x0102030405060708);
+
+    auto func = jit.finalize<uint64_t(*)()>();
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func(), 7u);
+}
+
+TEST(JitTest, UnboundLabelIsReportedByFinish) {
+    ur::jit::Jit jit;
+    auto nowhere = jit.new_label();
+    jit.b(nowhere);
+    EXPECT_THROW(jit.finish(), std::runtime_error);
+}
+
+TEST(JitTest, BackwardConditionalBranchOutOfRangeIsInverted) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    auto top = jit.new_label();
+    jit.bind(top);
+    for (int i = 0; i < 300000; ++i) {
+        jit.nop();
+    }
+    jit.b(ur::assembler::Condition::EQ, top);
+    jit.tbz(Register::X0, 1, top);
+    jit.finish();
+
+    const auto code = jit.get_code_span();
+    ASSERT_EQ(code.size(), 300004u);
+    EXPECT_EQ(code[300000], 0x54000000u | (2u << 5) | 0x1); // b.ne +8
+    EXPECT_EQ(code[300001], 0x14000000u | ((-300001) & 0x3FFFFFF));
+    EXPECT_EQ(code[300002], 0x37000000u | (1u << 19) | (2u << 5)); // tbnz x0, #1, +8
+    EXPECT_EQ(code[300003], 0x14000000u | ((-300003) & 0x3FFFFFF));
+}
+
+TEST(JitTest, ForwardTestBranchGoesThroughVeneer) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    auto far = jit.new_label();
+    jit.tbz(Register::X0, 3, far); // bit 3 clear -> 1
+    jit.mov(Register::W0, 2);
+    jit.ret();
+    // 40KB of unreachable code, more than TBZ can span; bind() gives the Jit a chance
+    // to place the veneer island in time.
+    for (int block = 0; block < 10; ++block) {
+        for (int i = 0; i < 1000; ++i) {
+            jit.nop();
+        }
+        auto next = jit.new_label();
+        jit.bind(next);
+    }
+    jit.bind(far);
+    jit.mov(Register::W0, 1);
+    jit.ret();
+    jit.finish();
+
+    const auto code = jit.get_code_span();
+    const uint32_t tbz = code[0];
+    ASSERT_EQ(tbz & 0x7F000000u, 0x36000000u);
+    const size_t veneer = ((tbz >> 5) & 0x3FFF);
+    ASSERT_GT(veneer, 3u);
+    const uint32_t b = code[veneer];
+    ASSERT_EQ(b & 0xFC000000u, 0x14000000u);
+    EXPECT_EQ(veneer + (b & 0x3FFFFFF), static_cast<size_t>(far.offset() / 4));
+    // The island is skipped by a branch right before it
+    EXPECT_EQ(code[veneer - 1], 0x14000002u);
+
+    auto func = jit.finalize<int(*)(uint64_t)>();
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func(0), 1);
+    EXPECT_EQ(func(8), 2);
+}
+
+TEST(JitTest, ManyForwardLabels) {
+    using ur::assembler::Register;
+    ur::jit::Jit jit;
+    jit.mov(Register::W0, 0);
+    for (int i = 0; i < 200; ++i) {
+        auto skip = jit.new_label();
+        auto next = jit.new_label();
+        jit.cbnz(Register::X1, skip); // x1 == 0: count this block
+        jit.add(Register::W0, Register::W0, 1);
+        jit.b(next);
+        jit.bind(skip);
+        jit.add(Register::W0, Register::W0, 2);
+        jit.bind(next);
+    }
+    jit.ret();
+
+    auto func = jit.finalize<int(*)(uint64_t, uint64_t)>();
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func(0, 0), 200);
+    EXPECT_EQ(func(0, 1), 400);
+}
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <sys/mman.h>
 
 // A dummy function to have an address within the test executable's code segment.
 void dummy_function_for_address_test() {}
@@ -43,3 +44,75 @@ TEST(MapsParserTest, FindByAddress) {
     EXPECT_TRUE(map_info->get_perms().find('r') != std::string::npos);
     EXPECT_TRUE(map_info->get_perms().find('x') != std::string::npos); // Code should be executable
 }
+
+TEST(MapsSnapshotTest, ParsesText) {
+    ur::maps_parser::MapsSnapshot snapshot(
+        "7f0000000000-7f0000001000 r--p 00000000 fd:01 1234    /system/lib64/libfoo.so\n"
+        "7f0000001000-7f0000003000 r-xp 00001000 fd:01 1234    /system/lib64/libfoo.so\n"
+        "7f0000005000-7f0000006000 rw-s 00000000 00:00 0 \n"
+        "7f0000006000-7f0000007000 rw-p 00000000 00:00 0      /data/dir with spaces/x.so\n");
+
+    ASSERT_EQ(snapshot.size(), 4);
+    const auto& code = snapshot.entries()[1];
+    EXPECT_EQ(code.start, 0x7f0000001000u);
+    EXPECT_EQ(code.end, 0x7f0000003000u);
+    EXPECT_EQ(code.offset, 0x1000u);
+    EXPECT_STREQ(code.perms, "r-xp");
+    EXPECT_EQ(code.prot, PROT_READ | PROT_EXEC);
+    EXPECT_TRUE(code.is_private);
+    EXPECT_EQ(code.path, "/system/lib64/libfoo.so");
+
+    EXPECT_FALSE(snapshot.entries()[2].is_private);
+    EXPECT_TRUE(snapshot.entries()[2].path.empty());
+    EXPECT_EQ(snapshot.entries()[3].path, "/data/dir with spaces/x.so");
+
+    EXPECT_EQ(snapshot.find_by_addr(0x7f0000002fff), &snapshot.entries()[1]);
+    EXPECT_EQ(snapshot.find_by_addr(0x7f0000003000), nullptr); // gap
+    EXPECT_EQ(snapshot.find_by_addr(0x1000), nullptr);
+
+    EXPECT_EQ(snapshot.find_by_path("/system/lib64/libfoo.so"), &snapshot.entries()[0]);
+    EXPECT_EQ(snapshot.find_all_by_path("/system/lib64/libfoo.so").size(), 2);
+    EXPECT_EQ(snapshot.find_by_path("/system/lib64/libbar.so"), nullptr);
+}
+
+TEST(MapsSnapshotTest, FindsNearestGap) {
+    ur::maps_parser::MapsSnapshot snapshot(
+        "10000000-10100000 r-xp 00000000 fd:01 1    /system/lib64/libfoo.so\n"
+        "10101000-10102000 rw-p 00000000 00:00 0 \n"       // 0x1000 hole below
+        "10110000-10200000 r--p 00000000 00:00 0 \n"       // 0xe000 hole below
+        "20000000-20001000 r--p 00000000 00:00 0 \n");     // large hole below
+
+    constexpr std::uintptr_t kNear = 0x10050000;
+    constexpr std::size_t kPage = 0x1000;
+
+    // The one-page hole right after the library is the closest
+    EXPECT_EQ(snapshot.find_gap(kNear, kPage, 0x1000000, kPage), 0x10100000u);
+    // Two pages do not fit there; the next hole does
+    EXPECT_EQ(snapshot.find_gap(kNear, 2 * kPage, 0x1000000, kPage), 0x10102000u);
+    // Too big for both small holes: the start of the large one
+    EXPECT_EQ(snapshot.find_gap(kNear, 0x100000, 0x1000000, kPage), 0x10200000u);
+    // Out of range
+    EXPECT_EQ(snapshot.find_gap(kNear, 0x100000, 0x100000, kPage), 0u);
+    // Below the large hole's upper mapping, the end of the hole is nearest
+    EXPECT_EQ(snapshot.find_gap(0x20000800, 0x10000, 0x100000, kPage), 0x1fff0000u);
+    // Alignment is honoured
+    EXPECT_EQ(snapshot.find_gap(kNear, 2 * kPage, 0x1000000, 0x10000), 0x10200000u);
+}
+
+TEST(MapsSnapshotTest, SharedSnapshotLookup) {
+    auto snapshot = ur::maps_parser::MapsSnapshot::current();
+    ASSERT_FALSE(snapshot->empty());
+    EXPECT_EQ(ur::maps_parser::MapsSnapshot::current(), snapshot);
+
+    auto func_ptr = reinterpret_cast<std::uintptr_t>(&dummy_function_for_address_test);
+    const auto* entry = snapshot->find_by_addr(func_ptr);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(entry->prot & PROT_EXEC);
+    EXPECT_EQ(snapshot->find_by_path(entry->path)->path, entry->path);
+
+    ur::maps_parser::MapsSnapshot::invalidate();
+    EXPECT_NE(ur::maps_parser::MapsSnapshot::current(), snapshot);
+
+    auto refreshed = ur::maps_parser::MapsSnapshot::refresh();
+    EXPECT_EQ(ur::maps_parser::MapsSnapshot::current(), refreshed);
+}
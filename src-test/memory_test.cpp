@@ -2,6 +2,7 @@
 #include "ur/memory.h"
 #include <sys/mman.h>
 #include <unistd.h>
+#include <vector>
 
 namespace ur::memory {
 
@@ -60,4 +61,75 @@ namespace ur::memory {
         EXPECT_FALSE(protect(0, getpagesize(), PROT_READ));
     }
 
+    TEST(MemoryTest, SafeReadAndWrite) {
+        const size_t size = getpagesize();
+        void* p = mmap(nullptr, size * 2, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        ASSERT_NE(p, MAP_FAILED);
+        const auto base = reinterpret_cast<uintptr_t>(p);
+        // 第二页不可访问
+        ASSERT_EQ(munmap(reinterpret_cast<void*>(base + size), size), 0);
+
+        uint64_t value = 0x1122334455667788;
+        EXPECT_TRUE(safe_write(base, &value, sizeof(value)));
+        uint64_t read_value = 0;
+        EXPECT_TRUE(safe_read(base, &read_value, sizeof(read_value)));
+        EXPECT_EQ(read_value, value);
+
+        // 未映射的地址返回 false 而不是崩溃；跨越映射末尾的访问同样失败
+        EXPECT_FALSE(safe_read(base + size, &read_value, sizeof(read_value)));
+        EXPECT_FALSE(safe_read(base + size - 4, &read_value, sizeof(read_value)));
+        EXPECT_FALSE(safe_write(base + size, &value, sizeof(value)));
+
+        // 只读页不可写
+        ASSERT_TRUE(protect(base, size, PROT_READ));
+        EXPECT_FALSE(safe_write(base, &value, sizeof(value)));
+        EXPECT_TRUE(safe_read(base, &read_value, sizeof(read_value)));
+
+        munmap(p, size);
+    }
+
+    TEST(MemoryTest, ReadManySkipsFailedRequests) {
+        const size_t size = getpagesize();
+        void* p = mmap(nullptr, size * 2, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        ASSERT_NE(p, MAP_FAILED);
+        const auto base = reinterpret_cast<uintptr_t>(p);
+        ASSERT_EQ(munmap(reinterpret_cast<void*>(base + size), size), 0);
+
+        // 超过一次系统调用的容量，且每隔几项夹杂一个无法访问的地址
+        constexpr size_t kCount = kMaxIovecs * 2 + 7;
+        std::vector<uint32_t> words(kCount);
+        std::vector<WriteRequest> writes(kCount);
+        std::vector<ReadRequest> reads(kCount);
+        size_t expected = 0;
+        for (size_t i = 0; i < kCount; ++i) {
+            words[i] = static_cast<uint32_t>(i * 3 + 1);
+            const bool bad = i % 5 == 3;
+            const uintptr_t address = bad ? base + size : base + (i % (size / 4)) * 4;
+            writes[i] = {address, &words[i], sizeof(uint32_t)};
+            expected += !bad;
+        }
+        // 同一地址可能被多次写入，按顺序以最后一次为准
+        EXPECT_EQ(write_many(writes), expected);
+
+        std::vector<uint32_t> results(kCount);
+        for (size_t i = 0; i < kCount; ++i) {
+            reads[i] = {writes[i].address, &results[i], sizeof(uint32_t)};
+        }
+        EXPECT_EQ(read_many(reads), expected);
+        for (size_t i = 0; i < kCount; ++i) {
+            EXPECT_EQ(reads[i].ok, i % 5 != 3) << i;
+            EXPECT_EQ(writes[i].ok, i % 5 != 3) << i;
+            if (reads[i].ok) {
+                EXPECT_EQ(results[i], *reinterpret_cast<const uint32_t*>(writes[i].address)) << i;
+            }
+        }
+
+        // 空请求视为成功
+        ReadRequest empty{base + size, nullptr, 0};
+        EXPECT_EQ(read_many({&empty, 1}), 1u);
+        EXPECT_TRUE(empty.ok);
+
+        munmap(p, size);
+    }
+
 } // namespace ur::memory
\ No newline at end of file
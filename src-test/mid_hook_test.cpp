@@ -244,3 +244,41 @@ TEST(MidHookTest, JitFunctionInfiniteHealth) {
 }
 
 // --- End of new test case for JIT function hook ---
+
+// Touches the FP registers and flags, which the detour must restore when asked to.
+void fp_clobbering_callback(ur::mid_hook::CpuContext* context) {
+    g_callback_executed = true;
+    volatile double scratch = 1.5;
+    scratch = scratch * 3.0;
+    context->gpr[1] = 20;
+}
+
+TEST(MidHookTest, ArgumentsOnlyOptions) {
+    g_callback_executed = false;
+    g_original_arg1 = 0;
+    uintptr_t target_address = reinterpret_cast<uintptr_t>(&target_function);
+
+    ur::mid_hook::MidHook hook(target_address, &modifying_callback,
+                               ur::mid_hook::MidHookOptions::arguments_only());
+    ASSERT_TRUE(hook.is_valid());
+
+    volatile int result = target_function(5, 10);
+    EXPECT_TRUE(g_callback_executed);
+    EXPECT_EQ(g_original_arg1, 5);
+    EXPECT_EQ(result, 110);
+}
+
+TEST(MidHookTest, SaveFlagsAndSimd) {
+    g_callback_executed = false;
+    uintptr_t target_address = reinterpret_cast<uintptr_t>(&target_function_2);
+
+    ur::mid_hook::MidHookOptions options = ur::mid_hook::MidHookOptions::arguments_only();
+    options.save_flags = true;
+    options.save_simd = true;
+    ur::mid_hook::MidHook hook(target_address, &fp_clobbering_callback, options);
+    ASSERT_TRUE(hook.is_valid());
+
+    volatile int result = target_function_2(3, 4);
+    EXPECT_TRUE(g_callback_executed);
+    EXPECT_EQ(result, 60); // 3 * 20
+}
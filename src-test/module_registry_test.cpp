@@ -0,0 +1,101 @@
+#include "ur/module_registry.h"
+#include "ur/maps_parser.h"
+#include "ur/plthook.h"
+#include "ur/symbol_cache.h"
+#include <gtest/gtest.h>
+
+#include <dlfcn.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+uintptr_t module_base(const void* address) {
+    Dl_info info{};
+    if (dladdr(address, &info) == 0) return 0;
+    return reinterpret_cast<uintptr_t>(info.dli_fbase);
+}
+
+} // namespace
+
+TEST(ModuleRegistryTest, ParsesEachModuleOnce) {
+    const uintptr_t libc_base = module_base(reinterpret_cast<const void*>(&fopen));
+    ASSERT_NE(libc_base, 0u);
+
+    auto first = ur::module_registry::get(libc_base);
+    ASSERT_NE(first, nullptr);
+    EXPECT_NE(first->find_symbol("fopen"), 0u);
+    EXPECT_EQ(ur::module_registry::get(libc_base), first);
+
+    // A dropped entry is parsed again; holders keep the old parser
+    ur::module_registry::invalidate(libc_base);
+    auto second = ur::module_registry::get(libc_base);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(second, first);
+    EXPECT_EQ(first->find_symbol("fopen"), second->find_symbol("fopen"));
+}
+
+TEST(ModuleRegistryTest, MapInfoParserIsPrivate) {
+    const uintptr_t libc_base = module_base(reinterpret_cast<const void*>(&fopen));
+    ASSERT_NE(libc_base, 0u);
+    auto shared = ur::module_registry::get(libc_base);
+    ASSERT_NE(shared, nullptr);
+
+    // MapInfo owns its parser, so enabling a symbol cache on it leaves the shared one untouched
+    auto maps = ur::maps_parser::MapsParser::parse();
+    const auto* map = ur::maps_parser::MapsParser::find_map_by_addr(maps, libc_base);
+    ASSERT_NE(map, nullptr);
+    auto* parser = map->get_elf_parser();
+    ASSERT_NE(parser, nullptr);
+    EXPECT_NE(parser, shared.get());
+    EXPECT_EQ(parser->find_symbol("fopen"), shared->find_symbol("fopen"));
+
+    if (parser->get_build_id().empty()) GTEST_SKIP() << "libc has no build-id";
+    std::string directory = ::testing::TempDir();
+    if (!directory.empty() && directory.back() == '/') directory.pop_back();
+    ASSERT_TRUE(parser->enable_symbol_cache(directory));
+    EXPECT_EQ(parser->find_symbol("fopen"), shared->find_symbol("fopen"));
+    ASSERT_TRUE(parser->flush_symbol_cache());
+
+    auto cache = ur::symbol_cache::Cache::open(directory, parser->get_build_id());
+    ASSERT_NE(cache, nullptr);
+    std::remove(cache->path().c_str());
+}
+
+TEST(ModuleRegistryTest, EnumeratesLoadedModules) {
+    const uintptr_t libc_base = module_base(reinterpret_cast<const void*>(&fopen));
+    ASSERT_NE(libc_base, 0u);
+
+    auto loaded = ur::module_registry::enumerate_loaded();
+    ASSERT_FALSE(loaded.modules.empty());
+    bool found = false;
+    for (const auto& module : loaded.modules) {
+        if (module.base == libc_base) found = true;
+    }
+    EXPECT_TRUE(found);
+
+    unsigned long long adds = 0;
+    unsigned long long subs = 0;
+    EXPECT_EQ(ur::module_registry::read_loader_counters(adds, subs), loaded.has_counters);
+    if (loaded.has_counters) {
+        EXPECT_GT(adds, 0u);
+    }
+}
+
+TEST(ModuleRegistryTest, RejectsNonElfAddresses) {
+    EXPECT_EQ(ur::module_registry::get(0), nullptr);
+    int local = 0;
+    EXPECT_EQ(ur::module_registry::get(reinterpret_cast<uintptr_t>(&local) & ~uintptr_t(0xfff)), nullptr);
+}
+
+TEST(ModuleRegistryTest, PltHooksShareTheModuleParser) {
+    const uintptr_t libc_base = module_base(reinterpret_cast<const void*>(&fopen));
+    ASSERT_NE(libc_base, 0u);
+
+    ur::module_registry::clear();
+    ur::plthook::Hook first(libc_base);
+    ur::plthook::Hook second(libc_base);
+    ASSERT_TRUE(first.is_valid());
+    ASSERT_TRUE(second.is_valid());
+    EXPECT_EQ(ur::module_registry::size(), 1u);
+}
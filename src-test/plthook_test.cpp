@@ -5,6 +5,7 @@
 #include <iostream>
 
 #include "ur/plthook.h"
+#include "ur/plthook_manager.h"
 
 // 记录替换调用日志
 static std::vector<std::string> g_log;
@@ -57,4 +58,88 @@ TEST(PltHookTest, HookAndUnhookPutsOnMainExecutable) {
     ret = puts("After unhook");
     (void)ret;
     ASSERT_TRUE(g_log.empty());
-}
\ No newline at end of file
+}
+TEST(PltHookTest, HookSymbolsInBulk) {
+    Dl_info info{};
+    ASSERT_NE(dladdr(reinterpret_cast<const void*>(&local_marker), &info), 0);
+    ur::plthook::Hook hook(reinterpret_cast<uintptr_t>(info.dli_fbase));
+    ASSERT_TRUE(hook.is_valid());
+
+    g_log.clear();
+    g_original_puts = nullptr;
+    void* missing_original = nullptr;
+    const ur::plthook::Hook::SymbolHook hooks[] = {
+        {"puts", reinterpret_cast<void*>(&my_puts), &g_original_puts},
+        {"__urhook_no_such_symbol__", reinterpret_cast<void*>(&my_puts), &missing_original},
+        {"", reinterpret_cast<void*>(&my_puts), nullptr},
+    };
+    // 未找到的符号和无效项被跳过
+    EXPECT_EQ(hook.hook_symbols(hooks), 1u);
+    ASSERT_NE(g_original_puts, nullptr);
+    EXPECT_EQ(missing_original, nullptr);
+    ASSERT_NE(hook.get_entry("puts"), nullptr);
+
+    puts("Hello from bulk PLT hook");
+    ASSERT_FALSE(g_log.empty());
+    EXPECT_EQ(g_log.back(), "hooked: Hello from bulk PLT hook");
+
+    ASSERT_TRUE(hook.unhook_symbol("puts"));
+    g_log.clear();
+    puts("After bulk unhook");
+    EXPECT_TRUE(g_log.empty());
+}
+
+TEST(PltHookTest, ManagerHooksEveryImportingModule) {
+    auto& manager = ur::plthook::Manager::instance();
+    manager.refresh();
+    EXPECT_GT(manager.module_count(), 0u);
+
+    g_log.clear();
+    g_original_puts = nullptr;
+    // 主程序导入了 puts，至少它会被修改
+    ASSERT_GE(manager.hook_symbol("puts", reinterpret_cast<void*>(&my_puts), &g_original_puts), 1u);
+    ASSERT_NE(g_original_puts, nullptr);
+
+    puts("Hello from PLT hook manager");
+    ASSERT_FALSE(g_log.empty());
+    EXPECT_EQ(g_log.back(), "hooked: Hello from PLT hook manager");
+
+    // 模块集合未变化时不会重新解析
+    EXPECT_EQ(manager.refresh(), 0u);
+
+    ASSERT_TRUE(manager.unhook_symbol("puts"));
+    EXPECT_FALSE(manager.unhook_symbol("puts"));
+    g_log.clear();
+    puts("After manager unhook");
+    EXPECT_TRUE(g_log.empty());
+}
+
+TEST(PltHookTest, UnhookSymbolsAndDestructorRestoreGot) {
+    Dl_info info{};
+    ASSERT_NE(dladdr(reinterpret_cast<const void*>(&local_marker), &info), 0);
+    const auto base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+
+    {
+        ur::plthook::Hook hook(base);
+        ASSERT_TRUE(hook.is_valid());
+        ASSERT_TRUE(hook.hook_symbol("puts", reinterpret_cast<void*>(&my_puts), &g_original_puts));
+
+        // 未安装的符号与重复项被跳过
+        const std::string symbols[] = {"puts", "puts", "__urhook_no_such_symbol__"};
+        EXPECT_EQ(hook.unhook_symbols(symbols), 1u);
+        EXPECT_EQ(hook.get_entry("puts"), nullptr);
+
+        g_log.clear();
+        puts("After bulk unhook");
+        EXPECT_TRUE(g_log.empty());
+
+        // 保持安装状态，交由析构函数恢复
+        ASSERT_TRUE(hook.hook_symbol("puts", reinterpret_cast<void*>(&my_puts), &g_original_puts));
+        puts("Hooked before destruction");
+        ASSERT_FALSE(g_log.empty());
+    }
+
+    g_log.clear();
+    puts("After destructor");
+    EXPECT_TRUE(g_log.empty());
+}
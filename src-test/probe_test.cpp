@@ -0,0 +1,209 @@
+#include "ur/probe.h"
+#include <gtest/gtest.h>
+
+#include <dlfcn.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+__attribute__((noinline)) int probe_target(int a, int b) {
+    asm volatile("nop\n nop\n nop\n nop\n nop");
+    return a * 3 + b;
+}
+
+__attribute__((noinline)) long probe_target_scratch(long a, long b) {
+    asm volatile("nop\n nop\n nop\n nop\n nop");
+    return a - b;
+}
+
+// 通过 volatile 指针调用，防止编译器内联
+template <typename T>
+T opaque(T function) {
+    T volatile pointer = function;
+    return pointer;
+}
+
+std::vector<ur::probe::Record> drain_all(std::vector<uint32_t>* thread_ids = nullptr) {
+    std::vector<ur::probe::Record> records;
+    ur::probe::drain([&](const ur::probe::Batch& batch) {
+        records.insert(records.end(), batch.records.begin(), batch.records.end());
+        if (thread_ids) thread_ids->insert(thread_ids->end(), batch.records.size(), batch.thread_id);
+    });
+    return records;
+}
+
+uint32_t current_thread_id() {
+    return static_cast<uint32_t>(syscall(SYS_gettid));
+}
+
+} // namespace
+
+TEST(ProbeTest, RecordsHitsWithSelectedRegisters) {
+    drain_all();
+    const auto address = reinterpret_cast<uintptr_t>(&probe_target);
+    ur::probe::ProbeOptions options;
+    options.register_mask = 0b11; // x0, x1
+    ur::probe::Probe probe(address, options);
+    ASSERT_TRUE(probe.is_valid());
+    EXPECT_EQ(probe.address(), address);
+
+    constexpr int kHits = 100;
+    for (int i = 0; i < kHits; ++i) {
+        EXPECT_EQ(opaque(&probe_target)(i, 7), i * 3 + 7);
+    }
+
+    std::vector<uint32_t> thread_ids;
+    const auto records = drain_all(&thread_ids);
+    ASSERT_EQ(records.size(), static_cast<size_t>(kHits));
+    uint64_t previous = 0;
+    for (int i = 0; i < kHits; ++i) {
+        EXPECT_EQ(records[i].pc, address);
+        EXPECT_EQ(static_cast<uint32_t>(records[i].registers[0]), static_cast<uint32_t>(i));
+        EXPECT_EQ(static_cast<uint32_t>(records[i].registers[1]), 7u);
+        EXPECT_EQ(records[i].registers[2], 0u);
+        EXPECT_GE(records[i].timestamp, previous);
+        previous = records[i].timestamp;
+        EXPECT_EQ(thread_ids[i], current_thread_id());
+    }
+    EXPECT_LE(previous, ur::probe::now());
+    EXPECT_GT(ur::probe::timer_frequency(), 0u);
+    EXPECT_TRUE(drain_all().empty());
+}
+
+TEST(ProbeTest, ScratchAndLinkRegistersAreRecordedAndPreserved) {
+    drain_all();
+    ur::probe::ProbeOptions options;
+    // x9-x11 是探针内部使用的临时寄存器，x30 是返回地址
+    options.register_mask = (1u << 0) | (1u << 9) | (1u << 10) | (1u << 11) | (1u << 30);
+    ur::probe::Probe probe(reinterpret_cast<uintptr_t>(&probe_target_scratch), options);
+
+    EXPECT_EQ(opaque(&probe_target_scratch)(50, 8), 42);
+    const auto records = drain_all();
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].registers[0], 50u);
+    EXPECT_NE(records[0].registers[4], 0u);
+    EXPECT_EQ(records[0].registers[5], 0u);
+}
+
+TEST(ProbeTest, RejectsInvalidArguments) {
+    EXPECT_THROW(ur::probe::Probe(0), std::invalid_argument);
+    ur::probe::ProbeOptions too_many;
+    too_many.register_mask = 0x7F;
+    EXPECT_THROW(ur::probe::Probe(reinterpret_cast<uintptr_t>(&probe_target), too_many), std::invalid_argument);
+    ur::probe::ProbeOptions stack_pointer;
+    stack_pointer.register_mask = 1u << 31;
+    EXPECT_THROW(ur::probe::Probe(reinterpret_cast<uintptr_t>(&probe_target), stack_pointer), std::invalid_argument);
+}
+
+TEST(ProbeTest, DisableAndUnhookStopRecording) {
+    drain_all();
+    ur::probe::Probe probe(reinterpret_cast<uintptr_t>(&probe_target));
+    opaque(&probe_target)(1, 1);
+    EXPECT_TRUE(probe.disable());
+    opaque(&probe_target)(1, 1);
+    EXPECT_TRUE(probe.enable());
+    opaque(&probe_target)(1, 1);
+    EXPECT_EQ(drain_all().size(), 2u);
+
+    ur::probe::Probe moved(std::move(probe));
+    EXPECT_FALSE(probe.is_valid()); // NOLINT
+    opaque(&probe_target)(1, 1);
+    moved.unhook();
+    EXPECT_FALSE(moved.is_valid());
+    EXPECT_EQ(opaque(&probe_target)(1, 1), 4);
+    EXPECT_EQ(drain_all().size(), 1u);
+}
+
+TEST(ProbeTest, FullRingDropsHits) {
+    drain_all();
+    ur::probe::Probe probe(reinterpret_cast<uintptr_t>(&probe_target));
+    const uint64_t dropped_before = ur::probe::dropped();
+
+    constexpr size_t kExtra = 10;
+    for (size_t i = 0; i < ur::probe::kRingCapacity + kExtra; ++i) {
+        opaque(&probe_target)(static_cast<int>(i), 0);
+    }
+    EXPECT_EQ(ur::probe::dropped() - dropped_before, kExtra);
+
+    // max_records 限制单次取出的数量，其余记录留在环中
+    size_t taken = 0;
+    EXPECT_EQ(ur::probe::drain([&](const ur::probe::Batch& batch) { taken += batch.records.size(); }, 100), 100u);
+    EXPECT_EQ(taken, 100u);
+    for (int i = 0; i < 200; ++i) opaque(&probe_target)(i, 0);
+    const auto records = drain_all();
+    ASSERT_EQ(records.size(), ur::probe::kRingCapacity + 100);
+    EXPECT_EQ(static_cast<uint32_t>(records.front().registers[0]), 100u);
+    EXPECT_EQ(static_cast<uint32_t>(records.back().registers[0]), 199u);
+}
+
+TEST(ProbeTest, ThreadsRecordWhileDraining) {
+    drain_all();
+    ur::probe::Probe probe(reinterpret_cast<uintptr_t>(&probe_target));
+    const uint64_t dropped_before = ur::probe::dropped();
+
+    constexpr int kThreads = 4;
+    constexpr int kIterations = 20000;
+    std::atomic<bool> stop{false};
+    std::map<uint32_t, std::vector<uint32_t>> arguments;
+    auto collect = [&](const ur::probe::Batch& batch) {
+        auto& values = arguments[batch.thread_id];
+        for (const auto& record : batch.records) values.push_back(static_cast<uint32_t>(record.registers[0]));
+    };
+    std::thread consumer([&] {
+        while (!stop) ur::probe::drain(collect);
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < kIterations; ++i) opaque(&probe_target)(i, 0);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    stop = true;
+    consumer.join();
+    ur::probe::drain(collect);
+
+    // 每个线程的记录按命中顺序排列；丢弃的只可能是环满时的命中
+    const uint64_t dropped = ur::probe::dropped() - dropped_before;
+    size_t total = 0;
+    for (const auto& [thread_id, values] : arguments) {
+        for (size_t i = 1; i < values.size(); ++i) {
+            ASSERT_LT(values[i - 1], values[i]) << "thread " << thread_id;
+        }
+        total += values.size();
+    }
+    EXPECT_EQ(total + dropped, static_cast<uint64_t>(kThreads) * kIterations);
+    EXPECT_EQ(arguments.size(), static_cast<size_t>(kThreads));
+}
+
+TEST(ProbeTest, ProbesTheAllocator) {
+    // 新线程第一次命中时登记自己的环；慢路径若调用 malloc 会在这里递归或死锁
+    auto* allocate = reinterpret_cast<void* (*)(size_t)>(dlsym(RTLD_DEFAULT, "malloc"));
+    ASSERT_NE(allocate, nullptr);
+    drain_all();
+    ur::probe::Probe probe(reinterpret_cast<uintptr_t>(allocate));
+
+    uint32_t thread_id = 0;
+    std::thread thread([&] {
+        thread_id = current_thread_id();
+        for (int i = 0; i < 10; ++i) free(opaque(allocate)(32));
+    });
+    thread.join();
+    probe.unhook();
+
+    std::vector<uint32_t> thread_ids;
+    const auto records = drain_all(&thread_ids);
+    size_t hits = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (thread_ids[i] == thread_id) ++hits;
+    }
+    EXPECT_GE(hits, 10u);
+}
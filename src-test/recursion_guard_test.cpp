@@ -0,0 +1,189 @@
+#include "ur/recursion_guard.h"
+#include "ur/inline_hook.h"
+#include "ur/mid_hook.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+__attribute__((noinline)) int guarded_target(int x) {
+    asm volatile("");
+    return x + 1;
+}
+
+__attribute__((noinline)) long guarded_many_args(long a, long b, long c, long d, long e, long f, long g, long h,
+                                                 long i, long j) {
+    asm volatile("");
+    return a + b + c + d + e + f + g + h + i + 2 * j;
+}
+
+__attribute__((noinline)) int guarded_mid_target(int a, int b) {
+    asm volatile("nop\n nop\n nop\n nop\n nop");
+    return a * b;
+}
+
+// 通过 volatile 指针调用，防止编译器内联
+template <typename T>
+T opaque(T function) {
+    T volatile pointer = function;
+    return pointer;
+}
+
+std::atomic<int> g_guarded_calls{0};
+bool g_saw_guard = false;
+
+// 回调中再次调用被 Hook 的函数：有保护时会直接进入原函数
+int recursive_callback(int x) {
+    ++g_guarded_calls;
+    g_saw_guard = ur::recursion_guard::active();
+    return opaque(&guarded_target)(x) * 10;
+}
+
+int other_callback(int x) {
+    ++g_guarded_calls;
+    return opaque(&guarded_target)(x) * 100;
+}
+
+long many_args_callback(long a, long b, long c, long d, long e, long f, long g, long h, long i, long j) {
+    ++g_guarded_calls;
+    return opaque(&guarded_many_args)(a, b, c, d, e, f, g, h, i, j) + 1000;
+}
+
+std::atomic<int> g_outer_calls{0};
+ur::inline_hook::Hook* g_outer_hook = nullptr;
+
+int outer_callback(int x) {
+    ++g_outer_calls;
+    return g_outer_hook->call_original<int>(x) + 7;
+}
+
+std::atomic<int> g_mid_calls{0};
+
+void counting_mid_callback(ur::mid_hook::CpuContext*) {
+    ++g_mid_calls;
+}
+
+} // namespace
+
+TEST(RecursionGuardTest, OffsetIsSharedByAllThreads) {
+    const intptr_t offset = ur::recursion_guard::thread_offset();
+    intptr_t other = 0;
+    std::thread([&] { other = ur::recursion_guard::thread_offset(); }).join();
+    EXPECT_EQ(offset, other);
+}
+
+TEST(RecursionGuardTest, ScopeMarksOnlyTheCallingThread) {
+    EXPECT_FALSE(ur::recursion_guard::active());
+    {
+        ur::recursion_guard::Scope scope;
+        EXPECT_TRUE(ur::recursion_guard::active());
+        {
+            ur::recursion_guard::Scope nested;
+            EXPECT_TRUE(ur::recursion_guard::active());
+        }
+        // 内层 Scope 不拥有保护字，退出时不清除
+        EXPECT_TRUE(ur::recursion_guard::active());
+
+        bool other_active = true;
+        std::thread([&] { other_active = ur::recursion_guard::active(); }).join();
+        EXPECT_FALSE(other_active);
+    }
+    EXPECT_FALSE(ur::recursion_guard::active());
+}
+
+TEST(RecursionGuardTest, GuardedInlineHookBypassesReentry) {
+    g_guarded_calls = 0;
+    g_saw_guard = false;
+    ur::inline_hook::HookOptions options;
+    options.recursion_guard = true;
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&guarded_target),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&recursive_callback), true, options);
+    ASSERT_TRUE(hook.is_valid());
+
+    EXPECT_EQ(opaque(&guarded_target)(4), 50);
+    EXPECT_EQ(g_guarded_calls, 1);
+    EXPECT_TRUE(g_saw_guard);
+    EXPECT_FALSE(ur::recursion_guard::active());
+
+    // Scope 内调用直接执行原函数
+    {
+        ur::recursion_guard::Scope scope;
+        EXPECT_EQ(opaque(&guarded_target)(4), 5);
+    }
+    EXPECT_EQ(g_guarded_calls, 1);
+
+    // 每个线程各自判断
+    int result = 0;
+    std::thread([&] { result = opaque(&guarded_target)(1); }).join();
+    EXPECT_EQ(result, 20);
+    EXPECT_EQ(g_guarded_calls, 2);
+
+    // 更换 detour 后仍然经过保护
+    hook.set_detour(reinterpret_cast<ur::inline_hook::Hook::Callback>(&other_callback));
+    EXPECT_EQ(opaque(&guarded_target)(4), 500);
+    EXPECT_EQ(g_guarded_calls, 3);
+
+    EXPECT_TRUE(hook.disable());
+    EXPECT_EQ(opaque(&guarded_target)(4), 5);
+    hook.unhook();
+    EXPECT_EQ(opaque(&guarded_target)(4), 5);
+    EXPECT_EQ(g_guarded_calls, 3);
+}
+
+TEST(RecursionGuardTest, GuardKeepsStackArguments) {
+    g_guarded_calls = 0;
+    ur::inline_hook::HookOptions options;
+    options.recursion_guard = true;
+    ur::inline_hook::Hook hook(reinterpret_cast<uintptr_t>(&guarded_many_args),
+                               reinterpret_cast<ur::inline_hook::Hook::Callback>(&many_args_callback), true, options);
+    ASSERT_TRUE(hook.is_valid());
+
+    EXPECT_EQ(opaque(&guarded_many_args)(1, 2, 3, 4, 5, 6, 7, 8, 9, 10), 65 + 1000);
+    EXPECT_EQ(g_guarded_calls, 1);
+}
+
+TEST(RecursionGuardTest, UnguardedHookInChainStillRuns) {
+    g_guarded_calls = 0;
+    g_outer_calls = 0;
+    ur::inline_hook::HookOptions options;
+    options.recursion_guard = true;
+    ur::inline_hook::Hook guarded(reinterpret_cast<uintptr_t>(&guarded_target),
+                                  reinterpret_cast<ur::inline_hook::Hook::Callback>(&recursive_callback), true, options);
+    ur::inline_hook::Hook outer(reinterpret_cast<uintptr_t>(&guarded_target),
+                                reinterpret_cast<ur::inline_hook::Hook::Callback>(&outer_callback));
+    g_outer_hook = &outer;
+
+    // outer -> guarded -> (重入) outer -> 跳过 guarded -> 原函数
+    EXPECT_EQ(opaque(&guarded_target)(4), ((5 + 7) * 10) + 7);
+    EXPECT_EQ(g_guarded_calls, 1);
+    EXPECT_EQ(g_outer_calls, 2);
+
+    // 无保护的 Hook 不受保护字影响
+    {
+        ur::recursion_guard::Scope scope;
+        EXPECT_EQ(opaque(&guarded_target)(4), 12);
+    }
+    EXPECT_EQ(g_guarded_calls, 1);
+    EXPECT_EQ(g_outer_calls, 3);
+    g_outer_hook = nullptr;
+}
+
+TEST(RecursionGuardTest, GuardedMidHookSkipsCallback) {
+    g_mid_calls = 0;
+    ur::mid_hook::MidHookOptions options;
+    options.recursion_guard = true;
+    ur::mid_hook::MidHook hook(reinterpret_cast<uintptr_t>(&guarded_mid_target), &counting_mid_callback, options);
+    ASSERT_TRUE(hook.is_valid());
+
+    EXPECT_EQ(opaque(&guarded_mid_target)(3, 4), 12);
+    EXPECT_EQ(g_mid_calls, 1);
+    EXPECT_FALSE(ur::recursion_guard::active());
+
+    {
+        ur::recursion_guard::Scope scope;
+        EXPECT_EQ(opaque(&guarded_mid_target)(3, 4), 12);
+    }
+    EXPECT_EQ(g_mid_calls, 1);
+}
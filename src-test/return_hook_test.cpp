@@ -0,0 +1,323 @@
+#include "ur/return_hook.h"
+#include "ur/inline_hook.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <csetjmp>
+#include <csignal>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+__attribute__((noinline)) int return_target_add(int a, int b) {
+    asm volatile("");
+    return a + b;
+}
+
+__attribute__((noinline)) long return_target_many(long a, long b, long c, long d, long e, long f, long g, long h,
+                                                  long i, long j) {
+    asm volatile("");
+    return a + b + c + d + e + f + g + h + i + 2 * j;
+}
+
+__attribute__((noinline)) int return_target_fib(int n) {
+    if (n < 2) return n;
+    int a = return_target_fib(n - 1);
+    int b = return_target_fib(n - 2);
+    // 两次调用之后的屏障阻止编译器把递归改写成循环
+    asm volatile("" : "+r"(a), "+r"(b));
+    return a + b;
+}
+
+__attribute__((noinline)) double return_target_scale(double x, int factor) {
+    asm volatile("");
+    return x * factor;
+}
+
+__attribute__((noinline)) double return_target_affine(double x) {
+    asm volatile("");
+    return x * 2.5 + 1.0;
+}
+
+std::jmp_buf g_jump;
+
+__attribute__((noinline)) int return_target_jump_away(int n) {
+    asm volatile("");
+    std::longjmp(g_jump, n);
+}
+
+// 经由被 Hook 的内层函数 longjmp 回到自身，内层调用的影子栈记录被遗弃
+__attribute__((noinline)) int return_target_jump_back(int n) {
+    volatile int result = n;
+    if (setjmp(g_jump) == 0) {
+        int (*volatile jump)(int) = &return_target_jump_away;
+        jump(n);
+    }
+    return result + 1;
+}
+
+volatile int g_handler_result = 0;
+
+__attribute__((noinline)) int return_target_raise(int n) {
+    raise(SIGUSR2);
+    asm volatile("");
+    return n + 1;
+}
+
+void call_hooked_in_handler(int) {
+    int (*volatile add)(int, int) = &return_target_add;
+    g_handler_result = add(2, 3);
+}
+
+// 通过 volatile 指针调用，防止编译器内联
+template <typename T>
+T opaque(T function) {
+    T volatile pointer = function;
+    return pointer;
+}
+
+struct Counters {
+    std::atomic<int> enters{0};
+    std::atomic<int> leaves{0};
+    std::atomic<int> max_depth{0};
+    uint64_t last_args[2] = {};
+    uint64_t last_result = 0;
+    uint64_t last_cookie = 0;
+};
+
+uint64_t record_enter(ur::return_hook::CallFrame* frame, void* user_data) {
+    auto* counters = static_cast<Counters*>(user_data);
+    ++counters->enters;
+    counters->last_args[0] = frame->gpr[0];
+    counters->last_args[1] = frame->gpr[1];
+    return frame->gpr[0] * 1000;
+}
+
+void record_leave(ur::return_hook::CallFrame* frame, uint64_t cookie, void* user_data) {
+    auto* counters = static_cast<Counters*>(user_data);
+    ++counters->leaves;
+    counters->last_cookie = cookie;
+    counters->last_result = frame->gpr[0];
+    // 出口回调运行时本次调用已经出栈
+    const int depth = static_cast<int>(ur::return_hook::ReturnHook::depth()) + 1;
+    int seen = counters->max_depth.load();
+    while (depth > seen && !counters->max_depth.compare_exchange_weak(seen, depth)) {}
+}
+
+uint64_t double_first_argument(ur::return_hook::CallFrame* frame, void*) {
+    frame->gpr[0] *= 2;
+    return 0;
+}
+
+void add_one_to_result(ur::return_hook::CallFrame* frame, uint64_t, void*) {
+    frame->gpr[0] = static_cast<uint32_t>(frame->gpr[0] + 1);
+}
+
+std::atomic<int> g_simple_leaves{0};
+std::atomic<int> g_simple_enters{0};
+
+uint64_t count_enter(ur::return_hook::CallFrame* frame, void*) {
+    ++g_simple_enters;
+    return frame->gpr[0];
+}
+
+void check_cookie_leave(ur::return_hook::CallFrame* frame, uint64_t cookie, void* user_data) {
+    // 每个调用的 cookie 是其参数 n，fib(n < 2) 返回 n
+    if (cookie < 2 && frame->gpr[0] != cookie) ++*static_cast<std::atomic<int>*>(user_data);
+    ++g_simple_leaves;
+}
+
+void count_leave(ur::return_hook::CallFrame*, uint64_t, void*) {
+    ++g_simple_leaves;
+}
+
+ur::inline_hook::Hook* g_inner_hook = nullptr;
+
+int inner_add_callback(int a, int b) {
+    return g_inner_hook->call_original<int>(a, b) * 10;
+}
+
+} // namespace
+
+TEST(ReturnHookTest, EnterAndLeaveSeeArgumentsAndResult) {
+    Counters counters;
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_add), &record_enter, &record_leave,
+                                     &counters);
+    ASSERT_TRUE(hook.is_valid());
+
+    EXPECT_EQ(opaque(&return_target_add)(3, 4), 7);
+    EXPECT_EQ(counters.enters, 1);
+    EXPECT_EQ(counters.leaves, 1);
+    EXPECT_EQ(counters.last_args[0], 3u);
+    EXPECT_EQ(counters.last_args[1], 4u);
+    EXPECT_EQ(static_cast<uint32_t>(counters.last_result), 7u);
+    EXPECT_EQ(counters.last_cookie, 3000u);
+    EXPECT_EQ(counters.max_depth, 1);
+    EXPECT_EQ(ur::return_hook::ReturnHook::depth(), 0u);
+
+    EXPECT_TRUE(hook.disable());
+    EXPECT_EQ(opaque(&return_target_add)(3, 4), 7);
+    EXPECT_EQ(counters.enters, 1);
+    EXPECT_TRUE(hook.enable());
+    EXPECT_EQ(opaque(&return_target_add)(1, 1), 2);
+    EXPECT_EQ(counters.enters, 2);
+    EXPECT_EQ(counters.leaves, 2);
+
+    hook.unhook();
+    EXPECT_FALSE(hook.is_valid());
+    EXPECT_EQ(opaque(&return_target_add)(1, 1), 2);
+    EXPECT_EQ(counters.enters, 2);
+}
+
+TEST(ReturnHookTest, CallbacksCanRewriteArgumentsAndResult) {
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_add), &double_first_argument,
+                                     &add_one_to_result);
+    EXPECT_EQ(opaque(&return_target_add)(5, 1), 12);
+}
+
+TEST(ReturnHookTest, EnterOnlyLeavesReturnAddressAlone) {
+    Counters counters;
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_add), &record_enter, nullptr,
+                                     &counters);
+    EXPECT_EQ(opaque(&return_target_add)(2, 2), 4);
+    EXPECT_EQ(counters.enters, 1);
+    EXPECT_EQ(ur::return_hook::ReturnHook::depth(), 0u);
+}
+
+TEST(ReturnHookTest, RejectsInvalidArguments) {
+    EXPECT_THROW(ur::return_hook::ReturnHook(0, &record_enter, &record_leave), std::invalid_argument);
+    EXPECT_THROW(ur::return_hook::ReturnHook(reinterpret_cast<uintptr_t>(&return_target_add), nullptr, nullptr),
+                 std::invalid_argument);
+}
+
+TEST(ReturnHookTest, StackArgumentsReachTheFunction) {
+    g_simple_leaves = 0;
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_many), nullptr, &count_leave);
+    EXPECT_EQ(opaque(&return_target_many)(1, 2, 3, 4, 5, 6, 7, 8, 9, 10), 65);
+    EXPECT_EQ(g_simple_leaves, 1);
+}
+
+TEST(ReturnHookTest, RecursiveCallsNestOnTheShadowStack) {
+    Counters counters;
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_fib), &record_enter, &record_leave,
+                                     &counters);
+    EXPECT_EQ(opaque(&return_target_fib)(10), 55);
+    // fib(10) 共调用 177 次，最深 10 层
+    EXPECT_EQ(counters.enters, 177);
+    EXPECT_EQ(counters.leaves, 177);
+    EXPECT_EQ(counters.max_depth, 10);
+    EXPECT_EQ(ur::return_hook::ReturnHook::depth(), 0u);
+}
+
+TEST(ReturnHookTest, FloatingPointResultSurvives) {
+    g_simple_leaves = 0;
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_scale), nullptr, &count_leave);
+    EXPECT_DOUBLE_EQ(opaque(&return_target_scale)(1.25, 4), 5.0);
+    EXPECT_EQ(g_simple_leaves, 1);
+}
+
+// 默认选项下入口和出口的簿记代码也不能破坏浮点参数与返回值
+TEST(ReturnHookTest, FloatingPointArgumentAndResultSurviveDefaultOptions) {
+    Counters counters;
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_affine), &record_enter,
+                                     &record_leave, &counters);
+    EXPECT_DOUBLE_EQ(opaque(&return_target_affine)(3.0), 8.5);
+    EXPECT_DOUBLE_EQ(opaque(&return_target_affine)(-0.5), -0.25);
+    EXPECT_EQ(counters.enters, 2);
+    EXPECT_EQ(counters.leaves, 2);
+}
+
+TEST(ReturnHookTest, ComposesWithInlineHooks) {
+    Counters counters;
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_add), &record_enter, &record_leave,
+                                     &counters);
+    ur::inline_hook::Hook inner(reinterpret_cast<uintptr_t>(&return_target_add),
+                                reinterpret_cast<ur::inline_hook::Hook::Callback>(&inner_add_callback));
+    g_inner_hook = &inner;
+
+    // 后安装的 inline hook 先执行，其原函数是 ReturnHook 的入口
+    EXPECT_EQ(opaque(&return_target_add)(1, 2), 30);
+    EXPECT_EQ(counters.enters, 1);
+    EXPECT_EQ(static_cast<uint32_t>(counters.last_result), 3u);
+    g_inner_hook = nullptr;
+}
+
+TEST(ReturnHookTest, ThreadsKeepSeparateShadowStacks) {
+    g_simple_enters = 0;
+    g_simple_leaves = 0;
+    std::atomic<int> failures{0};
+    ur::return_hook::ReturnHook hook(reinterpret_cast<uintptr_t>(&return_target_fib), &count_enter,
+                                     &check_cookie_leave, &failures);
+
+    constexpr int kThreads = 4;
+    constexpr int kIterations = 200;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < kIterations; ++i) {
+                if (opaque(&return_target_fib)(6) != 8) ++failures;
+            }
+            if (ur::return_hook::ReturnHook::depth() != 0) ++failures;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_EQ(failures, 0);
+    // fib(6) 共调用 25 次
+    EXPECT_EQ(g_simple_enters, kThreads * kIterations * 25);
+    EXPECT_EQ(g_simple_leaves, g_simple_enters.load());
+    EXPECT_EQ(ur::return_hook::ReturnHook::dropped(), 0u);
+}
+
+TEST(ReturnHookTest, LongjmpDiscardsAbandonedEntriesOnReturn) {
+    Counters counters;
+    ur::return_hook::ReturnHook outer(reinterpret_cast<uintptr_t>(&return_target_jump_back), &record_enter,
+                                      &record_leave, &counters);
+    ur::return_hook::ReturnHook inner(reinterpret_cast<uintptr_t>(&return_target_jump_away), &record_enter,
+                                      &record_leave, &counters);
+    EXPECT_EQ(opaque(&return_target_jump_back)(4), 5);
+    // 内层调用没有返回，只有外层执行出口回调
+    EXPECT_EQ(counters.enters, 2);
+    EXPECT_EQ(counters.leaves, 1);
+    EXPECT_EQ(counters.last_result, 5u);
+    EXPECT_EQ(ur::return_hook::ReturnHook::depth(), 0u);
+}
+
+// 备用栈位于本函数的栈帧中，地址高于被 Hook 的外层调用：入口不能按 sp 丢弃仍在执行的外层调用
+TEST(ReturnHookTest, CallsOnSigaltstackNestInsideOuterCalls) {
+    alignas(16) char alt_stack_memory[64 * 1024];
+    stack_t alt_stack{};
+    alt_stack.ss_sp = alt_stack_memory;
+    alt_stack.ss_size = sizeof(alt_stack_memory);
+    stack_t old_stack{};
+    ASSERT_EQ(sigaltstack(&alt_stack, &old_stack), 0);
+
+    struct sigaction action{};
+    action.sa_handler = &call_hooked_in_handler;
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    struct sigaction old_action{};
+    ASSERT_EQ(sigaction(SIGUSR2, &action, &old_action), 0);
+
+    Counters outer_counters;
+    Counters inner_counters;
+    {
+        ur::return_hook::ReturnHook outer(reinterpret_cast<uintptr_t>(&return_target_raise), &record_enter,
+                                          &record_leave, &outer_counters);
+        ur::return_hook::ReturnHook inner(reinterpret_cast<uintptr_t>(&return_target_add), &record_enter,
+                                          &record_leave, &inner_counters);
+        g_handler_result = 0;
+        EXPECT_EQ(opaque(&return_target_raise)(7), 8);
+        EXPECT_EQ(g_handler_result, 5);
+    }
+
+    sigaction(SIGUSR2, &old_action, nullptr);
+    sigaltstack(&old_stack, nullptr);
+
+    EXPECT_EQ(inner_counters.leaves, 1);
+    EXPECT_EQ(outer_counters.leaves, 1);
+    EXPECT_EQ(outer_counters.last_result, 8u);
+    EXPECT_EQ(ur::return_hook::ReturnHook::depth(), 0u);
+}
@@ -0,0 +1,280 @@
+#include "ur/scanner.h"
+#include "ur/cache_maintenance.h"
+#include "ur/jit.h"
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using ur::scanner::InsnPattern;
+using ur::scanner::Pattern;
+
+namespace {
+
+using ConstantFunc = uint64_t (*)();
+
+// 独立的可执行页。扫描不包含 exec_pool，因此被扫描的代码不能由 Jit::finalize 放进内存池
+class CodePage {
+public:
+    CodePage() : m_size(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+        m_memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    ~CodePage() {
+        if (m_memory != MAP_FAILED) munmap(m_memory, m_size);
+    }
+    CodePage(const CodePage&) = delete;
+    CodePage& operator=(const CodePage&) = delete;
+
+    void* load(std::span<const uint32_t> code) {
+        if (m_memory == MAP_FAILED || code.size_bytes() > m_size) return nullptr;
+        std::memcpy(m_memory, code.data(), code.size_bytes());
+        if (mprotect(m_memory, m_size, PROT_READ | PROT_EXEC) != 0) return nullptr;
+        ur::cache_maintenance::sync_code(reinterpret_cast<uintptr_t>(m_memory), code.size_bytes());
+        return m_memory;
+    }
+
+private:
+    size_t m_size;
+    void* m_memory = MAP_FAILED;
+};
+
+// 生成一个返回 expected 的函数。常量使指令序列在进程中唯一，且不会以字面量出现在本测试的
+// 代码或只读数据中；每次调用使用不同的常量，因为之前的测试可能在其他位置留有副本
+void emit_constant_function(ur::jit::Jit& jit, uint64_t& expected) {
+    using ur::assembler::Register;
+    static uint16_t salt = 0;
+    const uint16_t low = static_cast<uint16_t>(0xb4d2 + ++salt);
+    jit.movz(Register::X0, low);
+    jit.movk(Register::X0, 0x9e17, 16);
+    jit.movk(Register::X0, 0x3c5a, 32);
+    for (int i = 0; i < 4; ++i) jit.nop();
+    jit.ret();
+    expected = 0x3c5a9e170000u | low;
+}
+
+ConstantFunc make_constant_function(CodePage& page, uint64_t& expected) {
+    ur::jit::Jit jit;
+    emit_constant_function(jit, expected);
+    return reinterpret_cast<ConstantFunc>(page.load(jit.get_code_span()));
+}
+
+uint64_t replacement_constant() {
+    return 42;
+}
+
+} // namespace
+
+TEST(ScannerTest, ParsesIdaPatterns) {
+    Pattern pattern("FD 7B ?? a9 ? 00");
+    ASSERT_EQ(pattern.size(), 6u);
+    EXPECT_EQ(pattern.bytes()[0], 0xFD);
+    EXPECT_EQ(pattern.bytes()[3], 0xA9);
+    EXPECT_EQ(pattern.mask()[2], 0x00);
+    EXPECT_EQ(pattern.mask()[4], 0x00);
+    EXPECT_EQ(pattern.mask()[5], 0xFF);
+    // 锚点避开 AArch64 中常见的字节
+    EXPECT_EQ(pattern.anchor(), 0u);
+    EXPECT_EQ(Pattern("00 ?? 7B").anchor(), 2u);
+
+    EXPECT_THROW(Pattern("?? ??"), std::invalid_argument);
+    EXPECT_THROW(Pattern("FD7B"), std::invalid_argument);
+    EXPECT_THROW(Pattern("FG"), std::invalid_argument);
+    EXPECT_THROW(Pattern("F"), std::invalid_argument);
+}
+
+TEST(ScannerTest, ScanFindsAllMatchesInRange) {
+    // 匹配分布在开头、中间（跨 16 字节边界）和末尾
+    std::vector<uint8_t> buffer(4096, 0x00);
+    const uint8_t needle[] = {0x12, 0x34, 0x56, 0x78};
+    for (size_t offset : {size_t(0), size_t(30), size_t(1000), buffer.size() - sizeof(needle)}) {
+        std::memcpy(buffer.data() + offset, needle, sizeof(needle));
+    }
+    buffer[1000 + 2] = 0xEE; // 通配符位置的不同字节也应匹配
+
+    Pattern pattern("12 34 ?? 78");
+    auto matches = ur::scanner::scan(reinterpret_cast<uintptr_t>(buffer.data()), buffer.size(), pattern);
+    const auto base = reinterpret_cast<uintptr_t>(buffer.data());
+    ASSERT_EQ(matches.size(), 4u);
+    EXPECT_EQ(matches[0], base);
+    EXPECT_EQ(matches[1], base + 30);
+    EXPECT_EQ(matches[2], base + 1000);
+    EXPECT_EQ(matches[3], base + buffer.size() - sizeof(needle));
+
+    // 末尾被截断的部分匹配不算
+    auto truncated = ur::scanner::scan(base, buffer.size() - 1, pattern);
+    EXPECT_EQ(truncated.size(), 3u);
+}
+
+TEST(ScannerTest, ScanExecutableFindsJitFunction) {
+    CodePage page;
+    uint64_t expected = 0;
+    ConstantFunc func = make_constant_function(page, expected);
+    ASSERT_NE(func, nullptr);
+
+    // 从函数内存读取签名，并把 movk 的一个字节设为通配符
+    std::vector<uint8_t> bytes(12);
+    std::memcpy(bytes.data(), reinterpret_cast<const void*>(func), bytes.size());
+    std::vector<uint8_t> mask(bytes.size(), 0xFF);
+    mask[5] = 0x00;
+    Pattern pattern(bytes, mask);
+
+    ur::scanner::ScanOptions options;
+    options.threads = 4;
+    auto matches = ur::scanner::scan_executable(pattern, options);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0], reinterpret_cast<uintptr_t>(func));
+}
+
+TEST(ScannerTest, HookPatternHooksUniqueMatch) {
+    CodePage page;
+    uint64_t expected = 0;
+    ConstantFunc func = make_constant_function(page, expected);
+    ASSERT_NE(func, nullptr);
+    ASSERT_EQ(func(), expected);
+
+    std::vector<uint8_t> bytes(12);
+    std::memcpy(bytes.data(), reinterpret_cast<const void*>(func), bytes.size());
+    std::vector<uint8_t> mask(bytes.size(), 0xFF);
+    Pattern pattern(bytes, mask);
+
+    {
+        auto hook = ur::scanner::hook_pattern(pattern, reinterpret_cast<void*>(&replacement_constant));
+        ASSERT_TRUE(hook.is_valid());
+        EXPECT_EQ(func(), 42u);
+        EXPECT_EQ(hook.call_original<uint64_t>(), expected);
+        // 函数开头已被改写，跳板中的原始指令位于内存池，不算匹配
+        EXPECT_TRUE(ur::scanner::scan_executable(pattern).empty());
+    }
+    EXPECT_EQ(func(), expected);
+    // 解除 Hook 后可以再次按签名 Hook
+    {
+        auto hook = ur::scanner::hook_pattern(pattern, reinterpret_cast<void*>(&replacement_constant));
+        ASSERT_TRUE(hook.is_valid());
+        EXPECT_EQ(func(), 42u);
+    }
+
+    EXPECT_THROW(ur::scanner::hook_pattern(Pattern("12 34 56 78 9A BC DE F0 0F ED CB A9 87 65 43 21"),
+                                           reinterpret_cast<void*>(&replacement_constant)),
+                 std::runtime_error);
+}
+
+TEST(ScannerTest, ParsesInstructionPatterns) {
+    InsnPattern pattern("ADRP x?, *; add X1, x?, #0x10 ; BL *");
+    ASSERT_EQ(pattern.size(), 3u);
+    EXPECT_EQ(pattern.byte_size(), 12u);
+    EXPECT_EQ(pattern.steps()[1].ids[0], ur::disassembler::InstructionId::ADD);
+    ASSERT_EQ(pattern.steps()[1].operands.size(), 3u);
+    EXPECT_EQ(pattern.steps()[1].operands[0].kind, InsnPattern::Operand::Kind::REG);
+    EXPECT_EQ(pattern.steps()[1].operands[2].imm, 0x10);
+    // 锚点选择过滤条件最严格的指令
+    EXPECT_EQ(InsnPattern("add x0, x0, #1; ret").anchor(), 1u);
+    EXPECT_EQ(InsnPattern("* ; nop; b.eq *").anchor(), 1u);
+
+    EXPECT_THROW(InsnPattern(""), std::invalid_argument);
+    EXPECT_THROW(InsnPattern("*; ?"), std::invalid_argument);
+    EXPECT_THROW(InsnPattern("frob x0"), std::invalid_argument);
+    EXPECT_THROW(InsnPattern("add x31, x0, #1"), std::invalid_argument);
+    EXPECT_THROW(InsnPattern("ldr x0, [x1, #zz]"), std::invalid_argument);
+    EXPECT_THROW(InsnPattern("b.xx *"), std::invalid_argument);
+}
+
+TEST(ScannerTest, InstructionScanMatchesOperands) {
+    // 手工编码的指令流，匹配分别位于开头、中间和末尾
+    std::vector<uint32_t> words(64, 0xD503201F); // nop
+    auto place = [&](size_t at, uint32_t ldr) {
+        words[at] = 0xF9400820;     // ldr x0, [x1, #16]
+        words[at + 1] = 0x91000400; // add x0, x0, #1
+        words[at + 2] = ldr;
+    };
+    place(0, 0xF9000820);        // str x0, [x1, #16]
+    place(13, 0xF9000C20);       // str x0, [x1, #24]
+    place(61, 0xF9000820);
+    words[30] = 0xF9400820;      // 不完整的序列
+    words[31] = 0x91000800;      // add x0, x0, #2
+
+    const auto base = reinterpret_cast<uintptr_t>(words.data());
+    const size_t size = words.size() * 4;
+
+    auto matches = ur::scanner::scan(base, size, InsnPattern("ldr x?, [x1, #16]; add x0, x0, #1; str x0, [*]"));
+    ASSERT_EQ(matches.size(), 3u);
+    EXPECT_EQ(matches[0], base);
+    EXPECT_EQ(matches[1], base + 13 * 4);
+    EXPECT_EQ(matches[2], base + 61 * 4);
+
+    // 位移、立即数与寄存器类别都参与比较
+    EXPECT_EQ(ur::scanner::scan(base, size, InsnPattern("ldr x?, [x1, #16]; add x0, x0, #1; str x0, [x1, #24]")).size(), 1u);
+    EXPECT_EQ(ur::scanner::scan(base, size, InsnPattern("ldr x?, [*]; add x0, x0, #*; str w?, [*]")).size(), 0u);
+    EXPECT_EQ(ur::scanner::scan(base, size, InsnPattern("ldr *, [*]; add x0, x0, #2")).size(), 1u);
+    EXPECT_EQ(ur::scanner::scan(base, size, InsnPattern("add *; *; nop; nop")).size(), 3u);
+    // 末尾被截断的序列不算；未对齐的起点按下一个 4 字节边界处理
+    EXPECT_EQ(ur::scanner::scan(base, size - 4, InsnPattern("ldr x0, [x1, #16]; add *; str *")).size(), 2u);
+    EXPECT_EQ(ur::scanner::scan(base + 1, size - 1, InsnPattern("ldr x0, [x1, #16]; add *; str *")).size(), 2u);
+}
+
+TEST(ScannerTest, ScanExecutableFindsJitInstructionSequence) {
+    CodePage page;
+    uint64_t expected = 0;
+    ConstantFunc func = make_constant_function(page, expected);
+    ASSERT_NE(func, nullptr);
+
+    // 立即数按解码结果比较：movz 的低 16 位与 movk 的高位
+    char text[128];
+    snprintf(text, sizeof(text), "movz x0, #%u; movk x0, #0x9e17, #16; movk x0, #0x3c5a; nop; *; nop",
+             static_cast<unsigned>(expected & 0xffff));
+    ur::scanner::ScanOptions options;
+    options.threads = 4;
+    auto matches = ur::scanner::scan_executable(InsnPattern(text), options);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0], reinterpret_cast<uintptr_t>(func));
+
+    {
+        auto hook = ur::scanner::hook_pattern(InsnPattern(text), reinterpret_cast<void*>(&replacement_constant));
+        ASSERT_TRUE(hook.is_valid());
+        EXPECT_EQ(func(), 42u);
+    }
+    EXPECT_EQ(func(), expected);
+}
+
+TEST(ScannerTest, ScanExecutableSkipsExecPool) {
+    ur::jit::Jit jit;
+    uint64_t expected = 0;
+    emit_constant_function(jit, expected);
+    auto func = jit.finalize<ConstantFunc>();
+    ASSERT_NE(func, nullptr);
+    ASSERT_EQ(func(), expected);
+
+    std::vector<uint8_t> bytes(12);
+    std::memcpy(bytes.data(), reinterpret_cast<const void*>(func), bytes.size());
+    std::vector<uint8_t> mask(bytes.size(), 0xFF);
+    EXPECT_TRUE(ur::scanner::scan_executable(Pattern(bytes, mask)).empty());
+}
+
+TEST(ScannerTest, MaxMatchesKeepsLowestAddresses) {
+    // 三个页各放一份相同的函数，限制为两个时应返回地址较低的两个
+    CodePage pages[3];
+    ur::jit::Jit jit;
+    uint64_t expected = 0;
+    emit_constant_function(jit, expected);
+    std::vector<uintptr_t> functions;
+    for (auto& page : pages) {
+        void* code = page.load(jit.get_code_span());
+        ASSERT_NE(code, nullptr);
+        functions.push_back(reinterpret_cast<uintptr_t>(code));
+    }
+    std::sort(functions.begin(), functions.end());
+
+    std::vector<uint8_t> bytes(12);
+    std::memcpy(bytes.data(), reinterpret_cast<const void*>(functions[0]), bytes.size());
+    std::vector<uint8_t> mask(bytes.size(), 0xFF);
+    ur::scanner::ScanOptions options;
+    options.threads = 4;
+    options.max_matches = 2;
+    auto matches = ur::scanner::scan_executable(Pattern(bytes, mask), options);
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[0], functions[0]);
+    EXPECT_EQ(matches[1], functions[1]);
+}
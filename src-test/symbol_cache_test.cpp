@@ -0,0 +1,119 @@
+#include "ur/symbol_cache.h"
+#include "ur/elf_parser.h"
+#include <gtest/gtest.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+constexpr uint8_t kBuildId[] = {0xde, 0xad, 0xbe, 0xef, 0x01, 0x02, 0x03, 0x04};
+
+class SymbolCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory_ = ::testing::TempDir();
+        if (!directory_.empty() && directory_.back() == '/') directory_.pop_back();
+        std::remove(path().c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path().c_str());
+    }
+
+    std::string path() const {
+        return directory_ + "/deadbeef01020304.symcache";
+    }
+
+    std::string directory_;
+};
+
+} // namespace
+
+TEST_F(SymbolCacheTest, PersistsResultsAcrossInstances) {
+    {
+        auto cache = ur::symbol_cache::Cache::open(directory_, kBuildId);
+        ASSERT_NE(cache, nullptr);
+        EXPECT_EQ(cache->path(), path());
+
+        ur::symbol_cache::Result result;
+        EXPECT_FALSE(cache->lookup("open", ur::elf_parser::gnu_hash("open"), result));
+
+        cache->record("open", ur::elf_parser::gnu_hash("open"), {true, false, 0x1234});
+        cache->record("missing", ur::elf_parser::gnu_hash("missing"), {false, false, 0});
+        // 记录后立即可查，无需先写入文件
+        ASSERT_TRUE(cache->lookup("open", ur::elf_parser::gnu_hash("open"), result));
+        EXPECT_EQ(result.value, 0x1234u);
+        EXPECT_TRUE(cache->flush());
+    }
+    ASSERT_EQ(access(path().c_str(), R_OK), 0);
+
+    auto cache = ur::symbol_cache::Cache::open(directory_, kBuildId);
+    ASSERT_NE(cache, nullptr);
+    EXPECT_EQ(cache->size(), 2u);
+
+    ur::symbol_cache::Result result;
+    ASSERT_TRUE(cache->lookup("open", ur::elf_parser::gnu_hash("open"), result));
+    EXPECT_TRUE(result.present);
+    EXPECT_FALSE(result.ifunc);
+    EXPECT_EQ(result.value, 0x1234u);
+
+    ASSERT_TRUE(cache->lookup("missing", ur::elf_parser::gnu_hash("missing"), result));
+    EXPECT_FALSE(result.present);
+
+    EXPECT_FALSE(cache->lookup("close", ur::elf_parser::gnu_hash("close"), result));
+}
+
+TEST_F(SymbolCacheTest, IgnoresFileForDifferentBuildId) {
+    {
+        auto cache = ur::symbol_cache::Cache::open(directory_, kBuildId);
+        cache->record("open", ur::elf_parser::gnu_hash("open"), {true, false, 0x1234});
+    } // 析构时写入
+
+    // 用另一个 build-id 的缓存覆盖同名文件，模拟损坏或过期的缓存
+    const uint8_t other_id[] = {0x01};
+    {
+        auto other = ur::symbol_cache::Cache::open(directory_, other_id);
+        other->record("open", ur::elf_parser::gnu_hash("open"), {true, false, 0x9999});
+    }
+    std::rename((directory_ + "/01.symcache").c_str(), path().c_str());
+
+    auto cache = ur::symbol_cache::Cache::open(directory_, kBuildId);
+    ur::symbol_cache::Result result;
+    EXPECT_FALSE(cache->lookup("open", ur::elf_parser::gnu_hash("open"), result));
+    EXPECT_EQ(cache->size(), 0u);
+}
+
+TEST_F(SymbolCacheTest, ElfParserServesLookupsFromCache) {
+    void* handle = dlopen("libc.so", RTLD_NOW);
+    ASSERT_NE(handle, nullptr);
+    Dl_info info{};
+    ASSERT_NE(dladdr(dlsym(handle, "strlen"), &info), 0);
+    const auto base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+    const auto expected = reinterpret_cast<uintptr_t>(dlsym(handle, "fopen"));
+
+    ur::elf_parser::ElfParser parser(base);
+    ASSERT_TRUE(parser.parse());
+    if (parser.get_build_id().empty()) {
+        dlclose(handle);
+        GTEST_SKIP() << "libc has no build-id";
+    }
+    ASSERT_TRUE(parser.enable_symbol_cache(directory_));
+    EXPECT_EQ(parser.find_symbol("fopen"), expected);
+    ASSERT_TRUE(parser.flush_symbol_cache());
+
+    // 新的解析器（相当于下一次启动）直接从缓存文件得到同样的地址
+    ur::elf_parser::ElfParser warm(base);
+    ASSERT_TRUE(warm.parse());
+    ASSERT_TRUE(warm.enable_symbol_cache(directory_));
+    EXPECT_EQ(warm.find_symbol("fopen"), expected);
+
+    auto cache = ur::symbol_cache::Cache::open(directory_, warm.get_build_id());
+    ur::symbol_cache::Result result;
+    EXPECT_TRUE(cache->lookup("fopen", ur::elf_parser::gnu_hash("fopen"), result));
+
+    // 缓存文件以 build-id 命名，由测试清理
+    std::remove(cache->path().c_str());
+    dlclose(handle);
+}
@@ -0,0 +1,120 @@
+#include "ur/thread_suspend.h"
+#include "ur/jit.h"
+#include "ur/assembler.h"
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+TEST(ThreadSuspendTest, StopsAndResumesOtherThreads) {
+    constexpr size_t kThreads = 4;
+    std::array<std::atomic<uint64_t>, kThreads> counters{};
+    std::atomic<size_t> running{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i]() {
+            running.fetch_add(1);
+            while (!stop.load(std::memory_order_relaxed)) {
+                counters[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    while (running.load() != kThreads) {
+        std::this_thread::yield();
+    }
+
+    std::array<uint64_t, kThreads> before{};
+    {
+        ur::thread_suspend::ScopedSuspend suspended;
+        ASSERT_GE(suspended.size(), kThreads);
+        const auto self = static_cast<uint32_t>(syscall(SYS_gettid));
+        for (size_t i = 0; i < suspended.size(); ++i) {
+            EXPECT_NE(suspended.thread_id(i), 0u);
+            EXPECT_NE(suspended.thread_id(i), self);
+            EXPECT_NE(suspended.pc(i), 0u);
+        }
+
+        for (size_t i = 0; i < kThreads; ++i) {
+            before[i] = counters[i].load();
+        }
+        // Sleeping does not allocate or lock
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        for (size_t i = 0; i < kThreads; ++i) {
+            EXPECT_EQ(counters[i].load(), before[i]);
+        }
+    }
+
+    // Every thread runs again once the scope ends
+    for (size_t i = 0; i < kThreads; ++i) {
+        while (counters[i].load() == before[i]) {
+            std::this_thread::yield();
+        }
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST(ThreadSuspendTest, RedirectsSuspendedPc) {
+    using namespace ur::assembler;
+
+    // spin: b spin
+    ur::jit::Jit spin_jit;
+    auto loop = spin_jit.new_label();
+    spin_jit.bind(loop);
+    spin_jit.b(loop);
+    auto spin = spin_jit.finalize<int (*)()>();
+    ASSERT_NE(spin, nullptr);
+
+    // exit: mov w0, #42; ret
+    ur::jit::Jit exit_jit;
+    exit_jit.mov(Register::W0, 42);
+    exit_jit.ret();
+    auto exit = exit_jit.finalize<int (*)()>();
+    ASSERT_NE(exit, nullptr);
+
+    std::atomic<int> result{0};
+    std::thread spinner([&]() { result = spin(); });
+
+    const auto spin_address = reinterpret_cast<uintptr_t>(spin);
+    bool redirected = false;
+    for (int attempt = 0; attempt < 1000 && !redirected; ++attempt) {
+        ur::thread_suspend::ScopedSuspend suspended;
+        for (size_t i = 0; i < suspended.size(); ++i) {
+            if (suspended.pc(i) == spin_address) {
+                suspended.set_pc(i, reinterpret_cast<uintptr_t>(exit));
+                redirected = true;
+            }
+        }
+    }
+    ASSERT_TRUE(redirected);
+
+    spinner.join();
+    EXPECT_EQ(result.load(), 42);
+}
+
+TEST(ThreadSuspendTest, ResumeIsIdempotent) {
+    std::atomic<bool> stop{false};
+    std::thread worker([&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+        }
+    });
+
+    ur::thread_suspend::ScopedSuspend suspended;
+    EXPECT_GE(suspended.size(), 1u);
+    suspended.resume();
+    EXPECT_EQ(suspended.size(), 0u);
+    suspended.resume();
+
+    stop = true;
+    worker.join();
+}
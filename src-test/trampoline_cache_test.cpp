@@ -0,0 +1,176 @@
+#include "ur/trampoline_cache.h"
+#include "ur/inline_hook.h"
+#include "ur/module_registry.h"
+#include "ur/elf_parser.h"
+#include <gtest/gtest.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+constexpr uint8_t kBuildId[] = {0xde, 0xad, 0xbe, 0xef, 0x05, 0x06, 0x07, 0x08};
+
+class TrampolineCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory_ = ::testing::TempDir();
+        if (!directory_.empty() && directory_.back() == '/') directory_.pop_back();
+        std::remove(path().c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path().c_str());
+    }
+
+    std::string path() const {
+        return directory_ + "/deadbeef05060708.trampcache";
+    }
+
+    std::string directory_;
+};
+
+ur::trampoline_cache::Plan make_plan(uint32_t required_size) {
+    using ur::trampoline_cache::StepKind;
+    ur::trampoline_cache::Plan plan;
+    plan.required_size = required_size;
+    plan.backup_size = 8;
+    plan.original = {0xa9bf7bfd, 0x94000010};
+    plan.steps.resize(2);
+    plan.steps[0].raw = 0xa9bf7bfd; // stp x29, x30, [sp, #-16]!
+    plan.steps[1].kind = StepKind::Call;
+    plan.steps[1].delta = 0x40 + 4;
+    return plan;
+}
+
+__attribute__((noinline)) int cached_target(int x) {
+    return x * 3 + 1;
+}
+
+int cached_hook(int) {
+    return -7;
+}
+
+} // namespace
+
+TEST_F(TrampolineCacheTest, PersistsResultsAcrossInstances) {
+    {
+        auto cache = ur::trampoline_cache::Cache::open(directory_, kBuildId);
+        ASSERT_NE(cache, nullptr);
+        EXPECT_EQ(cache->path(), path());
+
+        uint32_t limit = 0;
+        ur::trampoline_cache::Plan plan;
+        EXPECT_FALSE(cache->lookup_limit(0x1000, limit));
+        EXPECT_FALSE(cache->lookup_plan(0x1000, 4, plan));
+
+        cache->record_limit(0x1000, 20);
+        cache->record_plan(0x1000, make_plan(4));
+        cache->record_plan(0x1000, make_plan(8));
+        ASSERT_TRUE(cache->lookup_limit(0x1000, limit));
+        EXPECT_EQ(limit, 20u);
+        EXPECT_TRUE(cache->flush());
+    }
+    ASSERT_EQ(access(path().c_str(), R_OK), 0);
+
+    auto cache = ur::trampoline_cache::Cache::open(directory_, kBuildId);
+    ASSERT_NE(cache, nullptr);
+    EXPECT_EQ(cache->size(), 1u);
+    uint32_t limit = 0;
+    ASSERT_TRUE(cache->lookup_limit(0x1000, limit));
+    EXPECT_EQ(limit, 20u);
+
+    ur::trampoline_cache::Plan plan;
+    ASSERT_TRUE(cache->lookup_plan(0x1000, 8, plan));
+    EXPECT_EQ(plan.backup_size, 8u);
+    ASSERT_EQ(plan.original.size(), 2u);
+    EXPECT_EQ(plan.original[1], 0x94000010u);
+    ASSERT_EQ(plan.steps.size(), 2u);
+    EXPECT_EQ(plan.steps[0].raw, 0xa9bf7bfdu);
+    EXPECT_EQ(plan.steps[1].kind, ur::trampoline_cache::StepKind::Call);
+    EXPECT_EQ(plan.steps[1].delta, 0x44);
+    EXPECT_FALSE(cache->lookup_plan(0x1000, 12, plan));
+}
+
+TEST_F(TrampolineCacheTest, IgnoresCorruptFile) {
+    FILE* file = std::fopen(path().c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs("not a trampoline cache", file);
+    std::fclose(file);
+
+    auto cache = ur::trampoline_cache::Cache::open(directory_, kBuildId);
+    ASSERT_NE(cache, nullptr);
+    EXPECT_EQ(cache->size(), 0u);
+
+    // The next flush replaces it
+    cache->record_limit(0x2000, 8);
+    EXPECT_TRUE(cache->flush());
+    auto reopened = ur::trampoline_cache::Cache::open(directory_, kBuildId);
+    uint32_t limit = 0;
+    EXPECT_TRUE(reopened->lookup_limit(0x2000, limit));
+}
+
+TEST_F(TrampolineCacheTest, IgnoresFileWithInvalidStep) {
+    {
+        auto cache = ur::trampoline_cache::Cache::open(directory_, kBuildId);
+        ASSERT_NE(cache, nullptr);
+        cache->record_limit(0x1000, 20);
+        cache->record_plan(0x1000, make_plan(4));
+        auto plan = make_plan(8);
+        plan.steps[1].kind = ur::trampoline_cache::StepKind::Load;
+        plan.steps[1].reg = 99; // Not a register
+        cache->record_plan(0x1000, plan);
+        EXPECT_TRUE(cache->flush());
+    }
+
+    // One bad record discards everything loaded from the file
+    auto cache = ur::trampoline_cache::Cache::open(directory_, kBuildId);
+    ASSERT_NE(cache, nullptr);
+    EXPECT_EQ(cache->size(), 0u);
+    uint32_t limit = 0;
+    EXPECT_FALSE(cache->lookup_limit(0x1000, limit));
+}
+
+TEST_F(TrampolineCacheTest, EmptyBuildIdHasNoCache) {
+    EXPECT_EQ(ur::trampoline_cache::Cache::open(directory_, {}), nullptr);
+}
+
+TEST_F(TrampolineCacheTest, HooksFromWarmCache) {
+    Dl_info info{};
+    ASSERT_NE(dladdr(reinterpret_cast<void*>(&cached_target), &info), 0);
+    auto parser = ur::module_registry::get(reinterpret_cast<uintptr_t>(info.dli_fbase));
+    if (!parser || parser->get_build_id().empty()) {
+        GTEST_SKIP() << "Test binary has no build-id";
+    }
+
+    ur::inline_hook::set_trampoline_cache_directory(directory_);
+    const auto target = reinterpret_cast<uintptr_t>(&cached_target);
+    const auto callback = reinterpret_cast<ur::inline_hook::Hook::Callback>(&cached_hook);
+
+    // Cold: the plan is built and recorded
+    {
+        ur::inline_hook::Hook hook(target, callback);
+        EXPECT_EQ(cached_target(2), -7);
+    }
+    EXPECT_EQ(cached_target(2), 7);
+    EXPECT_TRUE(ur::inline_hook::flush_trampoline_cache());
+
+    auto cache = ur::trampoline_cache::Cache::open(directory_, parser->get_build_id());
+    ASSERT_NE(cache, nullptr);
+    uint32_t limit = 0;
+    EXPECT_TRUE(cache->lookup_limit(target - reinterpret_cast<uintptr_t>(info.dli_fbase), limit));
+    const std::string cache_path = cache->path();
+    cache.reset();
+
+    // Warm: the trampoline is re-emitted from the cached plan
+    {
+        ur::inline_hook::Hook hook(target, callback);
+        EXPECT_EQ(cached_target(2), -7);
+        EXPECT_EQ(hook.call_original<int>(2), 7);
+    }
+    EXPECT_EQ(cached_target(2), 7);
+
+    ur::inline_hook::set_trampoline_cache_directory("");
+    std::remove(cache_path.c_str());
+}
@@ -0,0 +1,200 @@
+#include "ur/typed_hook.h"
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+__attribute__((noinline)) int typed_target_add(int a, int b) {
+    asm volatile("");
+    return a + b;
+}
+
+__attribute__((noinline)) int typed_target_mul(int a, int b) {
+    asm volatile("");
+    return a * b;
+}
+
+__attribute__((noinline)) long lambda_target_sum(int a, long b) {
+    asm volatile("");
+    return a + b;
+}
+
+__attribute__((noinline)) double lambda_target_mixed(double a, int b, float c, const int* d) {
+    asm volatile("");
+    return a + b + c + *d;
+}
+
+__attribute__((noinline)) long lambda_target_seven(long a, long b, long c, long d, long e, long f, long g) {
+    asm volatile("");
+    return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g;
+}
+
+// 通过 volatile 指针调用，防止编译器内联或常量折叠
+template <typename T>
+T opaque(T function) {
+    T volatile pointer = function;
+    return pointer;
+}
+
+using AddHook = ur::inline_hook::TypedHook<&typed_target_add>;
+
+int add_detour(int a, int b) {
+    return AddHook::original(a, b) * 10;
+}
+
+enum class HookKey { kMul };
+using MulHook = ur::inline_hook::TypedHook<HookKey::kMul, int(int, int)>;
+
+int mul_detour(int a, int b) {
+    return MulHook::original(a, b) + 1;
+}
+
+} // namespace
+
+TEST(TypedHookTest, DetourCallsOriginalThroughStaticSlot) {
+    EXPECT_EQ(AddHook::original_function(), &typed_target_add);
+    {
+        AddHook hook(&add_detour);
+        ASSERT_TRUE(hook.is_valid());
+        EXPECT_NE(AddHook::original_function(), &typed_target_add);
+        EXPECT_EQ(opaque(&typed_target_add)(2, 3), 50);
+
+        EXPECT_TRUE(hook.disable());
+        EXPECT_EQ(opaque(&typed_target_add)(2, 3), 5);
+        EXPECT_TRUE(hook.enable());
+        EXPECT_EQ(opaque(&typed_target_add)(2, 3), 50);
+
+        // 槽位在安装期间指向 Hook 的链接，从外部调用也会跳过 detour
+        EXPECT_EQ(AddHook::original(2, 3), 5);
+    }
+    // 移除后槽位恢复为目标函数本身
+    EXPECT_EQ(AddHook::original_function(), &typed_target_add);
+    EXPECT_EQ(opaque(&typed_target_add)(2, 3), 5);
+    EXPECT_EQ(AddHook::original(2, 3), 5);
+}
+
+TEST(TypedHookTest, OnlyOneInstancePerInstantiation) {
+    AddHook hook(&add_detour);
+    EXPECT_THROW(AddHook second(&add_detour), std::runtime_error);
+    EXPECT_EQ(opaque(&typed_target_add)(1, 1), 20);
+
+    // 移动之后由新对象负责移除
+    AddHook moved(std::move(hook));
+    EXPECT_FALSE(hook.is_valid());
+    EXPECT_TRUE(moved.is_valid());
+    EXPECT_EQ(opaque(&typed_target_add)(1, 1), 20);
+    moved.unhook();
+    EXPECT_EQ(opaque(&typed_target_add)(1, 1), 2);
+
+    AddHook again(&add_detour);
+    EXPECT_EQ(opaque(&typed_target_add)(1, 1), 20);
+}
+
+TEST(TypedHookTest, KeyTargetTakesRuntimeAddress) {
+    EXPECT_EQ(MulHook::original_function(), nullptr);
+    EXPECT_THROW(MulHook(reinterpret_cast<uintptr_t>(&typed_target_mul), nullptr), std::invalid_argument);
+    EXPECT_THROW(MulHook(0, &mul_detour), std::invalid_argument);
+    EXPECT_EQ(MulHook::original_function(), nullptr);
+
+    {
+        MulHook hook(reinterpret_cast<uintptr_t>(&typed_target_mul), &mul_detour);
+        EXPECT_EQ(opaque(&typed_target_mul)(3, 4), 13);
+    }
+    EXPECT_EQ(MulHook::original_function(), nullptr);
+    EXPECT_EQ(opaque(&typed_target_mul)(3, 4), 12);
+}
+
+TEST(LambdaHookTest, CapturingLambdaReceivesOriginal) {
+    int calls = 0;
+    long offset = 100;
+    ur::inline_hook::LambdaHook<long(int, long)> hook(
+        reinterpret_cast<uintptr_t>(&lambda_target_sum),
+        [&calls, offset](auto original, int a, long b) {
+            ++calls;
+            return original(a, b) + offset;
+        });
+    ASSERT_TRUE(hook.is_valid());
+    ASSERT_NE(hook.get_thunk(), nullptr);
+
+    EXPECT_EQ(opaque(&lambda_target_sum)(1, 2), 103);
+    EXPECT_EQ(opaque(&lambda_target_sum)(-5, 10), 105);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(hook.call_original(1, 2), 3);
+    EXPECT_EQ(calls, 2);
+
+    hook.unhook();
+    EXPECT_FALSE(hook.is_valid());
+    EXPECT_EQ(opaque(&lambda_target_sum)(1, 2), 3);
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(LambdaHookTest, FloatingPointArgumentsAreNotShifted) {
+    const int four = 4;
+    ur::inline_hook::LambdaHook<double(double, int, float, const int*)> hook(
+        reinterpret_cast<uintptr_t>(&lambda_target_mixed),
+        [](auto original, double a, int b, float c, const int* d) {
+            EXPECT_EQ(a, 0.5);
+            EXPECT_EQ(b, 2);
+            EXPECT_EQ(c, 0.25f);
+            EXPECT_EQ(*d, 4);
+            return original(a, b, c, d) * 2;
+        });
+    EXPECT_DOUBLE_EQ(opaque(&lambda_target_mixed)(0.5, 2, 0.25f, &four), 13.5);
+}
+
+TEST(LambdaHookTest, SevenIntegerArguments) {
+    long last = 0;
+    ur::inline_hook::LambdaHook<long(long, long, long, long, long, long, long)> hook(
+        reinterpret_cast<uintptr_t>(&lambda_target_seven),
+        [&last](auto original, long a, long b, long c, long d, long e, long f, long g) {
+            last = g;
+            return original(a, b, c, d, e, f, g) + 1;
+        });
+    EXPECT_EQ(opaque(&lambda_target_seven)(1, 1, 1, 1, 1, 1, 9), 1 + 2 + 3 + 4 + 5 + 6 + 63 + 1);
+    EXPECT_EQ(last, 9);
+}
+
+TEST(LambdaHookTest, HooksOnOneTargetChain) {
+    ur::inline_hook::LambdaHook<long(int, long)> inner(
+        reinterpret_cast<uintptr_t>(&lambda_target_sum),
+        [](auto original, int a, long b) { return original(a, b) * 2; });
+    ur::inline_hook::LambdaHook<long(int, long)> outer(
+        reinterpret_cast<uintptr_t>(&lambda_target_sum),
+        [](auto original, int a, long b) { return original(a, b) + 1; });
+
+    // 后安装的 Hook 先执行
+    EXPECT_EQ(opaque(&lambda_target_sum)(1, 2), 7);
+
+    ur::inline_hook::LambdaHook<long(int, long)> moved(std::move(inner));
+    EXPECT_FALSE(inner.is_valid());
+    EXPECT_EQ(opaque(&lambda_target_sum)(1, 2), 7);
+
+    moved.unhook();
+    EXPECT_EQ(opaque(&lambda_target_sum)(1, 2), 4);
+}
+
+TEST(LambdaHookTest, ContextThunkShiftsIntegerArguments) {
+    int context = 0;
+    ur::jit::Jit jit;
+    void* thunk = ur::inline_hook::detail::emit_context_thunk(
+        jit, &context, reinterpret_cast<uintptr_t>(&typed_target_add), 2);
+    ASSERT_NE(thunk, nullptr);
+
+    using ur::assembler::Register;
+    ur::assembler::Assembler expected(0);
+    expected.mov(Register::X2, Register::X1);
+    expected.mov(Register::X1, Register::X0);
+    const auto words = expected.get_code_span();
+
+    uint32_t code[2];
+    std::memcpy(code, thunk, sizeof(code));
+    EXPECT_EQ(code[0], words[0]);
+    EXPECT_EQ(code[1], words[1]);
+
+    // 上下文指针放在字面量池中，thunk 不依赖所在位置
+    uint64_t pool[2];
+    std::memcpy(pool, static_cast<uint8_t*>(thunk) + jit.get_code_size() - sizeof(pool), sizeof(pool));
+    EXPECT_TRUE(pool[0] == reinterpret_cast<uintptr_t>(&context) || pool[1] == reinterpret_cast<uintptr_t>(&context));
+}
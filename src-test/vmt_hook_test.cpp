@@ -2,6 +2,7 @@
 #include <ur/vmt_hook.h>
 #include <ur/memory.h>
 #include <ur/maps_parser.h>
+#include <stdexcept>
 #include <thread>
 #include <atomic>
 #include <chrono>
@@ -22,6 +23,13 @@ namespace ur::vmt_hook_test {
         }
     };
 
+    class VirtualBaseClass : public virtual TestClass {
+    public:
+        int another_method() override {
+            return 7;
+        }
+    };
+
     // A global variable to hold the hook object so the test hook can access it.
     std::unique_ptr<ur::VmHook> hook_handle;
 
@@ -288,4 +296,118 @@ TEST(VmtHookTest, FindVmtBySymbolWithElfParser) {
 
     hook_handle.reset();
     ASSERT_EQ(instance_ptr->test_method(10), 20);
-}
\ No newline at end of file
+}
+TEST(VmtHookTest, ShadowModeHooksOnlyOneInstance) {
+    using namespace ur::vmt_hook_test;
+
+    TestClass shadowed;
+    TestClass other;
+    TestClass* shadowed_ptr = &shadowed;
+    TestClass* other_ptr = &other;
+    void** original_vmt = *reinterpret_cast<void***>(shadowed_ptr);
+
+    {
+        ur::VmtHook vmt_hook(shadowed_ptr, ur::VmtMode::Shadow);
+        ASSERT_TRUE(vmt_hook.is_shadow());
+        EXPECT_GE(vmt_hook.shadow_size(), 2u);
+        EXPECT_NE(*reinterpret_cast<void***>(shadowed_ptr), original_vmt);
+        // The copied header keeps RTTI working
+        EXPECT_EQ(typeid(*shadowed_ptr), typeid(TestClass));
+
+        hook_handle = vmt_hook.hook_method(0, reinterpret_cast<void*>(&hooked_test_method));
+        ASSERT_NE(hook_handle, nullptr);
+        EXPECT_EQ(shadowed_ptr->test_method(10), 120);
+        EXPECT_EQ(other_ptr->test_method(10), 20);
+        EXPECT_EQ(shadowed_ptr->another_method(), 42);
+
+        // Toggling only touches the private copy
+        ASSERT_TRUE(hook_handle->disable());
+        EXPECT_EQ(shadowed_ptr->test_method(10), 20);
+        ASSERT_TRUE(hook_handle->enable());
+        EXPECT_EQ(shadowed_ptr->test_method(10), 120);
+
+        EXPECT_EQ(vmt_hook.hook_method(vmt_hook.shadow_size(), reinterpret_cast<void*>(&hooked_test_method)), nullptr);
+
+        hook_handle.reset();
+        EXPECT_EQ(shadowed_ptr->test_method(10), 20);
+    }
+
+    // The instance points at its class's vtable again
+    EXPECT_EQ(*reinterpret_cast<void***>(shadowed_ptr), original_vmt);
+}
+
+namespace ur::vmt_hook_test {
+    int bulk_hooked_another_method(TestClass*) {
+        return 7;
+    }
+}
+
+TEST(VmtHookTest, HookMethodsInBulk) {
+    using namespace ur::vmt_hook_test;
+
+    TestClass instance;
+    TestClass* instance_ptr = &instance;
+    ur::VmtHook vmt_hook(instance_ptr);
+
+    const ur::VmtHook::Method methods[] = {
+        {0, reinterpret_cast<void*>(&hooked_test_method)},
+        {1, reinterpret_cast<void*>(&bulk_hooked_another_method)},
+    };
+    ur::VmMethodHooks hooks = vmt_hook.hook_methods(methods, {.count_calls = true});
+    ASSERT_EQ(hooks.size(), 2u);
+
+    // hooked_test_method reaches its original through hook_handle, so only call the saved original
+    auto original = hooks.get_original<int (*)(TestClass*, int)>(0);
+    EXPECT_EQ(original(instance_ptr, 10), 20);
+    EXPECT_EQ(instance_ptr->another_method(), 7);
+    EXPECT_EQ(hooks.call_count(1), 1u);
+    EXPECT_EQ(hooks.get_original<int (*)(TestClass*)>(1)(instance_ptr), 42);
+
+    // Moving keeps the hooks installed
+    ur::VmMethodHooks moved = std::move(hooks);
+    EXPECT_TRUE(hooks.empty());
+    EXPECT_EQ(instance_ptr->another_method(), 7);
+
+    moved.unhook();
+    EXPECT_TRUE(moved.empty());
+    EXPECT_EQ(instance_ptr->test_method(10), 20);
+    EXPECT_EQ(instance_ptr->another_method(), 42);
+}
+
+TEST(VmtHookTest, ShadowModeRejectsVirtualBases) {
+    using namespace ur::vmt_hook_test;
+
+    VirtualBaseClass instance;
+    VirtualBaseClass* instance_ptr = &instance;
+    void** original_vmt = *reinterpret_cast<void***>(instance_ptr);
+
+    // Its vbase offset lives in front of the header words a shadow copy would take
+    EXPECT_THROW(ur::VmtHook(instance_ptr, ur::VmtMode::Shadow), std::runtime_error);
+    EXPECT_EQ(*reinterpret_cast<void***>(instance_ptr), original_vmt);
+    EXPECT_EQ(instance_ptr->another_method(), 7);
+}
+
+TEST(VmtHookTest, HookMethodsInBulkOnShadowVtable) {
+    using namespace ur::vmt_hook_test;
+
+    TestClass instance;
+    TestClass* instance_ptr = &instance;
+    ur::VmtHook vmt_hook(instance_ptr, ur::VmtMode::Shadow);
+
+    const ur::VmtHook::Method out_of_range[] = {
+        {1, reinterpret_cast<void*>(&bulk_hooked_another_method)},
+        {vmt_hook.shadow_size(), reinterpret_cast<void*>(&bulk_hooked_another_method)},
+    };
+    EXPECT_TRUE(vmt_hook.hook_methods(out_of_range).empty());
+    EXPECT_EQ(instance_ptr->another_method(), 42);
+
+    const ur::VmtHook::Method methods[] = {
+        {1, reinterpret_cast<void*>(&bulk_hooked_another_method)},
+    };
+    {
+        auto hooks = vmt_hook.hook_methods(methods);
+        ASSERT_EQ(hooks.size(), 1u);
+        EXPECT_EQ(instance_ptr->another_method(), 7);
+    }
+    EXPECT_EQ(instance_ptr->another_method(), 42);
+}
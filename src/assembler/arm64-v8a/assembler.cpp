@@ -24,6 +24,31 @@ namespace {
         return is_s_register(reg) || is_d_register(reg) || is_q_register(reg);
     }
 
+    // opc, access size scale and V bit shared by the GPR and SIMD&FP forms of LDP/STP.
+    void pair_encoding(Register rt, uint32_t& opc, int& scale, uint32_t& v) {
+        v = is_fp_register(rt) ? 1 : 0;
+        if (is_q_register(rt))      { opc = 2; scale = 4; }
+        else if (is_d_register(rt)) { opc = 1; scale = 3; }
+        else if (is_s_register(rt)) { opc = 0; scale = 2; }
+        else if (is_w_register(rt)) { opc = 0; scale = 2; }
+        else                        { opc = 2; scale = 3; }
+    }
+
+    // size, V and opc bits of a single-register load (LDR/LDUR) of rt, and its access size scale.
+    uint32_t load_encoding(Register rt, int& scale) {
+        if (is_q_register(rt)) { scale = 4; return (0u << 30) | (1u << 26) | (3u << 22); }
+        if (is_d_register(rt)) { scale = 3; return (3u << 30) | (1u << 26) | (1u << 22); }
+        if (is_s_register(rt)) { scale = 2; return (2u << 30) | (1u << 26) | (1u << 22); }
+        if (is_w_register(rt)) { scale = 2; return (2u << 30) | (1u << 22); }
+        scale = 3;
+        return (3u << 30) | (1u << 22);
+    }
+
+    // The same fields for a store (STR/STUR): opc bit 22 clear.
+    uint32_t store_encoding(Register rt, int& scale) {
+        return load_encoding(rt, scale) & ~(1u << 22);
+    }
+
     uint32_t to_sys_reg(SystemRegister sys_reg) {
         // This encoding is a bit complex. It's composed of op0, op1, CRn, CRm, op2 fields.
         // Let's represent them as a single value for simplicity here.
@@ -41,6 +66,12 @@ namespace {
             case SystemRegister::TPIDR_EL0:
                 // op0=1, op1=3, CRn=13, CRm=0, op2=2 -> 1_011_1101_0000_010
                 return (1 << 19) | (3 << 16) | (13 << 12) | (0 << 8) | (2 << 5);
+            case SystemRegister::CNTFRQ_EL0:
+                // op0=1, op1=3, CRn=14, CRm=0, op2=0 -> 1_011_1110_0000_000
+                return (1 << 19) | (3 << 16) | (14 << 12) | (0 << 8) | (0 << 5);
+            case SystemRegister::CNTVCT_EL0:
+                // op0=1, op1=3, CRn=14, CRm=0, op2=2 -> 1_011_1110_0000_010
+                return (1 << 19) | (3 << 16) | (14 << 12) | (0 << 8) | (2 << 5);
         }
         throw std::runtime_error("Unsupported system register");
     }
@@ -48,11 +79,81 @@ namespace {
 
 AssemblerAArch64::AssemblerAArch64(uintptr_t start_address) : current_address_(start_address) {}
 
+AssemblerAArch64::AssemblerAArch64(uintptr_t start_address, std::span<uint32_t> buffer)
+    : current_address_(start_address), buffer_(buffer), external_(true) {}
+
 void AssemblerAArch64::emit(uint32_t instruction) {
-    code_.push_back(instruction);
+    if (external_) {
+        if (buffer_size_ == buffer_.size()) throw std::runtime_error("Assembler buffer is full");
+        buffer_[buffer_size_++] = instruction;
+    } else {
+        code_.push_back(instruction);
+    }
     current_address_ += 4;
 }
 
+void AssemblerAArch64::emit_word(uint32_t value) {
+    emit(value);
+}
+
+void AssemblerAArch64::emit_quad(uint64_t value) {
+    emit(static_cast<uint32_t>(value));
+    emit(static_cast<uint32_t>(value >> 32));
+}
+
+void AssemblerAArch64::reserve(size_t instructions) {
+    if (!external_) code_.reserve(instructions);
+}
+
+bool AssemblerAArch64::can_encode_b(uintptr_t from, uintptr_t to) {
+    const int64_t offset = static_cast<int64_t>(to - from);
+    return (offset & 3) == 0 && offset >= -134217728 && offset <= 134217724;
+}
+
+bool AssemblerAArch64::can_encode_b_cond(uintptr_t from, uintptr_t to) {
+    const int64_t offset = static_cast<int64_t>(to - from);
+    return (offset & 3) == 0 && offset >= -1048576 && offset <= 1048572;
+}
+
+bool AssemblerAArch64::can_encode_tbz(uintptr_t from, uintptr_t to) {
+    const int64_t offset = static_cast<int64_t>(to - from);
+    return (offset & 3) == 0 && offset >= -32768 && offset <= 32764;
+}
+
+bool AssemblerAArch64::can_encode_adr(uintptr_t from, uintptr_t to) {
+    const int64_t offset = static_cast<int64_t>(to - from);
+    return offset >= -1048576 && offset <= 1048575;
+}
+
+bool AssemblerAArch64::can_encode_adrp(uintptr_t from, uintptr_t to) {
+    const int64_t offset = static_cast<int64_t>((to & ~uintptr_t(0xFFF)) - (from & ~uintptr_t(0xFFF)));
+    return offset >= -4294967296LL && offset <= 4294963200LL;
+}
+
+bool AssemblerAArch64::try_b(uintptr_t target_address) {
+    if (!can_encode_b(current_address_, target_address)) return false;
+    b(target_address);
+    return true;
+}
+
+bool AssemblerAArch64::try_b(Condition cond, uintptr_t target_address) {
+    if (!can_encode_b_cond(current_address_, target_address)) return false;
+    b(cond, target_address);
+    return true;
+}
+
+bool AssemblerAArch64::try_bl(uintptr_t target_address) {
+    if (!can_encode_b(current_address_, target_address)) return false;
+    bl(target_address);
+    return true;
+}
+
+bool AssemblerAArch64::try_adrp(Register rd, uintptr_t target_address) {
+    if (!can_encode_adrp(current_address_, target_address)) return false;
+    adrp(rd, target_address);
+    return true;
+}
+
 uint32_t AssemblerAArch64::to_reg(Register reg) {
     if (reg == Register::ZR || reg == Register::WZR) return 31;
     if (is_w_register(reg)) {
@@ -98,21 +199,21 @@ void AssemblerAArch64::gen_load_address(Register dest, uintptr_t address) {
 
 void AssemblerAArch64::b(uintptr_t target_address) {
     int64_t offset = target_address - current_address_;
-    if (offset < -134217728 || offset > 134217724) throw std::runtime_error("Branch offset out of range");
+    if (!can_encode_b(current_address_, target_address)) throw std::runtime_error("Branch offset out of range");
     uint32_t imm26 = (static_cast<uint32_t>(offset) >> 2) & 0x3FFFFFF;
     emit(0x14000000 | imm26);
 }
 
 void AssemblerAArch64::b(Condition cond, uintptr_t target_address) {
     int64_t offset = target_address - current_address_;
-    if (offset < -524288 || offset > 524284) throw std::runtime_error("Conditional branch offset out of range");
+    if (!can_encode_b_cond(current_address_, target_address)) throw std::runtime_error("Conditional branch offset out of range");
     uint32_t imm19 = (static_cast<uint32_t>(offset) >> 2) & 0x7FFFF;
     emit(0x54000000 | (imm19 << 5) | to_cond(cond));
 }
 
 void AssemblerAArch64::bl(uintptr_t target_address) {
     int64_t offset = target_address - current_address_;
-    if (offset < -134217728 || offset > 134217724) throw std::runtime_error("Branch with link offset out of range");
+    if (!can_encode_b(current_address_, target_address)) throw std::runtime_error("Branch with link offset out of range");
     uint32_t imm26 = (static_cast<uint32_t>(offset) >> 2) & 0x3FFFFFF;
     emit(0x94000000 | imm26);
 }
@@ -131,14 +232,14 @@ void AssemblerAArch64::ret() {
 
 void AssemblerAArch64::cbz(Register rt, uintptr_t target_address) {
     int64_t offset = target_address - current_address_;
-    if (offset < 0 || offset > 524284) throw std::runtime_error("CBZ offset out of range");
+    if (!can_encode_b_cond(current_address_, target_address)) throw std::runtime_error("CBZ offset out of range");
     uint32_t imm19 = (static_cast<uint32_t>(offset) >> 2) & 0x7FFFF;
     emit(0xB4000000 | (imm19 << 5) | to_reg(rt));
 }
 
 void AssemblerAArch64::cbnz(Register rt, uintptr_t target_address) {
     int64_t offset = target_address - current_address_;
-    if (offset < 0 || offset > 524284) throw std::runtime_error("CBNZ offset out of range");
+    if (!can_encode_b_cond(current_address_, target_address)) throw std::runtime_error("CBNZ offset out of range");
     uint32_t imm19 = (static_cast<uint32_t>(offset) >> 2) & 0x7FFFF;
     emit(0xB5000000 | (imm19 << 5) | to_reg(rt));
 }
@@ -146,7 +247,7 @@ void AssemblerAArch64::cbnz(Register rt, uintptr_t target_address) {
 void AssemblerAArch64::tbz(Register rt, uint32_t bit, uintptr_t target_address) {
     if (bit >= (is_w_register(rt) ? 32 : 64)) throw std::runtime_error("TBZ bit out of range");
     int64_t offset = target_address - current_address_;
-    if (offset < -32768 || offset > 32767) throw std::runtime_error("TBZ offset out of range");
+    if (!can_encode_tbz(current_address_, target_address)) throw std::runtime_error("TBZ offset out of range");
     uint32_t b5 = (bit >> 5) & 1;
     uint32_t b40 = bit & 0x1F;
     uint32_t imm14 = (static_cast<uint32_t>(offset) >> 2) & 0x3FFF;
@@ -156,7 +257,7 @@ void AssemblerAArch64::tbz(Register rt, uint32_t bit, uintptr_t target_address)
 void AssemblerAArch64::tbnz(Register rt, uint32_t bit, uintptr_t target_address) {
     if (bit >= (is_w_register(rt) ? 32 : 64)) throw std::runtime_error("TBNZ bit out of range");
     int64_t offset = target_address - current_address_;
-    if (offset < -32768 || offset > 32767) throw std::runtime_error("TBNZ offset out of range");
+    if (!can_encode_tbz(current_address_, target_address)) throw std::runtime_error("TBNZ offset out of range");
     uint32_t b5 = (bit >> 5) & 1;
     uint32_t b40 = bit & 0x1F;
     uint32_t imm14 = (static_cast<uint32_t>(offset) >> 2) & 0x3FFF;
@@ -452,7 +553,7 @@ void AssemblerAArch64::fcvtzs(Register rd, Register rn) {
 
 void AssemblerAArch64::adr(Register rd, uintptr_t target_address) {
     int64_t offset = target_address - current_address_;
-    if (offset < -1048576 || offset > 1048575) throw std::runtime_error("ADR offset out of range");
+    if (!can_encode_adr(current_address_, target_address)) throw std::runtime_error("ADR offset out of range");
     uint32_t immlo = offset & 0x3;
     uint32_t immhi = (offset >> 2) & 0x7FFFF;
     emit(0x10000000 | (immlo << 29) | (immhi << 5) | to_reg(rd));
@@ -460,7 +561,7 @@ void AssemblerAArch64::adr(Register rd, uintptr_t target_address) {
 
 void AssemblerAArch64::adrp(Register rd, uintptr_t target_address) {
     int64_t offset = (target_address & ~0xFFF) - (current_address_ & ~0xFFF);
-    if (offset < -2147483648 || offset > 2147483647) throw std::runtime_error("ADRP offset out of range");
+    if (!can_encode_adrp(current_address_, target_address)) throw std::runtime_error("ADRP offset out of range");
     uint32_t immlo = (offset >> 12) & 0x3;
     uint32_t immhi = (offset >> 14) & 0x7FFFF;
     emit(0x90000000 | (immlo << 29) | (immhi << 5) | to_reg(rd));
@@ -487,20 +588,22 @@ void AssemblerAArch64::str(Register rt, uintptr_t address) {
 }
 
 void AssemblerAArch64::ldr(Register rt, Register rn, int32_t offset) {
-    uint32_t size = is_w_register(rt) ? 2 : 3; // 2 for 32-bit, 3 for 64-bit
-    if (offset >= 0 && offset < (1 << 12) * (1 << size) && (offset % (1 << size) == 0)) {
-        uint32_t imm12 = (offset >> size) & 0xFFF;
-        emit((size << 30) | 0x39400000 | (imm12 << 10) | (to_reg(rn) << 5) | to_reg(rt));
+    int scale = 0;
+    const uint32_t encoding = load_encoding(rt, scale); // W/X, or S/D/Q (SIMD&FP)
+    if (offset >= 0 && offset < (1 << 12) * (1 << scale) && (offset % (1 << scale) == 0)) {
+        uint32_t imm12 = (offset >> scale) & 0xFFF;
+        emit(0x39000000 | encoding | (imm12 << 10) | (to_reg(rn) << 5) | to_reg(rt));
     } else {
         ldur(rt, rn, offset);
     }
 }
 
 void AssemblerAArch64::str(Register rt, Register rn, int32_t offset) {
-    uint32_t size = is_w_register(rt) ? 2 : 3; // 2 for 32-bit, 3 for 64-bit
-    if (offset >= 0 && offset < (1 << 12) * (1 << size) && (offset % (1 << size) == 0)) {
-        uint32_t imm12 = (offset >> size) & 0xFFF;
-        emit((size << 30) | 0x39000000 | (imm12 << 10) | (to_reg(rn) << 5) | to_reg(rt));
+    int scale = 0;
+    const uint32_t encoding = store_encoding(rt, scale); // W/X, or S/D/Q (SIMD&FP)
+    if (offset >= 0 && offset < (1 << 12) * (1 << scale) && (offset % (1 << scale) == 0)) {
+        uint32_t imm12 = (offset >> scale) & 0xFFF;
+        emit(0x39000000 | encoding | (imm12 << 10) | (to_reg(rn) << 5) | to_reg(rt));
     } else {
         stur(rt, rn, offset);
     }
@@ -508,16 +611,18 @@ void AssemblerAArch64::str(Register rt, Register rn, int32_t offset) {
 
 void AssemblerAArch64::ldur(Register rt, Register rn, int32_t offset) {
     if (offset < -256 || offset > 255) throw std::runtime_error("LDUR offset out of range");
-    uint32_t size = is_w_register(rt) ? 2 : 3;
+    int scale = 0;
+    const uint32_t encoding = load_encoding(rt, scale);
     uint32_t imm9 = offset & 0x1FF;
-    emit((size << 30) | 0x38400000 | (imm9 << 12) | (to_reg(rn) << 5) | to_reg(rt));
+    emit(0x38000000 | encoding | (imm9 << 12) | (to_reg(rn) << 5) | to_reg(rt));
 }
 
 void AssemblerAArch64::stur(Register rt, Register rn, int32_t offset) {
     if (offset < -256 || offset > 255) throw std::runtime_error("STUR offset out of range");
-    uint32_t size = is_w_register(rt) ? 2 : 3;
+    int scale = 0;
+    const uint32_t encoding = store_encoding(rt, scale);
     uint32_t imm9 = offset & 0x1FF;
-    emit((size << 30) | 0x38000000 | (imm9 << 12) | (to_reg(rn) << 5) | to_reg(rt));
+    emit(0x38000000 | encoding | (imm9 << 12) | (to_reg(rn) << 5) | to_reg(rt));
 }
 
 void AssemblerAArch64::ldrh(Register rt, Register rn, int32_t offset) {
@@ -637,21 +742,23 @@ void AssemblerAArch64::strb(Register rt, Register rn, int32_t offset) {
 }
 
 void AssemblerAArch64::ldp(Register rt1, Register rt2, Register rn, int32_t offset, bool post_index) {
-    uint32_t opc = is_w_register(rt1) ? 0 : 2;
-    int scale = is_w_register(rt1) ? 2 : 3;
-    if (offset < -256 * (1 << scale) || offset > 255 * (1 << scale) || offset % (1 << scale) != 0) throw std::runtime_error("LDP offset out of range");
+    uint32_t opc, v;
+    int scale;
+    pair_encoding(rt1, opc, scale, v);
+    if (offset < -64 * (1 << scale) || offset > 63 * (1 << scale) || offset % (1 << scale) != 0) throw std::runtime_error("LDP offset out of range");
     uint32_t imm7 = (offset >> scale) & 0x7F;
     uint32_t p_w_bits = post_index ? 0b01 : 0b10;
-    emit((opc << 30) | 0x28400000 | (p_w_bits << 23) | (imm7 << 15) | (to_reg(rt2) << 10) | (to_reg(rn) << 5) | to_reg(rt1));
+    emit((opc << 30) | 0x28400000 | (v << 26) | (p_w_bits << 23) | (imm7 << 15) | (to_reg(rt2) << 10) | (to_reg(rn) << 5) | to_reg(rt1));
 }
 
 void AssemblerAArch64::stp(Register rt1, Register rt2, Register rn, int32_t offset, bool pre_index) {
-    uint32_t opc = is_w_register(rt1) ? 0 : 2;
-    int scale = is_w_register(rt1) ? 2 : 3;
-    if (offset < -256 * (1 << scale) || offset > 255 * (1 << scale) || offset % (1 << scale) != 0) throw std::runtime_error("STP offset out of range");
+    uint32_t opc, v;
+    int scale;
+    pair_encoding(rt1, opc, scale, v);
+    if (offset < -64 * (1 << scale) || offset > 63 * (1 << scale) || offset % (1 << scale) != 0) throw std::runtime_error("STP offset out of range");
     uint32_t imm7 = (offset >> scale) & 0x7F;
     uint32_t p_w_bits = pre_index ? 0b11 : 0b10;
-    emit((opc << 30) | 0x28000000 | (p_w_bits << 23) | (imm7 << 15) | (to_reg(rt2) << 10) | (to_reg(rn) << 5) | to_reg(rt1));
+    emit((opc << 30) | 0x28000000 | (v << 26) | (p_w_bits << 23) | (imm7 << 15) | (to_reg(rt2) << 10) | (to_reg(rn) << 5) | to_reg(rt1));
 }
 
 void AssemblerAArch64::ldr_literal(Register rt, int64_t offset) {
@@ -714,6 +821,8 @@ void AssemblerAArch64::dmb(BarrierOption option) {
         case BarrierOption::NSH: imm4 = 0b0111; break;
         case BarrierOption::ISH: imm4 = 0b1011; break;
         case BarrierOption::SY:  imm4 = 0b1111; break;
+        case BarrierOption::ISHST: imm4 = 0b1010; break;
+        case BarrierOption::ISHLD: imm4 = 0b1001; break;
         default: throw std::runtime_error("Invalid barrier option");
     }
     emit(0xD50330BF | (imm4 << 8));
@@ -777,6 +886,16 @@ void AssemblerAArch64::stlr(Register rt, Register rn) {
     emit((size << 30) | 0x089F7C00 | (to_reg(rn) << 5) | to_reg(rt));
 }
 
+void AssemblerAArch64::ldadd(Register rs, Register rt, Register rn) {
+    uint32_t size = is_w_register(rs) ? 2 : 3;
+    emit((size << 30) | 0x38200000 | (to_reg(rs) << 16) | (to_reg(rn) << 5) | to_reg(rt));
+}
+
+void AssemblerAArch64::stadd(Register rs, Register rn) {
+    // STADD is LDADD discarding the old value
+    ldadd(rs, is_w_register(rs) ? Register::WZR : Register::ZR, rn);
+}
+
 void AssemblerAArch64::call_function(uintptr_t destination) {
     gen_abs_call(destination, Register::X17); // Use X17 as a scratch register
 }
@@ -809,8 +928,18 @@ std::vector<uint32_t>& AssemblerAArch64::get_code_mut() {
     return code_;
 }
 
+std::span<const uint32_t> AssemblerAArch64::get_code_span() const {
+    if (external_) return buffer_.first(buffer_size_);
+    return code_;
+}
+
+std::span<uint32_t> AssemblerAArch64::get_code_span_mut() {
+    if (external_) return buffer_.first(buffer_size_);
+    return code_;
+}
+
 size_t AssemblerAArch64::get_code_size() const {
-    return code_.size() * 4;
+    return (external_ ? buffer_size_ : code_.size()) * 4;
 }
 
 uintptr_t AssemblerAArch64::get_current_address() const {
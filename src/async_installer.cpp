@@ -0,0 +1,150 @@
+#include "ur/async_installer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace ur::inline_hook {
+
+AsyncInstaller::AsyncInstaller(const AsyncOptions& options) : options_(options) {
+    options_.max_batch = std::max<size_t>(options_.max_batch, 1);
+    const size_t workers = std::max<size_t>(options_.workers, 1);
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this]() { prepare_loop(); });
+    }
+    committer_ = std::thread([this]() { commit_loop(); });
+}
+
+AsyncInstaller::~AsyncInstaller() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_cv_.notify_all();
+    prepared_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    committer_.join();
+}
+
+std::future<Hook> AsyncInstaller::install(uintptr_t target, Hook::Callback callback, const HookOptions& options) {
+    if (target == 0) {
+        throw std::invalid_argument("Target must not be null");
+    }
+    if (callback == nullptr) {
+        throw std::invalid_argument("Callback must not be null");
+    }
+
+    std::future<Hook> future;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& request = queued_.emplace_back(Request{target, callback, options, {}});
+        future = request.promise.get_future();
+        ++outstanding_;
+    }
+    queued_cv_.notify_one();
+    return future;
+}
+
+void AsyncInstaller::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return outstanding_ == 0; });
+}
+
+size_t AsyncInstaller::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return outstanding_;
+}
+
+void AsyncInstaller::finish(size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        outstanding_ -= count;
+    }
+    done_cv_.notify_all();
+}
+
+void AsyncInstaller::prepare_loop() {
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queued_cv_.wait(lock, [this]() { return stopping_ || !queued_.empty(); });
+        if (queued_.empty()) return;
+        Request request = std::move(queued_.front());
+        queued_.pop_front();
+        ++preparing_;
+        lock.unlock();
+
+        bool prepared = true;
+        try {
+            HookBatch::prepare(request.target);
+        } catch (...) {
+            request.promise.set_exception(std::current_exception());
+            prepared = false;
+        }
+
+        lock.lock();
+        --preparing_;
+        if (prepared) {
+            prepared_.push_back(std::move(request));
+        }
+        lock.unlock();
+        if (!prepared) {
+            finish(1);
+        }
+        prepared_cv_.notify_one();
+    }
+}
+
+void AsyncInstaller::commit_loop() {
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Nothing more can arrive once stopping with no queued or in-flight requests
+        auto drained = [this]() { return queued_.empty() && preparing_ == 0; };
+        prepared_cv_.wait(lock, [&]() { return !prepared_.empty() || (stopping_ && drained()); });
+        if (prepared_.empty()) return;
+
+        // Let the workers fill the batch a little further while more is on the way
+        prepared_cv_.wait_for(lock, options_.linger, [&]() {
+            return prepared_.size() >= options_.max_batch || drained();
+        });
+
+        const size_t count = std::min(prepared_.size(), options_.max_batch);
+        std::vector<Request> batch(std::make_move_iterator(prepared_.begin()),
+                                   std::make_move_iterator(prepared_.begin() + count));
+        prepared_.erase(prepared_.begin(), prepared_.begin() + count);
+        lock.unlock();
+
+        commit(batch);
+    }
+}
+
+void AsyncInstaller::commit(std::vector<Request>& batch) {
+    HookBatch hook_batch(options_.batch);
+    for (const auto& request : batch) {
+        hook_batch.add(request.target, request.callback, request.options);
+    }
+
+    try {
+        auto hooks = hook_batch.commit();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i].promise.set_value(std::move(hooks[i]));
+        }
+    } catch (...) {
+        if (batch.size() > 1) {
+            // The batch was rolled back as a whole; retry each hook alone so that only the
+            // one at fault fails
+            for (auto& request : batch) {
+                std::vector<Request> single;
+                single.push_back(std::move(request));
+                commit(single);
+            }
+            return;
+        }
+        batch.front().promise.set_exception(std::current_exception());
+    }
+    finish(batch.size());
+}
+
+} // namespace ur::inline_hook
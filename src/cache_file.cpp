@@ -0,0 +1,55 @@
+#include "cache_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+
+namespace ur::cache_file {
+
+namespace {
+
+bool write_all(int fd, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size != 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+std::string path_for(const std::string& directory, std::span<const uint8_t> build_id, std::string_view suffix) {
+    std::string name;
+    name.reserve(build_id.size() * 2);
+    for (uint8_t byte : build_id) {
+        static constexpr char kHex[] = "0123456789abcdef";
+        name.push_back(kHex[byte >> 4]);
+        name.push_back(kHex[byte & 0xf]);
+    }
+
+    std::string path = directory.empty() ? name : directory + "/" + name;
+    path += suffix;
+    return path;
+}
+
+bool replace(const std::string& path, std::initializer_list<Part> parts) {
+    // 临时文件名带上 pid，多个进程同时 flush 时互不覆盖
+    const std::string temp_path = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (const auto& part : parts) {
+        if (!(ok = write_all(fd, part.data, part.size))) break;
+    }
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace ur::cache_file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+
+// symbol_cache 与 trampoline_cache 共用的缓存文件操作，不属于公开接口
+namespace ur::cache_file {
+
+    // 缓存文件路径：<directory>/<十六进制 build-id><suffix>，directory 为空时使用当前目录
+    std::string path_for(const std::string& directory, std::span<const uint8_t> build_id, std::string_view suffix);
+
+    struct Part {
+        const void* data;
+        size_t size;
+    };
+
+    // 依次写入各部分到临时文件后 rename 到 path，其他进程只会看到旧文件或完整的新文件
+    bool replace(const std::string& path, std::initializer_list<Part> parts);
+
+} // namespace ur::cache_file
@@ -0,0 +1,107 @@
+#include "ur/cache_maintenance.h"
+
+#include <algorithm>
+
+namespace ur::cache_maintenance {
+
+namespace {
+
+CacheInfo read_cache_info() {
+    CacheInfo cache;
+    uint64_t ctr = 0;
+    asm volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    // Line sizes are log2 of the number of 4-byte words
+    cache.icache_line = size_t{4} << (ctr & 0xF);
+    cache.dcache_line = size_t{4} << ((ctr >> 16) & 0xF);
+    cache.idc = (ctr >> 28) & 1;
+    cache.dic = (ctr >> 29) & 1;
+    return cache;
+}
+
+void clean_data(uintptr_t start, uintptr_t end, size_t line) {
+    for (uintptr_t address = start & -line; address < end; address += line) {
+        asm volatile("dc cvau, %0" : : "r"(address) : "memory");
+    }
+}
+
+void invalidate_instructions(uintptr_t start, uintptr_t end, size_t line) {
+    for (uintptr_t address = start & -line; address < end; address += line) {
+        asm volatile("ic ivau, %0" : : "r"(address) : "memory");
+    }
+}
+
+} // namespace
+
+const CacheInfo& info() {
+    static const CacheInfo cache = read_cache_info();
+    return cache;
+}
+
+void sync_code(uintptr_t address, uintptr_t write_address, size_t size) {
+    if (size == 0) return;
+    const CacheInfo& cache = info();
+    if (!cache.idc) {
+        clean_data(write_address, write_address + size, cache.dcache_line);
+    }
+    asm volatile("dsb ish" : : : "memory");
+    if (!cache.dic) {
+        invalidate_instructions(address, address + size, cache.icache_line);
+        asm volatile("dsb ish" : : : "memory");
+    }
+    asm volatile("isb" : : : "memory");
+}
+
+void Batch::reserve(size_t count) {
+    code_ranges_.reserve(count);
+    data_ranges_.reserve(count);
+}
+
+void Batch::insert(std::vector<Range>& ranges, uintptr_t start, uintptr_t end) {
+    // First range that ends at or after `start`; it and those after it that begin at or
+    // before `end` touch the new range and are folded into it
+    auto first = std::lower_bound(ranges.begin(), ranges.end(), start,
+                                  [](const Range& range, uintptr_t value) { return range.second < value; });
+    auto last = first;
+    while (last != ranges.end() && last->first <= end) {
+        start = std::min(start, last->first);
+        end = std::max(end, last->second);
+        ++last;
+    }
+    if (first == last) {
+        ranges.insert(first, {start, end});
+    } else {
+        *first = {start, end};
+        ranges.erase(first + 1, last);
+    }
+}
+
+void Batch::add(uintptr_t address, uintptr_t write_address, size_t size) {
+    if (size == 0) return;
+    insert(code_ranges_, address, address + size);
+    insert(data_ranges_, write_address, write_address + size);
+}
+
+void Batch::flush() const {
+    if (code_ranges_.empty()) return;
+    const CacheInfo& cache = info();
+    if (!cache.idc) {
+        for (const auto& [start, end] : data_ranges_) {
+            clean_data(start, end, cache.dcache_line);
+        }
+    }
+    asm volatile("dsb ish" : : : "memory");
+    if (!cache.dic) {
+        for (const auto& [start, end] : code_ranges_) {
+            invalidate_instructions(start, end, cache.icache_line);
+        }
+        asm volatile("dsb ish" : : : "memory");
+    }
+    asm volatile("isb" : : : "memory");
+}
+
+void Batch::clear() {
+    code_ranges_.clear();
+    data_ranges_.clear();
+}
+
+} // namespace ur::cache_maintenance
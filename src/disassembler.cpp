@@ -3,22 +3,48 @@
 #include <iomanip>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
+#include <cstring>
 
 namespace ur {
     namespace disassembler {
 
         namespace {
+            // Text produced alongside decoding when formatting is requested.
+            struct TextSink {
+                std::string mnemonic;
+                std::string op_str;
+            };
+
             // Helper to create an operand
-            Operand create_reg_operand(assembler::Register reg) {
-                return {OperandType::REGISTER, reg};
+            DecodedOperand create_reg_operand(assembler::Register reg) {
+                DecodedOperand op;
+                op.type = OperandType::REGISTER;
+                op.reg = reg;
+                return op;
+            }
+
+            DecodedOperand create_imm_operand(int64_t imm) {
+                DecodedOperand op;
+                op.type = OperandType::IMMEDIATE;
+                op.imm = imm;
+                return op;
             }
 
-            Operand create_imm_operand(int64_t imm) {
-                return {OperandType::IMMEDIATE, imm};
+            DecodedOperand create_mem_operand(assembler::Register base, int32_t disp) {
+                DecodedOperand op;
+                op.type = OperandType::MEMORY;
+                op.mem = MemOperand{base, assembler::Register::INVALID, disp};
+                return op;
             }
 
-            Operand create_mem_operand(assembler::Register base, int32_t disp) {
-                return {OperandType::MEMORY, MemOperand{base, assembler::Register::INVALID, disp}};
+            void push_operand(DecodedInsn& instr, const DecodedOperand& op) {
+                if (instr.operand_count < DecodedInsn::kMaxOperands) {
+                    instr.operands[instr.operand_count++] = op;
+                }
             }
 
             // Helper to get general-purpose register name string
@@ -73,323 +99,402 @@ namespace ur {
                     default: return assembler::Register::INVALID;
                 }
             }
-        } // namespace
-
-        class AArch64Disassembler : public Disassembler {
-        public:
-            std::vector<Instruction> Disassemble(
-                uint64_t address,
-                const uint8_t* code,
-                size_t code_size,
-                size_t count
-            ) override {
-                std::vector<Instruction> instructions;
-                uint64_t current_address = address;
-                size_t bytes_disassembled = 0;
-
-                for (size_t i = 0; i < count && bytes_disassembled + 4 <= code_size; ++i) {
-                    Instruction instr;
-                    instr.address = current_address;
-                    instr.size = 4;
-                    instr.bytes.assign(code + bytes_disassembled, code + bytes_disassembled + 4);
-
-                    uint32_t instr_word = *reinterpret_cast<const uint32_t*>(code + bytes_disassembled);
-
-                    decode_instruction(instr, instr_word);
-
-                    instructions.push_back(instr);
-
-                    current_address += 4;
-                    bytes_disassembled += 4;
-                }
-                return instructions;
+            // NOP
+            template <bool kWithText>
+            bool decode_nop(DecodedInsn& instr, uint32_t, TextSink* text) {
+                instr.id = InstructionId::NOP;
+                instr.group = InstructionGroup::SYSTEM;
+                if constexpr (kWithText) text->mnemonic = "nop";
+                return true;
             }
 
-        private:
-            void decode_instruction(Instruction& instr, uint32_t instr_word) {
-                // NOP
-                if (instr_word == 0xD503201F) {
-                    instr.id = InstructionId::NOP;
-                    instr.group = InstructionGroup::SYSTEM;
-                    instr.mnemonic = "nop";
-                    return;
-                }
-                // RET
-                if (instr_word == 0xD65F03C0) {
-                    instr.id = InstructionId::RET;
-                    instr.group = InstructionGroup::JUMP;
-                    instr.mnemonic = "ret";
-                    return;
-                }
+            // RET
+            template <bool kWithText>
+            bool decode_ret(DecodedInsn& instr, uint32_t, TextSink* text) {
+                instr.id = InstructionId::RET;
+                instr.group = InstructionGroup::JUMP;
+                if constexpr (kWithText) text->mnemonic = "ret";
+                return true;
+            }
 
-                // Unconditional branch (immediate)
-                if ((instr_word & 0xFC000000) == 0x14000000) {
-                    instr.id = InstructionId::B;
-                    instr.group = InstructionGroup::JUMP;
-                    instr.mnemonic = "b";
-                    instr.is_pc_relative = true;
-                    int64_t imm26 = instr_word & 0x03FFFFFF;
-                    if (imm26 & 0x02000000) imm26 |= ~0x03FFFFFFLL; // Sign extend
-                    int64_t offset = imm26 * 4;
-                    uint64_t target = instr.address + offset;
-                    instr.operands.push_back(create_imm_operand(target));
+            // Unconditional branch (immediate)
+            template <bool kWithText>
+            bool decode_b(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::B;
+                instr.group = InstructionGroup::JUMP;
+                if constexpr (kWithText) text->mnemonic = "b";
+                instr.is_pc_relative = true;
+                int64_t imm26 = instr_word & 0x03FFFFFF;
+                if (imm26 & 0x02000000) imm26 |= ~0x03FFFFFFLL; // Sign extend
+                int64_t offset = imm26 * 4;
+                uint64_t target = instr.address + offset;
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << "0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
-                
-                // Branch with link (immediate)
-                if ((instr_word & 0xFC000000) == 0x94000000) {
-                    instr.id = InstructionId::BL;
-                    instr.group = InstructionGroup::JUMP;
-                    instr.mnemonic = "bl";
-                    instr.is_pc_relative = true;
-                    int64_t imm26 = instr_word & 0x03FFFFFF;
-                    if (imm26 & 0x02000000) imm26 |= ~0x03FFFFFFLL; // Sign extend
-                    int64_t offset = imm26 * 4;
-                    uint64_t target = instr.address + offset;
-                    instr.operands.push_back(create_imm_operand(target));
+                return true;
+            }
+
+            // Branch with link (immediate)
+            template <bool kWithText>
+            bool decode_bl(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::BL;
+                instr.group = InstructionGroup::JUMP;
+                if constexpr (kWithText) text->mnemonic = "bl";
+                instr.is_pc_relative = true;
+                int64_t imm26 = instr_word & 0x03FFFFFF;
+                if (imm26 & 0x02000000) imm26 |= ~0x03FFFFFFLL; // Sign extend
+                int64_t offset = imm26 * 4;
+                uint64_t target = instr.address + offset;
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << "0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // Branch register
-                if ((instr_word & 0xFFFFFC1F) == 0xD61F0000) { // BR
-                    instr.id = InstructionId::BR;
-                    instr.group = InstructionGroup::JUMP;
-                    instr.mnemonic = "br";
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rn, true)));
-                    instr.op_str = get_reg_name(rn, true);
-                    return;
-                }
+            // Branch register
+            template <bool kWithText>
+            bool decode_br(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::BR;
+                instr.group = InstructionGroup::JUMP;
+                if constexpr (kWithText) text->mnemonic = "br";
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                push_operand(instr, create_reg_operand(get_reg_enum(rn, true)));
+                if constexpr (kWithText) text->op_str = get_reg_name(rn, true);
+                return true;
+            }
 
-                // Branch with link register
-                if ((instr_word & 0xFFFFFC1F) == 0xD63F0000) { // BLR
-                    instr.id = InstructionId::BLR;
-                    instr.group = InstructionGroup::JUMP;
-                    instr.mnemonic = "blr";
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rn, true)));
-                    instr.op_str = get_reg_name(rn, true);
-                    return;
-                }
+            // Branch with link register
+            template <bool kWithText>
+            bool decode_blr(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::BLR;
+                instr.group = InstructionGroup::JUMP;
+                if constexpr (kWithText) text->mnemonic = "blr";
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                push_operand(instr, create_reg_operand(get_reg_enum(rn, true)));
+                if constexpr (kWithText) text->op_str = get_reg_name(rn, true);
+                return true;
+            }
 
-                // Conditional branch
-                if ((instr_word & 0xFE000000) == 0x54000000) {
-                    instr.id = InstructionId::B_COND;
-                    instr.group = InstructionGroup::JUMP;
-                    instr.is_pc_relative = true;
-                    uint32_t cond_val = instr_word & 0xF;
-                    instr.cond = static_cast<assembler::Condition>(cond_val);
-                    instr.mnemonic = "b." + get_cond_name(cond_val);
-                    int64_t imm19 = (instr_word >> 5) & 0x7FFFF;
-                    if (imm19 & 0x40000) imm19 |= ~0x7FFFFLL; // Sign extend
-                    int64_t offset = imm19 * 4;
-                    uint64_t target = instr.address + offset;
-                    instr.operands.push_back(create_imm_operand(target));
+            // Conditional branch
+            template <bool kWithText>
+            bool decode_b_cond(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::B_COND;
+                instr.group = InstructionGroup::JUMP;
+                instr.is_pc_relative = true;
+                uint32_t cond_val = instr_word & 0xF;
+                instr.cond = static_cast<assembler::Condition>(cond_val);
+                if constexpr (kWithText) text->mnemonic = "b." + get_cond_name(cond_val);
+                int64_t imm19 = (instr_word >> 5) & 0x7FFFF;
+                if (imm19 & 0x40000) imm19 |= ~0x7FFFFLL; // Sign extend
+                int64_t offset = imm19 * 4;
+                uint64_t target = instr.address + offset;
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << "0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // Compare and branch (zero/non-zero)
-                if ((instr_word & 0x7E000000) == 0x34000000) {
-                    instr.group = InstructionGroup::JUMP;
-                    instr.is_pc_relative = true;
-                    bool sf = (instr_word >> 31) & 1;
-                    bool op = (instr_word >> 24) & 1;
-                    instr.id = op ? InstructionId::CBNZ : InstructionId::CBZ;
-                    instr.mnemonic = op ? "cbnz" : "cbz";
-                    uint32_t rt = instr_word & 0x1F;
-                    int64_t imm19 = (instr_word >> 5) & 0x7FFFF;
-                    if (imm19 & 0x40000) imm19 |= ~0x7FFFFLL; // Sign extend for negative offsets
-                    int64_t offset = imm19 * 4;
-                    uint64_t target = instr.address + offset;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rt, sf)));
-                    instr.operands.push_back(create_imm_operand(target));
+            // Compare and branch (zero/non-zero)
+            template <bool kWithText>
+            bool decode_cbz_cbnz(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::JUMP;
+                instr.is_pc_relative = true;
+                bool sf = (instr_word >> 31) & 1;
+                bool op = (instr_word >> 24) & 1;
+                instr.id = op ? InstructionId::CBNZ : InstructionId::CBZ;
+                if constexpr (kWithText) text->mnemonic = op ? "cbnz" : "cbz";
+                uint32_t rt = instr_word & 0x1F;
+                int64_t imm19 = (instr_word >> 5) & 0x7FFFF;
+                if (imm19 & 0x40000) imm19 |= ~0x7FFFFLL; // Sign extend for negative offsets
+                int64_t offset = imm19 * 4;
+                uint64_t target = instr.address + offset;
+                push_operand(instr, create_reg_operand(get_reg_enum(rt, sf)));
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rt, sf) << ", 0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // ADD/SUB (immediate)
-                if ((instr_word & 0x1F000000) == 0x11000000) {
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    bool sf = (instr_word >> 31) & 1;
-                    bool op = (instr_word >> 30) & 1;
-                    bool s = (instr_word >> 29) & 1;
-                    if (op) {
-                        instr.id = s ? InstructionId::SUBS : InstructionId::SUB;
-                        instr.mnemonic = s ? "subs" : "sub";
-                    } else {
-                        instr.id = s ? InstructionId::ADDS : InstructionId::ADD;
-                        instr.mnemonic = s ? "adds" : "add";
-                    }
-                    
-                    uint32_t rd = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t imm12 = (instr_word >> 10) & 0xFFF;
-                    bool shift = (instr_word >> 22) & 1;
-                    uint32_t final_imm = shift ? (imm12 << 12) : imm12;
+            // ADD/SUB (immediate)
+            template <bool kWithText>
+            bool decode_add_sub_imm(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                bool sf = (instr_word >> 31) & 1;
+                bool op = (instr_word >> 30) & 1;
+                bool s = (instr_word >> 29) & 1;
+                if (op) {
+                    instr.id = s ? InstructionId::SUBS : InstructionId::SUB;
+                    if constexpr (kWithText) text->mnemonic = s ? "subs" : "sub";
+                } else {
+                    instr.id = s ? InstructionId::ADDS : InstructionId::ADD;
+                    if constexpr (kWithText) text->mnemonic = s ? "adds" : "add";
+                }
+                
+                uint32_t rd = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t imm12 = (instr_word >> 10) & 0xFFF;
+                bool shift = (instr_word >> 22) & 1;
+                uint32_t final_imm = shift ? (imm12 << 12) : imm12;
 
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rn, sf)));
-                    instr.operands.push_back(create_imm_operand(final_imm));
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                push_operand(instr, create_reg_operand(get_reg_enum(rn, sf)));
+                push_operand(instr, create_imm_operand(final_imm));
 
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, sf, rd == 31) << ", " << get_reg_name(rn, sf, rn == 31) << ", #" << imm12;
                     if (shift) {
                         ss << ", lsl #12";
                     }
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // Logical (shifted register) - covers AND, ORR, EOR, ANDS
-                if ((instr_word & 0x1F800000) == 0x0A000000) {
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    bool sf = (instr_word >> 31) & 1;
-                    uint32_t opc = (instr_word >> 29) & 0x3;
-                    uint32_t n = (instr_word >> 21) & 1;
-                    uint32_t rd = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t rm = (instr_word >> 16) & 0x1F;
-
-                    if (opc == 1 && rn == 31 && n == 0) { // ORR with ZR is MOV
-                        instr.id = InstructionId::MOV;
-                        instr.mnemonic = "mov";
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rm, sf)));
-                        instr.op_str = get_reg_name(rd, sf) + ", " + get_reg_name(rm, sf);
-                    } else {
-                        switch(opc) {
-                            case 0: instr.id = InstructionId::AND; instr.mnemonic = "and"; break;
-                            case 1: instr.id = InstructionId::ORR; instr.mnemonic = "orr"; break;
-                            case 2: instr.id = InstructionId::EOR; instr.mnemonic = "eor"; break;
-                            case 3: instr.id = InstructionId::ANDS; instr.mnemonic = "ands"; break;
-                        }
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rn, sf)));
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rm, sf)));
+            // Logical (shifted register) - covers AND, ORR, EOR, ANDS
+            template <bool kWithText>
+            bool decode_logical_shifted_reg(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                bool sf = (instr_word >> 31) & 1;
+                uint32_t opc = (instr_word >> 29) & 0x3;
+                uint32_t n = (instr_word >> 21) & 1;
+                uint32_t rd = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t rm = (instr_word >> 16) & 0x1F;
+
+                if (opc == 1 && rn == 31 && n == 0) { // ORR with ZR is MOV
+                    instr.id = InstructionId::MOV;
+                    if constexpr (kWithText) text->mnemonic = "mov";
+                    push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                    push_operand(instr, create_reg_operand(get_reg_enum(rm, sf)));
+                    if constexpr (kWithText) text->op_str = get_reg_name(rd, sf) + ", " + get_reg_name(rm, sf);
+                } else {
+                    switch(opc) {
+                        case 0: instr.id = InstructionId::AND; if constexpr (kWithText) text->mnemonic = "and"; break;
+                        case 1: instr.id = InstructionId::ORR; if constexpr (kWithText) text->mnemonic = "orr"; break;
+                        case 2: instr.id = InstructionId::EOR; if constexpr (kWithText) text->mnemonic = "eor"; break;
+                        case 3: instr.id = InstructionId::ANDS; if constexpr (kWithText) text->mnemonic = "ands"; break;
+                    }
+                    push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                    push_operand(instr, create_reg_operand(get_reg_enum(rn, sf)));
+                    push_operand(instr, create_reg_operand(get_reg_enum(rm, sf)));
+                    if constexpr (kWithText) {
                         std::stringstream ss;
                         ss << get_reg_name(rd, sf) << ", " << get_reg_name(rn, sf) << ", " << get_reg_name(rm, sf);
-                        instr.op_str = ss.str();
+                        text->op_str = ss.str();
                     }
-                    return;
                 }
+                return true;
+            }
 
-                // ADD/SUB (shifted register)
-                if ((instr_word & 0x1F200000) == 0x0B000000) {
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    bool sf = (instr_word >> 31) & 1;
-                    bool op = (instr_word >> 30) & 1;
-                    bool s = (instr_word >> 29) & 1;
-                    if (op) {
-                        instr.id = s ? InstructionId::SUBS : InstructionId::SUB;
-                        instr.mnemonic = s ? "subs" : "sub";
-                    } else {
-                        instr.id = s ? InstructionId::ADDS : InstructionId::ADD;
-                        instr.mnemonic = s ? "adds" : "add";
-                    }
-                    uint32_t rd = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t rm = (instr_word >> 16) & 0x1F;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rn, sf)));
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rm, sf)));
+            // ADD/SUB (shifted register)
+            template <bool kWithText>
+            bool decode_add_sub_shifted_reg(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                bool sf = (instr_word >> 31) & 1;
+                bool op = (instr_word >> 30) & 1;
+                bool s = (instr_word >> 29) & 1;
+                if (op) {
+                    instr.id = s ? InstructionId::SUBS : InstructionId::SUB;
+                    if constexpr (kWithText) text->mnemonic = s ? "subs" : "sub";
+                } else {
+                    instr.id = s ? InstructionId::ADDS : InstructionId::ADD;
+                    if constexpr (kWithText) text->mnemonic = s ? "adds" : "add";
+                }
+                uint32_t rd = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t rm = (instr_word >> 16) & 0x1F;
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                push_operand(instr, create_reg_operand(get_reg_enum(rn, sf)));
+                push_operand(instr, create_reg_operand(get_reg_enum(rm, sf)));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, sf, rd == 31) << ", " << get_reg_name(rn, sf, rn == 31) << ", " << get_reg_name(rm, sf);
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // ADR
-                if ((instr_word & 0x9F000000) == 0x10000000) {
-                    instr.id = InstructionId::ADR;
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    instr.mnemonic = "adr";
-                    instr.is_pc_relative = true;
-                    uint32_t rd = instr_word & 0x1F;
-                    int64_t immhi = (instr_word >> 5) & 0x7FFFF;
-                    int64_t immlo = (instr_word >> 29) & 0x3;
-                    int64_t imm = (immhi << 2) | immlo;
-                    if (imm & (1LL << 20)) imm |= ~((1LL << 21) - 1); // Sign extend 21-bit
-                    uint64_t target = instr.address + imm;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, true)));
-                    instr.operands.push_back(create_imm_operand(target));
+            // ADR
+            template <bool kWithText>
+            bool decode_adr(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::ADR;
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                if constexpr (kWithText) text->mnemonic = "adr";
+                instr.is_pc_relative = true;
+                uint32_t rd = instr_word & 0x1F;
+                int64_t immhi = (instr_word >> 5) & 0x7FFFF;
+                int64_t immlo = (instr_word >> 29) & 0x3;
+                int64_t imm = (immhi << 2) | immlo;
+                if (imm & (1LL << 20)) imm |= ~((1LL << 21) - 1); // Sign extend 21-bit
+                uint64_t target = instr.address + imm;
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, true)));
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, true) << ", 0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // ADRP
-                if ((instr_word & 0x9F000000) == 0x90000000) {
-                    instr.id = InstructionId::ADRP;
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    instr.mnemonic = "adrp";
-                    instr.is_pc_relative = true;
-                    uint32_t rd = instr_word & 0x1F;
-                    int64_t immhi = (instr_word >> 5) & 0x7FFFF;
-                    int64_t immlo = (instr_word >> 29) & 0x3;
-                    int64_t imm = (immhi << 2) | immlo;
-                    if (imm & (1LL << 20)) imm |= ~((1LL << 21) - 1); // Sign extend 21-bit
-                    uint64_t target = (instr.address & ~0xFFFULL) + (imm << 12);
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, true)));
-                    instr.operands.push_back(create_imm_operand(target));
+            // ADRP
+            template <bool kWithText>
+            bool decode_adrp(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::ADRP;
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                if constexpr (kWithText) text->mnemonic = "adrp";
+                instr.is_pc_relative = true;
+                uint32_t rd = instr_word & 0x1F;
+                int64_t immhi = (instr_word >> 5) & 0x7FFFF;
+                int64_t immlo = (instr_word >> 29) & 0x3;
+                int64_t imm = (immhi << 2) | immlo;
+                if (imm & (1LL << 20)) imm |= ~((1LL << 21) - 1); // Sign extend 21-bit
+                uint64_t target = (instr.address & ~0xFFFULL) + (imm << 12);
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, true)));
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, true) << ", 0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // LDR/STR (immediate, unsigned offset)
-                if ((instr_word & 0x3B000000) == 0x39000000) {
-                    instr.group = InstructionGroup::LOAD_STORE;
-                    uint32_t size = (instr_word >> 30) & 0x3;
-                    bool is_load = (instr_word >> 22) & 1;
-                    instr.id = is_load ? InstructionId::LDR : InstructionId::STR;
-                    instr.mnemonic = is_load ? "ldr" : "str";
-                    uint32_t rt = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t imm12 = (instr_word >> 10) & 0xFFF;
-                    uint32_t offset = imm12 << size;
-                    bool is_64bit_reg = size >= 3;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rt, is_64bit_reg)));
-                    instr.operands.push_back(create_mem_operand(get_reg_enum(rn, true), offset));
+            // Register form of a single-register load/store, selected by its V, size and opc fields
+            struct LoadStoreForm {
+                InstructionId id = InstructionId::INVALID;
+                const char* mnemonic = "";
+                uint32_t scale = 0;    // log2 of the access size
+                bool is_64bit = false; // General-purpose forms: Xt rather than Wt
+                int fp_type = -1;      // SIMD&FP forms: the get_fp_reg_enum type (0 = S, 1 = D, 2 = Q)
+            };
+
+            // False for unallocated encodings and for the B/H SIMD&FP forms, which have no register enum.
+            // PRFM has no register form; its Rt is the prefetch operation.
+            bool load_store_form(uint32_t instr_word, LoadStoreForm& form) {
+                const uint32_t size = (instr_word >> 30) & 0x3;
+                const bool is_simd = (instr_word >> 26) & 1;
+                const uint32_t opc = (instr_word >> 22) & 0x3;
+                form.scale = size;
+                if (is_simd) {
+                    // opc: 00 = STR, 01 = LDR (B/H/S/D by size); 10 = STR Q, 11 = LDR Q (size 00 only)
+                    if (opc >= 2) {
+                        if (size != 0) return false;
+                        form.scale = 4;
+                        form.fp_type = 2;
+                    } else if (size >= 2) {
+                        form.fp_type = static_cast<int>(size) - 2;
+                    } else {
+                        return false;
+                    }
+                    const bool is_load = opc & 1;
+                    form.id = is_load ? InstructionId::LDR_FP : InstructionId::STR_FP;
+                    form.mnemonic = is_load ? "ldr" : "str";
+                    return true;
+                }
+
+                struct Gpr {
+                    InstructionId id;
+                    const char* mnemonic;
+                    bool is_64bit;
+                };
+                // [opc][size]: 00 = store, 01 = load, 10 = sign-extend to Xt (or PRFM), 11 = sign-extend to Wt
+                static constexpr Gpr kForms[4][4] = {
+                    {{InstructionId::STRB, "strb", false}, {InstructionId::STRH, "strh", false},
+                     {InstructionId::STR, "str", false}, {InstructionId::STR, "str", true}},
+                    {{InstructionId::LDRB, "ldrb", false}, {InstructionId::LDRH, "ldrh", false},
+                     {InstructionId::LDR, "ldr", false}, {InstructionId::LDR, "ldr", true}},
+                    {{InstructionId::LDRSB, "ldrsb", true}, {InstructionId::LDRSH, "ldrsh", true},
+                     {InstructionId::LDRSW, "ldrsw", true}, {InstructionId::PRFM, "prfm", true}},
+                    {{InstructionId::LDRSB, "ldrsb", false}, {InstructionId::LDRSH, "ldrsh", false},
+                     {InstructionId::INVALID, "", false}, {InstructionId::INVALID, "", false}},
+                };
+                const Gpr& gpr = kForms[opc][size];
+                if (gpr.id == InstructionId::INVALID) return false;
+                form.id = gpr.id;
+                form.mnemonic = gpr.mnemonic;
+                form.is_64bit = gpr.is_64bit;
+                return true;
+            }
+
+            // The transfer register operand, or PRFM's prefetch operation
+            void push_load_store_rt(DecodedInsn& instr, const LoadStoreForm& form, uint32_t rt) {
+                if (form.id == InstructionId::PRFM) {
+                    push_operand(instr, create_imm_operand(rt));
+                } else if (form.fp_type >= 0) {
+                    push_operand(instr, create_reg_operand(get_fp_reg_enum(rt, form.fp_type)));
+                } else {
+                    push_operand(instr, create_reg_operand(get_reg_enum(rt, form.is_64bit)));
+                }
+            }
+
+            std::string load_store_rt_name(const LoadStoreForm& form, uint32_t rt) {
+                if (form.id == InstructionId::PRFM) {
                     std::stringstream ss;
-                    ss << get_reg_name(rt, is_64bit_reg) << ", [" << get_reg_name(rn, true, true) << ", #" << offset << "]";
-                    instr.op_str = ss.str();
-                    return;
+                    ss << "#0x" << std::hex << rt;
+                    return ss.str();
                 }
+                return form.fp_type >= 0 ? get_fp_reg_name(rt, form.fp_type) : get_reg_name(rt, form.is_64bit);
+            }
 
-                // LDP/STP
-                if ((instr_word & 0x3E000000) == 0x28000000) {
-                    instr.group = InstructionGroup::LOAD_STORE;
-                    uint32_t opc = (instr_word >> 30) & 0x3;
-                    bool is_64bit = (opc == 2);
-                    bool is_load = (instr_word >> 22) & 1;
-                    instr.id = is_load ? InstructionId::LDP : InstructionId::STP;
-                    instr.mnemonic = is_load ? "ldp" : "stp";
-                    uint32_t rt1 = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t rt2 = (instr_word >> 10) & 0x1F;
-                    int32_t imm7 = (instr_word >> 15) & 0x7F;
-                    if (imm7 & 0x40) imm7 |= ~0x7F; // Sign extend
-                    uint32_t p_w_bits = (instr_word >> 23) & 0x3;
-                    int scale = is_64bit ? 3 : 2;
-                    int32_t offset = imm7 << scale;
-                    
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rt1, is_64bit)));
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rt2, is_64bit)));
-                    instr.operands.push_back(create_mem_operand(get_reg_enum(rn, true), offset));
+            // Single-register load/store (immediate, unsigned offset)
+            template <bool kWithText>
+            bool decode_ldr_str_unsigned_imm(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                LoadStoreForm form;
+                if (!load_store_form(instr_word, form)) return false;
+                instr.id = form.id;
+                instr.group = InstructionGroup::LOAD_STORE;
+                if constexpr (kWithText) text->mnemonic = form.mnemonic;
+                uint32_t rt = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t imm12 = (instr_word >> 10) & 0xFFF;
+                uint32_t offset = imm12 << form.scale;
+                push_load_store_rt(instr, form, rt);
+                push_operand(instr, create_mem_operand(get_reg_enum(rn, true), offset));
+                if constexpr (kWithText) {
+                    std::stringstream ss;
+                    ss << load_store_rt_name(form, rt) << ", [" << get_reg_name(rn, true, true) << ", #" << offset << "]";
+                    text->op_str = ss.str();
+                }
+                return true;
+            }
+
+            // LDP/STP
+            template <bool kWithText>
+            bool decode_ldp_stp(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::LOAD_STORE;
+                uint32_t opc = (instr_word >> 30) & 0x3;
+                bool is_64bit = (opc == 2);
+                bool is_load = (instr_word >> 22) & 1;
+                instr.id = is_load ? InstructionId::LDP : InstructionId::STP;
+                if constexpr (kWithText) text->mnemonic = is_load ? "ldp" : "stp";
+                uint32_t rt1 = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t rt2 = (instr_word >> 10) & 0x1F;
+                int32_t imm7 = (instr_word >> 15) & 0x7F;
+                if (imm7 & 0x40) imm7 |= ~0x7F; // Sign extend
+                uint32_t p_w_bits = (instr_word >> 23) & 0x3;
+                int scale = is_64bit ? 3 : 2;
+                int32_t offset = imm7 << scale;
+                
+                push_operand(instr, create_reg_operand(get_reg_enum(rt1, is_64bit)));
+                push_operand(instr, create_reg_operand(get_reg_enum(rt2, is_64bit)));
+                push_operand(instr, create_mem_operand(get_reg_enum(rn, true), offset));
 
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rt1, is_64bit) << ", " << get_reg_name(rt2, is_64bit) << ", [" << get_reg_name(rn, true, true);
                     if (p_w_bits == 0b10) { // signed offset
@@ -400,294 +505,582 @@ namespace ur {
                     } else if (p_w_bits == 0b01) { // post-index
                         ss << "], #" << offset;
                     }
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // LDR (literal)
-                if ((instr_word & 0x3F000000) == 0x18000000) {
-                    instr.id = InstructionId::LDR_LIT;
-                    instr.group = InstructionGroup::LOAD_STORE;
-                    instr.is_pc_relative = true;
-                    bool is_64bit = (instr_word >> 30) & 1;
-                    instr.mnemonic = "ldr";
-                    uint32_t rt = instr_word & 0x1F;
-                    int64_t imm19 = (instr_word >> 5) & 0x7FFFF;
-                    if (imm19 & 0x40000) imm19 |= ~0x7FFFFLL; // Sign extend
-                    int64_t offset = imm19 * 4;
-                    uint64_t target = instr.address + offset;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rt, is_64bit)));
-                    instr.operands.push_back(create_imm_operand(target));
+            // LDR, LDRSW and PRFM (literal)
+            template <bool kWithText>
+            bool decode_ldr_literal(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::LOAD_STORE;
+                instr.is_pc_relative = true;
+                // opc: 00 = LDR Wt, 01 = LDR Xt, 10 = LDRSW Xt, 11 = PRFM
+                const uint32_t opc = (instr_word >> 30) & 0x3;
+                const bool is_64bit = opc != 0;
+                uint32_t rt = instr_word & 0x1F;
+                int64_t imm19 = (instr_word >> 5) & 0x7FFFF;
+                if (imm19 & 0x40000) imm19 |= ~0x7FFFFLL; // Sign extend
+                int64_t offset = imm19 * 4;
+                uint64_t target = instr.address + offset;
+                if (opc == 3) {
+                    // Rt is the prefetch operation, not a register
+                    instr.id = InstructionId::PRFM_LIT;
+                    if constexpr (kWithText) text->mnemonic = "prfm";
+                    push_operand(instr, create_imm_operand(rt));
+                    push_operand(instr, create_imm_operand(target));
+                    if constexpr (kWithText) {
+                        std::stringstream ss;
+                        ss << "#0x" << std::hex << rt << ", 0x" << target;
+                        text->op_str = ss.str();
+                    }
+                    return true;
+                }
+                instr.id = opc == 2 ? InstructionId::LDRSW_LIT : InstructionId::LDR_LIT;
+                if constexpr (kWithText) text->mnemonic = opc == 2 ? "ldrsw" : "ldr";
+                push_operand(instr, create_reg_operand(get_reg_enum(rt, is_64bit)));
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rt, is_64bit) << ", 0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // LDR/STR (register offset)
-                if ((instr_word & 0x3B200800) == 0x38200800) {
-                    instr.group = InstructionGroup::LOAD_STORE;
-                    uint32_t size = (instr_word >> 30) & 0x3;
-                    bool is_load = (instr_word >> 22) & 1;
-                    instr.id = is_load ? InstructionId::LDR : InstructionId::STR;
-                    instr.mnemonic = is_load ? "ldr" : "str";
-                    uint32_t rt = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t rm = (instr_word >> 16) & 0x1F;
-                    bool is_64bit_reg = size >= 3;
-
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rt, is_64bit_reg)));
-                    instr.operands.push_back(create_mem_operand(get_reg_enum(rn, true), 0)); // Placeholder, complex mem operand
-                    
+            // LDR (literal, SIMD&FP)
+            template <bool kWithText>
+            bool decode_ldr_literal_fp(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                // opc: 00 = S, 01 = D, 10 = Q, 11 unallocated
+                const uint32_t type = (instr_word >> 30) & 0x3;
+                if (type == 3) return false;
+                instr.id = InstructionId::LDR_LIT;
+                instr.group = InstructionGroup::LOAD_STORE;
+                instr.is_pc_relative = true;
+                if constexpr (kWithText) text->mnemonic = "ldr";
+                uint32_t rt = instr_word & 0x1F;
+                int64_t imm19 = (instr_word >> 5) & 0x7FFFF;
+                if (imm19 & 0x40000) imm19 |= ~0x7FFFFLL; // Sign extend
+                uint64_t target = instr.address + imm19 * 4;
+                push_operand(instr, create_reg_operand(get_fp_reg_enum(rt, type)));
+                push_operand(instr, create_imm_operand(target));
+                if constexpr (kWithText) {
                     std::stringstream ss;
-                    ss << get_reg_name(rt, is_64bit_reg) << ", [" << get_reg_name(rn, true, true) << ", " << get_reg_name(rm, true) << "]";
-                    instr.op_str = ss.str();
-                    return;
+                    ss << get_fp_reg_name(rt, type) << ", 0x" << std::hex << target;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // Test and branch (zero/non-zero)
-                if ((instr_word & 0x7E000000) == 0x36000000) {
-                    instr.group = InstructionGroup::JUMP;
-                    instr.is_pc_relative = true;
-                    bool op = (instr_word >> 24) & 1;
-                    instr.id = op ? InstructionId::TBNZ : InstructionId::TBZ;
-                    instr.mnemonic = op ? "tbnz" : "tbz";
-                    uint32_t rt = instr_word & 0x1F;
-                    uint32_t b5 = (instr_word >> 31) & 1;
-                    uint32_t b40 = (instr_word >> 19) & 0x1F;
-                    uint32_t bit_pos = (b5 << 5) | b40;
-                    int64_t imm14 = (instr_word >> 5) & 0x3FFF;
-                    if (imm14 & 0x2000) imm14 |= ~0x3FFFLL; // Sign extend
-                    int64_t offset = imm14 * 4;
-                    uint64_t target = instr.address + offset;
-                    
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rt, true)));
-                    instr.operands.push_back(create_imm_operand(bit_pos));
-                    instr.operands.push_back(create_imm_operand(target));
+            // Single-register load/store (register offset)
+            template <bool kWithText>
+            bool decode_ldr_str_reg_offset(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                LoadStoreForm form;
+                if (!load_store_form(instr_word, form)) return false;
+                instr.id = form.id;
+                instr.group = InstructionGroup::LOAD_STORE;
+                if constexpr (kWithText) text->mnemonic = form.mnemonic;
+                uint32_t rt = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t rm = (instr_word >> 16) & 0x1F;
 
+                push_load_store_rt(instr, form, rt);
+                // The extend/shift of the index is not modelled; the index marks the operand as not a plain offset
+                auto mem = create_mem_operand(get_reg_enum(rn, true), 0);
+                mem.mem.index = get_reg_enum(rm, true);
+                push_operand(instr, mem);
+
+                if constexpr (kWithText) {
                     std::stringstream ss;
-                    ss << get_reg_name(rt, true) << ", #" << bit_pos << ", 0x" << std::hex << target;
-                    instr.op_str = ss.str();
-                    return;
+                    ss << load_store_rt_name(form, rt) << ", [" << get_reg_name(rn, true, true) << ", " << get_reg_name(rm, true) << "]";
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // Logical (immediate)
-                if ((instr_word & 0x1F800000) == 0x12000000) {
-                    // This is a very simplified check. A real implementation needs to decode N, immr, imms.
-                    // For now, we just want to distinguish it from other instructions.
-                    if (((instr_word >> 23) & 0x7) != 0) { // Check for non-zero N, immr, imms fields for common forms
-                        instr.group = InstructionGroup::DATA_PROCESSING;
-                        bool sf = (instr_word >> 31) & 1;
-                        uint32_t opc = (instr_word >> 29) & 0x3;
-                        uint32_t rd = instr_word & 0x1F;
-                        uint32_t rn = (instr_word >> 5) & 0x1F;
-                        // We don't fully decode the bitmask immediate here, just acknowledge the instruction
-                        switch(opc) {
-                            case 0: instr.id = InstructionId::AND; instr.mnemonic = "and"; break;
-                            case 1: instr.id = InstructionId::ORR; instr.mnemonic = "orr"; break;
-                            case 2: instr.id = InstructionId::EOR; instr.mnemonic = "eor"; break;
-                            case 3: instr.id = InstructionId::ANDS; instr.mnemonic = "ands"; break;
-                        }
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rn, sf)));
-                        // We don't fully decode the bitmask immediate here, so we add a placeholder
-                        instr.operands.push_back(create_imm_operand(0));
-                        // In a real scenario, we'd decode the immediate fully.
-                        instr.op_str = get_reg_name(rd, sf) + ", " + get_reg_name(rn, sf) + ", #imm";
-                        return;
-                    }
+            // Test and branch (zero/non-zero)
+            template <bool kWithText>
+            bool decode_tbz_tbnz(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::JUMP;
+                instr.is_pc_relative = true;
+                bool op = (instr_word >> 24) & 1;
+                instr.id = op ? InstructionId::TBNZ : InstructionId::TBZ;
+                if constexpr (kWithText) text->mnemonic = op ? "tbnz" : "tbz";
+                uint32_t rt = instr_word & 0x1F;
+                uint32_t b5 = (instr_word >> 31) & 1;
+                uint32_t b40 = (instr_word >> 19) & 0x1F;
+                uint32_t bit_pos = (b5 << 5) | b40;
+                int64_t imm14 = (instr_word >> 5) & 0x3FFF;
+                if (imm14 & 0x2000) imm14 |= ~0x3FFFLL; // Sign extend
+                int64_t offset = imm14 * 4;
+                uint64_t target = instr.address + offset;
+                
+                push_operand(instr, create_reg_operand(get_reg_enum(rt, true)));
+                push_operand(instr, create_imm_operand(bit_pos));
+                push_operand(instr, create_imm_operand(target));
+
+                if constexpr (kWithText) {
+                    std::stringstream ss;
+                    ss << get_reg_name(rt, true) << ", #" << bit_pos << ", 0x" << std::hex << target;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // MOVZ
-                if ((instr_word & 0x7F800000) == 0x52800000) {
-                    instr.id = InstructionId::MOVZ;
+            // Logical (immediate)
+            template <bool kWithText>
+            bool decode_logical_imm(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                // This is a very simplified check. A real implementation needs to decode N, immr, imms.
+                // For now, we just want to distinguish it from other instructions.
+                if (((instr_word >> 23) & 0x7) != 0) { // Check for non-zero N, immr, imms fields for common forms
                     instr.group = InstructionGroup::DATA_PROCESSING;
                     bool sf = (instr_word >> 31) & 1;
-                    instr.mnemonic = "movz";
+                    uint32_t opc = (instr_word >> 29) & 0x3;
                     uint32_t rd = instr_word & 0x1F;
-                    uint16_t imm16 = (instr_word >> 5) & 0xFFFF;
-                    uint32_t hw = (instr_word >> 21) & 0x3;
-                    uint32_t shift = hw * 16;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                    instr.operands.push_back(create_imm_operand(imm16));
-                    instr.operands.push_back(create_imm_operand(shift));
+                    uint32_t rn = (instr_word >> 5) & 0x1F;
+                    // We don't fully decode the bitmask immediate here, just acknowledge the instruction
+                    switch(opc) {
+                        case 0: instr.id = InstructionId::AND; if constexpr (kWithText) text->mnemonic = "and"; break;
+                        case 1: instr.id = InstructionId::ORR; if constexpr (kWithText) text->mnemonic = "orr"; break;
+                        case 2: instr.id = InstructionId::EOR; if constexpr (kWithText) text->mnemonic = "eor"; break;
+                        case 3: instr.id = InstructionId::ANDS; if constexpr (kWithText) text->mnemonic = "ands"; break;
+                    }
+                    push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                    push_operand(instr, create_reg_operand(get_reg_enum(rn, sf)));
+                    // We don't fully decode the bitmask immediate here, so we add a placeholder
+                    push_operand(instr, create_imm_operand(0));
+                    // In a real scenario, we'd decode the immediate fully.
+                    if constexpr (kWithText) text->op_str = get_reg_name(rd, sf) + ", " + get_reg_name(rn, sf) + ", #imm";
+                    return true;
+                }
+                return false;
+            }
+
+            // MOVZ
+            template <bool kWithText>
+            bool decode_movz(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::MOVZ;
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                bool sf = (instr_word >> 31) & 1;
+                if constexpr (kWithText) text->mnemonic = "movz";
+                uint32_t rd = instr_word & 0x1F;
+                uint16_t imm16 = (instr_word >> 5) & 0xFFFF;
+                uint32_t hw = (instr_word >> 21) & 0x3;
+                uint32_t shift = hw * 16;
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                push_operand(instr, create_imm_operand(imm16));
+                push_operand(instr, create_imm_operand(shift));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, sf) << ", #" << imm16;
                     if (hw > 0) {
                         ss << ", lsl #" << shift;
                     }
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // MOVN
-                if ((instr_word & 0x7F800000) == 0x12800000) {
-                    instr.id = InstructionId::MOVN;
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    bool sf = (instr_word >> 31) & 1;
-                    instr.mnemonic = "movn";
-                    uint32_t rd = instr_word & 0x1F;
-                    uint16_t imm16 = (instr_word >> 5) & 0xFFFF;
-                    uint32_t hw = (instr_word >> 21) & 0x3;
-                    uint32_t shift = hw * 16;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                    instr.operands.push_back(create_imm_operand(imm16));
-                    instr.operands.push_back(create_imm_operand(shift));
+            // MOVN
+            template <bool kWithText>
+            bool decode_movn(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::MOVN;
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                bool sf = (instr_word >> 31) & 1;
+                if constexpr (kWithText) text->mnemonic = "movn";
+                uint32_t rd = instr_word & 0x1F;
+                uint16_t imm16 = (instr_word >> 5) & 0xFFFF;
+                uint32_t hw = (instr_word >> 21) & 0x3;
+                uint32_t shift = hw * 16;
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                push_operand(instr, create_imm_operand(imm16));
+                push_operand(instr, create_imm_operand(shift));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, sf) << ", #" << imm16;
                     if (hw > 0) {
                         ss << ", lsl #" << shift;
                     }
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // MOVK
-                if ((instr_word & 0x7F800000) == 0x72800000) {
-                    instr.id = InstructionId::MOVK;
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    bool sf = (instr_word >> 31) & 1;
-                    instr.mnemonic = "movk";
-                    uint32_t rd = instr_word & 0x1F;
-                    uint16_t imm16 = (instr_word >> 5) & 0xFFFF;
-                    uint32_t hw = (instr_word >> 21) & 0x3;
-                    uint32_t shift = hw * 16;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                    instr.operands.push_back(create_imm_operand(imm16));
-                    instr.operands.push_back(create_imm_operand(shift));
+            // MOVK
+            template <bool kWithText>
+            bool decode_movk(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::MOVK;
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                bool sf = (instr_word >> 31) & 1;
+                if constexpr (kWithText) text->mnemonic = "movk";
+                uint32_t rd = instr_word & 0x1F;
+                uint16_t imm16 = (instr_word >> 5) & 0xFFFF;
+                uint32_t hw = (instr_word >> 21) & 0x3;
+                uint32_t shift = hw * 16;
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                push_operand(instr, create_imm_operand(imm16));
+                push_operand(instr, create_imm_operand(shift));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, sf) << ", #" << imm16;
                     if (hw > 0) {
                         ss << ", lsl #" << shift;
                     }
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // UBFM (used for LSL, etc.)
-                if ((instr_word & 0x7F800000) == 0x53000000) {
-                    instr.id = InstructionId::UBFM;
-                    instr.group = InstructionGroup::DATA_PROCESSING;
-                    instr.mnemonic = "ubfm"; // Can be alias for lsl, etc.
-                    bool sf = (instr_word >> 31) & 1;
-                    uint32_t rd = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t immr = (instr_word >> 16) & 0x3F;
-                    uint32_t imms = (instr_word >> 10) & 0x3F;
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                    instr.operands.push_back(create_reg_operand(get_reg_enum(rn, sf)));
-                    instr.operands.push_back(create_imm_operand(immr));
-                    instr.operands.push_back(create_imm_operand(imms));
+            // UBFM (used for LSL, etc.)
+            template <bool kWithText>
+            bool decode_ubfm(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::UBFM;
+                instr.group = InstructionGroup::DATA_PROCESSING;
+                if constexpr (kWithText) text->mnemonic = "ubfm"; // Can be alias for lsl, etc.
+                bool sf = (instr_word >> 31) & 1;
+                uint32_t rd = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t immr = (instr_word >> 16) & 0x3F;
+                uint32_t imms = (instr_word >> 10) & 0x3F;
+                push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                push_operand(instr, create_reg_operand(get_reg_enum(rn, sf)));
+                push_operand(instr, create_imm_operand(immr));
+                push_operand(instr, create_imm_operand(imms));
+                if constexpr (kWithText) {
                     std::stringstream ss;
                     ss << get_reg_name(rd, sf) << ", " << get_reg_name(rn, sf) << ", #" << immr << ", #" << imms;
-                    instr.op_str = ss.str();
-                    return;
+                    text->op_str = ss.str();
                 }
+                return true;
+            }
 
-                // Floating-point and SIMD data processing (2 source)
-                if ((instr_word & 0x1E200800) == 0x1E200800) {
-                    instr.group = InstructionGroup::FLOAT_SIMD;
-                    uint32_t type = (instr_word >> 22) & 0x1; // 0=S, 1=D
-                    uint32_t rd = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    uint32_t rm = (instr_word >> 16) & 0x1F;
-                    uint32_t opcode = (instr_word >> 12) & 0xF;
-
-                    switch (opcode) {
-                        case 0b0010: instr.id = InstructionId::FADD; instr.mnemonic = "fadd"; break;
-                        case 0b0011: instr.id = InstructionId::FSUB; instr.mnemonic = "fsub"; break;
-                        case 0b0000: instr.id = InstructionId::FMUL; instr.mnemonic = "fmul"; break;
-                        case 0b0001: instr.id = InstructionId::FDIV; instr.mnemonic = "fdiv"; break;
-                        default: instr.id = InstructionId::INVALID; instr.mnemonic = "fp_op"; break;
-                    }
+            // Floating-point and SIMD data processing (2 source)
+            template <bool kWithText>
+            bool decode_fp_data_processing(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::FLOAT_SIMD;
+                uint32_t type = (instr_word >> 22) & 0x1; // 0=S, 1=D
+                uint32_t rd = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                uint32_t rm = (instr_word >> 16) & 0x1F;
+                uint32_t opcode = (instr_word >> 12) & 0xF;
 
-                    if (instr.id != InstructionId::INVALID) {
-                        instr.operands.push_back(create_reg_operand(get_fp_reg_enum(rd, type)));
-                        instr.operands.push_back(create_reg_operand(get_fp_reg_enum(rn, type)));
-                        instr.operands.push_back(create_reg_operand(get_fp_reg_enum(rm, type)));
-                        std::stringstream ss;
-                        ss << get_fp_reg_name(rd, type) << ", " << get_fp_reg_name(rn, type) << ", " << get_fp_reg_name(rm, type);
-                        instr.op_str = ss.str();
-                        return;
-                    }
+                switch (opcode) {
+                    case 0b0010: instr.id = InstructionId::FADD; if constexpr (kWithText) text->mnemonic = "fadd"; break;
+                    case 0b0011: instr.id = InstructionId::FSUB; if constexpr (kWithText) text->mnemonic = "fsub"; break;
+                    case 0b0000: instr.id = InstructionId::FMUL; if constexpr (kWithText) text->mnemonic = "fmul"; break;
+                    case 0b0001: instr.id = InstructionId::FDIV; if constexpr (kWithText) text->mnemonic = "fdiv"; break;
+                    default: instr.id = InstructionId::INVALID; if constexpr (kWithText) text->mnemonic = "fp_op"; break;
                 }
 
-                // Conversion between float and integer
-                if ((instr_word & 0x1F000000) == 0x1E000000) {
-                    uint32_t opc = (instr_word >> 16) & 0x3F;
-                    // Check for SCVTF, FCVTZS
-                    if (opc == 0b100010 || opc == 0b111000) {
-                        instr.group = InstructionGroup::FLOAT_SIMD;
-                        bool sf = (instr_word >> 31) & 1;
-                        uint32_t type = (instr_word >> 22) & 0x1;
-                        uint32_t rd = instr_word & 0x1F;
-                        uint32_t rn = (instr_word >> 5) & 0x1F;
-
-                        if (opc == 0b100010) { // SCVTF
-                            instr.id = InstructionId::SCVTF;
-                            instr.mnemonic = "scvtf";
-                            instr.operands.push_back(create_reg_operand(get_fp_reg_enum(rd, type)));
-                            instr.operands.push_back(create_reg_operand(get_reg_enum(rn, sf)));
-                            instr.op_str = get_fp_reg_name(rd, type) + ", " + get_reg_name(rn, sf);
-                        } else { // FCVTZS
-                            instr.id = InstructionId::FCVTZS;
-                            instr.mnemonic = "fcvtzs";
-                            instr.operands.push_back(create_reg_operand(get_reg_enum(rd, sf)));
-                            instr.operands.push_back(create_reg_operand(get_fp_reg_enum(rn, type)));
-                            instr.op_str = get_reg_name(rd, sf) + ", " + get_fp_reg_name(rn, type);
-                        }
-                        return;
+                if (instr.id != InstructionId::INVALID) {
+                    push_operand(instr, create_reg_operand(get_fp_reg_enum(rd, type)));
+                    push_operand(instr, create_reg_operand(get_fp_reg_enum(rn, type)));
+                    push_operand(instr, create_reg_operand(get_fp_reg_enum(rm, type)));
+                    if constexpr (kWithText) {
+                        std::stringstream ss;
+                        ss << get_fp_reg_name(rd, type) << ", " << get_fp_reg_name(rn, type) << ", " << get_fp_reg_name(rm, type);
+                        text->op_str = ss.str();
                     }
+                    return true;
                 }
+                return false;
+            }
 
-                // FMOV (register)
-                if ((instr_word & 0xFFE0FC00) == 0x1E204000) {
-                    instr.id = InstructionId::FMOV;
+            // Conversion between float and integer
+            template <bool kWithText>
+            bool decode_fp_int_conversion(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                uint32_t opc = (instr_word >> 16) & 0x3F;
+                // Check for SCVTF, FCVTZS
+                if (opc == 0b100010 || opc == 0b111000) {
                     instr.group = InstructionGroup::FLOAT_SIMD;
-                    instr.mnemonic = "fmov";
+                    bool sf = (instr_word >> 31) & 1;
                     uint32_t type = (instr_word >> 22) & 0x1;
                     uint32_t rd = instr_word & 0x1F;
                     uint32_t rn = (instr_word >> 5) & 0x1F;
-                    instr.operands.push_back(create_reg_operand(get_fp_reg_enum(rd, type)));
-                    instr.operands.push_back(create_reg_operand(get_fp_reg_enum(rn, type)));
-                    instr.op_str = get_fp_reg_name(rd, type) + ", " + get_fp_reg_name(rn, type);
-                    return;
+
+                    if (opc == 0b100010) { // SCVTF
+                        instr.id = InstructionId::SCVTF;
+                        if constexpr (kWithText) text->mnemonic = "scvtf";
+                        push_operand(instr, create_reg_operand(get_fp_reg_enum(rd, type)));
+                        push_operand(instr, create_reg_operand(get_reg_enum(rn, sf)));
+                        if constexpr (kWithText) text->op_str = get_fp_reg_name(rd, type) + ", " + get_reg_name(rn, sf);
+                    } else { // FCVTZS
+                        instr.id = InstructionId::FCVTZS;
+                        if constexpr (kWithText) text->mnemonic = "fcvtzs";
+                        push_operand(instr, create_reg_operand(get_reg_enum(rd, sf)));
+                        push_operand(instr, create_reg_operand(get_fp_reg_enum(rn, type)));
+                        if constexpr (kWithText) text->op_str = get_reg_name(rd, sf) + ", " + get_fp_reg_name(rn, type);
+                    }
+                    return true;
                 }
+                return false;
+            }
 
-                // Load/Store Exclusive
-                if ((instr_word & 0x3F000000) == 0x08000000) {
-                    instr.group = InstructionGroup::LOAD_STORE;
-                    uint32_t size = (instr_word >> 30) & 0x3;
-                    bool is_load = ((instr_word >> 22) & 1);
-                    uint32_t rt = instr_word & 0x1F;
-                    uint32_t rn = (instr_word >> 5) & 0x1F;
-                    bool is_64bit_rt = (size == 3);
-
-                    if (is_load) {
-                        instr.id = InstructionId::LDXR;
-                        instr.mnemonic = "ldxr";
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rt, is_64bit_rt)));
-                        instr.operands.push_back(create_mem_operand(get_reg_enum(rn, true), 0));
-                        instr.op_str = get_reg_name(rt, is_64bit_rt) + ", [" + get_reg_name(rn, true, true) + "]";
-                    } else { // is store
-                        uint32_t rs = (instr_word >> 16) & 0x1F;
-                        instr.id = InstructionId::STXR;
-                        instr.mnemonic = "stxr";
-                        // For STXR, the status register (rs) is always 32-bit (Ws)
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rs, false)));
-                        instr.operands.push_back(create_reg_operand(get_reg_enum(rt, is_64bit_rt)));
-                        instr.operands.push_back(create_mem_operand(get_reg_enum(rn, true), 0));
-                        instr.op_str = get_reg_name(rs, false) + ", " + get_reg_name(rt, is_64bit_rt) + ", [" + get_reg_name(rn, true, true) + "]";
+            // FMOV (register)
+            template <bool kWithText>
+            bool decode_fmov_reg(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.id = InstructionId::FMOV;
+                instr.group = InstructionGroup::FLOAT_SIMD;
+                if constexpr (kWithText) text->mnemonic = "fmov";
+                uint32_t type = (instr_word >> 22) & 0x1;
+                uint32_t rd = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                push_operand(instr, create_reg_operand(get_fp_reg_enum(rd, type)));
+                push_operand(instr, create_reg_operand(get_fp_reg_enum(rn, type)));
+                if constexpr (kWithText) text->op_str = get_fp_reg_name(rd, type) + ", " + get_fp_reg_name(rn, type);
+                return true;
+            }
+
+            // Load/Store Exclusive
+            template <bool kWithText>
+            bool decode_load_store_exclusive(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                instr.group = InstructionGroup::LOAD_STORE;
+                uint32_t size = (instr_word >> 30) & 0x3;
+                bool is_load = ((instr_word >> 22) & 1);
+                uint32_t rt = instr_word & 0x1F;
+                uint32_t rn = (instr_word >> 5) & 0x1F;
+                bool is_64bit_rt = (size == 3);
+
+                if (is_load) {
+                    instr.id = InstructionId::LDXR;
+                    if constexpr (kWithText) text->mnemonic = "ldxr";
+                    push_operand(instr, create_reg_operand(get_reg_enum(rt, is_64bit_rt)));
+                    push_operand(instr, create_mem_operand(get_reg_enum(rn, true), 0));
+                    if constexpr (kWithText) text->op_str = get_reg_name(rt, is_64bit_rt) + ", [" + get_reg_name(rn, true, true) + "]";
+                } else { // is store
+                    uint32_t rs = (instr_word >> 16) & 0x1F;
+                    instr.id = InstructionId::STXR;
+                    if constexpr (kWithText) text->mnemonic = "stxr";
+                    // For STXR, the status register (rs) is always 32-bit (Ws)
+                    push_operand(instr, create_reg_operand(get_reg_enum(rs, false)));
+                    push_operand(instr, create_reg_operand(get_reg_enum(rt, is_64bit_rt)));
+                    push_operand(instr, create_mem_operand(get_reg_enum(rn, true), 0));
+                    if constexpr (kWithText) text->op_str = get_reg_name(rs, false) + ", " + get_reg_name(rt, is_64bit_rt) + ", [" + get_reg_name(rn, true, true) + "]";
+                }
+                return true;
+            }
+
+            // Leaf decoder for one encoding class. Returning false means the word is in
+            // the class but uses an unsupported sub-encoding; lookup then continues with
+            // the next matching class, exactly like falling out of an if-chain.
+            using LeafDecoder = bool (*)(DecodedInsn&, uint32_t, TextSink*);
+
+            struct Encoding {
+                uint32_t mask;
+                uint32_t value;
+                LeafDecoder decode;
+            };
+
+            // Encoding spec in priority order: a word is handled by the first class with
+            // (word & mask) == value whose leaf accepts it. New instruction classes only
+            // need an entry here; the dispatch table below is derived from it.
+            template <bool kWithText>
+            constexpr Encoding kEncodings[] = {
+                {0xFFFFFFFF, 0xD503201F, &decode_nop<kWithText>},                  // NOP
+                {0xFFFFFFFF, 0xD65F03C0, &decode_ret<kWithText>},                  // RET
+                {0xFC000000, 0x14000000, &decode_b<kWithText>},                    // Unconditional branch (immediate)
+                {0xFC000000, 0x94000000, &decode_bl<kWithText>},                   // Branch with link (immediate)
+                {0xFFFFFC1F, 0xD61F0000, &decode_br<kWithText>},                   // Branch register
+                {0xFFFFFC1F, 0xD63F0000, &decode_blr<kWithText>},                  // Branch with link register
+                {0xFE000000, 0x54000000, &decode_b_cond<kWithText>},               // Conditional branch
+                {0x7E000000, 0x34000000, &decode_cbz_cbnz<kWithText>},             // Compare and branch (zero/non-zero)
+                {0x1F000000, 0x11000000, &decode_add_sub_imm<kWithText>},          // ADD/SUB (immediate)
+                {0x1F800000, 0x0A000000, &decode_logical_shifted_reg<kWithText>},  // Logical (shifted register) - covers AND, ORR, EOR, ANDS
+                {0x1F200000, 0x0B000000, &decode_add_sub_shifted_reg<kWithText>},  // ADD/SUB (shifted register)
+                {0x9F000000, 0x10000000, &decode_adr<kWithText>},                  // ADR
+                {0x9F000000, 0x90000000, &decode_adrp<kWithText>},                 // ADRP
+                {0x3B000000, 0x39000000, &decode_ldr_str_unsigned_imm<kWithText>}, // Load/store register (unsigned offset)
+                {0x3E000000, 0x28000000, &decode_ldp_stp<kWithText>},              // LDP/STP
+                {0x3F000000, 0x18000000, &decode_ldr_literal<kWithText>},          // LDR/LDRSW/PRFM (literal)
+                {0x3F000000, 0x1C000000, &decode_ldr_literal_fp<kWithText>},       // LDR (literal, SIMD&FP)
+                {0x3B200C00, 0x38200800, &decode_ldr_str_reg_offset<kWithText>},   // Load/store register (register offset)
+                {0x7E000000, 0x36000000, &decode_tbz_tbnz<kWithText>},             // Test and branch (zero/non-zero)
+                {0x1F800000, 0x12000000, &decode_logical_imm<kWithText>},          // Logical (immediate)
+                {0x7F800000, 0x52800000, &decode_movz<kWithText>},                 // MOVZ
+                {0x7F800000, 0x12800000, &decode_movn<kWithText>},                 // MOVN
+                {0x7F800000, 0x72800000, &decode_movk<kWithText>},                 // MOVK
+                {0x7F800000, 0x53000000, &decode_ubfm<kWithText>},                 // UBFM (used for LSL, etc.)
+                {0x1E200800, 0x1E200800, &decode_fp_data_processing<kWithText>},   // Floating-point and SIMD data processing (2 source)
+                {0x1F000000, 0x1E000000, &decode_fp_int_conversion<kWithText>},    // Conversion between float and integer
+                {0xFFE0FC00, 0x1E204000, &decode_fmov_reg<kWithText>},             // FMOV (register)
+                {0x3F000000, 0x08000000, &decode_load_store_exclusive<kWithText>}, // Load/Store Exclusive
+            };
+
+            constexpr size_t kEncodingCount = std::size(kEncodings<false>);
+            static_assert(kEncodingCount <= 64, "candidate sets are stored as 64-bit masks");
+
+            // Dispatch index: op0 (bits 28:25, the top-level encoding group) plus bits 31:29
+            // (sf/op/S and size), i.e. the word's top seven bits.
+            constexpr unsigned kGroupShift = 25;
+            constexpr size_t kGroupCount = size_t{1} << (32 - kGroupShift);
+
+            // Whether any word in `group` can satisfy (word & mask) == value.
+            constexpr bool may_match(size_t group, uint32_t mask, uint32_t value) {
+                constexpr uint32_t kIndexBits = ~uint32_t{0} << kGroupShift;
+                const uint32_t word = static_cast<uint32_t>(group) << kGroupShift;
+                return (word & mask & kIndexBits) == (value & mask & kIndexBits);
+            }
+
+            // For every dispatch index, the set of encoding classes (bit i = kEncodings[i])
+            // that words with these top bits can belong to. Most sets have at most one bit.
+            constexpr std::array<uint64_t, kGroupCount> build_groups() {
+                std::array<uint64_t, kGroupCount> groups{};
+                for (size_t group = 0; group < kGroupCount; ++group) {
+                    for (size_t i = 0; i < kEncodingCount; ++i) {
+                        const auto& encoding = kEncodings<false>[i];
+                        if (may_match(group, encoding.mask, encoding.value)) groups[group] |= uint64_t{1} << i;
                     }
+                }
+                return groups;
+            }
+
+            constexpr std::array<uint64_t, kGroupCount> kGroups = build_groups();
+
+            // Distinct candidate sets. Indices with the same set (e.g. B/BL, whose imm26 reaches
+            // into the index bits) share one decoder, so the dispatch branch stays predictable.
+            struct CandidateSets {
+                std::array<uint64_t, kGroupCount> sets{};
+                size_t count = 0;
+                std::array<uint8_t, kGroupCount> set_of_group{};
+            };
+
+            constexpr CandidateSets build_candidate_sets() {
+                CandidateSets result;
+                for (size_t group = 0; group < kGroupCount; ++group) {
+                    size_t set = 0;
+                    while (set < result.count && result.sets[set] != kGroups[group]) ++set;
+                    if (set == result.count) result.sets[result.count++] = kGroups[group];
+                    result.set_of_group[group] = static_cast<uint8_t>(set);
+                }
+                return result;
+            }
+
+            constexpr CandidateSets kCandidateSets = build_candidate_sets();
+
+            // Decoder for one candidate set: its classes tried in spec order. Classes outside
+            // the set are removed at compile time, leaving a short chain of mask tests with
+            // the leaves inlined.
+            template <bool kWithText, size_t kSet, size_t... kIndex>
+            bool decode_candidates(DecodedInsn& instr, uint32_t instr_word, TextSink* text, std::index_sequence<kIndex...>) {
+                return ((((kCandidateSets.sets[kSet] >> kIndex) & 1) != 0 &&
+                         (instr_word & kEncodings<kWithText>[kIndex].mask) == kEncodings<kWithText>[kIndex].value &&
+                         kEncodings<kWithText>[kIndex].decode(instr, instr_word, text)) || ...);
+            }
+
+            template <bool kWithText, size_t kSet>
+            bool decode_candidate_set(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                return decode_candidates<kWithText, kSet>(instr, instr_word, text, std::make_index_sequence<kEncodingCount>{});
+            }
+
+            using GroupDecoder = bool (*)(DecodedInsn&, uint32_t, TextSink*);
+
+            template <bool kWithText, size_t... kSet>
+            constexpr std::array<GroupDecoder, kGroupCount> make_group_decoders(std::index_sequence<kSet...>) {
+                constexpr GroupDecoder kSetDecoders[] = {
+                    (kCandidateSets.sets[kSet] != 0 ? &decode_candidate_set<kWithText, kSet> : nullptr)...};
+                std::array<GroupDecoder, kGroupCount> decoders{};
+                for (size_t group = 0; group < kGroupCount; ++group) {
+                    decoders[group] = kSetDecoders[kCandidateSets.set_of_group[group]];
+                }
+                return decoders;
+            }
+
+            // Top-level dispatch table: one entry per dispatch index, nullptr for unallocated groups.
+            template <bool kWithText>
+            constexpr std::array<GroupDecoder, kGroupCount> kGroupDecoders =
+                make_group_decoders<kWithText>(std::make_index_sequence<kCandidateSets.count>{});
+
+            // Core decoder shared by the fast path (kWithText == false) and the
+            // formatting path, so both always agree on the decoded fields.
+            template <bool kWithText>
+            void decode_impl(DecodedInsn& instr, uint32_t instr_word, TextSink* text) {
+                const GroupDecoder decode_group = kGroupDecoders<kWithText>[instr_word >> kGroupShift];
+                if (decode_group != nullptr && decode_group(instr, instr_word, text)) {
                     return;
                 }
 
                 instr.id = InstructionId::INVALID;
                 instr.group = InstructionGroup::INVALID;
-                instr.mnemonic = "unknown";
-                std::stringstream ss;
-                ss << "0x" << std::hex << instr_word;
-                instr.op_str = ss.str();
+                if constexpr (kWithText) text->mnemonic = "unknown";
+                if constexpr (kWithText) {
+                    std::stringstream ss;
+                    ss << "0x" << std::hex << instr_word;
+                    text->op_str = ss.str();
+                }
+            }
+
+            template <bool kWithText>
+            void decode_into(uint64_t address, uint32_t word, DecodedInsn& out, TextSink* text) {
+                out = DecodedInsn{};
+                out.address = address;
+                out.raw = word;
+                decode_impl<kWithText>(out, word, text);
+            }
+        } // namespace
+
+        bool decode(uint64_t address, uint32_t word, DecodedInsn& out) {
+            decode_into<false>(address, word, out, nullptr);
+            return out.id != InstructionId::INVALID;
+        }
+
+        void format(const DecodedInsn& insn, std::string& mnemonic, std::string& op_str) {
+            DecodedInsn scratch;
+            TextSink text;
+            decode_into<true>(insn.address, insn.raw, scratch, &text);
+            mnemonic = std::move(text.mnemonic);
+            op_str = std::move(text.op_str);
+        }
+
+        Instruction to_instruction(const DecodedInsn& insn) {
+            Instruction instr;
+            instr.address = insn.address;
+            instr.size = 4;
+            const auto* raw_bytes = reinterpret_cast<const uint8_t*>(&insn.raw);
+            instr.bytes.assign(raw_bytes, raw_bytes + 4);
+            instr.id = insn.id;
+            instr.group = insn.group;
+            instr.is_pc_relative = insn.is_pc_relative;
+            instr.cond = insn.cond;
+            format(insn, instr.mnemonic, instr.op_str);
+
+            instr.operands.reserve(insn.operand_count);
+            for (size_t i = 0; i < insn.operand_count; ++i) {
+                const auto& op = insn.operands[i];
+                switch (op.type) {
+                    case OperandType::REGISTER: instr.operands.push_back({op.type, op.reg}); break;
+                    case OperandType::IMMEDIATE: instr.operands.push_back({op.type, op.imm}); break;
+                    case OperandType::MEMORY: instr.operands.push_back({op.type, op.mem}); break;
+                    default: instr.operands.push_back({}); break;
+                }
+            }
+            return instr;
+        }
+
+        class AArch64Disassembler : public Disassembler {
+        public:
+            std::vector<Instruction> Disassemble(
+                uint64_t address,
+                const uint8_t* code,
+                size_t code_size,
+                size_t count
+            ) override {
+                std::vector<Instruction> instructions;
+                instructions.reserve(std::min(count, code_size / 4));
+                uint64_t current_address = address;
+                size_t bytes_disassembled = 0;
+
+                for (size_t i = 0; i < count && bytes_disassembled + 4 <= code_size; ++i) {
+                    uint32_t instr_word;
+                    std::memcpy(&instr_word, code + bytes_disassembled, sizeof(instr_word));
+
+                    DecodedInsn decoded;
+                    decode(current_address, instr_word, decoded);
+                    instructions.push_back(to_instruction(decoded));
+
+                    current_address += 4;
+                    bytes_disassembled += 4;
+                }
+                return instructions;
             }
         };
 
@@ -1,6 +1,18 @@
 #include "ur/elf_parser.h"
+#include "ur/symbol_cache.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <vector>
 
+#ifdef UR_HAVE_LZMA
+#include <lzma.h>
+#endif
+
 namespace ur::elf_parser {
 
     // ElfHeader Implementation
@@ -125,6 +137,14 @@ namespace ur::elf_parser {
         }
     }
 
+    SectionHeaderTable::SectionHeaderTable(uintptr_t sh_table_addr, const ElfHeader& header, const char* string_table)
+        : m_string_table_data(string_table) {
+        auto shdr_count = header.get_section_header_count();
+        for (uint16_t i = 0; i < shdr_count; ++i) {
+            m_section_headers.emplace_back(reinterpret_cast<const Elf64_Shdr*>(sh_table_addr + i * sizeof(Elf64_Shdr)));
+        }
+    }
+
     const SectionHeader* SectionHeaderTable::get_section_by_name(const std::string& name) const {
         for (const auto& shdr : m_section_headers) {
             if (shdr.get_name(m_string_table_data) == name) {
@@ -157,9 +177,220 @@ namespace ur::elf_parser {
         return m_section_header_table;
     }
 
+    namespace {
+        // 对一块完整 ELF 文件数据（文件映射或解压后的 MiniDebugInfo）的节头视图，所有访问都做边界检查
+        struct FileSections {
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            const Elf64_Ehdr* header = nullptr;
+            const Elf64_Shdr* sections = nullptr;
+            size_t count = 0;
+            const char* names = nullptr;
+            size_t names_size = 0;
+
+            bool init(const uint8_t* image, size_t image_size) {
+                data = image;
+                size = image_size;
+                if (size < sizeof(Elf64_Ehdr)) return false;
+                header = reinterpret_cast<const Elf64_Ehdr*>(data);
+                if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != ELFCLASS64) return false;
+                if (header->e_shentsize != sizeof(Elf64_Shdr) || header->e_shoff == 0) return false;
+                count = header->e_shnum;
+                if (header->e_shoff > size || count > (size - header->e_shoff) / sizeof(Elf64_Shdr)) return false;
+                sections = reinterpret_cast<const Elf64_Shdr*>(data + header->e_shoff);
+                if (header->e_shstrndx == SHN_UNDEF || header->e_shstrndx >= count) return false;
+                names = reinterpret_cast<const char*>(contents(sections[header->e_shstrndx]));
+                names_size = names ? sections[header->e_shstrndx].sh_size : 0;
+                return names != nullptr;
+            }
+
+            const uint8_t* contents(const Elf64_Shdr& section) const {
+                if (section.sh_type == SHT_NOBITS) return nullptr;
+                if (section.sh_offset > size || section.sh_size > size - section.sh_offset) return nullptr;
+                return data + section.sh_offset;
+            }
+
+            const Elf64_Shdr* find(std::string_view name) const {
+                for (size_t i = 0; i < count; ++i) {
+                    const uint32_t offset = sections[i].sh_name;
+                    if (offset >= names_size) continue;
+                    const char* section_name = names + offset;
+                    if (strnlen(section_name, names_size - offset) == name.size() &&
+                        memcmp(section_name, name.data(), name.size()) == 0) {
+                        return &sections[i];
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        struct SymbolTable {
+            const Elf64_Sym* symbols = nullptr;
+            const char* strings = nullptr;
+            size_t count = 0;
+        };
+
+        // 查找 .symtab 及其关联（sh_link）的字符串表
+        SymbolTable find_symbol_table(const FileSections& file) {
+            const Elf64_Shdr* symtab = file.find(".symtab");
+            if (symtab == nullptr || symtab->sh_type != SHT_SYMTAB || symtab->sh_link >= file.count) return {};
+            const Elf64_Shdr& strtab = file.sections[symtab->sh_link];
+            const uint8_t* symbols = file.contents(*symtab);
+            const uint8_t* strings = file.contents(strtab);
+            if (symbols == nullptr || strings == nullptr || strtab.sh_size == 0 || strings[strtab.sh_size - 1] != '\0') {
+                return {};
+            }
+            return {reinterpret_cast<const Elf64_Sym*>(symbols), reinterpret_cast<const char*>(strings),
+                    symtab->sh_size / sizeof(Elf64_Sym)};
+        }
+
+#ifdef UR_HAVE_LZMA
+        bool xz_decode(const uint8_t* input, size_t input_size, std::vector<uint8_t>& output) {
+            lzma_stream stream = LZMA_STREAM_INIT;
+            if (lzma_stream_decoder(&stream, UINT64_MAX, 0) != LZMA_OK) return false;
+
+            output.resize(std::max<size_t>(input_size * 4, 4096));
+            stream.next_in = input;
+            stream.avail_in = input_size;
+            stream.next_out = output.data();
+            stream.avail_out = output.size();
+
+            lzma_ret ret;
+            do {
+                if (stream.avail_out == 0) {
+                    const size_t used = output.size();
+                    output.resize(used * 2);
+                    stream.next_out = output.data() + used;
+                    stream.avail_out = output.size() - used;
+                }
+                ret = lzma_code(&stream, LZMA_FINISH);
+            } while (ret == LZMA_OK);
+
+            output.resize(stream.total_out);
+            lzma_end(&stream);
+            return ret == LZMA_STREAM_END;
+        }
+#endif
+
+        struct FileCache {
+            std::mutex mutex;
+            std::unordered_map<std::string, std::weak_ptr<const ElfFile>> files;
+        };
+
+        FileCache& file_cache() {
+            // Intentionally leaked, same as the other process-wide caches.
+            static FileCache* cache = new FileCache();
+            return *cache;
+        }
+    }
+
+    // ElfFile Implementation
+    std::shared_ptr<const ElfFile> ElfFile::open(const std::string& path) {
+        struct stat st{};
+        if (path.empty() || stat(path.c_str(), &st) != 0) return nullptr;
+
+        auto& cache = file_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+
+        auto it = cache.files.find(path);
+        if (it != cache.files.end()) {
+            auto file = it->second.lock();
+            // 路径对应的文件被替换（inode 变化）时重新映射
+            if (file && file->m_device == static_cast<uint64_t>(st.st_dev) && file->m_inode == static_cast<uint64_t>(st.st_ino)) {
+                return file;
+            }
+        }
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return nullptr;
+        }
+        void* mem = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) return nullptr;
+
+        std::shared_ptr<ElfFile> file(new ElfFile());
+        file->m_path = path;
+        file->m_data = static_cast<const uint8_t*>(mem);
+        file->m_size = static_cast<size_t>(st.st_size);
+        file->m_device = static_cast<uint64_t>(st.st_dev);
+        file->m_inode = static_cast<uint64_t>(st.st_ino);
+
+        // 顺便清理已失效的条目
+        for (auto entry = cache.files.begin(); entry != cache.files.end();) {
+            entry = entry->second.expired() ? cache.files.erase(entry) : std::next(entry);
+        }
+        cache.files[path] = file;
+        return file;
+    }
+
+    ElfFile::~ElfFile() {
+        if (m_data != nullptr) {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+    }
+
+    std::shared_ptr<const std::vector<uint8_t>> ElfFile::decompress_xz(uint64_t offset, size_t size) const {
+        if (offset > m_size || size > m_size - offset) return nullptr;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_decompressed.find(offset);
+        if (it != m_decompressed.end()) return it->second;
+
+        std::shared_ptr<const std::vector<uint8_t>> result;
+#ifdef UR_HAVE_LZMA
+        auto output = std::make_shared<std::vector<uint8_t>>();
+        if (xz_decode(m_data + offset, size, *output)) {
+            result = std::move(output);
+        }
+#endif
+        // 失败同样缓存，避免重复解压
+        m_decompressed.emplace(offset, result);
+        return result;
+    }
+
     // ElfParser Implementation
     ElfParser::ElfParser(uintptr_t base_address) : m_base_address(base_address) {}
 
+    ElfParser::ElfParser(uintptr_t base_address, std::string file_path, uint64_t file_offset)
+        : m_base_address(base_address), m_file_path(std::move(file_path)), m_file_offset(file_offset) {}
+
+    bool ElfParser::load_file_symbols() {
+        if (!m_file) m_file = ElfFile::open(m_file_path);
+        if (!m_file || m_file_offset >= m_file->size()) return false;
+
+        FileSections file;
+        if (!file.init(m_file->data() + m_file_offset, m_file->size() - m_file_offset)) return false;
+        // 与内存中的 ELF 头比较，确认文件就是已加载的这个模块
+        if (memcmp(file.header, reinterpret_cast<const void*>(m_base_address), sizeof(Elf64_Ehdr)) != 0) return false;
+
+        if (!m_section_header_table) {
+            m_section_header_table = std::make_unique<SectionHeaderTable>(
+                reinterpret_cast<uintptr_t>(file.sections), *m_header, file.names);
+        }
+
+        SymbolTable table = find_symbol_table(file);
+        if (table.symbols == nullptr) {
+            // 没有 .symtab 时尝试 MiniDebugInfo：.gnu_debugdata 是 XZ 压缩的、只含符号表的 ELF
+            const Elf64_Shdr* debugdata = file.find(".gnu_debugdata");
+            if (debugdata == nullptr || file.contents(*debugdata) == nullptr) return false;
+            m_debug_data = m_file->decompress_xz(m_file_offset + debugdata->sh_offset, debugdata->sh_size);
+            if (!m_debug_data) return false;
+
+            FileSections debug;
+            if (!debug.init(m_debug_data->data(), m_debug_data->size())) return false;
+            table = find_symbol_table(debug);
+            if (table.symbols == nullptr) return false;
+        }
+
+        m_symtab = table.symbols;
+        m_strtab = table.strings;
+        m_symtab_count = table.count;
+        return true;
+    }
+
     uintptr_t ElfParser::file_offset_to_memory_addr(uint64_t offset) {
         if (m_load_bias != 0) {
              // If we have a load bias, we can assume the segments are loaded in memory
@@ -224,6 +455,27 @@ namespace ur::elf_parser {
         }
         m_load_bias = m_base_address - min_vaddr_pt_load->get_virtual_address();
 
+        // NT_GNU_BUILD_ID 位于已加载的 PT_NOTE 段中
+        m_build_id.clear();
+        for (const auto& phdr : *m_program_header_table) {
+            if (phdr.get_type() != PT_NOTE || !m_build_id.empty()) continue;
+            const auto* note = reinterpret_cast<const uint8_t*>(m_load_bias + phdr.get_virtual_address());
+            const auto* end = note + phdr.get_file_size();
+            while (note + sizeof(Elf64_Nhdr) <= end) {
+                const auto* nhdr = reinterpret_cast<const Elf64_Nhdr*>(note);
+                const size_t name_size = (nhdr->n_namesz + 3) & ~size_t(3);
+                const size_t desc_size = (nhdr->n_descsz + 3) & ~size_t(3);
+                const uint8_t* name = note + sizeof(Elf64_Nhdr);
+                const uint8_t* desc = name + name_size;
+                if (desc + desc_size > end) break;
+                if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+                    m_build_id.assign(desc, desc + nhdr->n_descsz);
+                    break;
+                }
+                note = desc + desc_size;
+            }
+        }
+
         // Dynamic symbols are essential for many operations.
         const auto* pt_dynamic = m_program_header_table->find_first_by_type(PT_DYNAMIC);
         if (pt_dynamic != nullptr) {
@@ -255,6 +507,11 @@ namespace ur::elf_parser {
             }
         }
 
+        m_symtab_index.clear();
+        m_symtab_index_built = false;
+        m_function_index.clear();
+        m_function_index_built = false;
+
         // Section headers are optional. They might not be loaded in memory.
         uintptr_t sh_table_addr = file_offset_to_memory_addr(m_header->get_section_header_offset());
         if (sh_table_addr != 0) {
@@ -272,64 +529,147 @@ namespace ur::elf_parser {
             }
         }
 
+        if ((m_symtab == nullptr || m_strtab == nullptr) && !m_file_path.empty()) {
+            // 失败不影响动态符号的查找
+            (void)load_file_symbols();
+        }
+
         // As long as we have a valid header and program headers, consider parsing successful.
         return true;
     }
     
-    static uint32_t gnu_hash(const char *s) {
-        uint32_t h = 5381;
-        for (unsigned char c = *s; c != '\0'; c = *++s) {
-            h = (h << 5) + h + c;
+    namespace {
+        // 比较以 '\0' 结尾的字符串表项与 string_view（后者不一定以 '\0' 结尾）
+        bool name_equals(const char* str, std::string_view name) {
+            return strncmp(str, name.data(), name.size()) == 0 && str[name.size()] == '\0';
+        }
+
+        bool is_defined_symbol(const Elf64_Sym* sym) {
+            auto type = ELF64_ST_TYPE(sym->st_info);
+            return (type == STT_FUNC || type == STT_OBJECT || type == STT_GNU_IFUNC) && sym->st_shndx != SHN_UNDEF;
         }
-        return h;
     }
 
-    uintptr_t ElfParser::find_symbol(const std::string& symbol_name) {
-        if (m_gnu_hash_table != nullptr) {
-            auto addr = find_symbol_by_gnu_hash(symbol_name);
-            if (addr != 0) return addr;
+    uintptr_t ElfParser::resolve_address(uint64_t value, bool ifunc) const {
+        if (ifunc) {
+            using resolver_t = void* (*)();
+            auto resolver = (resolver_t)(m_load_bias + value);
+            return (uintptr_t)resolver();
+        }
+        return m_load_bias + value;
+    }
+
+    const Elf64_Sym* ElfParser::lookup_symbol(const SymbolKey& key) {
+        if (m_gnu_hash_table != nullptr && gnu_bloom_may_contain(key.gnu)) {
+            if (const auto* sym = find_symbol_by_gnu_hash(key)) return sym;
         }
         if (m_hash_table != nullptr) {
-            auto addr = find_symbol_by_hash(symbol_name);
-            if (addr != 0) return addr;
-        }
-        if (m_symtab != nullptr && m_strtab != nullptr) {
-            for (size_t i = 0; i < m_symtab_count; ++i) {
-                const Elf64_Sym* sym = &m_symtab[i];
-                if (strcmp(symbol_name.c_str(), m_strtab + sym->st_name) == 0) {
-                     auto type = ELF64_ST_TYPE(sym->st_info);
-                    if ((type == STT_FUNC || type == STT_OBJECT || type == STT_GNU_IFUNC) && sym->st_shndx != SHN_UNDEF) {
-                        if (type == STT_GNU_IFUNC) {
-                            using resolver_t = void* (*)();
-                            auto resolver = (resolver_t)(m_load_bias + sym->st_value);
-                            return (uintptr_t)resolver();
-                        }
-                        return m_load_bias + sym->st_value;
-                    }
+            if (const auto* sym = find_symbol_by_hash(key)) return sym;
+        }
+        return find_symbol_in_symtab(key);
+    }
+
+    // 记录到符号缓存并解析出最终地址
+    uintptr_t ElfParser::finish_lookup(const SymbolKey& key, const Elf64_Sym* sym) {
+        const bool ifunc = sym != nullptr && ELF64_ST_TYPE(sym->st_info) == STT_GNU_IFUNC;
+        if (m_symbol_cache) {
+            symbol_cache::Result result;
+            result.present = sym != nullptr;
+            result.ifunc = ifunc;
+            result.value = sym ? sym->st_value : 0;
+            m_symbol_cache->record(key.name, key.gnu, result);
+        }
+        return sym ? resolve_address(sym->st_value, ifunc) : 0;
+    }
+
+    uintptr_t ElfParser::find_symbol(const SymbolKey& key) {
+        if (m_symbol_cache) {
+            symbol_cache::Result cached;
+            if (m_symbol_cache->lookup(key.name, key.gnu, cached)) {
+                return cached.present ? resolve_address(cached.value, cached.ifunc) : 0;
+            }
+        }
+        return finish_lookup(key, lookup_symbol(key));
+    }
+
+    size_t ElfParser::find_symbols(std::span<const SymbolKey> keys, std::span<uintptr_t> out) {
+        if (out.size() < keys.size()) return 0;
+        std::fill(out.begin(), out.begin() + keys.size(), 0);
+
+        // 缓存命中的符号不再参与任何哈希表查找
+        size_t found = 0;
+        std::vector<size_t> misses;
+        misses.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            symbol_cache::Result cached;
+            if (m_symbol_cache && m_symbol_cache->lookup(keys[i].name, keys[i].gnu, cached)) {
+                if (cached.present) {
+                    out[i] = resolve_address(cached.value, cached.ifunc);
+                    ++found;
                 }
+            } else {
+                misses.push_back(i);
             }
         }
-        return 0;
+
+        // 第一遍：只做布隆过滤，绝大多数不存在于 .dynsym 的符号在这里就被排除；
+        // 第二遍：只为通过过滤的符号遍历哈希链
+        std::vector<const Elf64_Sym*> symbols(keys.size(), nullptr);
+        if (m_gnu_hash_table != nullptr) {
+            std::vector<size_t> candidates;
+            candidates.reserve(misses.size());
+            for (size_t i : misses) {
+                if (gnu_bloom_may_contain(keys[i].gnu)) candidates.push_back(i);
+            }
+            for (size_t i : candidates) {
+                symbols[i] = find_symbol_by_gnu_hash(keys[i]);
+            }
+        }
+
+        // 其余符号与 find_symbol 的回退顺序相同：DT_HASH，然后是 .symtab 索引
+        for (size_t i : misses) {
+            if (symbols[i] == nullptr && m_hash_table != nullptr) symbols[i] = find_symbol_by_hash(keys[i]);
+            if (symbols[i] == nullptr) symbols[i] = find_symbol_in_symtab(keys[i]);
+            out[i] = finish_lookup(keys[i], symbols[i]);
+            if (out[i] != 0) ++found;
+        }
+        return found;
     }
 
-    uintptr_t ElfParser::find_symbol_by_gnu_hash(const std::string& symbol_name) {
-        const uint32_t nbuckets = m_gnu_hash_table[0];
-        const uint32_t symoffset = m_gnu_hash_table[1];
+    std::span<const uint8_t> ElfParser::get_build_id() const {
+        return m_build_id;
+    }
+
+    bool ElfParser::enable_symbol_cache(const std::string& directory) {
+        if (m_build_id.empty()) return false;
+        m_symbol_cache = symbol_cache::Cache::open(directory, m_build_id);
+        return m_symbol_cache != nullptr;
+    }
+
+    bool ElfParser::flush_symbol_cache() {
+        return m_symbol_cache ? m_symbol_cache->flush() : false;
+    }
+
+    bool ElfParser::gnu_bloom_may_contain(uint32_t hash) const {
         const uint32_t bloom_size = m_gnu_hash_table[2];
         const uint32_t bloom_shift = m_gnu_hash_table[3];
         const auto bloom_filter = reinterpret_cast<const Elf64_Addr*>(&m_gnu_hash_table[4]);
-        const auto buckets = reinterpret_cast<const uint32_t*>(&bloom_filter[bloom_size]);
-        const auto chain = &buckets[nbuckets];
-
-        uint32_t hash = gnu_hash(symbol_name.c_str());
 
         uint64_t bloom_word = bloom_filter[(hash / 64) % bloom_size];
         uint64_t h1 = hash % 64;
         uint64_t h2 = (hash >> bloom_shift) % 64;
-        if (!((bloom_word >> h1) & (bloom_word >> h2) & 1)) {
-            return 0;
-        }
-        
+        return (bloom_word >> h1) & (bloom_word >> h2) & 1;
+    }
+
+    const Elf64_Sym* ElfParser::find_symbol_by_gnu_hash(const SymbolKey& key) const {
+        const uint32_t nbuckets = m_gnu_hash_table[0];
+        const uint32_t symoffset = m_gnu_hash_table[1];
+        const uint32_t bloom_size = m_gnu_hash_table[2];
+        const auto bloom_filter = reinterpret_cast<const Elf64_Addr*>(&m_gnu_hash_table[4]);
+        const auto buckets = reinterpret_cast<const uint32_t*>(&bloom_filter[bloom_size]);
+        const auto chain = &buckets[nbuckets];
+
+        const uint32_t hash = key.gnu;
         uint32_t sym_idx = buckets[hash % nbuckets];
         if (sym_idx < symoffset) {
             return 0;
@@ -341,16 +681,8 @@ namespace ur::elf_parser {
         for (;; sym_idx++, sym++, hash_chain++) {
             uint32_t chain_hash = *hash_chain;
             if ((hash | 1) == (chain_hash | 1)) {
-                if (strcmp(symbol_name.c_str(), m_dynstr + sym->st_name) == 0) {
-                    auto type = ELF64_ST_TYPE(sym->st_info);
-                    if ((type == STT_FUNC || type == STT_OBJECT || type == STT_GNU_IFUNC) && sym->st_shndx != SHN_UNDEF) {
-                        if (type == STT_GNU_IFUNC) {
-                            using resolver_t = void* (*)();
-                            auto resolver = (resolver_t)(m_load_bias + sym->st_value);
-                            return (uintptr_t)resolver();
-                        }
-                        return m_load_bias + sym->st_value;
-                    }
+                if (name_equals(m_dynstr + sym->st_name, key.name) && is_defined_symbol(sym)) {
+                    return sym;
                 }
             }
             if (chain_hash & 1) {
@@ -360,40 +692,142 @@ namespace ur::elf_parser {
 
         return 0;
     }
-    
-    static uint32_t elf_hash(const char *s) {
-        uint32_t h = 0, g;
-        while (*s) {
-            h = (h << 4) + *s++;
-            if ((g = h & 0xf0000000)) {
-                h ^= g >> 24;
-            }
-            h &= ~g;
-        }
-        return h;
-    }
 
-    uintptr_t ElfParser::find_symbol_by_hash(const std::string& symbol_name) {
+    const Elf64_Sym* ElfParser::find_symbol_by_hash(const SymbolKey& key) const {
         const uint32_t nbucket = m_hash_table[0];
-        const uint32_t nchain = m_hash_table[1];
         const auto bucket = &m_hash_table[2];
         const auto chain = &bucket[nbucket];
 
-        uint32_t hash = elf_hash(symbol_name.c_str());
-        for (uint32_t i = bucket[hash % nbucket]; i != 0; i = chain[i]) {
+        for (uint32_t i = bucket[key.sysv % nbucket]; i != 0; i = chain[i]) {
             const Elf64_Sym* sym = &m_dynsym[i];
-            if (strcmp(symbol_name.c_str(), m_dynstr + sym->st_name) == 0) {
-                auto type = ELF64_ST_TYPE(sym->st_info);
-                if ((type == STT_FUNC || type == STT_OBJECT || type == STT_GNU_IFUNC) && sym->st_shndx != SHN_UNDEF) {
-                    if (type == STT_GNU_IFUNC) {
-                        using resolver_t = void* (*)();
-                        auto resolver = (resolver_t)(m_load_bias + sym->st_value);
-                        return (uintptr_t)resolver();
-                    }
-                    return m_load_bias + sym->st_value;
-                }
+            if (name_equals(m_dynstr + sym->st_name, key.name) && is_defined_symbol(sym)) {
+                return sym;
             }
         }
         return 0;
     }
-}
\ No newline at end of file
+
+    void ElfParser::build_symtab_index() {
+        std::lock_guard<std::mutex> lock(m_index_mutex);
+        if (m_symtab_index_built.load(std::memory_order_relaxed)) return;
+        if (m_symtab == nullptr || m_strtab == nullptr || m_symtab_count == 0) {
+            m_symtab_index_built.store(true, std::memory_order_release);
+            return;
+        }
+
+        // 容量为 2 的幂且不低于符号数的两倍，保证线性探测的链足够短
+        size_t capacity = 16;
+        while (capacity < m_symtab_count * 2) capacity <<= 1;
+        m_symtab_index.assign(capacity, SymtabSlot{});
+        const size_t mask = capacity - 1;
+
+        for (size_t i = 0; i < m_symtab_count; ++i) {
+            const Elf64_Sym* sym = &m_symtab[i];
+            if (!is_defined_symbol(sym)) continue;
+            const char* name = m_strtab + sym->st_name;
+            if (*name == '\0') continue;
+
+            const uint32_t hash = gnu_hash(name);
+            for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+                auto& entry = m_symtab_index[slot];
+                if (entry.index == 0) {
+                    entry.hash = hash;
+                    entry.index = static_cast<uint32_t>(i + 1);
+                    break;
+                }
+                // 同名符号保留第一个，与线性查找的结果一致
+                if (entry.hash == hash && strcmp(m_strtab + m_symtab[entry.index - 1].st_name, name) == 0) {
+                    break;
+                }
+            }
+        }
+        // 索引建好后才发布，其他线程看到标志时索引已完整
+        m_symtab_index_built.store(true, std::memory_order_release);
+    }
+
+    const Elf64_Sym* ElfParser::find_symbol_in_symtab(const SymbolKey& key) {
+        if (!m_symtab_index_built.load(std::memory_order_acquire)) build_symtab_index();
+        if (m_symtab_index.empty()) return 0;
+
+        const size_t mask = m_symtab_index.size() - 1;
+        for (size_t slot = key.gnu & mask;; slot = (slot + 1) & mask) {
+            const auto& entry = m_symtab_index[slot];
+            if (entry.index == 0) return 0;
+            if (entry.hash == key.gnu) {
+                const Elf64_Sym* sym = &m_symtab[entry.index - 1];
+                if (name_equals(m_strtab + sym->st_name, key.name)) {
+                    return sym;
+                }
+            }
+        }
+    }
+
+    // .dynsym 没有记录自身的大小：DT_HASH 的 nchain 就是符号数，只有 DT_GNU_HASH 时取最大桶起点
+    // 并沿哈希链走到结束标记
+    size_t ElfParser::dynamic_symbol_count() const {
+        if (m_hash_table != nullptr) return m_hash_table[1];
+        if (m_gnu_hash_table == nullptr) return 0;
+
+        const uint32_t nbuckets = m_gnu_hash_table[0];
+        const uint32_t symoffset = m_gnu_hash_table[1];
+        const uint32_t bloom_size = m_gnu_hash_table[2];
+        const auto bloom_filter = reinterpret_cast<const Elf64_Addr*>(&m_gnu_hash_table[4]);
+        const auto buckets = reinterpret_cast<const uint32_t*>(&bloom_filter[bloom_size]);
+        const auto chain = &buckets[nbuckets];
+
+        uint32_t last = 0;
+        for (uint32_t i = 0; i < nbuckets; ++i) last = std::max(last, buckets[i]);
+        if (last < symoffset) return symoffset;
+        while ((chain[last - symoffset] & 1) == 0) ++last;
+        return last + 1;
+    }
+
+    void ElfParser::build_function_index() {
+        std::lock_guard<std::mutex> lock(m_index_mutex);
+        if (m_function_index_built.load(std::memory_order_relaxed)) return;
+        m_function_index.clear();
+
+        auto collect = [this](const Elf64_Sym* symbols, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                const Elf64_Sym& sym = symbols[i];
+                const auto type = ELF64_ST_TYPE(sym.st_info);
+                if ((type != STT_FUNC && type != STT_GNU_IFUNC) || sym.st_shndx == SHN_UNDEF || sym.st_size == 0) continue;
+                m_function_index.push_back({sym.st_value, sym.st_size});
+            }
+        };
+        if (m_dynsym != nullptr) collect(m_dynsym, dynamic_symbol_count());
+        if (m_symtab != nullptr) collect(m_symtab, m_symtab_count);
+
+        // 别名（同一地址的多个名字）只保留一份
+        std::sort(m_function_index.begin(), m_function_index.end(), [](const FunctionRange& a, const FunctionRange& b) {
+            return a.value != b.value ? a.value < b.value : a.size > b.size;
+        });
+        m_function_index.erase(std::unique(m_function_index.begin(), m_function_index.end(),
+                                           [](const FunctionRange& a, const FunctionRange& b) {
+                                               return a.value == b.value && a.size == b.size;
+                                           }),
+                               m_function_index.end());
+        m_function_index_built.store(true, std::memory_order_release);
+    }
+
+    bool ElfParser::find_function(uintptr_t address, uintptr_t& start, size_t& size) {
+        if (!m_function_index_built.load(std::memory_order_acquire)) build_function_index();
+        if (address < m_load_bias) return false;
+
+        // 最后一个起点不大于 value 的区间；起点相同的区间中较大的排在前面
+        const uint64_t value = address - m_load_bias;
+        auto it = std::upper_bound(m_function_index.begin(), m_function_index.end(), value,
+                                   [](uint64_t v, const FunctionRange& range) { return v < range.value; });
+        while (it != m_function_index.begin()) {
+            --it;
+            if (value - it->value < it->size) {
+                start = m_load_bias + it->value;
+                size = it->size;
+                return true;
+            }
+            // 更早的函数只有在嵌套时才可能覆盖 address，这里只回看起点相同的区间
+            if (it == m_function_index.begin() || std::prev(it)->value != it->value) break;
+        }
+        return false;
+    }
+}
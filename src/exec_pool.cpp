@@ -0,0 +1,568 @@
+#include "ur/exec_pool.h"
+#include "ur/cache_maintenance.h"
+#include "ur/fork_safety.h"
+#include "ur/maps_parser.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace ur::exec_pool {
+
+namespace {
+
+constexpr size_t kAlignment = 16;
+constexpr size_t kSlabSize = 64 * 1024;
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+// A pool mapping. With dual mapping the same memfd pages are mapped twice: `base` is the
+// RX view that code executes from and `write_base` an RW view at some other address.
+// Single mappings are RWX and write_base == base.
+struct Mapping {
+    uintptr_t base = 0;
+    uintptr_t write_base = 0;
+};
+
+struct Slab {
+    uintptr_t base = 0;
+    uintptr_t write_base = 0;
+    size_t size = 0;
+    size_t bump = 0;                                // Offset of the first never-used byte
+    std::map<size_t, size_t> free_blocks;           // offset -> size, kept coalesced
+    std::unordered_map<size_t, size_t> used_blocks; // offset -> size
+    bool inherited = false; // Shared with forked processes; never reused or unmapped
+};
+
+struct Dedicated {
+    size_t size = 0;
+    uintptr_t write_base = 0;
+    bool inherited = false;
+};
+
+struct Pool {
+    std::mutex mutex;
+    std::map<uintptr_t, std::unique_ptr<Slab>> slabs;  // keyed by slab base
+    std::map<uintptr_t, Dedicated> dedicated;          // large blocks, keyed by base
+    size_t bytes_in_use = 0;
+    // Cleared after the first failed memfd mapping (no memfd_create, or exec on shared
+    // memory denied by the policy); from then on RWX mappings are used.
+    bool dual_mapping = true;
+    // The fork_safety participant holds the mutex on the forking thread (see remap_after_fork)
+    bool locked_for_fork = false;
+};
+
+void remap_after_fork();
+
+Pool& pool() {
+    // Intentionally leaked: hooks may still be torn down from static destructors.
+    static Pool* instance = [] {
+        auto* p = new Pool();
+        // Always on, independent of fork_safety::enable(): a plain fork() must not leave
+        // the child sharing code and data slots with its parent.
+        pthread_atfork(nullptr, nullptr, remap_after_fork);
+        return p;
+    }();
+    return *instance;
+}
+
+size_t page_size() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uintptr_t distance(uintptr_t a, uintptr_t b) {
+    return a > b ? a - b : b - a;
+}
+
+bool range_within(uintptr_t start, size_t size, uintptr_t near, size_t max_distance) {
+    return distance(start, near) <= max_distance && distance(start + size, near) <= max_distance;
+}
+
+void* map_anywhere(size_t size, int prot, int flags, int fd) {
+    void* mem = mmap(nullptr, size, prot, flags, fd, 0);
+    return mem == MAP_FAILED ? nullptr : mem;
+}
+
+// Places the mapping at `address` exactly; fails if it is taken or the kernel moves it.
+void* map_fixed(uintptr_t address, size_t size, int prot, int flags, int fd) {
+#ifdef MAP_FIXED_NOREPLACE
+    flags |= MAP_FIXED_NOREPLACE;
+#endif
+    void* mem = mmap(reinterpret_cast<void*>(address), size, prot, flags, fd, 0);
+    if (mem == MAP_FAILED) return nullptr;
+    if (reinterpret_cast<uintptr_t>(mem) != address) {
+        // Kernels without MAP_FIXED_NOREPLACE treat the address as a hint
+        munmap(mem, size);
+        return nullptr;
+    }
+    return mem;
+}
+
+// Maps into the free hole nearest to `target` found in the shared maps snapshot, with a
+// single mmap. The snapshot does not know about mappings made since it was captured, so
+// a taken hole means it is stale: refresh it once and try again.
+void* map_into_gap(uintptr_t target, size_t size, size_t max_distance, int prot, int flags, int fd) {
+    auto snapshot = maps_parser::MapsSnapshot::current();
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (attempt != 0) snapshot = maps_parser::MapsSnapshot::refresh();
+        const uintptr_t gap = snapshot->find_gap(target, size, max_distance, page_size());
+        if (gap == 0) continue;
+        if (void* mem = map_fixed(gap, size, prot, flags, fd)) return mem;
+    }
+    return nullptr;
+}
+
+// Bounded near-allocation, tries symmetric hints around target. Holes are looked up in the
+// maps snapshot first; probing is only the fallback when that finds nothing.
+// If MAP_FIXED_NOREPLACE is available, it will be used to request exact placement safely.
+// Otherwise, it uses hints and validates the returned address is within max_distance;
+// if not, it unmaps and continues.
+void* map_near(uintptr_t target, size_t size, size_t max_distance, int prot, int flags, int fd) {
+    if (void* mem = map_into_gap(target, size, max_distance, prot, flags, fd)) return mem;
+
+    uintptr_t base = target & ~(static_cast<uintptr_t>(page_size()) - 1);
+
+    // Probe parameters: 1MB step, up to 256 symmetric probes (~256MB span).
+    constexpr uintptr_t kStep = 1ull << 20; // 1MB
+    const size_t max_probes = std::min<size_t>(256, (max_distance / kStep) + 1);
+
+    for (size_t i = 0; i < max_probes; ++i) {
+        for (int dir = (i == 0 ? 0 : -1); dir <= 1; dir += 2) {
+            uintptr_t offset = i * kStep;
+            uintptr_t candidate = base;
+            if (dir < 0) {
+                if (base >= offset + size) candidate = base - offset - size;
+                else continue;
+            } else if (dir > 0) {
+                candidate = base + offset;
+            }
+
+            void* addr = reinterpret_cast<void*>(candidate);
+#ifdef MAP_FIXED_NOREPLACE
+            void* mem = mmap(addr, size, prot, flags | MAP_FIXED_NOREPLACE, fd, 0);
+#else
+            // Use hint; kernel may place elsewhere. Validate window on success.
+            void* mem = mmap(addr, size, prot, flags, fd, 0);
+#endif
+            if (mem != MAP_FAILED) {
+                if (range_within(reinterpret_cast<uintptr_t>(mem), size, target, max_distance)) {
+                    return mem;
+                }
+                munmap(mem, size);
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Outcome of map_dual().
+enum class DualStatus {
+    Mapped,
+    NoRoom,      // The RX view fits nowhere in the window; dual mapping itself works
+    Unsupported, // memfd or shared RX/RW mappings are not usable in this process
+};
+
+// Maps a memfd twice: an RX view (near `near` if requested) and an RW view anywhere.
+DualStatus map_dual(size_t size, uintptr_t near, size_t max_distance, Mapping& out) {
+    int fd = static_cast<int>(syscall(__NR_memfd_create, "urhook-code", MFD_CLOEXEC));
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        if (fd >= 0) close(fd);
+        return DualStatus::Unsupported;
+    }
+
+    void* exec = near ? map_near(near, size, max_distance, PROT_READ | PROT_EXEC, MAP_SHARED, fd)
+                      : map_anywhere(size, PROT_READ | PROT_EXEC, MAP_SHARED, fd);
+    if (exec == nullptr) {
+        // A window failure is only about placement if the same mapping works without one;
+        // otherwise the policy forbids shared RX memory.
+        DualStatus status = DualStatus::Unsupported;
+        if (near) {
+            if (void* probe = map_anywhere(size, PROT_READ | PROT_EXEC, MAP_SHARED, fd)) {
+                munmap(probe, size);
+                status = DualStatus::NoRoom;
+            }
+        }
+        close(fd);
+        return status;
+    }
+    void* write = map_anywhere(size, PROT_READ | PROT_WRITE, MAP_SHARED, fd);
+    // The mappings keep the memory alive.
+    close(fd);
+    if (write == nullptr) {
+        munmap(exec, size);
+        return DualStatus::Unsupported;
+    }
+
+    out.base = reinterpret_cast<uintptr_t>(exec);
+    out.write_base = reinterpret_cast<uintptr_t>(write);
+    return DualStatus::Mapped;
+}
+
+// Maps pool memory, preferring a dual mapping. Caller must hold the pool mutex.
+bool map_region(Pool& p, size_t size, uintptr_t near, size_t max_distance, Mapping& out) {
+    if (p.dual_mapping) {
+        switch (map_dual(size, near, max_distance, out)) {
+            case DualStatus::Mapped: return true;
+            case DualStatus::NoRoom: return false; // RWX would not find room in the window either
+            case DualStatus::Unsupported: p.dual_mapping = false; break;
+        }
+    }
+
+    constexpr int kProt = PROT_READ | PROT_WRITE | PROT_EXEC;
+    constexpr int kFlags = MAP_ANONYMOUS | MAP_PRIVATE;
+    void* mem = near ? map_near(near, size, max_distance, kProt, kFlags, -1) : map_anywhere(size, kProt, kFlags, -1);
+    if (mem == nullptr) return false;
+    out.base = reinterpret_cast<uintptr_t>(mem);
+    out.write_base = out.base;
+    return true;
+}
+
+void unmap_region(uintptr_t base, uintptr_t write_base, size_t size) {
+    munmap(reinterpret_cast<void*>(base), size);
+    if (write_base != base) {
+        munmap(reinterpret_cast<void*>(write_base), size);
+    }
+}
+
+// Carves `size` bytes out of a slab, first-fit from the free list, then from the bump region.
+void* slab_allocate(Slab& slab, size_t size) {
+    for (auto it = slab.free_blocks.begin(); it != slab.free_blocks.end(); ++it) {
+        if (it->second < size) continue;
+        size_t offset = it->first;
+        size_t remaining = it->second - size;
+        slab.free_blocks.erase(it);
+        if (remaining != 0) {
+            slab.free_blocks.emplace(offset + size, remaining);
+        }
+        slab.used_blocks.emplace(offset, size);
+        return reinterpret_cast<void*>(slab.base + offset);
+    }
+    if (slab.size - slab.bump >= size) {
+        size_t offset = slab.bump;
+        slab.bump += size;
+        slab.used_blocks.emplace(offset, size);
+        return reinterpret_cast<void*>(slab.base + offset);
+    }
+    return nullptr;
+}
+
+void slab_free(Slab& slab, size_t offset, size_t size) {
+    slab.used_blocks.erase(offset);
+
+    // Merge with neighbouring free blocks.
+    auto next = slab.free_blocks.lower_bound(offset);
+    if (next != slab.free_blocks.end() && offset + size == next->first) {
+        size += next->second;
+        next = slab.free_blocks.erase(next);
+    }
+    if (next != slab.free_blocks.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            slab.free_blocks.erase(prev);
+        }
+    }
+    // A free block touching the bump pointer simply gives the space back to it.
+    if (offset + size == slab.bump) {
+        slab.bump = offset;
+    } else {
+        slab.free_blocks.emplace(offset, size);
+    }
+}
+
+Slab* find_slab(Pool& p, uintptr_t address) {
+    auto it = p.slabs.upper_bound(address);
+    if (it == p.slabs.begin()) return nullptr;
+    --it;
+    Slab* slab = it->second.get();
+    return address < slab->base + slab->size ? slab : nullptr;
+}
+
+// Gives the calling (child) process its own copy of a dual mapping, at the same two
+// addresses: pointers into either view that hooks keep stay valid. Returns false if the
+// mapping is still shared with the parent.
+bool make_private(uintptr_t base, uintptr_t write_base, size_t size) {
+    int fd = static_cast<int>(syscall(__NR_memfd_create, "urhook-code", MFD_CLOEXEC));
+    if (fd < 0) return false;
+    bool ok = false;
+    void* copy = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        copy = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (copy != MAP_FAILED) {
+        std::memcpy(copy, reinterpret_cast<void*>(write_base), size);
+        // Each MAP_FIXED mmap replaces one view of the parent's memfd with the copy
+        ok = mmap(reinterpret_cast<void*>(write_base), size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+             mmap(reinterpret_cast<void*>(base), size, PROT_READ | PROT_EXEC,
+                  MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+        munmap(copy, size);
+    }
+    close(fd);
+    if (ok) cache_maintenance::sync_code(base, write_base, size);
+    return ok;
+}
+
+// pthread_atfork child handler. Dual mappings are MAP_SHARED, so without this the child
+// would run from, and write to, the same pages as its parent. Each one is replaced by a
+// private copy; one that cannot be is marked inherited, so its blocks are never reused.
+// A mutex held by another thread at the fork leaves the pool unusable in the child, and
+// nothing can be written through it then.
+void remap_after_fork() {
+    auto& p = pool();
+    const bool locked = p.locked_for_fork;
+    if (!locked && !p.mutex.try_lock()) return;
+    for (auto& [base, slab] : p.slabs) {
+        if (slab->write_base == slab->base) continue;
+        slab->inherited = !make_private(slab->base, slab->write_base, slab->size);
+    }
+    for (auto& [base, dedicated] : p.dedicated) {
+        if (dedicated.write_base == base) continue;
+        dedicated.inherited = !make_private(base, dedicated.write_base, dedicated.size);
+    }
+    if (!locked) p.mutex.unlock();
+}
+
+// Dual mappings are MAP_SHARED, so a forked process shares them with its parent: writes
+// to a block show up in both. Blocks handed out before the fork therefore must not be
+// handed out again, and empty slabs must not be unmapped while the other process may
+// still run code from them. RWX mappings are private and stay reusable.
+void mark_pool_inherited() {
+    auto& p = pool();
+    for (auto& [base, slab] : p.slabs) {
+        if (slab->write_base != slab->base) slab->inherited = true;
+    }
+    for (auto& [base, dedicated] : p.dedicated) {
+        if (dedicated.write_base != base) dedicated.inherited = true;
+    }
+}
+
+void verify_pool(fork_safety::InheritedState& state) {
+    state.shared_bytes += get_stats().inherited_bytes;
+}
+
+[[maybe_unused]] const bool g_fork_participant = fork_safety::add_participant({
+    fork_safety::Rank::Memory,
+    [] {
+        pool().mutex.lock();
+        pool().locked_for_fork = true;
+    },
+    [] {
+        pool().locked_for_fork = false;
+        pool().mutex.unlock();
+    },
+    mark_pool_inherited,
+    verify_pool,
+});
+
+} // namespace
+
+void* allocate(size_t size, uintptr_t near, size_t max_distance) {
+    if (size == 0) return nullptr;
+    size = align_up(size, kAlignment);
+
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    const size_t slab_size = align_up(kSlabSize, page_size());
+
+    // Large blocks get their own mapping; they would only fragment the slabs.
+    if (size > slab_size / 4) {
+        size_t mapping_size = align_up(size, page_size());
+        Mapping mapping;
+        if (!map_region(p, mapping_size, near, max_distance, mapping)) return nullptr;
+        p.dedicated.emplace(mapping.base, Dedicated{mapping_size, mapping.write_base});
+        p.bytes_in_use += mapping_size;
+        return reinterpret_cast<void*>(mapping.base);
+    }
+
+    // Try existing slabs that are completely inside the requested window.
+    auto first = p.slabs.begin();
+    auto last = p.slabs.end();
+    if (near) {
+        uintptr_t low = near > max_distance ? near - max_distance : 0;
+        first = p.slabs.lower_bound(low);
+        last = p.slabs.upper_bound(near + max_distance);
+    }
+    for (auto it = first; it != last; ++it) {
+        Slab& slab = *it->second;
+        if (slab.inherited) continue;
+        if (near && !range_within(slab.base, slab.size, near, max_distance)) continue;
+        if (void* mem = slab_allocate(slab, size)) {
+            p.bytes_in_use += size;
+            return mem;
+        }
+    }
+
+    // No room: map a new slab in the window.
+    Mapping mapping;
+    if (!map_region(p, slab_size, near, max_distance, mapping)) return nullptr;
+
+    auto slab = std::make_unique<Slab>();
+    slab->base = mapping.base;
+    slab->write_base = mapping.write_base;
+    slab->size = slab_size;
+    void* block = slab_allocate(*slab, size);
+    p.slabs.emplace(slab->base, std::move(slab));
+    p.bytes_in_use += size;
+    return block;
+}
+
+void free(void* ptr) {
+    if (ptr == nullptr) return;
+    auto address = reinterpret_cast<uintptr_t>(ptr);
+
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    auto dedicated = p.dedicated.find(address);
+    if (dedicated != p.dedicated.end()) {
+        if (dedicated->second.inherited) return;
+        unmap_region(address, dedicated->second.write_base, dedicated->second.size);
+        p.bytes_in_use -= dedicated->second.size;
+        p.dedicated.erase(dedicated);
+        return;
+    }
+
+    Slab* slab = find_slab(p, address);
+    if (!slab || slab->inherited) return;
+    size_t offset = address - slab->base;
+    auto used = slab->used_blocks.find(offset);
+    if (used == slab->used_blocks.end()) return;
+
+    size_t size = used->second;
+    slab_free(*slab, offset, size);
+    p.bytes_in_use -= size;
+
+    if (slab->used_blocks.empty()) {
+        unmap_region(slab->base, slab->write_base, slab->size);
+        p.slabs.erase(slab->base);
+    }
+}
+
+size_t block_size(const void* ptr) {
+    if (ptr == nullptr) return 0;
+    auto address = reinterpret_cast<uintptr_t>(ptr);
+
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    auto dedicated = p.dedicated.find(address);
+    if (dedicated != p.dedicated.end()) return dedicated->second.size;
+
+    Slab* slab = find_slab(p, address);
+    if (!slab) return 0;
+    auto used = slab->used_blocks.find(address - slab->base);
+    return used == slab->used_blocks.end() ? 0 : used->second;
+}
+
+bool contains(uintptr_t address, size_t size) {
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    if (Slab* slab = find_slab(p, address)) {
+        return address + size <= slab->base + slab->size;
+    }
+    auto it = p.dedicated.upper_bound(address);
+    if (it == p.dedicated.begin()) return false;
+    --it;
+    return address + size <= it->first + it->second.size;
+}
+
+void* writable(const void* ptr) {
+    if (ptr == nullptr) return nullptr;
+    auto address = reinterpret_cast<uintptr_t>(ptr);
+
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    if (Slab* slab = find_slab(p, address)) {
+        return reinterpret_cast<void*>(slab->write_base + (address - slab->base));
+    }
+    auto it = p.dedicated.upper_bound(address);
+    if (it == p.dedicated.begin()) return nullptr;
+    --it;
+    if (address >= it->first + it->second.size) return nullptr;
+    return reinterpret_cast<void*>(it->second.write_base + (address - it->first));
+}
+
+void write_code(void* code, const void* data, size_t size) {
+    if (size == 0) return;
+    auto* view = static_cast<char*>(writable(code));
+    if (view == nullptr) return;
+    std::memcpy(view, data, size);
+    // Clean the lines through the view that was written, then invalidate the executable range.
+    cache_maintenance::sync_code(reinterpret_cast<uintptr_t>(code), reinterpret_cast<uintptr_t>(view), size);
+}
+
+bool is_inherited(const void* ptr) {
+    if (ptr == nullptr) return false;
+    auto address = reinterpret_cast<uintptr_t>(ptr);
+
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    if (Slab* slab = find_slab(p, address)) return slab->inherited;
+    auto it = p.dedicated.upper_bound(address);
+    if (it == p.dedicated.begin()) return false;
+    --it;
+    return address < it->first + it->second.size && it->second.inherited;
+}
+
+bool is_dual_mapped() {
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.dual_mapping;
+}
+
+std::vector<Range> executable_ranges() {
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    std::vector<Range> ranges;
+    ranges.reserve(p.slabs.size() + p.dedicated.size());
+    for (const auto& [base, slab] : p.slabs) ranges.push_back({base, base + slab->size});
+    for (const auto& [base, dedicated] : p.dedicated) ranges.push_back({base, base + dedicated.size});
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.start < b.start; });
+    return ranges;
+}
+
+Stats get_stats() {
+    auto& p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    Stats stats;
+    stats.slab_count = p.slabs.size();
+    stats.bytes_in_use = p.bytes_in_use;
+    for (const auto& [base, slab] : p.slabs) {
+        stats.bytes_reserved += slab->size;
+        stats.allocation_count += slab->used_blocks.size();
+        if (slab->write_base != slab->base) stats.dual_mapped_bytes += slab->size;
+        if (slab->inherited) stats.inherited_bytes += slab->size;
+    }
+    for (const auto& [base, dedicated] : p.dedicated) {
+        stats.bytes_reserved += dedicated.size;
+        stats.allocation_count += 1;
+        if (dedicated.write_base != base) stats.dual_mapped_bytes += dedicated.size;
+        if (dedicated.inherited) stats.inherited_bytes += dedicated.size;
+    }
+    return stats;
+}
+
+} // namespace ur::exec_pool
@@ -0,0 +1,122 @@
+#include "ur/fork_safety.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace ur::fork_safety {
+
+namespace {
+
+struct State {
+    // Guards everything below. The prepare handler keeps it locked until the parent or
+    // child handler runs, so fork() cannot interleave with enable() or mark_inherited().
+    std::mutex mutex;
+    std::vector<Participant> participants; // Sorted by rank, in registration order within a rank
+    ForkOptions options;
+    bool installed = false; // pthread_atfork() handlers registered
+    bool enabled = false;
+    bool locked = false;    // The prepare handler took the participants' locks
+};
+
+State& state() {
+    // Intentionally leaked: participants register from static initializers of other
+    // translation units and fork() may still run during static destruction.
+    static State* instance = new State();
+    return *instance;
+}
+
+// Caller must hold State::mutex.
+void lock_all(State& s) {
+    for (const auto& participant : s.participants) {
+        participant.lock();
+    }
+}
+
+void unlock_all(State& s) {
+    for (auto it = s.participants.rbegin(); it != s.participants.rend(); ++it) {
+        it->unlock();
+    }
+}
+
+// Caller must hold State::mutex and every participant's lock.
+void mark_all(State& s) {
+    for (const auto& participant : s.participants) {
+        if (participant.mark_inherited) participant.mark_inherited();
+    }
+}
+
+void prepare() {
+    auto& s = state();
+    s.mutex.lock();
+    if (!s.enabled) return;
+    lock_all(s);
+    s.locked = true;
+    if (s.options.mark_inherited) mark_all(s);
+}
+
+// Runs in the parent and in the child; the child is a copy of the forking thread, so it
+// may release the locks that thread took.
+void release() {
+    auto& s = state();
+    if (s.locked) {
+        unlock_all(s);
+        s.locked = false;
+    }
+    s.mutex.unlock();
+}
+
+} // namespace
+
+void enable(const ForkOptions& options) {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.options = options;
+    s.enabled = true;
+    if (!s.installed) {
+        s.installed = pthread_atfork(prepare, release, release) == 0;
+    }
+}
+
+void disable() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.enabled = false;
+}
+
+bool is_enabled() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.enabled && s.installed;
+}
+
+void mark_inherited() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    lock_all(s);
+    mark_all(s);
+    unlock_all(s);
+}
+
+InheritedState verify_inherited() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    InheritedState result;
+    for (const auto& participant : s.participants) {
+        if (participant.verify) participant.verify(result);
+    }
+    return result;
+}
+
+bool add_participant(const Participant& participant) {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto position = std::upper_bound(s.participants.begin(), s.participants.end(), participant.rank,
+        [](Rank rank, const Participant& other) { return rank < other.rank; });
+    s.participants.insert(position, participant);
+    return true;
+}
+
+} // namespace ur::fork_safety
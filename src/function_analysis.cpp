@@ -0,0 +1,335 @@
+#include "ur/function_analysis.h"
+#include "ur/disassembler.h"
+#include "ur/elf_parser.h"
+#include "ur/fork_safety.h"
+#include "ur/memory.h"
+#include "ur/module_registry.h"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ur::function_analysis {
+
+namespace {
+
+// 没有符号时最多向后扫描的字节数
+constexpr size_t kMaxSweepBytes = 16 * 1024;
+
+// 按符号分析的结果记录其所在模块，模块被 dlclose 后（包括同一基址被另一个模块复用）丢弃
+struct Entry {
+    std::shared_ptr<const Function> function;
+    uintptr_t module_base = 0; // 0 表示边界由调用者给出，不随模块失效（见 invalidate()）
+    std::string module_path;
+};
+
+struct Cache {
+    std::mutex mutex;
+    std::map<uintptr_t, Entry> functions; // 按起始地址
+    unsigned long long loader_subs = 0;   // 上次清理时装载器的卸载计数
+    bool has_counter = false;
+};
+
+Cache& cache() {
+    // 有意泄漏：Hook 可能在静态析构期间才被移除
+    static Cache* instance = new Cache();
+    return *instance;
+}
+
+// fork 前后持有缓存锁（见 ur::fork_safety）
+[[maybe_unused]] const bool g_fork_participant = fork_safety::add_participant({
+    fork_safety::Rank::Caches,
+    [] { cache().mutex.lock(); },
+    [] { cache().mutex.unlock(); },
+});
+
+// 有模块被卸载时丢弃不再装载的模块中的结果；同一基址上路径不同的模块视为已被替换。
+// 主程序的 dlpi_name 可能为空，此时只比较基址
+void sweep_unloaded(Cache& state) {
+    unsigned long long adds = 0;
+    unsigned long long subs = 0;
+    const bool has_counters = module_registry::read_loader_counters(adds, subs);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (has_counters && state.has_counter && subs == state.loader_subs) return;
+    }
+
+    // 遍历模块时不持有缓存锁（见 module_registry::enumerate_loaded()）
+    const auto current = module_registry::enumerate_loaded();
+    std::unordered_map<uintptr_t, std::string> loaded;
+    loaded.reserve(current.modules.size());
+    for (const auto& module : current.modules) loaded.emplace(module.base, module.path);
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.loader_subs = current.subs;
+    state.has_counter = current.has_counters;
+    for (auto it = state.functions.begin(); it != state.functions.end();) {
+        const Entry& entry = it->second;
+        bool stale = false;
+        if (entry.module_base != 0) {
+            auto module = loaded.find(entry.module_base);
+            stale = module == loaded.end() ||
+                    (!module->second.empty() && !entry.module_path.empty() && module->second != entry.module_path);
+        }
+        it = stale ? state.functions.erase(it) : std::next(it);
+    }
+}
+
+// 模块的解析器来自进程级注册表，与 plthook 等共用
+bool find_symbol_bounds(uintptr_t address, uintptr_t& start, size_t& size, Entry& module) {
+    Dl_info info{};
+    if (dladdr(reinterpret_cast<void*>(address), &info) == 0 || info.dli_fbase == nullptr) return false;
+    module.module_base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+    module.module_path = info.dli_fname ? info.dli_fname : "";
+    auto parser = module_registry::get(module.module_base);
+    return parser && parser->find_function(address, start, size);
+}
+
+bool is_block_end(disassembler::InstructionId id) {
+    using disassembler::InstructionId;
+    switch (id) {
+        case InstructionId::B:
+        case InstructionId::B_COND:
+        case InstructionId::CBZ:
+        case InstructionId::CBNZ:
+        case InstructionId::TBZ:
+        case InstructionId::TBNZ:
+        case InstructionId::BR:
+        case InstructionId::RET:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// 直接分支与 ADR 的目标地址（总是最后一个操作数），其他指令返回 false
+bool direct_target(const disassembler::DecodedInsn& insn, uintptr_t& target) {
+    using disassembler::InstructionId;
+    switch (insn.id) {
+        case InstructionId::B:
+        case InstructionId::BL:
+        case InstructionId::B_COND:
+        case InstructionId::CBZ:
+        case InstructionId::CBNZ:
+        case InstructionId::TBZ:
+        case InstructionId::TBNZ:
+        case InstructionId::ADR:
+            break;
+        default:
+            return false;
+    }
+    if (insn.operand_count == 0 || insn.operands[insn.operand_count - 1].type != disassembler::OperandType::IMMEDIATE) {
+        return false;
+    }
+    target = static_cast<uintptr_t>(insn.operands[insn.operand_count - 1].imm);
+    return true;
+}
+
+// [start, limit) 的线性扫描在第一个之后没有已知分支到达的 RET/BR/B 处结束
+uintptr_t sweep_end(uintptr_t start, uintptr_t limit) {
+    const auto* code = reinterpret_cast<const uint32_t*>(start);
+    uintptr_t furthest = start;
+    disassembler::DecodedInsn insn;
+    for (uintptr_t pc = start; pc + 4 <= limit; pc += 4) {
+        disassembler::decode(pc, code[(pc - start) / 4], insn);
+        uintptr_t target = 0;
+        if (insn.id != disassembler::InstructionId::BL && direct_target(insn, target) &&
+            target > pc && target < limit) {
+            furthest = std::max(furthest, target);
+        }
+        const bool unconditional = insn.id == disassembler::InstructionId::B ||
+                                   insn.id == disassembler::InstructionId::BR ||
+                                   insn.id == disassembler::InstructionId::RET;
+        if (unconditional && pc + 4 > furthest) return pc + 4;
+    }
+    return limit;
+}
+
+} // namespace
+
+class Builder {
+public:
+    static std::shared_ptr<const Function> build(uintptr_t start, uintptr_t end, bool symbol_bounds) {
+        auto function = std::make_shared<Function>();
+        function->m_start = start;
+        function->m_end = end;
+        function->m_symbol_bounds = symbol_bounds;
+
+        struct Terminator {
+            uintptr_t pc;
+            disassembler::InstructionId id;
+            uintptr_t target;
+        };
+        std::vector<Terminator> terminators;
+        std::vector<uintptr_t> leaders{start};
+        auto& targets = function->m_branch_targets;
+
+        const auto* code = reinterpret_cast<const uint32_t*>(start);
+        disassembler::DecodedInsn insn;
+        for (uintptr_t pc = start; pc + 4 <= end; pc += 4) {
+            disassembler::decode(pc, code[(pc - start) / 4], insn);
+            uintptr_t target = 0;
+            const bool direct = direct_target(insn, target);
+            if (direct && function->contains(target) && (target & 3) == 0) {
+                targets.push_back(target);
+            }
+            if (!is_block_end(insn.id)) continue;
+
+            if (insn.id == disassembler::InstructionId::BR) function->m_indirect_branches = true;
+            terminators.push_back({pc, insn.id, direct ? target : 0});
+            if (pc + 4 < end) leaders.push_back(pc + 4);
+        }
+
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+        leaders.insert(leaders.end(), targets.begin(), targets.end());
+        std::sort(leaders.begin(), leaders.end());
+        leaders.erase(std::unique(leaders.begin(), leaders.end()), leaders.end());
+
+        // 块的最后一条指令决定后继；terminators 按地址有序
+        auto& blocks = function->m_blocks;
+        blocks.reserve(leaders.size());
+        auto terminator = terminators.begin();
+        for (size_t i = 0; i < leaders.size(); ++i) {
+            BasicBlock block;
+            block.start = leaders[i];
+            block.end = i + 1 < leaders.size() ? leaders[i + 1] : end;
+
+            while (terminator != terminators.end() && terminator->pc + 4 < block.end) ++terminator;
+            const bool terminated = terminator != terminators.end() && terminator->pc + 4 == block.end;
+            auto add_successor = [&](uintptr_t address) {
+                if (function->contains(address)) block.successors[block.successor_count++] = address;
+            };
+
+            if (!terminated) {
+                add_successor(block.end);
+            } else {
+                using disassembler::InstructionId;
+                switch (terminator->id) {
+                    case InstructionId::RET:
+                    case InstructionId::BR:
+                        block.exits = true;
+                        break;
+                    case InstructionId::B:
+                        if (function->contains(terminator->target)) {
+                            add_successor(terminator->target);
+                        } else {
+                            block.exits = true;
+                        }
+                        break;
+                    default: // 条件分支
+                        add_successor(block.end);
+                        if (terminator->target != block.end) add_successor(terminator->target);
+                        break;
+                }
+            }
+            blocks.push_back(block);
+        }
+        return function;
+    }
+};
+
+bool Function::is_branch_target(uintptr_t address) const {
+    return std::binary_search(m_branch_targets.begin(), m_branch_targets.end(), address);
+}
+
+const BasicBlock* Function::block_at(uintptr_t address) const {
+    if (!contains(address)) return nullptr;
+    auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), address,
+                               [](uintptr_t value, const BasicBlock& block) { return value < block.start; });
+    if (it == m_blocks.begin()) return nullptr;
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+size_t Function::max_patch_size(uintptr_t address, size_t limit) const {
+    if (!contains(address) || (address & 3) != 0 || limit < 4) return 0;
+
+    size_t size = 4;
+    // 下一个分支目标之前的字节都可以覆盖
+    auto next = std::upper_bound(m_branch_targets.begin(), m_branch_targets.end(), address);
+    const uintptr_t stop = next != m_branch_targets.end() ? std::min(*next, m_end) : m_end;
+    while (size + 4 <= limit && address + size + 4 <= stop) size += 4;
+    return size;
+}
+
+std::shared_ptr<const Function> analyze(uintptr_t address) {
+    auto& state = cache();
+    sweep_unloaded(state);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto it = state.functions.upper_bound(address);
+        if (it != state.functions.begin() && std::prev(it)->second.function->contains(address)) {
+            return std::prev(it)->second.function;
+        }
+    }
+
+    uintptr_t start = 0;
+    size_t size = 0;
+    Entry entry;
+    if (find_symbol_bounds(address, start, size, entry) && (start & 3) == 0) {
+        entry.function = Builder::build(start, start + (size & ~size_t(3)), true);
+        // 并发分析同一函数时保留先插入的结果
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.functions.emplace(start, std::move(entry)).first->second.function;
+    }
+
+    // 没有符号：从 address 开始扫描。堆、栈上的代码地址可能被复用，这类结果不缓存
+    memory::MappedRegion region;
+    if ((address & 3) != 0 || !memory::find_mapped_region(address, region) ||
+        region.perms.empty() || region.perms[0] != 'r') {
+        return nullptr;
+    }
+    const uintptr_t limit = address + std::min<uintptr_t>(region.end - address, kMaxSweepBytes);
+    return Builder::build(address, sweep_end(address, limit), false);
+}
+
+std::shared_ptr<const Function> analyze(uintptr_t start, size_t size) {
+    if (size < 4 || (start & 3) != 0) return nullptr;
+
+    auto& state = cache();
+    sweep_unloaded(state);
+    const uintptr_t end = start + (size & ~size_t(3));
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto it = state.functions.find(start);
+        if (it != state.functions.end() && it->second.function->end() == end) return it->second.function;
+    }
+
+    Entry entry;
+    entry.function = Builder::build(start, end, false);
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto& slot = state.functions[start];
+    slot = std::move(entry);
+    return slot.function;
+}
+
+void invalidate(uintptr_t start, size_t size) {
+    auto& state = cache();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const uintptr_t end = start + size;
+    auto it = state.functions.lower_bound(start);
+    if (it != state.functions.begin() && std::prev(it)->second.function->end() > start) --it;
+    while (it != state.functions.end() && it->first < end) {
+        it = state.functions.erase(it);
+    }
+}
+
+void clear_cache() {
+    auto& state = cache();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.functions.clear();
+}
+
+size_t cache_size() {
+    auto& state = cache();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.functions.size();
+}
+
+} // namespace ur::function_analysis
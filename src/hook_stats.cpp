@@ -0,0 +1,248 @@
+#include "ur/hook_stats.h"
+#include "ur/exec_pool.h"
+#include "ur/fork_safety.h"
+
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#ifndef HWCAP_ATOMICS
+#define HWCAP_ATOMICS (1 << 8)
+#endif
+
+namespace ur::hook_stats {
+
+using assembler::Register;
+
+namespace {
+
+// 2^64 / φ：乘法把线程指针所有位的差异扩散到高位，取最高 kShardBits 位作为分片号
+constexpr uint64_t kFibonacciMultiplier = 0x9E3779B97F4A7C15ull;
+
+constexpr uint32_t kCacheLineShift = 6;
+
+static_assert(sizeof(Counter::Shard) == kCacheLineSize, "Shards must not share cache lines");
+static_assert((size_t{1} << kCacheLineShift) == kCacheLineSize);
+
+} // namespace
+
+// 计数器与计数 thunk 只分配不释放，移除的 Hook 归还后供新 Hook 复用
+class Registry {
+public:
+    static Registry& instance() {
+        // Intentionally leaked, like the counters themselves
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    Counter* acquire(HookKind kind, uintptr_t address, std::string_view name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Counter* counter = nullptr;
+        if (!free_counters_.empty()) {
+            counter = free_counters_.back();
+            free_counters_.pop_back();
+        } else {
+            counter = new Counter();
+            counters_.push_back(counter);
+        }
+        activate(*counter, kind, address, name);
+        return counter;
+    }
+
+    void release(Counter* counter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counter->active_ = false;
+        free_counters_.push_back(counter);
+    }
+
+    // Returns a thunk whose counter is already activated, or one with code == nullptr.
+    CountingThunk acquire_thunk(HookKind kind, uintptr_t address, std::string_view name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CountingThunk thunk;
+        if (!free_thunks_.empty()) {
+            thunk = free_thunks_.back();
+            free_thunks_.pop_back();
+            activate(*thunk.counter, kind, address, name);
+        }
+        return thunk;
+    }
+
+    // Lists a freshly built thunk's counter; the counter is not shared with acquire().
+    Counter* new_thunk_counter(HookKind kind, uintptr_t address, std::string_view name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto* counter = new Counter();
+        counters_.push_back(counter);
+        activate(*counter, kind, address, name);
+        return counter;
+    }
+
+    // 与其他进程共享的 thunk 只停用计数器，不再复用（见 ur::fork_safety）
+    void release_thunk(const CountingThunk& thunk, bool recycle) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        thunk.counter->active_ = false;
+        if (recycle) free_thunks_.push_back(thunk);
+    }
+
+    std::vector<HookStats> snapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<HookStats> result;
+        for (const Counter* counter : counters_) {
+            if (!counter->active_) continue;
+            result.push_back({counter->kind_, counter->address_, counter->name_, counter->calls()});
+        }
+        return result;
+    }
+
+    void reset_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Counter* counter : counters_) {
+            if (counter->active_) counter->reset();
+        }
+    }
+
+    void lock_for_fork() { mutex_.lock(); }
+    void unlock_after_fork() { mutex_.unlock(); }
+
+    // fork 前空闲的 thunk 可能位于共享内存，复用时改写目标会影响其他进程；持有 mutex_ 时调用
+    void drop_free_thunks() { free_thunks_.clear(); }
+
+private:
+    // Caller must hold mutex_.
+    static void activate(Counter& counter, HookKind kind, uintptr_t address, std::string_view name) {
+        counter.reset();
+        counter.kind_ = kind;
+        counter.address_ = address;
+        counter.name_.assign(name);
+        counter.active_ = true;
+    }
+
+    std::mutex mutex_;
+    std::vector<Counter*> counters_; // Every counter ever created, in creation order
+    std::vector<Counter*> free_counters_;
+    std::vector<CountingThunk> free_thunks_;
+};
+
+namespace {
+
+[[maybe_unused]] const bool g_fork_participant = fork_safety::add_participant({
+    fork_safety::Rank::Caches,
+    [] { Registry::instance().lock_for_fork(); },
+    [] { Registry::instance().unlock_after_fork(); },
+    [] { Registry::instance().drop_free_thunks(); },
+});
+
+} // namespace
+
+uint64_t Counter::calls() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.calls.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Counter::reset() {
+    for (auto& shard : shards_) {
+        shard.calls.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::vector<HookStats> snapshot() {
+    return Registry::instance().snapshot();
+}
+
+void reset_all() {
+    Registry::instance().reset_all();
+}
+
+Counter* acquire_counter(HookKind kind, uintptr_t address, std::string_view name) {
+    return Registry::instance().acquire(kind, address, name);
+}
+
+void release_counter(Counter* counter) {
+    if (counter == nullptr) return;
+    Registry::instance().release(counter);
+}
+
+bool has_lse_atomics() {
+#if defined(__linux__)
+    static const bool supported = (getauxval(AT_HWCAP) & HWCAP_ATOMICS) != 0;
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void emit_increment(jit::Jit& jit, const Counter& counter, Register address, Register scratch) {
+    // 线程指针哈希为分片号：address = shards + (hash(tpidr_el0) >> (64 - kShardBits)) * kCacheLineSize
+    jit.mrs(address, assembler::SystemRegister::TPIDR_EL0);
+    jit.ldr_constant(scratch, kFibonacciMultiplier);
+    jit.mul(address, address, scratch);
+    jit.lsr(address, address, 64 - kShardBits);
+    jit.ldr_constant(scratch, reinterpret_cast<uint64_t>(counter.shards()));
+    jit.add(address, scratch, address, 0, kCacheLineShift);
+
+    jit.mov(scratch, 1);
+    if (has_lse_atomics()) {
+        jit.stadd(scratch, address);
+        return;
+    }
+
+    // 没有 LSE 时用独占访问循环，状态寄存器 x14 临时保存在栈上
+    jit.stp(Register::X14, Register::X15, Register::SP, -16, true);
+    jit::Label retry;
+    jit.bind(retry);
+    jit.ldxr(Register::X15, address);
+    jit.add(Register::X15, Register::X15, scratch);
+    jit.stxr(Register::W14, Register::X15, address);
+    jit.cbnz(Register::W14, retry);
+    jit.ldp(Register::X14, Register::X15, Register::SP, 16, true);
+}
+
+CountingThunk acquire_counting_thunk(HookKind kind, uintptr_t address, uintptr_t destination,
+                                     std::string_view name) {
+    auto& registry = Registry::instance();
+    CountingThunk thunk = registry.acquire_thunk(kind, address, name);
+    if (thunk.code == nullptr) {
+        Counter* counter = registry.new_thunk_counter(kind, address, name);
+        try {
+            jit::Jit jit;
+            jit::Label destination_slot;
+            emit_increment(jit, *counter, Register::X16, Register::X17);
+            jit.ldr_literal(Register::X16, destination_slot);
+            jit.br(Register::X16);
+            if (jit.get_code_size() % sizeof(uint64_t) != 0) jit.nop();
+            jit.bind(destination_slot);
+            jit.emit_quad(0);
+
+            auto* code = jit.finalize<uint8_t*>();
+            if (code == nullptr) throw std::runtime_error("Failed to allocate counting thunk memory");
+            jit.release();
+
+            thunk.code = code;
+            thunk.destination_slot = static_cast<uint64_t*>(exec_pool::writable(code + destination_slot.offset()));
+            thunk.counter = counter;
+        } catch (...) {
+            // No code references the counter yet, so it can serve acquire_counter() instead.
+            registry.release(counter);
+            throw;
+        }
+    }
+    set_destination(thunk, destination);
+    return thunk;
+}
+
+void set_destination(const CountingThunk& thunk, uintptr_t destination) {
+    __atomic_store_n(thunk.destination_slot, static_cast<uint64_t>(destination), __ATOMIC_RELEASE);
+}
+
+void release_counting_thunk(CountingThunk& thunk) {
+    if (thunk.code == nullptr) return;
+    Registry::instance().release_thunk(thunk, !exec_pool::is_inherited(thunk.code));
+    thunk = CountingThunk{};
+}
+
+} // namespace ur::hook_stats
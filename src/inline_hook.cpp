@@ -2,31 +2,58 @@
 #include "ur/memory.h"
 #include "ur/assembler.h"
 #include "ur/disassembler.h"
-
+#include "ur/exec_pool.h"
+#include "ur/fork_safety.h"
+#include "ur/function_analysis.h"
+#include "ur/jit.h"
+#include "ur/recursion_guard.h"
+#include "ur/hook_stats.h"
+#include "ur/thread_suspend.h"
+#include "ur/trampoline_cache.h"
+#include "ur/module_registry.h"
+#include "ur/elf_parser.h"
+
+#include <array>
 #include <map>
+#include <span>
+#include <unordered_map>
 #include <mutex>
 #include <list>
 #include <stdexcept>
 #include <algorithm>
-#include <sys/mman.h>
 #include <cstring>
-#include <unistd.h>
+
+#include <dlfcn.h>
 
 namespace ur::inline_hook {
 
 // --- Helper Functions & Data Structures ---
 
-namespace {
+// Entry thunk of a hook created with HookOptions::recursion_guard, see acquire_guard_thunk().
+struct GuardThunk {
+    void* code = nullptr;
+    uint64_t* callback_slot = nullptr; // Writable views of the thunk's data slots
+    uint64_t* bypass_slot = nullptr;
+};
 
 // Represents a single link in the hook chain.
 struct HookEntry {
     Hook* owner = nullptr; // Back-pointer to the Hook object
     Hook::Callback callback = nullptr;
-    void* call_next = nullptr; // Address to call for the "original" function
+    size_t link = 0;       // Index of this hook's link in the target's dispatch table
     bool is_enabled = true;
+    GuardThunk guard{};    // Routed to instead of the callback when guard.code is set
+    hook_stats::CountingThunk counter{}; // Routed to before the guard or callback when counter.code is set
 };
 
+// Longest patch sequence written at a target: the absolute jump (MOVZ/MOVK×4 + BR)
+constexpr size_t kMaxPatchWords = assembler::Assembler::ABS_JUMP_SIZE / sizeof(uint32_t);
+
+constexpr uint32_t kNopWord = 0xD503201F;
+
 // Holds all information about a hooked target address.
+// Shared between the registry and every Hook on the target; `trampoline` is
+// written once while the first hook is being built and is immutable afterwards.
 struct HookInfo {
     uintptr_t target_address = 0;
     std::list<HookEntry> entries; // A list to represent the call chain
@@ -35,182 +62,132 @@ struct HookInfo {
     // Trampoline that holds relocated original instructions and jumps back
     void* trampoline = nullptr;
     size_t backup_size = 0;
+    // Trampoline offset of the code that replaces each original word of the backup,
+    // used to move suspended threads out of the patched bytes (see BatchOptions)
+    std::array<uint16_t, kMaxPatchWords + 1> relocated_offsets{};
 
     // Minimal patch strategy: detour stub and target patch information
     void* detour_stub = nullptr;             // Near stub that always receives the target jump
-    size_t detour_stub_size = 0;             // Size of stub code (bytes)
+    size_t detour_stub_size = 0;             // Size of stub code (bytes), 0 until the stub is built
+    uint64_t* detour_slot = nullptr;         // Writable view of the stub's destination slot
     size_t patch_size_at_target = 0;         // Size of the chosen patch sequence at target (bytes)
-    std::vector<uint32_t> target_patch_code; // Cached patch sequence words (uint32_t instructions)
-
-    std::mutex info_mutex;
-};
-
-// Global map to manage all active hooks.
-static std::map<uintptr_t, std::unique_ptr<HookInfo>> g_hooks;
-static std::mutex g_hooks_mutex;
-
-void* allocate_executable_memory(size_t size) {
-    long page_size = sysconf(_SC_PAGESIZE);
-    size_t aligned_size = (size + page_size - 1) & -page_size;
-    void* mem = mmap(nullptr, aligned_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-    return mem == MAP_FAILED ? nullptr : mem;
-}
+    std::array<uint32_t, kMaxPatchWords> target_patch_code{}; // Cached patch sequence words
+    size_t target_patch_words = 0;           // 0 when no sequence is cached (patched directly)
 
-void free_executable_memory(void* mem, size_t size) {
-    if (mem) {
-        long page_size = sysconf(_SC_PAGESIZE);
-        size_t aligned_size = (size + page_size - 1) & -page_size;
-        munmap(mem, aligned_size);
-    }
-}
+    bool target_patched = false; // Whether the target currently jumps away from the original code
+    bool switchable = false;     // Keep the target patched while no hook is enabled (see HookOptions)
+    // Hooked before a fork (see ur::fork_safety): the stub and dispatch table may be shared
+    // with other processes and must not be written. Only set with every shard locked.
+    bool inherited = false;
 
- // Hint-based executable memory allocation (single attempt, no maps scanning)
-void* allocate_executable_memory_hint(size_t size, uintptr_t hint) {
-    long page_size = sysconf(_SC_PAGESIZE);
-    size_t aligned_size = (size + page_size - 1) & -page_size;
-    uintptr_t aligned_hint = hint ? (hint & ~(static_cast<uintptr_t>(page_size) - 1)) : 0;
-    void* addr_hint = aligned_hint ? reinterpret_cast<void*>(aligned_hint) : nullptr;
-    void* mem = mmap(addr_hint, aligned_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-    return mem == MAP_FAILED ? nullptr : mem;
-}
+    // Dispatch table: one link per hook, see acquire_link()
+    std::vector<void*> dispatch_blocks;
+    std::vector<uint64_t*> dispatch_slots; // Writable view of each block's slot array
+    std::vector<size_t> free_links;
 
-// Bounded near-allocation without maps scanning, tries symmetric hints around target.
-// If MAP_FIXED_NOREPLACE is available, it will be used to request exact placement safely.
-// Otherwise, it uses hints and validates the returned address is within max_distance;
-// if not, it unmaps and continues.
-void* allocate_executable_memory_near(uintptr_t target, size_t size, size_t max_distance) {
-    long page_size = sysconf(_SC_PAGESIZE);
-    size_t aligned_size = (size + page_size - 1) & -page_size;
+    std::mutex info_mutex;
+};
 
-    uintptr_t base = target & ~(static_cast<uintptr_t>(page_size) - 1);
+namespace {
 
-    // Probe parameters: 1MB step, up to 256 symmetric probes (~256MB span).
-    constexpr uintptr_t kStep = 1ull << 20; // 1MB
-    const size_t max_probes = std::min<size_t>(256, (max_distance / kStep) + 1);
+// Registry of hooked targets, split into shards so that only hooks whose targets
+// land in the same shard contend. It is only consulted when a hook is created or
+// removed; Hook objects keep a shared_ptr to their HookInfo for everything else.
+// Lock order: shard mutex, then HookInfo::info_mutex.
+constexpr size_t kRegistryShardBits = 6;
+constexpr size_t kRegistryShards = size_t{1} << kRegistryShardBits;
 
-    auto within_window = [&](uintptr_t addr) -> bool {
-        uintptr_t a = addr;
-        uintptr_t t = target;
-        uintptr_t dist = (a > t) ? (a - t) : (t - a);
-        return dist <= max_distance;
-    };
+struct RegistryShard {
+    std::mutex mutex;
+    std::unordered_map<uintptr_t, std::shared_ptr<HookInfo>> hooks;
+};
 
-    for (size_t i = 0; i < max_probes; ++i) {
-        for (int dir = (i == 0 ? 0 : -1); dir <= 1; dir += 2) {
-            uintptr_t offset = i * kStep;
-            uintptr_t candidate = base;
-            if (dir < 0) {
-                if (base >= offset) candidate = base - offset;
-                else continue;
-            } else if (dir > 0) {
-                candidate = base + offset;
-            } else { // i == 0
-                candidate = base;
-            }
+RegistryShard g_registry[kRegistryShards];
 
-            void* addr = reinterpret_cast<void*>(candidate);
-            void* mem = nullptr;
-
-#ifdef MAP_FIXED_NOREPLACE
-            mem = mmap(addr, aligned_size,
-                       PROT_READ | PROT_WRITE | PROT_EXEC,
-                       MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED_NOREPLACE,
-                       -1, 0);
-            if (mem != MAP_FAILED) {
-                // Exact placement succeeded; ensure in window then return.
-                if (within_window(reinterpret_cast<uintptr_t>(mem))) {
-                    return mem;
-                } else {
-                    munmap(mem, aligned_size);
-                }
-            }
-#else
-            // Use hint; kernel may place elsewhere. Validate window on success.
-            mem = mmap(addr, aligned_size,
-                       PROT_READ | PROT_WRITE | PROT_EXEC,
-                       MAP_ANONYMOUS | MAP_PRIVATE,
-                       -1, 0);
-            if (mem != MAP_FAILED) {
-                if (within_window(reinterpret_cast<uintptr_t>(mem))) {
-                    return mem;
-                } else {
-                    munmap(mem, aligned_size);
-                }
-            }
-#endif
-        }
-    }
+size_t shard_index(uintptr_t target) {
+    // Fibonacci hashing; the low bits of code addresses are mostly alignment.
+    return static_cast<size_t>((static_cast<uint64_t>(target) * 0x9E3779B97F4A7C15ull) >> (64 - kRegistryShardBits));
+}
 
-    return nullptr;
+RegistryShard& shard_for(uintptr_t target) {
+    return g_registry[shard_index(target)];
 }
 
 // Patch target with provided machine code (uint32 words)
-bool patch_target_with_code(uintptr_t target, const std::vector<uint32_t>& code_words) {
+bool patch_target_with_code(uintptr_t target, std::span<const uint32_t> code_words) {
     const auto* patch_code = reinterpret_cast<const uint8_t*>(code_words.data());
     size_t patch_size = code_words.size() * sizeof(uint32_t);
     return memory::atomic_patch(target, patch_code, patch_size);
 }
 
-// Choose shortest feasible patch sequence from target -> dest
+// Choose shortest feasible patch sequence from target -> dest that fits in max_size bytes
 // Priority: B (4B) → ADRP+ADD+BR (12B) → ABS jump (20B)
-bool choose_patch_sequence(uintptr_t target, uintptr_t dest, std::vector<uint32_t>& out_code, size_t& out_patch_size) {
+// The encoding is picked with the assembler's range checks and emitted straight into
+// `out`, so choosing a patch neither allocates nor throws.
+bool choose_patch_sequence(uintptr_t target, uintptr_t dest, size_t max_size,
+                           std::array<uint32_t, kMaxPatchWords>& out, size_t& out_words) {
     using namespace ur::assembler;
-    // Try single B within ±128MB
-    try {
-        Assembler asm_b(target);
-        asm_b.b(dest);
-        out_code = asm_b.get_code();
-        out_patch_size = asm_b.get_code_size();
-        return true;
-    } catch (const std::runtime_error&) {
-        // fallthrough
+    Assembler assembler(target, out);
+    if (Assembler::can_encode_b(target, dest)) {
+        assembler.b(dest);
+    } else if (Assembler::can_encode_adrp(target, dest)) {
+        assembler.adrp(Register::X16, dest);
+        assembler.add(Register::X16, Register::X16, static_cast<uint16_t>(dest & 0xFFF), false);
+        assembler.br(Register::X16);
+    } else {
+        // MOVZ/MOVK×4 + BR
+        assembler.gen_abs_jump(dest, Register::X16);
     }
+    out_words = assembler.get_code_span().size();
+    return assembler.get_code_size() <= max_size;
+}
 
-    // Try ADRP + ADD + BR within ADRP page window
-    try {
-        Assembler asm_adrp(target);
-        asm_adrp.adrp(Register::X16, dest);
-        asm_adrp.add(Register::X16, Register::X16, static_cast<uint16_t>(dest & 0xFFF), false);
-        asm_adrp.br(Register::X16);
-        out_code = asm_adrp.get_code();
-        out_patch_size = asm_adrp.get_code_size();
-        return true;
-    } catch (const std::runtime_error&) {
-        // fallthrough
-    }
+// Number of bytes at the target that can be overwritten without spilling past the end of
+// its function or covering an instruction that a branch inside the function jumps to.
+// The analysis is cached per function, so hooking the same function again does not repeat it.
+size_t safe_patch_limit(uintptr_t target) {
+    auto function = function_analysis::analyze(target);
+    if (!function) return assembler::Assembler::ABS_JUMP_SIZE;
+    return function->max_patch_size(target, assembler::Assembler::ABS_JUMP_SIZE);
+}
 
-    // Fallback to ABS jump (MOVZ/MOVK×4 + BR)
-    Assembler asm_abs(target);
-    asm_abs.gen_abs_jump(dest, Register::X16);
-    out_code = asm_abs.get_code();
-    out_patch_size = asm_abs.get_code_size();
-    return true;
+// Detour stub layout: the jump destination lives in a data slot next to the code,
+//   ldr x16, #8 ; br x16 ; .quad destination
+// so re-routing the stub is a single 64-bit store with no code modification or cache maintenance.
+constexpr size_t kDetourStubSize = 16;
+constexpr size_t kDetourSlotOffset = 8;
+
+bool has_stub(const HookInfo& info) {
+    return info.detour_stub != nullptr && info.target_patch_words != 0;
 }
 
-// Build or update detour stub: absolute jump to detour_addr
-bool update_detour_stub(HookInfo& info, uintptr_t detour_addr) {
-    if (!info.detour_stub) return false;
+// Writes the stub code once; the slot starts out pointing at `detour_addr`.
+void build_detour_stub(HookInfo& info, uintptr_t detour_addr) {
     using namespace ur::assembler;
-    Assembler stub_asm(reinterpret_cast<uintptr_t>(info.detour_stub));
-    stub_asm.gen_abs_jump(detour_addr, Register::X16);
-    const auto& stub_code = stub_asm.get_code();
-
-    std::memcpy(info.detour_stub, stub_code.data(), stub_code.size() * sizeof(uint32_t));
-    info.detour_stub_size = stub_asm.get_code_size();
+    std::array<uint32_t, kDetourStubSize / sizeof(uint32_t)> stub_code;
+    Assembler stub_asm(reinterpret_cast<uintptr_t>(info.detour_stub), stub_code);
+    stub_asm.ldr_literal(Register::X16, kDetourSlotOffset);
+    stub_asm.br(Register::X16);
+    stub_asm.emit_quad(detour_addr);
+
+    exec_pool::write_code(info.detour_stub, stub_code.data(), sizeof(stub_code));
+    info.detour_stub_size = kDetourStubSize;
+    info.detour_slot = static_cast<uint64_t*>(exec_pool::writable(static_cast<char*>(info.detour_stub) + kDetourSlotOffset));
+}
 
-    __builtin___clear_cache(reinterpret_cast<char*>(info.detour_stub),
-                            reinterpret_cast<char*>(info.detour_stub) + info.detour_stub_size);
+// Re-routes the detour stub to detour_addr. The slot is naturally aligned, so threads
+// running through the stub observe either the old or the new destination.
+bool update_detour_stub(HookInfo& info, uintptr_t detour_addr) {
+    if (!info.detour_stub || info.detour_stub_size == 0) return false;
+    __atomic_store_n(info.detour_slot, static_cast<uint64_t>(detour_addr), __ATOMIC_RELEASE);
     return true;
 }
 
 bool patch_target(uintptr_t target, uintptr_t destination) {
-    assembler::Assembler assembler(target);
+    std::array<uint32_t, kMaxPatchWords> patch_code;
+    assembler::Assembler assembler(target, patch_code);
     assembler.gen_abs_jump(destination, assembler::Register::X16);
-    const auto& patch_code_vec = assembler.get_code();
-    const auto* patch_code = reinterpret_cast<const uint8_t*>(patch_code_vec.data());
-    size_t patch_size = patch_code_vec.size() * sizeof(uint32_t);
-
-    return memory::atomic_patch(target, patch_code, patch_size);
+    return patch_target_with_code(target, assembler.get_code_span());
 }
 
 bool restore_target(HookInfo& info) {
@@ -219,112 +196,162 @@ bool restore_target(HookInfo& info) {
 
 // --- Trampoline Relocation Logic ---
 
-// Relocates instructions from the target function to a trampoline.
-// Returns the relocated machine code.
-std::vector<uint32_t> relocate_trampoline(uintptr_t target, uintptr_t trampoline_addr, size_t& backup_size, size_t required_size) {
-    auto disassembler = disassembler::CreateAArch64Disassembler();
-    const uint8_t* code = reinterpret_cast<const uint8_t*>(target);
-    
-    auto instructions = disassembler->Disassemble(target, code, 100, 20); // Disassemble up to 20 instructions
-    if (instructions.empty()) {
-        throw std::runtime_error("Failed to disassemble target function");
-    }
+// Decodes the instructions a patch of `required_size` bytes overwrites into a relocation
+// plan. Every address in the plan is stored relative to the target, so the plan does not
+// depend on where the module or the trampoline is placed and can be cached on disk.
+trampoline_cache::Plan plan_relocation(uintptr_t target, size_t required_size) {
+    using disassembler::DecodedInsn;
+    using disassembler::InstructionId;
+    using disassembler::InstructionGroup;
+    using disassembler::OperandType;
+    using trampoline_cache::StepKind;
+
+    // Instructions are decoded one at a time, only as far as the patch reaches
+    // (plus one look-ahead for ADRP pairs), so a 4-byte patch costs a single decode.
+    constexpr size_t kMaxInstructions = 20;
+    const auto* code = reinterpret_cast<const uint32_t*>(target);
+
+    trampoline_cache::Plan plan;
+    plan.required_size = static_cast<uint32_t>(required_size);
+    size_t backup_size = 0;
 
-    assembler::Assembler tramp_asm(trampoline_addr);
-    backup_size = 0;
+    auto add_step = [&](StepKind kind, assembler::Register reg, uintptr_t address, uint8_t words = 1, uint8_t extra = 0) {
+        trampoline_cache::Step step;
+        step.kind = kind;
+        step.words = words;
+        step.extra = extra;
+        step.reg = static_cast<int32_t>(reg);
+        step.delta = static_cast<int64_t>(address - target);
+        plan.steps.push_back(step);
+    };
+    auto add_copy = [&](uint32_t raw) {
+        trampoline_cache::Step step;
+        step.raw = raw;
+        plan.steps.push_back(step);
+    };
+    // The step that replays a load/store based on an ADRP result through its absolute address.
+    // PRFM, register-offset forms and accesses not based on `base` are not paired.
+    auto access_kind = [](const DecodedInsn& insn, assembler::Register base, StepKind& kind) {
+        if (insn.operand_count < 2 || insn.operands[0].type != OperandType::REGISTER ||
+            insn.operands[1].type != OperandType::MEMORY || insn.operands[1].mem.base != base ||
+            insn.operands[1].mem.index != assembler::Register::INVALID) {
+            return false;
+        }
+        switch (insn.id) {
+            case InstructionId::LDR:
+            case InstructionId::LDR_FP: kind = StepKind::Load; return true;
+            case InstructionId::STR:
+            case InstructionId::STR_FP: kind = StepKind::Store; return true;
+            case InstructionId::LDRSW: kind = StepKind::LoadSigned; return true;
+            case InstructionId::LDRB: kind = StepKind::LoadByte; return true;
+            case InstructionId::LDRH: kind = StepKind::LoadHalf; return true;
+            case InstructionId::LDRSB: kind = StepKind::LoadSignedByte; return true;
+            case InstructionId::LDRSH: kind = StepKind::LoadSignedHalf; return true;
+            case InstructionId::STRB: kind = StepKind::StoreByte; return true;
+            case InstructionId::STRH: kind = StepKind::StoreHalf; return true;
+            default: return false;
+        }
+    };
 
-    for (size_t i = 0; i < instructions.size(); ++i) {
-        auto& current_insn = instructions[i];
+    DecodedInsn current_insn;
+    DecodedInsn next_insn;
+    for (size_t i = 0; backup_size < required_size && i < kMaxInstructions; ++i) {
+        disassembler::decode(target + i * 4, code[i], current_insn);
 
         if (current_insn.is_pc_relative) {
             // Handle ADRP instruction
-            if (current_insn.id == disassembler::InstructionId::ADRP) {
+            if (current_insn.id == InstructionId::ADRP) {
                 bool pair_relocated = false;
-                uintptr_t page_addr = std::get<int64_t>(current_insn.operands[1].value);
+                uintptr_t page_addr = current_insn.operands[1].imm;
 
-                if (i + 1 < instructions.size()) {
-                    auto& next_insn = instructions[i + 1];
-                    auto adrp_dest_reg = std::get<assembler::Register>(current_insn.operands[0].value);
-                    uintptr_t final_addr;
+                if (i + 1 < kMaxInstructions) {
+                    disassembler::decode(target + (i + 1) * 4, code[i + 1], next_insn);
+                    auto adrp_dest_reg = current_insn.operands[0].reg;
 
                     // Case 1: ADRP + ADD
-                    if (next_insn.id == disassembler::InstructionId::ADD && next_insn.operands.size() > 2 &&
-                        next_insn.operands[1].type == disassembler::OperandType::REGISTER && std::get<assembler::Register>(next_insn.operands[1].value) == adrp_dest_reg &&
-                        next_insn.operands[2].type == disassembler::OperandType::IMMEDIATE) {
+                    if (next_insn.id == InstructionId::ADD && next_insn.operand_count > 2 &&
+                        next_insn.operands[1].type == OperandType::REGISTER && next_insn.operands[1].reg == adrp_dest_reg &&
+                        next_insn.operands[2].type == OperandType::IMMEDIATE) {
 
-                        final_addr = page_addr + std::get<int64_t>(next_insn.operands[2].value);
-                        auto dest_reg = std::get<assembler::Register>(next_insn.operands[0].value);
-                        tramp_asm.gen_load_address(dest_reg, final_addr);
+                        add_step(StepKind::LoadAddress, next_insn.operands[0].reg, page_addr + next_insn.operands[2].imm, 2);
                         pair_relocated = true;
                     }
-                    // Case 2: ADRP + LDR/STR (memory access)
-                    else if ((next_insn.id == disassembler::InstructionId::LDR || next_insn.id == disassembler::InstructionId::STR) && next_insn.operands.size() > 1 &&
-                             next_insn.operands[1].type == disassembler::OperandType::MEMORY) {
-                        auto mem_op = std::get<disassembler::MemOperand>(next_insn.operands[1].value);
-                        if (mem_op.base == adrp_dest_reg) {
-                            final_addr = page_addr + mem_op.displacement;
-                            auto data_reg = std::get<assembler::Register>(next_insn.operands[0].value);
-
-                            tramp_asm.gen_load_address(assembler::Register::X16, final_addr);
-                            if (next_insn.id == disassembler::InstructionId::LDR) {
-                                tramp_asm.ldr(data_reg, assembler::Register::X16, 0);
-                            } else { // STR
-                                tramp_asm.str(data_reg, assembler::Register::X16, 0);
-                            }
-                            pair_relocated = true;
-                        }
+                    // Case 2: ADRP + load/store (memory access)
+                    else if (StepKind kind; access_kind(next_insn, adrp_dest_reg, kind)) {
+                        add_step(kind, next_insn.operands[0].reg, page_addr + next_insn.operands[1].mem.displacement, 2);
+                        pair_relocated = true;
                     }
                 }
 
                 if (pair_relocated) {
-                    backup_size += current_insn.size + instructions[i+1].size;
+                    backup_size += 8;
                     i++; // Consumed two instructions
                 } else {
                     // If not a recognized pair or last instruction, just relocate the ADRP itself.
-                    auto dest_reg = std::get<assembler::Register>(current_insn.operands[0].value);
-                    tramp_asm.gen_load_address(dest_reg, page_addr);
-                    backup_size += current_insn.size;
+                    add_step(StepKind::LoadAddress, current_insn.operands[0].reg, page_addr);
+                    backup_size += 4;
                 }
             }
-            // Handle LDR (literal)
-            else if (current_insn.id == disassembler::InstructionId::LDR_LIT) {
-                 uintptr_t target_addr = std::get<int64_t>(current_insn.operands[1].value);
-                 auto dest_reg = std::get<assembler::Register>(current_insn.operands[0].value);
-                 tramp_asm.gen_load_address(assembler::Register::X16, target_addr);
-                 tramp_asm.ldr(dest_reg, assembler::Register::X16, 0);
-                 backup_size += current_insn.size;
+            // Handle LDR and LDRSW (literal), into general or SIMD&FP registers
+            else if (current_insn.id == InstructionId::LDR_LIT || current_insn.id == InstructionId::LDRSW_LIT) {
+                add_step(current_insn.id == InstructionId::LDR_LIT ? StepKind::Load : StepKind::LoadSigned,
+                         current_insn.operands[0].reg, current_insn.operands[1].imm);
+                backup_size += 4;
             }
-            // Handle branches
-            else if (current_insn.group == disassembler::InstructionGroup::JUMP) {
-                uintptr_t target_addr = std::get<int64_t>(current_insn.operands[0].value);
-
-                if (current_insn.id == disassembler::InstructionId::B_COND) {
-                    tramp_asm.b(current_insn.cond, target_addr);
-                } else {
-                    tramp_asm.gen_load_address(assembler::Register::X16, target_addr);
-                    if (current_insn.id == disassembler::InstructionId::BL) {
-                        tramp_asm.blr(assembler::Register::X16);
-                    } else { // B, CBZ, CBNZ, TBZ, TBNZ etc.
-                        tramp_asm.br(assembler::Register::X16);
-                    }
+            // A literal prefetch is only a hint; the trampoline drops it
+            else if (current_insn.id == InstructionId::PRFM_LIT) {
+                add_copy(kNopWord);
+                backup_size += 4;
+            }
+            // Handle branches; the destination is always the last operand
+            else if (current_insn.group == InstructionGroup::JUMP) {
+                const auto& rt = current_insn.operands[0];
+                uintptr_t target_addr = current_insn.operands[current_insn.operand_count - 1].imm;
+
+                // B.AL/B.NV always branch; inverting them would not give a skip
+                const bool always = current_insn.id == InstructionId::B_COND &&
+                                    static_cast<int>(current_insn.cond) >= static_cast<int>(assembler::Condition::AL);
+                switch (current_insn.id) {
+                    case InstructionId::BL:
+                        add_step(StepKind::Call, assembler::Register::INVALID, target_addr);
+                        break;
+                    case InstructionId::B_COND:
+                        if (always) {
+                            add_step(StepKind::Jump, assembler::Register::INVALID, target_addr);
+                        } else {
+                            add_step(StepKind::BranchCond, assembler::Register::INVALID, target_addr, 1,
+                                     static_cast<uint8_t>(current_insn.cond));
+                        }
+                        break;
+                    case InstructionId::CBZ:
+                        add_step(StepKind::Cbz, rt.reg, target_addr);
+                        break;
+                    case InstructionId::CBNZ:
+                        add_step(StepKind::Cbnz, rt.reg, target_addr);
+                        break;
+                    case InstructionId::TBZ:
+                        add_step(StepKind::Tbz, rt.reg, target_addr, 1, static_cast<uint8_t>(current_insn.operands[1].imm));
+                        break;
+                    case InstructionId::TBNZ:
+                        add_step(StepKind::Tbnz, rt.reg, target_addr, 1, static_cast<uint8_t>(current_insn.operands[1].imm));
+                        break;
+                    default: // B
+                        add_step(StepKind::Jump, assembler::Register::INVALID, target_addr);
+                        break;
                 }
-                backup_size += current_insn.size;
+                backup_size += 4;
             } else {
                 // Other PC-relative.
                 // Handle ADR as absolute load to avoid PC-relative issues.
-                if (current_insn.id == disassembler::InstructionId::ADR && current_insn.operands.size() > 1 &&
-                    current_insn.operands[0].type == disassembler::OperandType::REGISTER &&
-                    current_insn.operands[1].type == disassembler::OperandType::IMMEDIATE) {
-                    auto dest_reg = std::get<assembler::Register>(current_insn.operands[0].value);
-                    uintptr_t target_addr = std::get<int64_t>(current_insn.operands[1].value);
-                    tramp_asm.gen_load_address(dest_reg, target_addr);
-                    backup_size += current_insn.size;
+                if (current_insn.id == InstructionId::ADR && current_insn.operand_count > 1 &&
+                    current_insn.operands[0].type == OperandType::REGISTER &&
+                    current_insn.operands[1].type == OperandType::IMMEDIATE) {
+                    add_step(StepKind::LoadAddress, current_insn.operands[0].reg, current_insn.operands[1].imm);
                 } else {
                     // Fallback: copy as-is (potentially unsafe). TODO: add more PC-relative rewrites if needed.
-                    uint32_t instruction_word = *reinterpret_cast<const uint32_t*>(current_insn.bytes.data());
-                    tramp_asm.get_code_mut().push_back(instruction_word);
-                    backup_size += current_insn.size;
+                    add_copy(current_insn.raw);
                 }
+                backup_size += 4;
             }
         } else {
             // Not a PC-relative instruction.
@@ -333,49 +360,33 @@ std::vector<uint32_t> relocate_trampoline(uintptr_t target, uintptr_t trampoline
             bool handled = false;
 
             if (i == 0) {
-                // Try to decode the previous instruction (at target - 4), but only if it's in a valid memory region.
-                ur::memory::MappedRegion region;
-                if (ur::memory::find_mapped_region(target - 4, region)) {
-                    auto prev_vec = disassembler->Disassemble(target - 4, reinterpret_cast<const uint8_t*>(target - 4), 4, 1);
-                    if (!prev_vec.empty()) {
-                        auto& prev = prev_vec[0];
-                        if (prev.id == disassembler::InstructionId::ADRP) {
-                            auto adrp_dest_reg = std::get<assembler::Register>(prev.operands[0].value);
-                            uintptr_t page_addr = std::get<int64_t>(prev.operands[1].value);
-
-                            // Case A: ADD following ADRP
-                            if (current_insn.id == disassembler::InstructionId::ADD &&
-                                current_insn.operands.size() > 2 &&
-                                current_insn.operands[1].type == disassembler::OperandType::REGISTER &&
-                                std::get<assembler::Register>(current_insn.operands[1].value) == adrp_dest_reg &&
-                                current_insn.operands[2].type == disassembler::OperandType::IMMEDIATE) {
-
-                                uintptr_t final_addr = page_addr + std::get<int64_t>(current_insn.operands[2].value);
-                                auto dest_reg = std::get<assembler::Register>(current_insn.operands[0].value);
-                                tramp_asm.gen_load_address(dest_reg, final_addr);
-                                backup_size += current_insn.size;
-                                handled = true;
-                            }
-                            // Case B: LDR/STR with base from ADRP
-                            else if ((current_insn.id == disassembler::InstructionId::LDR || current_insn.id == disassembler::InstructionId::STR) &&
-                                     current_insn.operands.size() > 1 &&
-                                     current_insn.operands[1].type == disassembler::OperandType::MEMORY) {
-
-                                auto mem_op = std::get<disassembler::MemOperand>(current_insn.operands[1].value);
-                                if (mem_op.base == adrp_dest_reg) {
-                                    uintptr_t final_addr = page_addr + mem_op.displacement;
-                                    auto data_reg = std::get<assembler::Register>(current_insn.operands[0].value);
-
-                                    tramp_asm.gen_load_address(assembler::Register::X16, final_addr);
-                                    if (current_insn.id == disassembler::InstructionId::LDR) {
-                                        tramp_asm.ldr(data_reg, assembler::Register::X16, 0);
-                                    } else { // STR
-                                        tramp_asm.str(data_reg, assembler::Register::X16, 0);
-                                    }
-                                    backup_size += current_insn.size;
-                                    handled = true;
-                                }
-                            }
+                // Try to decode the previous instruction (at target - 4), but only if it's readable.
+                uint32_t prev_word = 0;
+                if (ur::memory::safe_read(target - 4, &prev_word, sizeof(prev_word))) {
+                    DecodedInsn prev;
+                    if (disassembler::decode(target - 4, prev_word, prev) &&
+                        prev.id == InstructionId::ADRP) {
+                        auto adrp_dest_reg = prev.operands[0].reg;
+                        uintptr_t page_addr = prev.operands[1].imm;
+
+                        // Case A: ADD following ADRP
+                        if (current_insn.id == InstructionId::ADD &&
+                            current_insn.operand_count > 2 &&
+                            current_insn.operands[1].type == OperandType::REGISTER &&
+                            current_insn.operands[1].reg == adrp_dest_reg &&
+                            current_insn.operands[2].type == OperandType::IMMEDIATE) {
+
+                            add_step(StepKind::LoadAddress, current_insn.operands[0].reg, page_addr + current_insn.operands[2].imm);
+                            handled = true;
+                        }
+                        // Case B: load/store with base from ADRP
+                        else if (StepKind kind; access_kind(current_insn, adrp_dest_reg, kind)) {
+                            add_step(kind, current_insn.operands[0].reg, page_addr + current_insn.operands[1].mem.displacement);
+                            handled = true;
+                        }
+                        if (handled) {
+                            plan.uses_previous_word = true;
+                            plan.previous_word = prev_word;
                         }
                     }
                 }
@@ -383,124 +394,701 @@ std::vector<uint32_t> relocate_trampoline(uintptr_t target, uintptr_t trampoline
 
             if (!handled) {
                 // Default: copy the instruction word as-is.
-                uint32_t instruction_word = *reinterpret_cast<const uint32_t*>(current_insn.bytes.data());
-                tramp_asm.get_code_mut().push_back(instruction_word);
-                backup_size += current_insn.size;
+                add_copy(current_insn.raw);
             }
+            backup_size += 4;
         }
+    }
 
-        if (backup_size >= required_size) break;
+    plan.backup_size = static_cast<uint32_t>(backup_size);
+    plan.original.assign(code, code + backup_size / 4);
+    return plan;
+}
+
+// Whether the code at `target` is still what `plan` was built from.
+bool plan_matches(const trampoline_cache::Plan& plan, uintptr_t target) {
+    if (plan.original.size() * sizeof(uint32_t) != plan.backup_size ||
+        std::memcmp(reinterpret_cast<const void*>(target), plan.original.data(), plan.backup_size) != 0) {
+        return false;
     }
+    if (!plan.uses_previous_word) return true;
+    uint32_t prev_word = 0;
+    return ur::memory::safe_read(target - 4, &prev_word, sizeof(prev_word)) && prev_word == plan.previous_word;
+}
+
+// Emits the trampoline for `plan`: the relocated instructions, followed by the jump back
+// to target + backup_size and the literal pool. Returns the trampoline code.
+//
+// With trampoline_addr == 0 the code is position-independent: every absolute address is
+// loaded from the pool with a single LDR (literal). With the real address, ADR, ADRP+ADD,
+// B, BL and B.cond are used where they reach.
+// word_offsets[i] receives the offset in the trampoline where the code for the i-th original
+// word starts; both words of a relocated ADRP pair map to the start of the pair.
+std::vector<uint32_t> emit_relocation(const trampoline_cache::Plan& plan, uintptr_t target, uintptr_t trampoline_addr,
+                                      std::span<uint16_t> word_offsets = {}) {
+    using assembler::Register;
+    using trampoline_cache::StepKind;
+
+    jit::Jit tramp_asm(trampoline_addr);
+    size_t word = 0;
+    for (const auto& step : plan.steps) {
+        const size_t insn_offset = tramp_asm.get_code_size();
+        for (size_t i = 0; i < step.words; ++i, ++word) {
+            if (word < word_offsets.size()) word_offsets[word] = static_cast<uint16_t>(insn_offset);
+        }
 
-    return tramp_asm.get_code();
+        const auto reg = static_cast<Register>(step.reg);
+        const uintptr_t address = target + static_cast<uintptr_t>(step.delta);
+        jit::Label skip; // Only takes an id when a conditional branch uses it
+        switch (step.kind) {
+            case StepKind::Copy:
+                tramp_asm.emit_word(step.raw);
+                break;
+            case StepKind::LoadAddress:
+                tramp_asm.load_address(reg, address);
+                break;
+            case StepKind::Load:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.ldr(reg, Register::X16, 0);
+                break;
+            case StepKind::Store:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.str(reg, Register::X16, 0);
+                break;
+            case StepKind::LoadSigned:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.ldrsw(reg, Register::X16, 0);
+                break;
+            case StepKind::LoadByte:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.ldrb(reg, Register::X16, 0);
+                break;
+            case StepKind::LoadHalf:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.ldrh(reg, Register::X16, 0);
+                break;
+            case StepKind::LoadSignedByte:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.ldrsb(reg, Register::X16, 0);
+                break;
+            case StepKind::LoadSignedHalf:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.ldrsh(reg, Register::X16, 0);
+                break;
+            case StepKind::StoreByte:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.strb(reg, Register::X16, 0);
+                break;
+            case StepKind::StoreHalf:
+                tramp_asm.load_address(Register::X16, address);
+                tramp_asm.strh(reg, Register::X16, 0);
+                break;
+            case StepKind::Jump:
+                tramp_asm.jump(address);
+                break;
+            case StepKind::Call:
+                tramp_asm.call(address);
+                break;
+            // Conditional branches keep their condition: the inverted branch skips the far jump
+            case StepKind::BranchCond: {
+                const auto cond = static_cast<assembler::Condition>(step.extra);
+                if (trampoline_addr != 0 && assembler::Assembler::can_encode_b_cond(tramp_asm.get_current_address(), address)) {
+                    tramp_asm.b(cond, address);
+                    break;
+                }
+                tramp_asm.b(static_cast<assembler::Condition>(step.extra ^ 1), skip);
+                tramp_asm.jump(address);
+                tramp_asm.bind(skip);
+                break;
+            }
+            case StepKind::Cbz:
+                tramp_asm.cbnz(reg, skip);
+                tramp_asm.jump(address);
+                tramp_asm.bind(skip);
+                break;
+            case StepKind::Cbnz:
+                tramp_asm.cbz(reg, skip);
+                tramp_asm.jump(address);
+                tramp_asm.bind(skip);
+                break;
+            case StepKind::Tbz:
+                tramp_asm.tbnz(reg, step.extra, skip);
+                tramp_asm.jump(address);
+                tramp_asm.bind(skip);
+                break;
+            case StepKind::Tbnz:
+                tramp_asm.tbz(reg, step.extra, skip);
+                tramp_asm.jump(address);
+                tramp_asm.bind(skip);
+                break;
+        }
+    }
+
+    // Jump back to the rest of the original function; the pool follows the final branch
+    tramp_asm.jump(target + plan.backup_size);
+    tramp_asm.finish();
+    return std::move(tramp_asm.get_code_mut());
 }
 
 
-} // namespace
+// Persistent trampoline caches, one per module build-id; see set_trampoline_cache_directory().
+struct TrampolineCaches {
+    std::mutex mutex;
+    std::string directory; // Empty while disabled
+    std::unordered_map<std::string, std::shared_ptr<trampoline_cache::Cache>> by_build_id;
+};
 
-// --- Hook Class Implementation ---
+TrampolineCaches& trampoline_caches() {
+    // Not leaked: the caches flush when the process exits
+    static TrampolineCaches caches;
+    return caches;
+}
 
-Hook::Hook(uintptr_t target, Callback callback, bool enable_now) {
-    if (target == 0) {
-        throw std::invalid_argument("Target must not be null");
+// The cache of the module that contains `target` and the target's offset in it.
+struct ModuleCache {
+    std::shared_ptr<trampoline_cache::Cache> cache;
+    uint64_t offset = 0;
+};
+
+ModuleCache trampoline_cache_for(uintptr_t target) {
+    auto& caches = trampoline_caches();
+    {
+        std::lock_guard<std::mutex> lock(caches.mutex);
+        if (caches.directory.empty()) return {};
     }
-    if (callback == nullptr && enable_now) {
-        throw std::invalid_argument("Callback must not be null if hook is enabled immediately");
+
+    Dl_info dl{};
+    if (dladdr(reinterpret_cast<void*>(target), &dl) == 0 || dl.dli_fbase == nullptr) return {};
+    const auto base = reinterpret_cast<uintptr_t>(dl.dli_fbase);
+    auto parser = module_registry::get(base);
+    if (!parser) return {};
+    const auto build_id = parser->get_build_id();
+    if (build_id.empty()) return {};
+
+    std::lock_guard<std::mutex> lock(caches.mutex);
+    if (caches.directory.empty()) return {};
+    auto& cache = caches.by_build_id[std::string(reinterpret_cast<const char*>(build_id.data()), build_id.size())];
+    if (!cache) {
+        cache = trampoline_cache::Cache::open(caches.directory, build_id);
     }
+    return {cache, target - base};
+}
 
-    try {
-        std::lock_guard<std::mutex> lock(g_hooks_mutex);
-        if (g_hooks.find(target) == g_hooks.end()) {
-            g_hooks[target] = std::make_unique<HookInfo>();
+// Allocates the detour stub, chooses the target patch and builds the trampoline
+// for a target on first use. Caller must hold info.info_mutex.
+void prepare_hook_info(HookInfo& info, uintptr_t target) {
+    const bool needs_patch = info.target_patch_words == 0 || info.patch_size_at_target == 0;
+    const ModuleCache module = needs_patch || info.trampoline == nullptr ? trampoline_cache_for(target) : ModuleCache{};
+
+    // Allocate detour stub once from the shared pool, preferably within B range of the target
+    if (info.detour_stub == nullptr) {
+        info.detour_stub = exec_pool::allocate(kDetourStubSize, target, exec_pool::kBranchRange);
+        if (!info.detour_stub) {
+            // Fallback: anywhere (target will be patched with ADRP or ABS sequence)
+            info.detour_stub = exec_pool::allocate(kDetourStubSize);
         }
-        
-        auto& info = *g_hooks[target];
-        std::lock_guard<std::mutex> info_lock(info.info_mutex);
+    }
 
-        target_address_ = target;
-        callback_ = callback;
-        info.target_address = target;
-
-        // Allocate detour stub once (bounded near attempts; no maps scanning)
-        if (info.detour_stub == nullptr) {
-            constexpr size_t kNearWindow = 128ull * 1024 * 1024; // 128MB
-            info.detour_stub = allocate_executable_memory_near(target, assembler::Assembler::ABS_JUMP_SIZE, kNearWindow);
-            if (!info.detour_stub) {
-                // Fallback: one-shot hint, then generic mapping
-                info.detour_stub = allocate_executable_memory_hint(assembler::Assembler::ABS_JUMP_SIZE, target);
-                if (!info.detour_stub) {
-                    info.detour_stub = allocate_executable_memory(assembler::Assembler::ABS_JUMP_SIZE);
-                }
+    // Choose minimal patch sequence from target to detour stub (cache code and patch size)
+    if (needs_patch) {
+        // Function analysis is the expensive part; a warm cache skips it
+        uint32_t cached_limit = 0;
+        size_t limit = 0;
+        if (module.cache && module.cache->lookup_limit(module.offset, cached_limit)) {
+            limit = cached_limit;
+        } else {
+            limit = safe_patch_limit(target);
+            if (module.cache) module.cache->record_limit(module.offset, static_cast<uint32_t>(limit));
+        }
+        if (info.detour_stub) {
+            size_t words = 0;
+            if (!choose_patch_sequence(target, reinterpret_cast<uintptr_t>(info.detour_stub), limit, info.target_patch_code, words)) {
+                throw std::runtime_error("No patch sequence fits the target without overwriting a branch target");
             }
+            info.target_patch_words = words;
+            info.patch_size_at_target = words * sizeof(uint32_t);
+        } else {
+            // No stub: patch size equals ABS jump; target_patch_code left empty to force direct patch
+            if (limit < assembler::Assembler::ABS_JUMP_SIZE) {
+                throw std::runtime_error("No patch sequence fits the target without overwriting a branch target");
+            }
+            info.patch_size_at_target = assembler::Assembler::ABS_JUMP_SIZE;
         }
+    }
 
-        // Choose minimal patch sequence from target to detour stub (cache code and patch size)
-        if (info.target_patch_code.empty() || info.patch_size_at_target == 0) {
-            if (info.detour_stub) {
-                std::vector<uint32_t> patch_code;
-                size_t patch_size = 0;
-                choose_patch_sequence(target, reinterpret_cast<uintptr_t>(info.detour_stub), patch_code, patch_size);
-                info.target_patch_code = std::move(patch_code);
-                info.patch_size_at_target = patch_size;
-            } else {
-                // No stub: patch size equals ABS jump; target_patch_code left empty to force direct patch
-                info.patch_size_at_target = assembler::Assembler::ABS_JUMP_SIZE;
-            }
+    // Build trampoline once
+    if (info.trampoline == nullptr) {
+        // Decode once, or reuse the cached plan while the target still holds the same code
+        trampoline_cache::Plan plan;
+        const auto required_size = static_cast<uint32_t>(info.patch_size_at_target);
+        if (!module.cache || !module.cache->lookup_plan(module.offset, required_size, plan) || !plan_matches(plan, target)) {
+            plan = plan_relocation(target, info.patch_size_at_target);
+            if (module.cache) module.cache->record_plan(module.offset, plan);
+        }
+        info.backup_size = plan.backup_size;
+
+        // The position-independent relocation sizes the allocation. Placed near the target,
+        // relocating again at the real address mostly gets the short PC-relative forms;
+        // that version is kept only if it still fits.
+        auto relocated_code = emit_relocation(plan, target, 0, info.relocated_offsets);
+        size_t trampoline_size = relocated_code.size() * sizeof(uint32_t);
+        info.trampoline = exec_pool::allocate(trampoline_size, target, exec_pool::kBranchRange);
+        if (!info.trampoline) info.trampoline = exec_pool::allocate(trampoline_size);
+        if (!info.trampoline) throw std::runtime_error("Failed to allocate trampoline memory");
+
+        std::array<uint16_t, kMaxPatchWords + 1> placed_offsets{};
+        auto placed_code = emit_relocation(plan, target, reinterpret_cast<uintptr_t>(info.trampoline), placed_offsets);
+        if (placed_code.size() <= relocated_code.size()) {
+            relocated_code = std::move(placed_code);
+            info.relocated_offsets = placed_offsets;
         }
+        exec_pool::write_code(info.trampoline, relocated_code.data(), relocated_code.size() * sizeof(uint32_t));
+
+        // Save original code
+        info.original_code.assign(reinterpret_cast<uint8_t*>(target), reinterpret_cast<uint8_t*>(target) + info.backup_size);
+    }
 
-        // Build trampoline once
-        if (info.trampoline == nullptr) {
-            // Relocate with dynamic required size equal to selected patch size
-            auto relocated_code = relocate_trampoline(target, 0, info.backup_size, info.patch_size_at_target);
-            size_t relocated_size = relocated_code.size() * sizeof(uint32_t);
+    // The stub starts out routed to the original code
+    if (info.detour_stub && info.detour_stub_size == 0) {
+        build_detour_stub(info, reinterpret_cast<uintptr_t>(info.trampoline));
+    }
+}
 
-            size_t trampoline_size = relocated_size + assembler::Assembler::ABS_JUMP_SIZE;
-            info.trampoline = allocate_executable_memory(trampoline_size);
-            if (!info.trampoline) throw std::runtime_error("Failed to allocate trampoline memory");
+// --- Dispatch Table ---
+//
+// Every hook on a target owns one link of the target's dispatch table. A link is a
+// two-instruction thunk `ldr x16, slot; br x16` whose data slot holds the address of the
+// next enabled hook in the chain (or the trampoline). Hook::call_original() jumps to the
+// hook's own thunk, so walking a chain costs one indirect branch per link, and adding,
+// removing or toggling hooks only stores new slot values; no code is ever rewritten.
+//
+// Links are allocated in blocks that never move; a block holds the thunks followed by
+// their slots, so every thunk reaches its slot at the same PC-relative offset.
+constexpr size_t kLinksPerBlock = 16;
+constexpr size_t kLinkThunkSize = 8;
+constexpr size_t kDispatchBlockSize = kLinksPerBlock * (kLinkThunkSize + sizeof(uint64_t));
+
+uintptr_t link_thunk(const HookInfo& info, size_t link) {
+    return reinterpret_cast<uintptr_t>(info.dispatch_blocks[link / kLinksPerBlock]) + (link % kLinksPerBlock) * kLinkThunkSize;
+}
 
-            // Copy the relocated code into the trampoline
-            std::memcpy(info.trampoline, relocated_code.data(), relocated_size);
-            
-            // Add the jump back to the original function
-            assembler::Assembler tramp_asm(reinterpret_cast<uintptr_t>(info.trampoline) + relocated_size);
-            tramp_asm.gen_abs_jump(target + info.backup_size, assembler::Register::X16);
-            
-            // Copy the generated jump code to the trampoline
-            const auto& tramp_jump_code = tramp_asm.get_code();
-            std::memcpy(reinterpret_cast<char*>(info.trampoline) + relocated_size, tramp_jump_code.data(), tramp_jump_code.size() * sizeof(uint32_t));
+// Slots are written through the block's writable view; thunks read them from the executable one.
+uint64_t* link_slot(const HookInfo& info, size_t link) {
+    return info.dispatch_slots[link / kLinksPerBlock] + link % kLinksPerBlock;
+}
 
-            // Save original code
-            info.original_code.assign(reinterpret_cast<uint8_t*>(target), reinterpret_cast<uint8_t*>(target) + info.backup_size);
-            
-            __builtin___clear_cache(reinterpret_cast<char*>(info.trampoline),
-                                    reinterpret_cast<char*>(info.trampoline) + trampoline_size);
+// Hands out a free link, mapping a new dispatch block when all are in use.
+// Fresh links jump to the trampoline. Caller must hold info.info_mutex.
+size_t acquire_link(HookInfo& info) {
+    if (info.free_links.empty()) {
+        void* block = exec_pool::allocate(kDispatchBlockSize);
+        if (!block) throw std::runtime_error("Failed to allocate dispatch table memory");
+
+        using namespace ur::assembler;
+        auto block_addr = reinterpret_cast<uintptr_t>(block);
+        std::array<uint32_t, kDispatchBlockSize / sizeof(uint32_t)> code;
+        Assembler block_asm(block_addr, code);
+        for (size_t i = 0; i < kLinksPerBlock; ++i) {
+            block_asm.ldr_literal(Register::X16, kLinksPerBlock * kLinkThunkSize);
+            block_asm.br(Register::X16);
+        }
+        for (size_t i = 0; i < kLinksPerBlock; ++i) {
+            block_asm.emit_quad(reinterpret_cast<uint64_t>(info.trampoline));
         }
+        exec_pool::write_code(block, code.data(), sizeof(code));
+
+        size_t first = info.dispatch_blocks.size() * kLinksPerBlock;
+        info.dispatch_blocks.push_back(block);
+        info.dispatch_slots.push_back(static_cast<uint64_t*>(exec_pool::writable(reinterpret_cast<void*>(block_addr + kLinksPerBlock * kLinkThunkSize))));
+        // Hand out low indices first so short chains stay in the first block.
+        for (size_t i = kLinksPerBlock; i-- > 0;) {
+            info.free_links.push_back(first + i);
+        }
+    }
+    size_t link = info.free_links.back();
+    info.free_links.pop_back();
+    return link;
+}
 
-        // Build detour stub to current detour target (callback when enabling now, otherwise trampoline)
-        if (info.detour_stub) {
-            uintptr_t detour_target = enable_now ? reinterpret_cast<uintptr_t>(callback)
-                                                 : reinterpret_cast<uintptr_t>(info.trampoline);
-            update_detour_stub(info, detour_target);
+// Caller must hold info.info_mutex.
+void release_link(HookInfo& info, size_t link) {
+    __atomic_store_n(link_slot(info, link), reinterpret_cast<uint64_t>(info.trampoline), __ATOMIC_RELEASE);
+    info.free_links.push_back(link);
+}
+
+// --- Recursion Guard ---
+//
+// A hook created with HookOptions::recursion_guard is entered through a guard thunk
+// that calls the callback only if the thread is not already inside a guarded detour:
+//
+//     mrs  x17, tpidr_el0           ; guard word, see ur::recursion_guard
+//     ldr  x16, [x17, #guard]
+//     cbnz x16, bypass
+//     str  x30, [x17, #guard]       ; the saved return address doubles as the flag
+//     ldr  x16, callback_slot
+//     blr  x16
+//     mrs  x17, tpidr_el0
+//     ldr  x30, [x17, #guard]
+//     str  xzr, [x17, #guard]
+//     ret
+//   bypass:
+//     ldr  x16, bypass_slot         ; this hook's link: the rest of the chain
+//     br   x16
+//
+// SP is left alone, so stack-passed arguments reach the callback unchanged; the callback
+// must return normally, since exceptions cannot unwind through the thunk. Thunks are
+// recycled rather than freed: all of them share the same code, so a thread still
+// returning into the thunk of a removed hook runs the same epilogue.
+struct GuardThunkPool {
+    std::mutex mutex;
+    std::vector<GuardThunk> free;
+};
+
+GuardThunkPool& guard_thunks() {
+    // Intentionally leaked, like the thunks themselves
+    static GuardThunkPool* instance = new GuardThunkPool();
+    return *instance;
+}
+
+GuardThunk build_guard_thunk() {
+    using assembler::Register;
+    jit::Jit jit;
+    jit::Label bypass;
+    jit::Label callback_slot;
+    jit::Label bypass_slot;
+
+    const int32_t guard = recursion_guard::emit_guard_base(jit, Register::X17);
+    jit.ldr(Register::X16, Register::X17, guard);
+    jit.cbnz(Register::X16, bypass);
+    jit.str(Register::LR, Register::X17, guard);
+    jit.ldr_literal(Register::X16, callback_slot);
+    jit.blr(Register::X16);
+    recursion_guard::emit_guard_base(jit, Register::X17);
+    jit.ldr(Register::LR, Register::X17, guard);
+    jit.str(Register::ZR, Register::X17, guard);
+    jit.ret();
+
+    jit.bind(bypass);
+    jit.ldr_literal(Register::X16, bypass_slot);
+    jit.br(Register::X16);
+
+    if (jit.get_code_size() % sizeof(uint64_t) != 0) jit.nop();
+    jit.bind(callback_slot);
+    jit.emit_quad(0);
+    jit.bind(bypass_slot);
+    jit.emit_quad(0);
+
+    auto* code = jit.finalize<uint8_t*>();
+    if (code == nullptr) throw std::runtime_error("Failed to allocate recursion guard memory");
+    jit.release();
+
+    GuardThunk thunk;
+    thunk.code = code;
+    thunk.callback_slot = static_cast<uint64_t*>(exec_pool::writable(code + callback_slot.offset()));
+    thunk.bypass_slot = static_cast<uint64_t*>(exec_pool::writable(code + bypass_slot.offset()));
+    return thunk;
+}
+
+// Hands out a guard thunk that calls `callback` and otherwise continues at `bypass`.
+GuardThunk acquire_guard_thunk(uintptr_t callback, uintptr_t bypass) {
+    GuardThunk thunk;
+    {
+        auto& pool = guard_thunks();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.free.empty()) {
+            thunk = pool.free.back();
+            pool.free.pop_back();
         }
+    }
+    if (thunk.code == nullptr) thunk = build_guard_thunk();
+    __atomic_store_n(thunk.callback_slot, static_cast<uint64_t>(callback), __ATOMIC_RELEASE);
+    __atomic_store_n(thunk.bypass_slot, static_cast<uint64_t>(bypass), __ATOMIC_RELEASE);
+    return thunk;
+}
 
-        void* next_func_to_call = info.entries.empty() ? info.trampoline : info.entries.front().callback;
-        original_func_ = next_func_to_call;
+// Call once nothing routes to the thunk any more. Thunks shared with a forked process
+// are dropped: rewriting their slots would redirect the other process too.
+void release_guard_thunk(GuardThunk& thunk) {
+    if (thunk.code == nullptr) return;
+    if (exec_pool::is_inherited(thunk.code)) {
+        thunk = GuardThunk{};
+        return;
+    }
+    auto& pool = guard_thunks();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.free.push_back(thunk);
+    thunk = GuardThunk{};
+}
 
-        info.entries.push_front({this, callback, next_func_to_call, enable_now});
+// --- Call Counting ---
+//
+// A hook created with HookOptions::count_calls is entered through a counting thunk
+// (see ur::hook_stats) that increments the hook's counter and continues at the guard
+// thunk, or at the callback when there is no guard. Like guard thunks, counting thunks
+// are recycled by hook_stats rather than freed.
+
+// Acquires the entry thunks requested by `options`; on failure none are left acquired.
+void acquire_entry_thunks(HookEntry& entry, const HookOptions& options, uintptr_t target, uintptr_t link) {
+    const auto callback = reinterpret_cast<uintptr_t>(entry.callback);
+    if (options.recursion_guard) {
+        entry.guard = acquire_guard_thunk(callback, link);
+    }
+    if (options.count_calls) {
+        try {
+            const uintptr_t next = entry.guard.code != nullptr ? reinterpret_cast<uintptr_t>(entry.guard.code) : callback;
+            entry.counter = hook_stats::acquire_counting_thunk(hook_stats::HookKind::Inline, target, next);
+        } catch (...) {
+            release_guard_thunk(entry.guard);
+            throw;
+        }
+    }
+}
 
-        if (enable_now) {
-            if (info.detour_stub && !info.target_patch_code.empty()) {
-                // Patch target to detour stub using minimal sequence
-                patch_target_with_code(target, info.target_patch_code);
-            } else {
-                // Fallback: direct absolute jump to callback
-                patch_target(target, reinterpret_cast<uintptr_t>(callback));
-            }
+// Call once nothing routes to the entry's thunks any more.
+void release_entry_thunks(HookEntry& entry) {
+    release_guard_thunk(entry.guard);
+    hook_stats::release_counting_thunk(entry.counter);
+}
+
+void set_entry_callback(HookEntry& entry, Hook::Callback callback) {
+    entry.callback = callback;
+    if (entry.guard.code != nullptr) {
+        __atomic_store_n(entry.guard.callback_slot, reinterpret_cast<uint64_t>(callback), __ATOMIC_RELEASE);
+    } else if (entry.counter.code != nullptr) {
+        hook_stats::set_destination(entry.counter, reinterpret_cast<uintptr_t>(callback));
+    }
+}
+
+// Where the chain enters an enabled entry: its counting thunk, its guard thunk, or the
+// callback itself.
+uintptr_t entry_destination(const HookEntry& entry) {
+    if (entry.counter.code != nullptr) return reinterpret_cast<uintptr_t>(entry.counter.code);
+    return reinterpret_cast<uintptr_t>(entry.guard.code != nullptr ? entry.guard.code : entry.callback);
+}
+
+// Rewrites every link so that it points at the next enabled hook after it, walking the
+// chain from the tail so a thread entering any link always sees an up-to-date suffix.
+// Returns the chain head: the first enabled callback, or the trampoline.
+// Caller must hold info.info_mutex.
+uintptr_t publish_chain(HookInfo& info) {
+    auto next = reinterpret_cast<uintptr_t>(info.trampoline);
+    for (auto it = info.entries.rbegin(); it != info.entries.rend(); ++it) {
+        __atomic_store_n(link_slot(info, it->link), static_cast<uint64_t>(next), __ATOMIC_RELEASE);
+        if (it->is_enabled) {
+            next = entry_destination(*it);
+        }
+    }
+    return next;
+}
+
+// Frees all executable memory of a target whose last hook is gone.
+// Caller must hold info.info_mutex.
+void release_target_memory(HookInfo& info) {
+    exec_pool::free(info.trampoline);
+    exec_pool::free(info.detour_stub);
+    for (void* block : info.dispatch_blocks) {
+        exec_pool::free(block);
+    }
+    info.dispatch_blocks.clear();
+    info.dispatch_slots.clear();
+    info.free_links.clear();
+}
+
+// Routes the target to the first enabled hook. With a detour stub this is a store to the
+// stub's slot; the target itself is only patched when it does not already jump to the stub,
+// and only restored when no hook is enabled and the target is not switchable.
+// Caller must hold info.info_mutex.
+bool route_target(HookInfo& info) {
+    const uintptr_t head = publish_chain(info);
+    const bool any_enabled = head != reinterpret_cast<uintptr_t>(info.trampoline);
+
+    if (!any_enabled && !(info.switchable && has_stub(info))) {
+        update_detour_stub(info, reinterpret_cast<uintptr_t>(info.trampoline));
+        if (info.target_patched) {
+            if (!restore_target(info)) return false;
+            info.target_patched = false;
+        }
+        return true;
+    }
+
+    if (!has_stub(info)) {
+        // No stub: direct absolute jump to the first enabled callback
+        if (!patch_target(info.target_address, head)) return false;
+        info.target_patched = true;
+        return true;
+    }
+
+    update_detour_stub(info, head);
+    if (!info.target_patched) {
+        if (!patch_target_with_code(info.target_address, std::span<const uint32_t>(info.target_patch_code).first(info.target_patch_words))) return false;
+        info.target_patched = true;
+    }
+    return true;
+}
+
+// --- Fork Safety ---
+//
+// Around fork() every shard and every HookInfo is locked (shards first, like
+// HookBatch::commit), so a child never inherits a registry locked by a thread that
+// does not exist in it. See ur::fork_safety.
+
+void lock_registry_for_fork() {
+    for (auto& shard : g_registry) {
+        shard.mutex.lock();
+    }
+    for (auto& shard : g_registry) {
+        for (auto& [target, info] : shard.hooks) {
+            info->info_mutex.lock();
+        }
+    }
+}
+
+void unlock_registry_after_fork() {
+    for (auto& shard : g_registry) {
+        for (auto& [target, info] : shard.hooks) {
+            info->info_mutex.unlock();
+        }
+    }
+    for (auto& shard : g_registry) {
+        shard.mutex.unlock();
+    }
+}
+
+void mark_registry_inherited() {
+    for (auto& shard : g_registry) {
+        for (auto& [target, info] : shard.hooks) {
+            info->inherited = true;
         }
-        is_enabled_ = enable_now;
+    }
+}
+
+// Whether the target still holds the code this process last wrote there.
+// Caller must hold info.info_mutex.
+bool target_intact(const HookInfo& info) {
+    const auto* code = reinterpret_cast<const uint8_t*>(info.target_address);
+    if (!info.target_patched) {
+        return memcmp(code, info.original_code.data(), info.backup_size) == 0;
+    }
+    if (info.target_patch_words != 0) {
+        return memcmp(code, info.target_patch_code.data(), info.target_patch_words * sizeof(uint32_t)) == 0;
+    }
+    // Patched directly with an absolute jump that is not cached; anything but the original will do
+    return memcmp(code, info.original_code.data(), info.backup_size) != 0;
+}
+
+void verify_registry(fork_safety::InheritedState& state) {
+    for (auto& shard : g_registry) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto& [target, info] : shard.hooks) {
+            std::lock_guard<std::mutex> info_lock(info->info_mutex);
+            if (!info->inherited) continue;
+            ++state.targets;
+            if (target_intact(*info)) ++state.intact;
+        }
+    }
+}
+
+[[maybe_unused]] const bool g_fork_registry = fork_safety::add_participant({
+    fork_safety::Rank::Registries,
+    lock_registry_for_fork,
+    unlock_registry_after_fork,
+    mark_registry_inherited,
+    verify_registry,
+});
+
+[[maybe_unused]] const bool g_fork_trampoline_caches = fork_safety::add_participant({
+    fork_safety::Rank::Caches,
+    [] { trampoline_caches().mutex.lock(); },
+    [] { trampoline_caches().mutex.unlock(); },
+});
+
+[[maybe_unused]] const bool g_fork_guard_thunks = fork_safety::add_participant({
+    fork_safety::Rank::Caches,
+    [] { guard_thunks().mutex.lock(); },
+    [] { guard_thunks().mutex.unlock(); },
+    // Free thunks may be shared now; acquiring one would rewrite its slots in every process
+    [] { guard_thunks().free.clear(); },
+});
+
+void throw_if_inherited(const HookInfo& info) {
+    if (info.inherited) {
+        throw std::runtime_error("Target was hooked before fork() and is inherited; its hooks cannot change");
+    }
+}
+
+} // namespace
+
+// --- Hook Class Implementation ---
+
+Hook::Hook(uintptr_t target, Callback callback, bool enable_now, const HookOptions& options) {
+    if (target == 0) {
+        throw std::invalid_argument("Target must not be null");
+    }
+    if (callback == nullptr && enable_now) {
+        throw std::invalid_argument("Callback must not be null if hook is enabled immediately");
+    }
+
+    auto& shard = shard_for(target);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& slot = shard.hooks[target];
+    if (!slot) {
+        slot = std::make_shared<HookInfo>();
+    }
+
+    auto& info = *slot;
+    std::unique_lock<std::mutex> info_lock(info.info_mutex);
+    throw_if_inherited(info);
+
+    // Do not leave a half-prepared target behind when nothing else uses it
+    auto release_if_unused = [&]() {
+        if (!info.entries.empty()) return;
+        release_target_memory(info);
+        info_lock.unlock();
+        shard.hooks.erase(target);
+    };
+
+    info.target_address = target;
+    info.switchable = info.switchable || options.switchable;
+
+    try {
+        prepare_hook_info(info, target);
+    } catch (...) {
+        release_if_unused();
+        throw;
+    }
+
+    // call_original() goes through this hook's link, which always follows the live chain.
+    size_t link = acquire_link(info);
+    HookEntry entry{this, callback, link, enable_now};
+    try {
+        acquire_entry_thunks(entry, options, target, link_thunk(info, link));
     } catch (...) {
+        info.free_links.push_back(link);
+        release_if_unused();
         throw;
     }
+    info.entries.push_front(entry);
+
+    // Switchable targets are patched right away so that enabling later is a single store.
+    if (!route_target(info)) {
+        // The target was not patched, so nothing reaches the new entry; unlink it like a
+        // failed HookBatch::commit() does and route the remaining hooks as before.
+        info.entries.pop_front();
+        release_entry_thunks(entry);
+        info.free_links.push_back(link);
+        if (info.entries.empty()) {
+            release_if_unused();
+        } else {
+            route_target(info);
+        }
+        throw std::runtime_error("Failed to patch the target");
+    }
+
+    target_address_ = target;
+    callback_ = callback;
+    original_func_ = reinterpret_cast<void*>(link_thunk(info, link));
+    info_ = slot;
+    is_enabled_ = enable_now;
 }
 
 Hook::~Hook() {
@@ -508,37 +1096,22 @@ Hook::~Hook() {
 }
 
 void Hook::set_detour(Callback callback) {
-    if (!is_valid()) return;
-    
-    std::lock_guard<std::mutex> lock(g_hooks_mutex);
-    auto it = g_hooks.find(target_address_);
-    if (it == g_hooks.end()) return;
+    if (!is_valid() || !info_) return;
 
-    auto& info = *it->second;
+    auto& info = *info_;
     std::lock_guard<std::mutex> info_lock(info.info_mutex);
+    if (info.inherited) return;
 
     auto entry_it = std::find_if(info.entries.begin(), info.entries.end(), 
         [this](const HookEntry& entry) { return entry.owner == this; });
 
     if (entry_it != info.entries.end()) {
-        entry_it->callback = callback;
+        set_entry_callback(*entry_it, callback);
         this->callback_ = callback;
         
-        // If this is the currently active hook, route to the new detour
-        if (is_enabled_ && info.entries.front().owner == this) {
-            if (info.detour_stub) {
-                update_detour_stub(info, reinterpret_cast<uintptr_t>(callback));
-                // Ensure target points to stub with minimal patch
-                if (!info.target_patch_code.empty()) {
-                    patch_target_with_code(target_address_, info.target_patch_code);
-                } else {
-                    // Fallback to absolute jump to detour when patch code missing
-                    patch_target(target_address_, reinterpret_cast<uintptr_t>(callback));
-                }
-            } else {
-                // No stub: direct patch to callback
-                patch_target(target_address_, reinterpret_cast<uintptr_t>(callback));
-            }
+        // If this hook may be the active one, route to the new detour
+        if (is_enabled_) {
+            route_target(info);
         }
     }
 }
@@ -546,53 +1119,56 @@ void Hook::set_detour(Callback callback) {
 void Hook::do_unhook() {
     if (!is_valid()) return;
 
-    std::lock_guard<std::mutex> lock(g_hooks_mutex);
-    auto it = g_hooks.find(target_address_);
-    if (it == g_hooks.end()) {
+    if (!info_) {
         reset();
         return;
     }
 
-    auto& info = *it->second;
-    std::lock_guard<std::mutex> info_lock(info.info_mutex);
+    // Removing the last entry erases the target from the registry, so take the shard lock.
+    auto& shard = shard_for(target_address_);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& info = *info_;
+    std::unique_lock<std::mutex> info_lock(info.info_mutex);
 
     auto entry_it = std::find_if(info.entries.begin(), info.entries.end(), 
         [this](const HookEntry& entry) { return entry.owner == this; });
 
+    // An inherited chain cannot be re-linked. Removing its last hook only restores the
+    // (private) target code and frees nothing shared; any other hook stays in the chain.
+    if (info.inherited && (entry_it == info.entries.end() || info.entries.size() > 1)) {
+        if (entry_it != info.entries.end()) entry_it->owner = nullptr;
+        info_lock.unlock();
+        reset();
+        return;
+    }
+
+    bool removed = false;
+    size_t link = 0;
+    HookEntry thunks; // The removed entry's thunks, released once nothing routes to them
     if (entry_it != info.entries.end()) {
-        auto next_it = std::next(entry_it);
-        if (entry_it != info.entries.begin()) {
-            auto prev_it = std::prev(entry_it);
-            if (next_it != info.entries.end()) {
-                prev_it->call_next = next_it->callback;
-            } else {
-                prev_it->call_next = info.trampoline;
-            }
-        }
+        link = entry_it->link;
+        thunks = *entry_it;
         info.entries.erase(entry_it);
+        removed = true;
     }
 
     if (info.entries.empty()) {
-        restore_target(info);
-        free_executable_memory(info.trampoline, info.backup_size + assembler::Assembler::ABS_JUMP_SIZE);
-        if (info.detour_stub) {
-            free_executable_memory(info.detour_stub, info.detour_stub_size ? info.detour_stub_size : assembler::Assembler::ABS_JUMP_SIZE);
+        if (info.target_patched) {
+            restore_target(info);
+        }
+        release_target_memory(info);
+        release_entry_thunks(thunks);
+        info_lock.unlock();
+        auto it = shard.hooks.find(target_address_);
+        if (it != shard.hooks.end() && it->second == info_) {
+            shard.hooks.erase(it);
         }
-        g_hooks.erase(it);
     } else {
-        // Keep target patch routing
-        if (info.detour_stub) {
-            // Update stub to point to current chain head
-            update_detour_stub(info, reinterpret_cast<uintptr_t>(info.entries.front().callback));
-            if (!info.target_patch_code.empty()) {
-                patch_target_with_code(target_address_, info.target_patch_code);
-            } else {
-                // If patch code missing, ensure direct jump to current chain head
-                patch_target(target_address_, reinterpret_cast<uintptr_t>(info.entries.front().callback));
-            }
-        } else {
-            // No stub: direct patch to current chain head
-            patch_target(target_address_, reinterpret_cast<uintptr_t>(info.entries.front().callback));
+        // Route around the removed hook first; only then can its link be reused.
+        route_target(info);
+        if (removed) {
+            release_link(info, link);
+            release_entry_thunks(thunks);
         }
     }
 
@@ -612,14 +1188,13 @@ bool Hook::enable() {
         return false;
     }
 
-    std::lock_guard<std::mutex> lock(g_hooks_mutex);
-    auto it = g_hooks.find(target_address_);
-    if (it == g_hooks.end()) {
+    if (!info_) {
         return false;
     }
 
-    auto& info = *it->second;
+    auto& info = *info_;
     std::lock_guard<std::mutex> info_lock(info.info_mutex);
+    if (info.inherited) return false;
 
     auto entry_it = std::find_if(info.entries.begin(), info.entries.end(),
         [this](const HookEntry& entry) { return entry.owner == this; });
@@ -629,28 +1204,8 @@ bool Hook::enable() {
     }
     is_enabled_ = true; // Update flag before patching
 
-    // Re-patch to the first enabled hook
-    auto first_enabled = std::find_if(info.entries.begin(), info.entries.end(),
-        [](const HookEntry& entry) { return entry.is_enabled; });
-
-    if (first_enabled != info.entries.end()) {
-        if (info.detour_stub) {
-            update_detour_stub(info, reinterpret_cast<uintptr_t>(first_enabled->callback));
-            if (!info.target_patch_code.empty()) {
-                patch_target_with_code(target_address_, info.target_patch_code);
-            } else {
-                // If minimal patch code not cached, ensure direct jump
-                patch_target(target_address_, reinterpret_cast<uintptr_t>(first_enabled->callback));
-            }
-        } else {
-            // No stub: direct patch to first enabled callback
-            patch_target(target_address_, reinterpret_cast<uintptr_t>(first_enabled->callback));
-        }
-    } else {
-        restore_target(info);
-    }
-
-    return true;
+    // Re-route to the first enabled hook
+    return route_target(info);
 }
 
 bool Hook::disable() {
@@ -658,14 +1213,13 @@ bool Hook::disable() {
         return false;
     }
 
-    std::lock_guard<std::mutex> lock(g_hooks_mutex);
-    auto it = g_hooks.find(target_address_);
-    if (it == g_hooks.end()) {
+    if (!info_) {
         return false;
     }
 
-    auto& info = *it->second;
+    auto& info = *info_;
     std::lock_guard<std::mutex> info_lock(info.info_mutex);
+    if (info.inherited) return false;
 
     auto entry_it = std::find_if(info.entries.begin(), info.entries.end(),
         [this](const HookEntry& entry) { return entry.owner == this; });
@@ -675,39 +1229,19 @@ bool Hook::disable() {
     }
     is_enabled_ = false; // Update flag before patching
 
-    // Re-patch to the first enabled hook
-    auto first_enabled = std::find_if(info.entries.begin(), info.entries.end(),
-        [](const HookEntry& entry) { return entry.is_enabled; });
-
-    if (first_enabled != info.entries.end()) {
-        if (info.detour_stub) {
-            update_detour_stub(info, reinterpret_cast<uintptr_t>(first_enabled->callback));
-            if (!info.target_patch_code.empty()) {
-                patch_target_with_code(target_address_, info.target_patch_code);
-            } else {
-                patch_target(target_address_, reinterpret_cast<uintptr_t>(first_enabled->callback));
-            }
-        } else {
-            // No stub: direct patch to first enabled callback
-            patch_target(target_address_, reinterpret_cast<uintptr_t>(first_enabled->callback));
-        }
-    } else {
-        restore_target(info);
-    }
-
-    return true;
+    // Re-route to the first enabled hook, or back to the original code
+    return route_target(info);
 }
 
 Hook::Hook(Hook&& other) noexcept
     : target_address_(other.target_address_),
       callback_(other.callback_),
       original_func_(other.original_func_),
-      is_enabled_(other.is_enabled_) {
+      is_enabled_(other.is_enabled_),
+      info_(std::move(other.info_)) {
     if (!is_valid()) return;
-    std::lock_guard<std::mutex> lock(g_hooks_mutex);
-    auto it = g_hooks.find(target_address_);
-    if (it != g_hooks.end()) {
-        auto& info = *it->second;
+    if (info_) {
+        auto& info = *info_;
         std::lock_guard<std::mutex> info_lock(info.info_mutex);
         auto entry_it = std::find_if(info.entries.begin(), info.entries.end(), 
             [&other](const HookEntry& entry) { return entry.owner == &other; });
@@ -725,12 +1259,11 @@ Hook& Hook::operator=(Hook&& other) noexcept {
         callback_ = other.callback_;
         original_func_ = other.original_func_;
         is_enabled_ = other.is_enabled_;
-        
+        info_ = std::move(other.info_);
+
         if (is_valid()) {
-            std::lock_guard<std::mutex> lock(g_hooks_mutex);
-            auto it = g_hooks.find(target_address_);
-            if (it != g_hooks.end()) {
-                auto& info = *it->second;
+            if (info_) {
+                auto& info = *info_;
                 std::lock_guard<std::mutex> info_lock(info.info_mutex);
                 auto entry_it = std::find_if(info.entries.begin(), info.entries.end(), 
                     [&other](const HookEntry& entry) { return entry.owner == &other; });
@@ -748,18 +1281,34 @@ bool Hook::is_valid() const {
     return target_address_ != 0;
 }
 
-uintptr_t Hook::get_trampoline() const {
-    if (!is_valid()) {
+uint64_t Hook::call_count() const {
+    if (!is_valid() || !info_) {
         return 0;
     }
-    std::lock_guard<std::mutex> lock(g_hooks_mutex);
-    auto it = g_hooks.find(target_address_);
-    if (it == g_hooks.end()) {
+    auto& info = *info_;
+    std::lock_guard<std::mutex> info_lock(info.info_mutex);
+    auto entry_it = std::find_if(info.entries.begin(), info.entries.end(),
+        [this](const HookEntry& entry) { return entry.owner == this; });
+    if (entry_it == info.entries.end() || entry_it->counter.counter == nullptr) {
         return 0;
     }
-    auto& info = *it->second;
-    std::lock_guard<std::mutex> info_lock(info.info_mutex);
-    return reinterpret_cast<uintptr_t>(info.trampoline);
+    return entry_it->counter.counter->calls();
+}
+
+bool Hook::is_inherited() const {
+    if (!is_valid() || !info_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> info_lock(info_->info_mutex);
+    return info_->inherited;
+}
+
+uintptr_t Hook::get_trampoline() const {
+    if (!is_valid() || !info_) {
+        return 0;
+    }
+    // No lock needed: the trampoline never changes while a hook references the HookInfo.
+    return reinterpret_cast<uintptr_t>(info_->trampoline);
 }
 
 void Hook::reset() {
@@ -767,6 +1316,447 @@ void Hook::reset() {
     callback_ = nullptr;
     original_func_ = nullptr;
     is_enabled_ = false;
+    info_.reset();
+}
+
+// --- Patch Region Check ---
+
+PatchRegionStatus check_patch_region(uintptr_t target, size_t patch_size) {
+    using disassembler::InstructionId;
+
+    const auto* code = reinterpret_cast<const uint32_t*>(target);
+    const size_t count = (patch_size + 3) / 4;
+    const uintptr_t region_end = target + count * 4;
+
+    for (size_t i = 0; i < count; ++i) {
+        disassembler::DecodedInsn insn;
+        disassembler::decode(target + i * 4, code[i], insn);
+
+        const bool is_last = i + 1 == count;
+        if (!is_last && (insn.id == InstructionId::RET || insn.id == InstructionId::BR || insn.id == InstructionId::B)) {
+            return PatchRegionStatus::EndsFunction;
+        }
+
+        if (insn.is_pc_relative && insn.group == disassembler::InstructionGroup::JUMP && insn.id != InstructionId::BL) {
+            // The branch target is the last operand (TBZ/TBNZ carry the bit number before it).
+            uintptr_t branch_target = static_cast<uintptr_t>(insn.operands[insn.operand_count - 1].imm);
+            if (branch_target > target && branch_target < region_end) {
+                return PatchRegionStatus::BranchIntoRegion;
+            }
+        }
+    }
+    if (count == 1) return PatchRegionStatus::Safe;
+
+    // Branches from the rest of the function come from its (cached) analysis.
+    auto function = function_analysis::analyze(target);
+    if (!function) return PatchRegionStatus::Safe;
+    if (function->has_symbol_bounds() && region_end > function->end()) {
+        return PatchRegionStatus::EndsFunction;
+    }
+    const auto& targets = function->branch_targets();
+    auto next = std::upper_bound(targets.begin(), targets.end(), target);
+    if (next != targets.end() && *next < region_end) {
+        return PatchRegionStatus::BranchIntoRegion;
+    }
+    return PatchRegionStatus::Safe;
+}
+
+// --- HookBatch Implementation ---
+
+namespace {
+
+// Patched bytes of one target and where their relocated copy lives, for moving the
+// threads that are suspended in the middle of the patch.
+struct PcFixup {
+    uintptr_t start = 0; // Target address
+    uintptr_t end = 0;   // End of the bytes the patch overwrites
+    uintptr_t trampoline = 0;
+    std::array<uint16_t, kMaxPatchWords + 1> offsets{};
+    bool restore = false; // The original code is written back over a jump
+};
+
+// Maps an address strictly inside a patch to the same point in the trampoline; the first
+// word is left alone since the thread then runs the patch itself. When the original code is
+// restored, a PC inside the old jump restarts at the target and LR is left alone, since it
+// can only point into the original code. `fixups` is sorted by start.
+// Does not allocate, so it can run while other threads are suspended.
+uintptr_t relocate_pc(std::span<const PcFixup> fixups, uintptr_t pc, bool is_lr = false) {
+    auto it = std::upper_bound(fixups.begin(), fixups.end(), pc,
+                               [](uintptr_t value, const PcFixup& fixup) { return value < fixup.start; });
+    if (it == fixups.begin()) return pc;
+    const PcFixup& fixup = *--it;
+    if (pc <= fixup.start || pc >= fixup.end || (pc & 3) != 0) return pc;
+    if (fixup.restore) return is_lr ? pc : fixup.start;
+    return fixup.trampoline + fixup.offsets[(pc - fixup.start) / 4];
+}
+
+// Applies the patches while every other thread is suspended. Threads stopped inside a
+// patched range continue in the trampoline, and return addresses still held in LR are
+// moved the same way. Returns false if the patches could not be written.
+bool patch_suspended(const std::vector<memory::PatchRequest>& patches, std::span<const PcFixup> fixups,
+                     const thread_suspend::SuspendOptions& options) {
+    // Everything that allocates happens before the threads stop
+    const memory::PatchPlan plan = memory::plan_batch_patch(patches);
+
+    thread_suspend::ScopedSuspend suspended(options);
+    if (!memory::apply_patch_plan(plan)) return false;
+    for (size_t i = 0; i < suspended.size(); ++i) {
+        suspended.set_pc(i, relocate_pc(fixups, suspended.pc(i)));
+        suspended.set_lr(i, relocate_pc(fixups, suspended.lr(i), true));
+    }
+    return true;
+}
+
+} // namespace
+
+void set_trampoline_cache_directory(const std::string& directory) {
+    auto& caches = trampoline_caches();
+    std::unordered_map<std::string, std::shared_ptr<trampoline_cache::Cache>> previous;
+    {
+        std::lock_guard<std::mutex> lock(caches.mutex);
+        if (caches.directory == directory) return;
+        caches.directory = directory;
+        previous.swap(caches.by_build_id);
+    }
+    // The caches of the old directory flush as they are released
+}
+
+bool flush_trampoline_cache() {
+    auto& caches = trampoline_caches();
+    std::vector<std::shared_ptr<trampoline_cache::Cache>> open_caches;
+    {
+        std::lock_guard<std::mutex> lock(caches.mutex);
+        for (const auto& [build_id, cache] : caches.by_build_id) {
+            if (cache) open_caches.push_back(cache);
+        }
+    }
+    bool ok = true;
+    for (const auto& cache : open_caches) {
+        ok = cache->flush() && ok;
+    }
+    return ok;
+}
+
+HookBatch& HookBatch::add(uintptr_t target, Hook::Callback callback, const HookOptions& options) {
+    requests_.push_back({target, callback, options});
+    return *this;
+}
+
+void HookBatch::prepare(uintptr_t target) {
+    if (target == 0) {
+        throw std::invalid_argument("Target must not be null");
+    }
+    auto& shard = shard_for(target);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& slot = shard.hooks[target];
+    if (!slot) {
+        slot = std::make_shared<HookInfo>();
+    }
+    auto& info = *slot;
+    std::unique_lock<std::mutex> info_lock(info.info_mutex);
+    throw_if_inherited(info);
+    info.target_address = target;
+    try {
+        prepare_hook_info(info, target);
+    } catch (...) {
+        // Do not leave a half-prepared target behind when nothing else uses it
+        if (info.entries.empty()) {
+            release_target_memory(info);
+            info_lock.unlock();
+            shard.hooks.erase(target);
+        }
+        throw;
+    }
+}
+
+std::vector<Hook> HookBatch::commit() {
+    for (const auto& request : requests_) {
+        if (request.target == 0) {
+            throw std::invalid_argument("Target must not be null");
+        }
+        if (request.callback == nullptr) {
+            throw std::invalid_argument("Callback must not be null");
+        }
+    }
+
+    std::vector<Hook> hooks;
+    // Chain entries point back at these Hook objects, so the storage must never reallocate.
+    hooks.reserve(requests_.size());
+    std::vector<uintptr_t> touched_targets;
+    touched_targets.reserve(requests_.size());
+
+    // Lock every shard the batch touches, in index order so concurrent batches cannot deadlock.
+    std::vector<size_t> shards;
+    shards.reserve(requests_.size());
+    for (const auto& request : requests_) {
+        shards.push_back(shard_index(request.target));
+    }
+    std::sort(shards.begin(), shards.end());
+    shards.erase(std::unique(shards.begin(), shards.end()), shards.end());
+    std::vector<std::unique_lock<std::mutex>> shard_locks;
+    shard_locks.reserve(shards.size());
+    for (size_t index : shards) {
+        shard_locks.emplace_back(g_registry[index].mutex);
+    }
+
+    // Undo everything done so far. Targets are only patched once batch_patch succeeds,
+    // so rolling back only has to unlink entries, re-route stubs and release memory.
+    auto rollback = [&]() {
+        for (auto hook = hooks.rbegin(); hook != hooks.rend(); ++hook) {
+            if (hook->info_) {
+                auto& info = *hook->info_;
+                std::lock_guard<std::mutex> info_lock(info.info_mutex);
+                auto entry_it = std::find_if(info.entries.begin(), info.entries.end(),
+                    [&](const HookEntry& entry) { return entry.owner == &*hook; });
+                if (entry_it != info.entries.end()) {
+                    size_t link = entry_it->link;
+                    release_entry_thunks(*entry_it);
+                    info.entries.erase(entry_it);
+                    // The hook object is gone, so nothing calls through its link any more.
+                    info.free_links.push_back(link);
+                }
+            }
+            hook->reset();
+        }
+        for (uintptr_t target : touched_targets) {
+            auto& registry = shard_for(target).hooks;
+            auto it = registry.find(target);
+            if (it == registry.end()) continue;
+            auto& info = *it->second;
+            {
+                std::lock_guard<std::mutex> info_lock(info.info_mutex);
+                if (!info.entries.empty()) {
+                    route_target(info);
+                    continue;
+                }
+                release_target_memory(info);
+            }
+            registry.erase(it);
+        }
+    };
+
+    try {
+        // Phase 1: prepare stubs and trampolines and link the new entries into their chains.
+        for (const auto& request : requests_) {
+            auto& slot = shard_for(request.target).hooks[request.target];
+            // The shard lock is enough to read `inherited`; inherited targets stay out of the rollback
+            if (slot) throw_if_inherited(*slot);
+            touched_targets.push_back(request.target);
+            if (!slot) {
+                slot = std::make_shared<HookInfo>();
+            }
+            auto& info = *slot;
+            std::lock_guard<std::mutex> info_lock(info.info_mutex);
+            info.target_address = request.target;
+            info.switchable = info.switchable || request.options.switchable;
+
+            prepare_hook_info(info, request.target);
+
+            hooks.push_back(Hook());
+            Hook& hook = hooks.back();
+            hook.target_address_ = request.target;
+            hook.callback_ = request.callback;
+            size_t link = acquire_link(info);
+            hook.original_func_ = reinterpret_cast<void*>(link_thunk(info, link));
+            hook.is_enabled_ = true;
+            hook.info_ = slot;
+            HookEntry entry{&hook, request.callback, link, true};
+            try {
+                acquire_entry_thunks(entry, request.options, request.target, link_thunk(info, link));
+            } catch (...) {
+                info.free_links.push_back(link);
+                throw;
+            }
+            info.entries.push_front(entry);
+        }
+
+        // Phase 2: patch every distinct target in one pass.
+        std::sort(touched_targets.begin(), touched_targets.end());
+        touched_targets.erase(std::unique(touched_targets.begin(), touched_targets.end()), touched_targets.end());
+
+        std::vector<std::array<uint32_t, kMaxPatchWords>> direct_jumps; // Backing storage for targets without a stub
+        direct_jumps.reserve(touched_targets.size());
+        std::vector<memory::PatchRequest> patches;
+        patches.reserve(touched_targets.size());
+        std::vector<PcFixup> fixups;
+
+        for (uintptr_t target : touched_targets) {
+            auto& info = *shard_for(target).hooks[target];
+            std::lock_guard<std::mutex> info_lock(info.info_mutex);
+            const uintptr_t head = publish_chain(info);
+            if (has_stub(info)) {
+                // Targets already jumping to the stub need no patch.
+                update_detour_stub(info, head);
+                if (info.target_patched) continue;
+                patches.push_back({target, reinterpret_cast<const uint8_t*>(info.target_patch_code.data()),
+                                   info.target_patch_words * sizeof(uint32_t)});
+            } else {
+                // No stub: direct absolute jump to the chain head
+                auto& jump = direct_jumps.emplace_back();
+                assembler::Assembler assembler(target, jump);
+                assembler.gen_abs_jump(head, assembler::Register::X16);
+                patches.push_back({target, reinterpret_cast<const uint8_t*>(jump.data()), assembler.get_code_size()});
+            }
+            if (options_.suspend_threads) {
+                fixups.push_back({target, target + patches.back().size,
+                                  reinterpret_cast<uintptr_t>(info.trampoline), info.relocated_offsets});
+            }
+        }
+
+        // touched_targets is sorted, so the fixups are too
+        const bool patched = options_.suspend_threads ? patch_suspended(patches, fixups, options_.suspend)
+                                                      : memory::batch_patch(patches);
+        if (!patched) {
+            throw std::runtime_error("Failed to patch hook targets");
+        }
+        for (uintptr_t target : touched_targets) {
+            auto& info = *shard_for(target).hooks[target];
+            std::lock_guard<std::mutex> info_lock(info.info_mutex);
+            info.target_patched = true;
+        }
+    } catch (...) {
+        rollback();
+        throw;
+    }
+
+    requests_.clear();
+    return hooks;
+}
+
+bool HookBatch::set_enabled(std::span<Hook* const> hooks, bool enabled) const {
+    bool ok = true;
+    std::vector<Hook*> changed;
+    changed.reserve(hooks.size());
+    for (Hook* hook : hooks) {
+        if (hook == nullptr || !hook->is_valid() || !hook->info_ || (enabled && hook->callback_ == nullptr)) {
+            ok = false;
+            continue;
+        }
+        if (hook->is_enabled_ != enabled) changed.push_back(hook);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    if (changed.empty()) return ok;
+
+    std::vector<uintptr_t> targets;
+    targets.reserve(changed.size());
+    for (Hook* hook : changed) {
+        targets.push_back(hook->target_address_);
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    // Same shard order as commit(), so batches cannot deadlock with each other.
+    std::vector<size_t> shards;
+    shards.reserve(targets.size());
+    for (uintptr_t target : targets) {
+        shards.push_back(shard_index(target));
+    }
+    std::sort(shards.begin(), shards.end());
+    shards.erase(std::unique(shards.begin(), shards.end()), shards.end());
+    std::vector<std::unique_lock<std::mutex>> shard_locks;
+    shard_locks.reserve(shards.size());
+    for (size_t index : shards) {
+        shard_locks.emplace_back(g_registry[index].mutex);
+    }
+
+    auto set_flag = [](Hook& hook, bool value) {
+        auto& info = *hook.info_;
+        auto entry_it = std::find_if(info.entries.begin(), info.entries.end(),
+            [&](const HookEntry& entry) { return entry.owner == &hook; });
+        if (entry_it != info.entries.end()) {
+            entry_it->is_enabled = value;
+        }
+        hook.is_enabled_ = value;
+    };
+
+    // Phase 1: flip the flags. Inherited chains cannot change.
+    std::erase_if(changed, [&](Hook* hook) {
+        std::lock_guard<std::mutex> info_lock(hook->info_->info_mutex);
+        if (hook->info_->inherited) {
+            ok = false;
+            return true;
+        }
+        set_flag(*hook, enabled);
+        return false;
+    });
+
+    // Phase 2: re-route every target like route_target(), but collect the code changes.
+    struct Routed {
+        HookInfo* info;
+        bool patched; // target_patched once the patches are written
+    };
+    std::vector<Routed> routed;
+    std::vector<std::array<uint32_t, kMaxPatchWords>> direct_jumps; // Backing storage for targets without a stub
+    direct_jumps.reserve(targets.size());
+    std::vector<memory::PatchRequest> patches;
+    patches.reserve(targets.size());
+    std::vector<PcFixup> fixups;
+
+    for (uintptr_t target : targets) {
+        auto it = shard_for(target).hooks.find(target);
+        if (it == shard_for(target).hooks.end()) continue;
+        auto& info = *it->second;
+        std::lock_guard<std::mutex> info_lock(info.info_mutex);
+        if (info.inherited) continue;
+        const auto trampoline = reinterpret_cast<uintptr_t>(info.trampoline);
+        const uintptr_t head = publish_chain(info);
+
+        PcFixup fixup{target, 0, trampoline, info.relocated_offsets};
+        if (head == trampoline && !(info.switchable && has_stub(info))) {
+            update_detour_stub(info, trampoline);
+            if (!info.target_patched) continue;
+            patches.push_back({target, info.original_code.data(), info.backup_size});
+            routed.push_back({&info, false});
+            fixup.restore = true;
+        } else if (!has_stub(info)) {
+            auto& jump = direct_jumps.emplace_back();
+            assembler::Assembler assembler(target, jump);
+            assembler.gen_abs_jump(head, assembler::Register::X16);
+            patches.push_back({target, reinterpret_cast<const uint8_t*>(jump.data()), assembler.get_code_size()});
+            routed.push_back({&info, true});
+        } else {
+            update_detour_stub(info, head);
+            if (info.target_patched) continue;
+            patches.push_back({target, reinterpret_cast<const uint8_t*>(info.target_patch_code.data()),
+                               info.target_patch_words * sizeof(uint32_t)});
+            routed.push_back({&info, true});
+        }
+        if (options_.suspend_threads) {
+            fixup.end = target + patches.back().size;
+            fixups.push_back(fixup);
+        }
+    }
+
+    // Phase 3: one pass over all targets; targets is sorted, so the fixups are too.
+    bool patched = true;
+    if (!patches.empty()) {
+        try {
+            patched = options_.suspend_threads ? patch_suspended(patches, fixups, options_.suspend)
+                                               : memory::batch_patch(patches);
+        } catch (...) {
+            patched = false;
+        }
+    }
+    if (!patched) {
+        // Nothing was written: restore the flags and route every target as before.
+        for (Hook* hook : changed) {
+            std::lock_guard<std::mutex> info_lock(hook->info_->info_mutex);
+            set_flag(*hook, !enabled);
+        }
+        for (uintptr_t target : targets) {
+            auto it = shard_for(target).hooks.find(target);
+            if (it == shard_for(target).hooks.end()) continue;
+            std::lock_guard<std::mutex> info_lock(it->second->info_mutex);
+            if (!it->second->inherited) route_target(*it->second);
+        }
+        return false;
+    }
+    for (const auto& [info, value] : routed) {
+        std::lock_guard<std::mutex> info_lock(info->info_mutex);
+        info->target_patched = value;
+    }
+    return ok;
 }
 
 } // namespace ur::inline_hook
@@ -0,0 +1,143 @@
+#include "ur/capi.h"
+#include "ur/inline_hook.h"
+#include <memory>
+#include <new>
+#include <vector>
+
+extern "C" {
+
+struct ur_inline_hook {
+    std::unique_ptr<ur::inline_hook::Hook> impl;
+};
+
+ur_status_t ur_inline_hook_create(uintptr_t target, void* callback, int enable_now, ur_inline_hook_t** out) {
+    if (out == nullptr || target == 0 || (callback == nullptr && enable_now)) return UR_STATUS_INVALID_ARG;
+    *out = nullptr;
+    ur_inline_hook_t* h = new (std::nothrow) ur_inline_hook_t{};
+    if (!h) return UR_STATUS_ERROR;
+    try {
+        h->impl = std::make_unique<ur::inline_hook::Hook>(target, callback, enable_now != 0);
+    } catch (...) {
+        delete h;
+        return UR_STATUS_ERROR;
+    }
+    *out = h;
+    return UR_STATUS_OK;
+}
+
+void ur_inline_hook_destroy(ur_inline_hook_t* hook) {
+    delete hook;
+}
+
+int ur_inline_hook_is_valid(const ur_inline_hook_t* hook) {
+    if (!hook || !hook->impl) return 0;
+    return hook->impl->is_valid() ? 1 : 0;
+}
+
+ur_status_t ur_inline_hook_enable(ur_inline_hook_t* hook) {
+    if (!hook || !hook->impl) return UR_STATUS_INVALID_ARG;
+    return hook->impl->enable() ? UR_STATUS_OK : UR_STATUS_ERROR;
+}
+
+ur_status_t ur_inline_hook_disable(ur_inline_hook_t* hook) {
+    if (!hook || !hook->impl) return UR_STATUS_INVALID_ARG;
+    return hook->impl->disable() ? UR_STATUS_OK : UR_STATUS_ERROR;
+}
+
+ur_status_t ur_inline_hook_unhook(ur_inline_hook_t* hook) {
+    if (!hook || !hook->impl) return UR_STATUS_INVALID_ARG;
+    hook->impl->unhook();
+    return UR_STATUS_OK;
+}
+
+void* ur_inline_hook_get_trampoline(const ur_inline_hook_t* hook) {
+    if (!hook || !hook->impl) return nullptr;
+    return reinterpret_cast<void*>(hook->impl->get_trampoline());
+}
+
+ur_status_t ur_inline_hook_set_detour(ur_inline_hook_t* hook, void* callback) {
+    if (!hook || !hook->impl || !callback) return UR_STATUS_INVALID_ARG;
+    if (!hook->impl->is_valid()) return UR_STATUS_ERROR;
+    hook->impl->set_detour(callback);
+    return UR_STATUS_OK;
+}
+
+ur_status_t ur_inline_hook_create_many(const uintptr_t* targets, void* const* callbacks, size_t count,
+                                       int suspend_threads, ur_inline_hook_t** out_hooks) {
+    if (count == 0) return UR_STATUS_OK;
+    if (!targets || !callbacks || !out_hooks) return UR_STATUS_INVALID_ARG;
+    for (size_t i = 0; i < count; ++i) {
+        out_hooks[i] = nullptr;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (targets[i] == 0 || callbacks[i] == nullptr) return UR_STATUS_INVALID_ARG;
+    }
+
+    std::vector<std::unique_ptr<ur_inline_hook_t>> handles;
+    try {
+        ur::inline_hook::BatchOptions options;
+        options.suspend_threads = suspend_threads != 0;
+        ur::inline_hook::HookBatch batch(options);
+        for (size_t i = 0; i < count; ++i) {
+            batch.add(targets[i], callbacks[i]);
+        }
+        std::vector<ur::inline_hook::Hook> hooks = batch.commit();
+
+        // 分配失败时 hooks 与已建立的句柄一起析构，整个批次被卸载
+        handles.reserve(count);
+        for (auto& hook : hooks) {
+            auto handle = std::make_unique<ur_inline_hook_t>();
+            handle->impl = std::make_unique<ur::inline_hook::Hook>(std::move(hook));
+            handles.push_back(std::move(handle));
+        }
+    } catch (...) {
+        return UR_STATUS_ERROR;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        out_hooks[i] = handles[i].release();
+    }
+    return UR_STATUS_OK;
+}
+
+}
+
+namespace {
+
+// 收集非空句柄，用一次 HookBatch::set_enabled 完成启用/禁用
+ur_status_t set_enabled_many(ur_inline_hook_t* const* hooks, size_t count, int suspend_threads, bool enabled) {
+    if (!hooks && count != 0) return UR_STATUS_INVALID_ARG;
+    try {
+        std::vector<ur::inline_hook::Hook*> impls;
+        impls.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (hooks[i] && hooks[i]->impl) impls.push_back(hooks[i]->impl.get());
+        }
+        ur::inline_hook::BatchOptions options;
+        options.suspend_threads = suspend_threads != 0;
+        return ur::inline_hook::HookBatch(options).set_enabled(impls, enabled) ? UR_STATUS_OK : UR_STATUS_ERROR;
+    } catch (...) {
+        return UR_STATUS_ERROR;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+ur_status_t ur_inline_hook_enable_many(ur_inline_hook_t* const* hooks, size_t count, int suspend_threads) {
+    return set_enabled_many(hooks, count, suspend_threads, true);
+}
+
+ur_status_t ur_inline_hook_disable_many(ur_inline_hook_t* const* hooks, size_t count, int suspend_threads) {
+    return set_enabled_many(hooks, count, suspend_threads, false);
+}
+
+void ur_inline_hook_destroy_many(ur_inline_hook_t* const* hooks, size_t count) {
+    if (!hooks) return;
+    // 同一目标上的 Hook 按安装的逆序移除
+    for (size_t i = count; i > 0; --i) {
+        delete hooks[i - 1];
+    }
+}
+
+} // extern "C"
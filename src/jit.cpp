@@ -1,23 +1,44 @@
 #include "ur/jit.h"
+#include <algorithm>
 #include <utility>
 #include <stdexcept>
 
 namespace ur::jit {
 
-    uint32_t Label::next_id_ = 0;
+    namespace {
+        using assembler::Condition;
 
-    Jit::Jit(uintptr_t address) : ur::assembler::Assembler(address) {}
+        // Largest forward distance in bytes each fixup kind can encode
+        constexpr int64_t kReach[] = {
+            134217724, // kBranch26
+            1048572,   // kBranch19
+            32764,     // kBranch14
+            1048572,   // kLiteral19
+            1048575,   // kAdr21
+        };
+
+        Condition invert(Condition cond) {
+            return static_cast<Condition>(static_cast<int>(cond) ^ 1);
+        }
+    }
+
+    Jit::Jit(uintptr_t address) : ur::assembler::Assembler(address), fixed_address_(address != 0) {}
 
     Jit::~Jit() {
         if (mem_ != nullptr) {
-            munmap(mem_, size_);
+            exec_pool::free(mem_);
         }
     }
 
     Jit::Jit(Jit&& other) noexcept : ur::assembler::Assembler(std::move(other)) {
         mem_ = other.mem_;
         size_ = other.size_;
-        label_patches_ = std::move(other.label_patches_);
+        fixed_address_ = other.fixed_address_;
+        label_offsets_ = std::move(other.label_offsets_);
+        fixups_ = std::move(other.fixups_);
+        next_deadline_ = other.next_deadline_;
+        literals_ = std::move(other.literals_);
+        literal_index_ = std::move(other.literal_index_);
         other.mem_ = nullptr;
         other.size_ = 0;
     }
@@ -26,11 +47,16 @@ namespace ur::jit {
         if (this != &other) {
             ur::assembler::Assembler::operator=(std::move(other));
             if (mem_ != nullptr) {
-                munmap(mem_, size_);
+                exec_pool::free(mem_);
             }
             mem_ = other.mem_;
             size_ = other.size_;
-            label_patches_ = std::move(other.label_patches_);
+            fixed_address_ = other.fixed_address_;
+            label_offsets_ = std::move(other.label_offsets_);
+            fixups_ = std::move(other.fixups_);
+            next_deadline_ = other.next_deadline_;
+            literals_ = std::move(other.literals_);
+            literal_index_ = std::move(other.literal_index_);
             other.mem_ = nullptr;
             other.size_ = 0;
         }
@@ -45,57 +71,325 @@ namespace ur::jit {
     }
 
     Label Jit::new_label() {
-        return Label();
+        Label label;
+        label.id_ = new_label_id();
+        return label;
+    }
+
+    uint32_t Jit::new_label_id() {
+        label_offsets_.push_back(-1);
+        return static_cast<uint32_t>(label_offsets_.size() - 1);
+    }
+
+    uint32_t Jit::label_id(Label& label) {
+        if (label.id_ == Label::kNoId) {
+            label.id_ = new_label_id();
+        }
+        return label.id_;
+    }
+
+    uintptr_t Jit::label_address(uint32_t id) const {
+        return get_current_address() - get_code_size() + label_offsets_[id];
     }
 
     void Jit::bind(Label& label) {
         if (label.is_bound()) {
             throw std::runtime_error("Label is already bound");
         }
+        check_island(0);
+        const uint32_t id = label_id(label);
+        label.offset_ = static_cast<int32_t>(get_code_size());
+        label_offsets_[id] = label.offset_;
+    }
+
+    void Jit::add_fixup(uint32_t label, FixupKind kind) {
+        const size_t offset = get_code_size();
+        fixups_.push_back({static_cast<uint32_t>(offset), label, kind});
+        next_deadline_ = std::min(next_deadline_, offset + static_cast<size_t>(kReach[static_cast<int>(kind)]));
+    }
+
+    void Jit::b(Label& label) {
+        check_island(4);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            ur::assembler::Assembler::b(label_address(id));
+        } else {
+            add_fixup(id, FixupKind::kBranch26);
+            ur::assembler::Assembler::b(get_current_address()); // Placeholder branching to itself
+        }
+    }
+
+    void Jit::bl(Label& label) {
+        check_island(4);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            ur::assembler::Assembler::bl(label_address(id));
+        } else {
+            add_fixup(id, FixupKind::kBranch26);
+            ur::assembler::Assembler::bl(get_current_address());
+        }
+    }
 
-        auto& code = get_code_mut();
-        uint32_t current_offset = code.size() * 4;
-        label.offset_ = current_offset;
-        label.bound_ = true;
-
-        // Patch all previous references to this label
-        for (auto const& patch_site_offset : label.references_) {
-            uint32_t instruction = code[patch_site_offset / 4];
-            int32_t relative_offset = current_offset - patch_site_offset;
-
-            // This logic assumes branch instructions (B and B.cond)
-            // The offset is encoded in the lower 26 bits for B, and 19 bits for B.cond
-            if ((instruction & 0xFC000000) == 0x14000000) { // Unconditional Branch (B)
-                uint32_t imm26 = (relative_offset >> 2) & 0x3FFFFFF;
-                code[patch_site_offset / 4] |= imm26;
-            } else if ((instruction & 0xFF000010) == 0x54000000) { // Conditional Branch (B.cond)
-                uint32_t imm19 = (relative_offset >> 2) & 0x7FFFF;
-                code[patch_site_offset / 4] |= (imm19 << 5);
+    void Jit::b(Condition cond, Label& label) {
+        check_island(8);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            const uintptr_t target = label_address(id);
+            if (!try_b(cond, target)) {
+                if (cond != Condition::AL && cond != Condition::NV) {
+                    ur::assembler::Assembler::b(invert(cond), get_current_address() + 8);
+                }
+                ur::assembler::Assembler::b(target);
             }
+        } else {
+            add_fixup(id, FixupKind::kBranch19);
+            ur::assembler::Assembler::b(cond, get_current_address());
         }
-        label.references_.clear(); // All patched
     }
 
-    void Jit::b(Label& label) {
-        if (label.is_bound()) {
-            // If the label is already bound, we know the target address
-            ur::assembler::Assembler::b(get_current_address() + (label.offset() - get_code_size()));
+    void Jit::cbz(assembler::Register rt, Label& label) {
+        check_island(8);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            const uintptr_t target = label_address(id);
+            if (ur::assembler::Assembler::can_encode_b_cond(get_current_address(), target)) {
+                ur::assembler::Assembler::cbz(rt, target);
+            } else {
+                ur::assembler::Assembler::cbnz(rt, get_current_address() + 8);
+                ur::assembler::Assembler::b(target);
+            }
         } else {
-            // Label is not bound yet, emit a placeholder and record for patching
-            uint32_t current_offset = get_code_size();
-            label.references_.push_back(current_offset);
-            ur::assembler::Assembler::b(get_current_address()); // Emit B instruction pointing to itself
+            add_fixup(id, FixupKind::kBranch19);
+            ur::assembler::Assembler::cbz(rt, get_current_address());
         }
     }
 
-    void Jit::b(assembler::Condition cond, Label& label) {
-        if (label.is_bound()) {
-            ur::assembler::Assembler::b(cond, get_current_address() + (label.offset() - get_code_size()));
+    void Jit::cbnz(assembler::Register rt, Label& label) {
+        check_island(8);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            const uintptr_t target = label_address(id);
+            if (ur::assembler::Assembler::can_encode_b_cond(get_current_address(), target)) {
+                ur::assembler::Assembler::cbnz(rt, target);
+            } else {
+                ur::assembler::Assembler::cbz(rt, get_current_address() + 8);
+                ur::assembler::Assembler::b(target);
+            }
+        } else {
+            add_fixup(id, FixupKind::kBranch19);
+            ur::assembler::Assembler::cbnz(rt, get_current_address());
+        }
+    }
+
+    void Jit::tbz(assembler::Register rt, uint32_t bit, Label& label) {
+        check_island(8);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            const uintptr_t target = label_address(id);
+            if (ur::assembler::Assembler::can_encode_tbz(get_current_address(), target)) {
+                ur::assembler::Assembler::tbz(rt, bit, target);
+            } else {
+                ur::assembler::Assembler::tbnz(rt, bit, get_current_address() + 8);
+                ur::assembler::Assembler::b(target);
+            }
         } else {
-            uint32_t current_offset = get_code_size();
-            label.references_.push_back(current_offset);
-            ur::assembler::Assembler::b(cond, get_current_address()); // Emit B.cond pointing to itself
+            add_fixup(id, FixupKind::kBranch14);
+            ur::assembler::Assembler::tbz(rt, bit, get_current_address());
+        }
+    }
+
+    void Jit::tbnz(assembler::Register rt, uint32_t bit, Label& label) {
+        check_island(8);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            const uintptr_t target = label_address(id);
+            if (ur::assembler::Assembler::can_encode_tbz(get_current_address(), target)) {
+                ur::assembler::Assembler::tbnz(rt, bit, target);
+            } else {
+                ur::assembler::Assembler::tbz(rt, bit, get_current_address() + 8);
+                ur::assembler::Assembler::b(target);
+            }
+        } else {
+            add_fixup(id, FixupKind::kBranch14);
+            ur::assembler::Assembler::tbnz(rt, bit, get_current_address());
+        }
+    }
+
+    void Jit::adr(assembler::Register rd, Label& label) {
+        check_island(4);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            ur::assembler::Assembler::adr(rd, label_address(id));
+        } else {
+            add_fixup(id, FixupKind::kAdr21);
+            ur::assembler::Assembler::adr(rd, get_current_address());
+        }
+    }
+
+    void Jit::ldr_literal(assembler::Register rt, Label& label) {
+        check_island(4);
+        const uint32_t id = label_id(label);
+        if (label_offsets_[id] >= 0) {
+            ur::assembler::Assembler::ldr_literal(rt, static_cast<int64_t>(label_address(id) - get_current_address()));
+        } else {
+            add_fixup(id, FixupKind::kLiteral19);
+            ur::assembler::Assembler::ldr_literal(rt, 0);
+        }
+    }
+
+    void Jit::ldr_constant(assembler::Register rt, uint64_t value) {
+        check_island(4);
+        auto [it, inserted] = literal_index_.try_emplace(value, static_cast<uint32_t>(literals_.size()));
+        if (inserted) {
+            literals_.push_back({value, new_label_id()});
+        }
+        add_fixup(literals_[it->second].label, FixupKind::kLiteral19);
+        ur::assembler::Assembler::ldr_literal(rt, 0);
+    }
+
+    void Jit::place_literal_pool() {
+        if (literals_.empty()) {
+            return;
+        }
+
+        // Keep the 8-byte slots naturally aligned
+        if (get_current_address() & 7) {
+            nop();
+        }
+        for (const auto& literal : literals_) {
+            label_offsets_[literal.label] = static_cast<int32_t>(get_code_size());
+            emit_quad(literal.value);
+        }
+        literals_.clear();
+        literal_index_.clear();
+    }
+
+    // The earliest offset by which an unresolved reference must see its label, and the
+    // number of those references that can be redirected through a veneer.
+    size_t Jit::pending_deadline(size_t* veneers) const {
+        size_t deadline = SIZE_MAX;
+        size_t count = 0;
+        for (const auto& fixup : fixups_) {
+            if (label_offsets_[fixup.label] >= 0) {
+                continue;
+            }
+            deadline = std::min(deadline, fixup.offset + static_cast<size_t>(kReach[static_cast<int>(fixup.kind)]));
+            if (fixup.kind == FixupKind::kBranch19 || fixup.kind == FixupKind::kBranch14) {
+                ++count;
+            }
+        }
+        if (veneers != nullptr) {
+            *veneers = count;
+        }
+        return deadline;
+    }
+
+    void Jit::check_island(size_t upcoming) {
+        // next_deadline_ only ever errs early: binding a label retires its references
+        // without updating it, so recompute before deciding to emit an island.
+        const size_t end = get_code_size() + upcoming + kIslandMargin + literals_.size() * sizeof(uint64_t);
+        if (end < next_deadline_) {
+            return;
+        }
+        size_t veneers = 0;
+        next_deadline_ = pending_deadline(&veneers);
+        if (end + 8 + veneers * 4 < next_deadline_) {
+            return;
+        }
+        place_island();
+    }
+
+    void Jit::place_island() {
+        // Execution branches over the island
+        const uint32_t over = new_label_id();
+        add_fixup(over, FixupKind::kBranch26);
+        ur::assembler::Assembler::b(get_current_address());
+
+        // Each pending short-range branch is redirected to a B that reaches its label
+        const size_t count = fixups_.size();
+        for (size_t i = 0; i < count; ++i) {
+            const Fixup fixup = fixups_[i];
+            if ((fixup.kind != FixupKind::kBranch19 && fixup.kind != FixupKind::kBranch14) ||
+                label_offsets_[fixup.label] >= 0) {
+                continue;
+            }
+            const uint32_t veneer = new_label_id();
+            label_offsets_[veneer] = static_cast<int32_t>(get_code_size());
+            fixups_[i].label = veneer;
+            add_fixup(fixup.label, FixupKind::kBranch26);
+            ur::assembler::Assembler::b(get_current_address());
+        }
+
+        place_literal_pool();
+        label_offsets_[over] = static_cast<int32_t>(get_code_size());
+        next_deadline_ = pending_deadline(nullptr);
+    }
+
+    void Jit::finish() {
+        place_literal_pool();
+
+        auto code = get_code_span_mut();
+        for (const auto& fixup : fixups_) {
+            const int32_t target = label_offsets_[fixup.label];
+            if (target < 0) {
+                throw std::runtime_error("Label is not bound");
+            }
+            // Placeholders refer to themselves, so their offset fields are zero
+            const int64_t delta = static_cast<int64_t>(target) - fixup.offset;
+            const int64_t reach = kReach[static_cast<int>(fixup.kind)];
+            const int64_t lowest = fixup.kind == FixupKind::kAdr21 ? -reach - 1 : -reach - 4;
+            if (delta > reach || delta < lowest) {
+                throw std::runtime_error("Label out of range");
+            }
+            uint32_t& insn = code[fixup.offset / 4];
+            const auto value = static_cast<uint32_t>(delta);
+            switch (fixup.kind) {
+                case FixupKind::kBranch26:
+                    insn |= (value >> 2) & 0x3FFFFFF;
+                    break;
+                case FixupKind::kBranch19:
+                case FixupKind::kLiteral19:
+                    insn |= ((value >> 2) & 0x7FFFF) << 5;
+                    break;
+                case FixupKind::kBranch14:
+                    insn |= ((value >> 2) & 0x3FFF) << 5;
+                    break;
+                case FixupKind::kAdr21:
+                    insn |= ((value & 0x3) << 29) | (((value >> 2) & 0x7FFFF) << 5);
+                    break;
+            }
+        }
+        fixups_.clear();
+        next_deadline_ = SIZE_MAX;
+    }
+
+    void Jit::load_address(assembler::Register rd, uintptr_t address) {
+        using ur::assembler::Assembler;
+        const uintptr_t pc = get_current_address();
+        if (fixed_address_ && Assembler::can_encode_adr(pc, address)) {
+            ur::assembler::Assembler::adr(rd, address);
+        } else if (fixed_address_ && Assembler::can_encode_adrp(pc, address)) {
+            adrp(rd, address);
+            add(rd, rd, static_cast<uint16_t>(address & 0xFFF));
+        } else {
+            ldr_constant(rd, address);
+        }
+    }
+
+    void Jit::jump(uintptr_t destination, assembler::Register scratch) {
+        if (fixed_address_ && try_b(destination)) {
+            return;
+        }
+        ldr_constant(scratch, destination);
+        br(scratch);
+    }
+
+    void Jit::call(uintptr_t destination, assembler::Register scratch) {
+        if (fixed_address_ && try_bl(destination)) {
+            return;
         }
+        ldr_constant(scratch, destination);
+        blr(scratch);
     }
 
 }
@@ -1,8 +1,13 @@
 #include "ur/maps_parser.h"
-#include <fstream>
-#include <sstream>
+#include "ur/fork_safety.h"
+#include <cerrno>
+#include <cstring>
 #include <algorithm>
 #include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 namespace ur::maps_parser {
 
@@ -11,7 +16,12 @@ namespace ur::maps_parser {
 
     elf_parser::ElfParser* MapInfo::get_elf_parser() const {
         if (!m_elf_parser) {
-            m_elf_parser = std::make_unique<elf_parser::ElfParser>(m_start);
+            // 有文件路径时允许解析器回退到磁盘文件读取未加载的节头与 .symtab
+            if (!m_path.empty() && m_path[0] == '/') {
+                m_elf_parser = std::make_unique<elf_parser::ElfParser>(m_start, m_path, m_offset);
+            } else {
+                m_elf_parser = std::make_unique<elf_parser::ElfParser>(m_start);
+            }
             if (!m_elf_parser->parse()) {
                 m_elf_parser.reset(); // Reset if parsing fails
             }
@@ -36,24 +46,11 @@ namespace ur::maps_parser {
     }
 
     std::vector<MapInfo> MapsParser::parse() {
+        auto snapshot = MapsSnapshot::capture();
         std::vector<MapInfo> maps;
-        std::ifstream file("/proc/self/maps");
-        std::string line;
-
-        while (std::getline(file, line)) {
-            std::stringstream ss(line);
-            uintptr_t start, end, offset;
-            std::string perms, dev, path;
-            ino_t inode;
-            char dash;
-
-            ss >> std::hex >> start >> dash >> end >> perms >> offset >> dev >> inode;
-            
-            // After the inode, there might be whitespace before the path
-            ss >> std::ws;
-            std::getline(ss, path);
-
-            maps.emplace_back(start, end, perms, offset, path);
+        maps.reserve(snapshot->size());
+        for (const auto& entry : snapshot->entries()) {
+            maps.emplace_back(entry.start, entry.end, std::string(entry.perms), entry.offset, std::string(entry.path));
         }
         return maps;
     }
@@ -74,5 +71,219 @@ namespace ur::maps_parser {
         return it != maps.end() ? &(*it) : nullptr;
     }
 
-}
+    // --- MapsSnapshot ---
+
+    namespace {
+
+        int hex_digit(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // Parses a hex number at p, advancing p past it.
+        std::uintptr_t parse_hex(const char*& p, const char* end) {
+            std::uintptr_t value = 0;
+            int digit;
+            while (p < end && (digit = hex_digit(*p)) >= 0) {
+                value = (value << 4) | static_cast<std::uintptr_t>(digit);
+                ++p;
+            }
+            return value;
+        }
+
+        void skip_field(const char*& p, const char* end) {
+            while (p < end && *p != ' ' && *p != '\t') ++p;
+        }
+
+        void skip_spaces(const char*& p, const char* end) {
+            while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        }
+
+        // Parses one line ("start-end perms offset dev inode path"). Returns false on malformed input.
+        bool parse_line(const char* p, const char* end, MapEntry& entry) {
+            entry.start = parse_hex(p, end);
+            if (p >= end || *p != '-') return false;
+            ++p;
+            entry.end = parse_hex(p, end);
+            skip_spaces(p, end);
+
+            const char* perms = p;
+            skip_field(p, end);
+            if (p - perms < 4) return false;
+            for (int i = 0; i < 4; ++i) entry.perms[i] = perms[i];
+            entry.perms[4] = '\0';
+            entry.prot = (perms[0] == 'r' ? PROT_READ : 0) |
+                         (perms[1] == 'w' ? PROT_WRITE : 0) |
+                         (perms[2] == 'x' ? PROT_EXEC : 0);
+            entry.is_private = perms[3] == 'p';
+            skip_spaces(p, end);
+
+            entry.offset = parse_hex(p, end);
+            skip_spaces(p, end);
+            skip_field(p, end); // dev
+            skip_spaces(p, end);
+            skip_field(p, end); // inode
+            skip_spaces(p, end);
+
+            // The rest of the line is the path, which might contain spaces
+            entry.path = std::string_view(p, static_cast<std::size_t>(end - p));
+            return true;
+        }
+
+        bool read_proc_maps(std::string& out) {
+            int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+
+            out.clear();
+            std::size_t used = 0;
+            out.resize(64 * 1024);
+            while (true) {
+                if (out.size() - used < 4096) {
+                    out.resize(out.size() * 2);
+                }
+                ssize_t n = ::read(fd, &out[used], out.size() - used);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    close(fd);
+                    return false;
+                }
+                if (n == 0) break;
+                used += static_cast<std::size_t>(n);
+            }
+            close(fd);
+            out.resize(used);
+            return true;
+        }
+
+        std::mutex g_snapshot_mutex;
+        std::shared_ptr<const MapsSnapshot> g_snapshot;
+
+        // Held across fork() (see ur::fork_safety).
+        [[maybe_unused]] const bool g_fork_participant = fork_safety::add_participant({
+            fork_safety::Rank::Maps,
+            [] { g_snapshot_mutex.lock(); },
+            [] { g_snapshot_mutex.unlock(); },
+        });
+
+    } // namespace
+
+    MapsSnapshot::MapsSnapshot(std::string contents) : m_buffer(std::move(contents)) {
+        const char* p = m_buffer.data();
+        const char* end = p + m_buffer.size();
+
+        m_entries.reserve(static_cast<std::size_t>(std::count(p, end, '\n')) + 1);
+        while (p < end) {
+            const char* line_end = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+            if (!line_end) line_end = end;
+
+            MapEntry entry;
+            if (line_end > p && parse_line(p, line_end, entry)) {
+                m_entries.push_back(entry);
+            }
+            p = line_end + 1;
+        }
+
+        // The kernel already emits mappings in address order; only sort if the input did not.
+        if (!std::is_sorted(m_entries.begin(), m_entries.end(),
+                            [](const MapEntry& a, const MapEntry& b) { return a.start < b.start; })) {
+            std::sort(m_entries.begin(), m_entries.end(),
+                      [](const MapEntry& a, const MapEntry& b) { return a.start < b.start; });
+        }
+
+        for (std::size_t i = 0; i < m_entries.size(); ++i) {
+            if (!m_entries[i].path.empty()) {
+                m_path_index[m_entries[i].path].push_back(i);
+            }
+        }
+    }
+
+    std::shared_ptr<const MapsSnapshot> MapsSnapshot::capture() {
+        std::string contents;
+        if (!read_proc_maps(contents)) {
+            contents.clear();
+        }
+        return std::make_shared<const MapsSnapshot>(std::move(contents));
+    }
+
+    std::shared_ptr<const MapsSnapshot> MapsSnapshot::current() {
+        std::lock_guard<std::mutex> lock(g_snapshot_mutex);
+        if (!g_snapshot) {
+            g_snapshot = capture();
+        }
+        return g_snapshot;
+    }
+
+    std::shared_ptr<const MapsSnapshot> MapsSnapshot::refresh() {
+        auto snapshot = capture();
+        std::lock_guard<std::mutex> lock(g_snapshot_mutex);
+        g_snapshot = snapshot;
+        return snapshot;
+    }
+
+    void MapsSnapshot::invalidate() {
+        std::lock_guard<std::mutex> lock(g_snapshot_mutex);
+        g_snapshot.reset();
+    }
+
+    const MapEntry* MapsSnapshot::find_by_addr(std::uintptr_t addr) const {
+        auto it = std::upper_bound(m_entries.begin(), m_entries.end(), addr,
+                                   [](std::uintptr_t value, const MapEntry& entry) { return value < entry.start; });
+        if (it == m_entries.begin()) return nullptr;
+        --it;
+        return it->contains(addr) ? &*it : nullptr;
+    }
+
+    std::uintptr_t MapsSnapshot::find_gap(std::uintptr_t near, std::size_t size, std::size_t max_distance,
+                                          std::size_t alignment) const {
+        if (size == 0 || alignment == 0 || m_entries.size() < 2) return 0;
+        const std::uintptr_t mask = ~(static_cast<std::uintptr_t>(alignment) - 1);
+        const std::uintptr_t low = near > max_distance ? near - max_distance : 0;
+        const std::uintptr_t high = near + max_distance < near ? UINTPTR_MAX : near + max_distance;
+        auto distance = [near](std::uintptr_t address) { return address > near ? address - near : near - address; };
+
+        // First mapping ending after the window starts; the hole before it may still reach in
+        auto it = std::upper_bound(m_entries.begin(), m_entries.end(), low,
+                                   [](std::uintptr_t value, const MapEntry& entry) { return value < entry.end; });
+        std::size_t index = it == m_entries.begin() ? 0 : static_cast<std::size_t>(it - m_entries.begin()) - 1;
+
+        std::uintptr_t best = 0;
+        std::uintptr_t best_distance = UINTPTR_MAX;
+        for (; index + 1 < m_entries.size(); ++index) {
+            const std::uintptr_t hole_start = (m_entries[index].end + alignment - 1) & mask;
+            const std::uintptr_t hole_end = m_entries[index + 1].start;
+            if (hole_start >= high) break;
+            if (hole_start >= hole_end || hole_end - hole_start < size) continue;
+
+            // The aligned start inside the hole that is nearest to `near`
+            const std::uintptr_t last_start = (hole_end - size) & mask;
+            if (last_start < hole_start) continue;
+            const std::uintptr_t candidate = std::clamp(near & mask, hole_start, last_start);
+            const std::uintptr_t farthest = std::max(distance(candidate), distance(candidate + size));
+            if (farthest <= max_distance && farthest < best_distance) {
+                best = candidate;
+                best_distance = farthest;
+            }
+        }
+        return best;
+    }
+
+    const MapEntry* MapsSnapshot::find_by_path(std::string_view path) const {
+        auto it = m_path_index.find(path);
+        if (it == m_path_index.end()) return nullptr;
+        return &m_entries[it->second.front()];
+    }
 
+    std::vector<const MapEntry*> MapsSnapshot::find_all_by_path(std::string_view path) const {
+        std::vector<const MapEntry*> result;
+        auto it = m_path_index.find(path);
+        if (it == m_path_index.end()) return result;
+        result.reserve(it->second.size());
+        for (std::size_t index : it->second) {
+            result.push_back(&m_entries[index]);
+        }
+        return result;
+    }
+
+}
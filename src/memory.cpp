@@ -1,13 +1,147 @@
 #include "ur/memory.h"
+#include "ur/maps_parser.h"
+#include "ur/exec_pool.h"
+#include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <cstring>
 #include <sys/uio.h> // For process_vm_writev
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <utility>
 
 namespace ur {
     namespace memory {
+        namespace {
+            // process_vm_readv/writev 被拒绝（ENOSYS，或 seccomp 返回的 EPERM）后不再尝试
+            std::atomic<bool> g_vm_calls_unavailable{false};
+
+            // [address, address + size) 是否完全落在具有 prot 权限的映射中
+            bool range_accessible(uintptr_t address, size_t size, int prot) {
+                const uintptr_t end = address + size;
+                if (end < address) return false;
+                auto snapshot = maps_parser::MapsSnapshot::current();
+                bool refreshed = false;
+                for (uintptr_t cursor = address; cursor < end;) {
+                    const maps_parser::MapEntry* entry = snapshot->find_by_addr(cursor);
+                    if (!entry && !refreshed) {
+                        snapshot = maps_parser::MapsSnapshot::refresh();
+                        refreshed = true;
+                        continue;
+                    }
+                    if (!entry || (entry->prot & prot) != prot) return false;
+                    cursor = entry->end;
+                }
+                return true;
+            }
+
+            // process_vm_readv 不可用时的容错读取：把数据 write() 进管道再读回。由内核代为访问源地址，
+            // 未映射或不可读的页返回 EFAULT 而不是触发 SIGSEGV，权限判断与直接访问一致（/proc/self/mem
+            // 会强制读取不可读的页）。无法创建管道时读取失败。管道只在一次 read_many 内使用
+            class FaultSafeReader {
+            public:
+                FaultSafeReader() = default;
+                FaultSafeReader(const FaultSafeReader&) = delete;
+                FaultSafeReader& operator=(const FaultSafeReader&) = delete;
+
+                ~FaultSafeReader() {
+                    if (m_pipe[0] >= 0) close(m_pipe[0]);
+                    if (m_pipe[1] >= 0) close(m_pipe[1]);
+                }
+
+                bool read(uintptr_t address, void* buffer, size_t size) {
+                    if (m_pipe[0] < 0 && pipe2(m_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+                        m_pipe[0] = m_pipe[1] = -1;
+                        return false;
+                    }
+                    // 管道容量至少一页，按页大小分块写入不会阻塞
+                    const size_t chunk_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+                    auto* out = static_cast<uint8_t*>(buffer);
+                    for (size_t done = 0; done < size;) {
+                        const size_t chunk = std::min(chunk_size, size - done);
+                        const ssize_t written = write(m_pipe[1], reinterpret_cast<const void*>(address + done), chunk);
+                        if (written < 0 && errno == EINTR) continue;
+                        if (written <= 0) return false;
+                        // 读回已写入的部分使管道保持为空；只写入一部分说明其后的地址不可读
+                        for (ssize_t drained = 0; drained < written;) {
+                            const ssize_t bytes = ::read(m_pipe[0], out + done + drained,
+                                                         static_cast<size_t>(written - drained));
+                            if (bytes < 0 && errno == EINTR) continue;
+                            if (bytes <= 0) return false;
+                            drained += bytes;
+                        }
+                        if (static_cast<size_t>(written) != chunk) return false;
+                        done += chunk;
+                    }
+                    return true;
+                }
+
+            private:
+                int m_pipe[2] = {-1, -1};
+            };
+
+            iovec local_iovec(const ReadRequest& request) {
+                return {request.buffer, request.size};
+            }
+
+            iovec local_iovec(const WriteRequest& request) {
+                return {const_cast<void*>(request.data), request.size};
+            }
+
+            // 每批最多 kMaxIovecs 项交给一次系统调用。内核按 iovec 粒度传输，遇到无法访问的项即停止，
+            // 返回值之前的项全部完成；出错项标记失败，其后的项重新提交。
+            template <typename Request, typename Transfer, typename Fallback>
+            size_t transfer_many(std::span<Request> requests, Transfer&& transfer, Fallback&& fallback) {
+                size_t succeeded = 0;
+                size_t next = 0;
+                while (next < requests.size()) {
+                    iovec local[kMaxIovecs];
+                    iovec remote[kMaxIovecs];
+                    size_t index[kMaxIovecs];
+                    size_t count = 0;
+                    for (; next < requests.size() && count < kMaxIovecs; ++next) {
+                        auto& request = requests[next];
+                        request.ok = request.size == 0;
+                        if (request.ok) {
+                            ++succeeded;
+                            continue;
+                        }
+                        local[count] = local_iovec(request);
+                        remote[count] = {reinterpret_cast<void*>(request.address), request.size};
+                        index[count++] = next;
+                    }
+
+                    for (size_t first = 0; first < count;) {
+                        ssize_t bytes = -1;
+                        if (!g_vm_calls_unavailable.load(std::memory_order_relaxed)) {
+                            bytes = transfer(local + first, remote + first, count - first);
+                            if (bytes < 0 && (errno == ENOSYS || errno == EPERM)) {
+                                g_vm_calls_unavailable.store(true, std::memory_order_relaxed);
+                            }
+                        }
+                        if (bytes < 0 && g_vm_calls_unavailable.load(std::memory_order_relaxed)) {
+                            for (; first < count; ++first) {
+                                auto& request = requests[index[first]];
+                                request.ok = fallback(request);
+                                succeeded += request.ok;
+                            }
+                            break;
+                        }
+
+                        size_t transferred = bytes > 0 ? static_cast<size_t>(bytes) : 0;
+                        for (; first < count && local[first].iov_len <= transferred; ++first) {
+                            transferred -= local[first].iov_len;
+                            requests[index[first]].ok = true;
+                            ++succeeded;
+                        }
+                        ++first; // 跳过出错的项
+                    }
+                }
+                return succeeded;
+            }
+        }
+
         bool read(uintptr_t address, void* buffer, size_t size) {
             memcpy(buffer, reinterpret_cast<const void*>(address), size);
             return true;
@@ -19,6 +153,42 @@ namespace ur {
             return true;
         }
 
+        size_t read_many(std::span<ReadRequest> requests) {
+            const pid_t self = getpid();
+            return transfer_many(
+                requests,
+                [self](const iovec* local, const iovec* remote, size_t count) {
+                    return process_vm_readv(self, local, count, remote, count, 0);
+                },
+                [reader = FaultSafeReader()](const ReadRequest& request) mutable {
+                    return reader.read(request.address, request.buffer, request.size);
+                });
+        }
+
+        size_t write_many(std::span<WriteRequest> requests) {
+            const pid_t self = getpid();
+            return transfer_many(
+                requests,
+                [self](const iovec* local, const iovec* remote, size_t count) {
+                    return process_vm_writev(self, local, count, remote, count, 0);
+                },
+                [](const WriteRequest& request) {
+                    if (!range_accessible(request.address, request.size, PROT_WRITE)) return false;
+                    memcpy(reinterpret_cast<void*>(request.address), request.data, request.size);
+                    return true;
+                });
+        }
+
+        bool safe_read(uintptr_t address, void* buffer, size_t size) {
+            ReadRequest request{address, buffer, size};
+            return read_many({&request, 1}) == 1;
+        }
+
+        bool safe_write(uintptr_t address, const void* buffer, size_t size) {
+            WriteRequest request{address, buffer, size};
+            return write_many({&request, 1}) == 1;
+        }
+
         bool protect(uintptr_t address, size_t size, int prot) {
             long page_size = sysconf(_SC_PAGESIZE);
             
@@ -32,76 +202,38 @@ namespace ur {
         }
 
         void flush_instruction_cache(uintptr_t address, size_t size) {
-            char* start = reinterpret_cast<char*>(address);
-            char* end = start + size;
-
-            // Data Synchronization Barrier
-            // Ensures that all previous memory accesses (writes) are complete
-            // before we proceed with the instruction cache invalidation.
-            asm volatile("dsb ish" : : : "memory");
-
-            // The cache line size on modern ARM64 is typically 64 bytes.
-            // We iterate and invalidate by this size for efficiency.
-            long cache_line_size = sysconf(_SC_LEVEL1_ICACHE_LINESIZE);
-            if (cache_line_size <= 0) {
-                cache_line_size = 64; // A reasonable default
-            }
-            for (char* p = start; p < end; p += cache_line_size) {
-                asm volatile("ic ivau, %0" : : "r"(p) : "memory");
-            }
-
-            // Data Synchronization Barrier again to ensure the cache invalidation is complete
-            // before any new instructions are fetched.
-            asm volatile("dsb ish" : : : "memory");
-
-            // Instruction Synchronization Barrier
-            // Flushes the pipeline and ensures that all subsequent instructions
-            // are fetched from the newly cleaned cache.
-            asm volatile("isb" : : : "memory");
+            cache_maintenance::sync_code(address, size);
         }
 
         bool find_mapped_region(uintptr_t address, MappedRegion& region) {
-            std::ifstream maps_file("/proc/self/maps");
-            std::string line;
-            if (!maps_file.is_open()) {
-                return false;
+            // 优先使用共享的 maps 快照；未命中时说明映射可能已变化，刷新一次后重试
+            auto snapshot = maps_parser::MapsSnapshot::current();
+            const maps_parser::MapEntry* entry = snapshot->find_by_addr(address);
+            if (!entry) {
+                snapshot = maps_parser::MapsSnapshot::refresh();
+                entry = snapshot->find_by_addr(address);
             }
-
-            while (std::getline(maps_file, line)) {
-                std::istringstream iss(line);
-                uintptr_t start, end, offset;
-                char dash, colon;
-                std::string perms, dev;
-                long inode;
-                std::string path;
-
-                iss >> std::hex >> start >> dash >> end >> perms >> offset >> std::dec >> dev >> inode;
-                // The rest of the line is the path, which might contain spaces
-                std::getline(iss, path);
-                // Trim leading whitespace from path
-                path.erase(0, path.find_first_not_of(" \t"));
-
-
-                if (address >= start && address < end) {
-                    region.start = start;
-                    region.end = end;
-                    region.offset = offset;
-                    region.perms = perms;
-                    region.path = path;
-                    maps_file.close();
-                    return true;
-                }
+            if (!entry) {
+                return false;
             }
 
-            maps_file.close();
-            return false;
+            region.start = entry->start;
+            region.end = entry->end;
+            region.offset = entry->offset;
+            region.perms = entry->perms;
+            region.path = std::string(entry->path);
+            return true;
         }
 
         bool atomic_patch(uintptr_t address, const uint8_t* patch_code, size_t patch_size) {
             if (patch_size == 0) return true;
 
+            // 池内存的执行视图不可写，通过其可写别名写入；同页上还有运行时会写入的块，不能修改其保护属性
+            const bool in_pool = exec_pool::contains(address, patch_size);
+            const uintptr_t write_address = in_pool ? reinterpret_cast<uintptr_t>(exec_pool::writable(reinterpret_cast<void*>(address))) : address;
+
             // Ensure memory is writable and executable
-            if (!protect(address, patch_size, PROT_READ | PROT_WRITE | PROT_EXEC)) {
+            if (!in_pool && !protect(address, patch_size, PROT_READ | PROT_WRITE | PROT_EXEC)) {
                 return false;
             }
 
@@ -110,32 +242,105 @@ namespace ur {
             // might execute a partially written instruction sequence.
             if (patch_size > 4) {
                 // 1. Write all but the first 4 bytes.
-                if (!write(address + 4, patch_code + 4, patch_size - 4)) {
+                if (!write(write_address + 4, patch_code + 4, patch_size - 4)) {
                     // Best effort to restore original protection, but failure here is already an error state.
-                    protect(address, patch_size, PROT_READ | PROT_EXEC);
+                    if (!in_pool) protect(address, patch_size, PROT_READ | PROT_EXEC);
                     return false;
                 }
             }
 
             // 2. Write the first 4 bytes. This makes the patch "live".
             // On ARM64, a 32-bit write is atomic.
-            if (!write(address, patch_code, 4)) {
+            if (!write(write_address, patch_code, 4)) {
                 // If the final atomic write fails, we are in a bad state.
                 // The patch is partially applied. Reverting is complex and may also fail.
-                protect(address, patch_size, PROT_READ | PROT_EXEC);
+                if (!in_pool) protect(address, patch_size, PROT_READ | PROT_EXEC);
                 return false;
             }
 
             // Restore original permissions
-            if (!protect(address, patch_size, PROT_READ | PROT_EXEC)) {
+            if (!in_pool && !protect(address, patch_size, PROT_READ | PROT_EXEC)) {
                 // The patch is live, but permissions are not ideal.
                 // This is a non-fatal error for the patch itself, but should be noted.
             }
 
             // Flush the instruction cache to ensure the CPU sees the new instructions.
-            flush_instruction_cache(address, patch_size);
+            // 写入的可能是另一个虚拟地址，数据缓存按写入地址清理
+            cache_maintenance::sync_code(address, write_address, patch_size);
 
             return true;
         }
+
+        PatchPlan plan_batch_patch(const std::vector<PatchRequest>& patches) {
+            PatchPlan plan;
+            long page_size = sysconf(_SC_PAGESIZE);
+
+            // 收集所有涉及的页，合并相邻/重叠的区间，每个区间只调用一次 mprotect
+            std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+            ranges.reserve(patches.size());
+            plan.writes.reserve(patches.size());
+            plan.cache.reserve(patches.size());
+            for (const auto& patch : patches) {
+                if (patch.size == 0) continue;
+                // 池内的目标不修改页保护：执行视图是 R-X，但写入经 exec_pool 的 RW 视图进行
+                // （RWX 回退映射时 writable() 返回原地址，本身可写）
+                uintptr_t write_address = patch.address;
+                if (exec_pool::contains(patch.address, patch.size)) {
+                    write_address = reinterpret_cast<uintptr_t>(exec_pool::writable(reinterpret_cast<void*>(patch.address)));
+                } else {
+                    uintptr_t start = patch.address & -page_size;
+                    uintptr_t end = (patch.address + patch.size + page_size - 1) & -page_size;
+                    ranges.emplace_back(start, end);
+                }
+                plan.writes.push_back({patch.address, write_address, patch.code, patch.size});
+                plan.cache.add(patch.address, write_address, patch.size);
+            }
+
+            std::sort(ranges.begin(), ranges.end());
+            for (const auto& range : ranges) {
+                if (!plan.ranges.empty() && range.first <= plan.ranges.back().second) {
+                    plan.ranges.back().second = std::max(plan.ranges.back().second, range.second);
+                } else {
+                    plan.ranges.push_back(range);
+                }
+            }
+            return plan;
+        }
+
+        bool apply_patch_plan(const PatchPlan& plan) {
+            if (plan.writes.empty()) return true;
+
+            for (size_t i = 0; i < plan.ranges.size(); ++i) {
+                const auto& [start, end] = plan.ranges[i];
+                if (mprotect(reinterpret_cast<void*>(start), end - start, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+                    // 回滚已修改的页，此时尚未写入任何补丁
+                    for (size_t j = 0; j < i; ++j) {
+                        mprotect(reinterpret_cast<void*>(plan.ranges[j].first), plan.ranges[j].second - plan.ranges[j].first, PROT_READ | PROT_EXEC);
+                    }
+                    return false;
+                }
+            }
+
+            // 与 atomic_patch 相同：先写尾部，最后写入首条指令使补丁生效
+            for (const auto& patch : plan.writes) {
+                if (patch.size > 4) {
+                    write(patch.write_address + 4, patch.code + 4, patch.size - 4);
+                }
+                write(patch.write_address, patch.code, std::min<size_t>(patch.size, 4));
+            }
+
+            for (const auto& [start, end] : plan.ranges) {
+                mprotect(reinterpret_cast<void*>(start), end - start, PROT_READ | PROT_EXEC);
+            }
+
+            // 合并后的区间只清理/失效一次，一次屏障序列覆盖所有补丁
+            plan.cache.flush();
+
+            return true;
+        }
+
+        bool batch_patch(const std::vector<PatchRequest>& patches) {
+            return apply_patch_plan(plan_batch_patch(patches));
+        }
     }
 }
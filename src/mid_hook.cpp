@@ -1,12 +1,58 @@
 #include "ur/mid_hook.h"
 #include "ur/inline_hook.h"
+#include "ur/recursion_guard.h"
+#include "ur/hook_stats.h"
+#include <cstddef>
 #include <stdexcept>
 #include <utility>
 
 namespace ur::mid_hook {
 
+using assembler::Register;
+
+namespace {
+
+Register gpr(int index) {
+    return static_cast<Register>(static_cast<int>(Register::X0) + index);
+}
+
+Register qreg(int index) {
+    return static_cast<Register>(static_cast<int>(Register::Q0) + index);
+}
+
+// Stores (or loads) every GPR selected by `mask` at its CpuContext slot, pairing
+// neighbouring registers into STP/LDP.
+void transfer_gprs(ur::jit::Jit& jit, uint32_t mask, bool store) {
+    for (int i = 0; i <= 30;) {
+        if (!(mask & (1u << i))) {
+            ++i;
+            continue;
+        }
+        const int32_t offset = static_cast<int32_t>(offsetof(CpuContext, gpr) + i * sizeof(uint64_t));
+        if (i < 30 && (mask & (1u << (i + 1)))) {
+            if (store) jit.stp(gpr(i), gpr(i + 1), Register::SP, offset);
+            else jit.ldp(gpr(i), gpr(i + 1), Register::SP, offset);
+            i += 2;
+        } else {
+            if (store) jit.str(gpr(i), Register::SP, offset);
+            else jit.ldr(gpr(i), Register::SP, offset);
+            ++i;
+        }
+    }
+}
+
+void transfer_simd(ur::jit::Jit& jit, bool store) {
+    for (int i = 0; i < 32; i += 2) {
+        const int32_t offset = static_cast<int32_t>(offsetof(CpuContext, simd) + i * sizeof(__uint128_t));
+        if (store) jit.stp(qreg(i), qreg(i + 1), Register::SP, offset);
+        else jit.ldp(qreg(i), qreg(i + 1), Register::SP, offset);
+    }
+}
+
+} // namespace
+
 // Constructor implementation
-MidHook::MidHook(uintptr_t target, Callback callback)
+MidHook::MidHook(uintptr_t target, Callback callback, const MidHookOptions& options)
     : callback_(callback) {
     if (target == 0 || callback == nullptr) {
         throw std::invalid_argument("Target and callback must not be null.");
@@ -25,40 +71,69 @@ MidHook::MidHook(uintptr_t target, Callback callback)
     // 2. JIT-compile the detour function.
     auto jit = std::make_optional<ur::jit::Jit>();
 
-    // Prologue: Save context
+    // Whatever the callback may clobber must survive the call, requested or not.
+    const uint32_t saved_gprs = (options.gpr_mask & MidHookOptions::kAllGprs) | MidHookOptions::kCallerSavedGprs;
+
+    // Prologue: Save context. The whole CpuContext is reserved so the callback can
+    // always dereference it, but only the selected state is written.
     constexpr int context_size = sizeof(CpuContext);
-    jit->sub(assembler::Register::SP, assembler::Register::SP, context_size);
-    for (int i = 0; i < 30; i += 2) {
-        jit->stp(
-            static_cast<assembler::Register>(static_cast<int>(assembler::Register::X0) + i),
-            static_cast<assembler::Register>(static_cast<int>(assembler::Register::X0) + i + 1),
-            assembler::Register::SP,
-            i * 8
-        );
+    static_assert(context_size % 16 == 0, "CpuContext must keep SP 16-byte aligned");
+    jit->sub(Register::SP, Register::SP, context_size);
+    transfer_gprs(*jit, saved_gprs, true);
+    if (options.save_flags) {
+        // x0 is already saved, so it is free as a scratch register.
+        jit->mrs(Register::X0, assembler::SystemRegister::NZCV);
+        jit->str(Register::X0, Register::SP, offsetof(CpuContext, nzcv));
+    }
+    if (options.save_simd) {
+        transfer_simd(*jit, true);
+    }
+
+    // x9/x10 are always saved, so they are free for the counter and the guard.
+    if (options.count_calls) {
+        counter_ = hook_stats::acquire_counter(hook_stats::HookKind::Mid, target);
+        hook_stats::emit_increment(*jit, *counter_, Register::X9, Register::X10);
+    }
+
+    // With the guard, x9/x10 test and set the per-thread guard word.
+    ur::jit::Label skip_callback;
+    int32_t guard = 0;
+    if (options.recursion_guard) {
+        guard = recursion_guard::emit_guard_base(*jit, Register::X9);
+        jit->ldr(Register::X10, Register::X9, guard);
+        jit->cbnz(Register::X10, skip_callback);
+        jit->mov(Register::X10, 1);
+        jit->str(Register::X10, Register::X9, guard);
     }
-    jit->str(assembler::Register::LR, assembler::Register::SP, 30 * 8);
 
-    // Call the user-provided callback
-    jit->mov(assembler::Register::X0, assembler::Register::SP); // Pass context pointer
-    jit->gen_abs_call(reinterpret_cast<uintptr_t>(callback_), assembler::Register::X16);
+    // Call the user-provided callback. LR is restored with the saved context below.
+    jit->mov(Register::X0, Register::SP); // Pass context pointer
+    jit->call(reinterpret_cast<uintptr_t>(callback_), Register::X16);
+
+    if (options.recursion_guard) {
+        recursion_guard::emit_guard_base(*jit, Register::X9);
+        jit->str(Register::ZR, Register::X9, guard);
+        jit->bind(skip_callback);
+    }
 
     // Epilogue: Restore context
-    for (int i = 0; i < 30; i += 2) {
-        jit->ldp(
-            static_cast<assembler::Register>(static_cast<int>(assembler::Register::X0) + i),
-            static_cast<assembler::Register>(static_cast<int>(assembler::Register::X0) + i + 1),
-            assembler::Register::SP,
-            i * 8
-        );
+    if (options.save_simd) {
+        transfer_simd(*jit, false);
     }
-    jit->ldr(assembler::Register::LR, assembler::Register::SP, 30 * 8);
-    jit->add(assembler::Register::SP, assembler::Register::SP, context_size);
+    if (options.save_flags) {
+        jit->ldr(Register::X0, Register::SP, offsetof(CpuContext, nzcv));
+        jit->msr(assembler::SystemRegister::NZCV, Register::X0);
+    }
+    transfer_gprs(*jit, saved_gprs, false);
+    jit->add(Register::SP, Register::SP, context_size);
 
-    // Jump to the original instructions (trampoline)
-    jit->gen_abs_jump(trampoline, assembler::Register::X16);
+    // Jump to the original instructions (trampoline); the addresses are loaded from the
+    // literal pool that finalize() places after this branch.
+    jit->jump(trampoline, Register::X16);
 
     detour_ = jit->finalize<void*>();
     if (!detour_) {
+        hook_stats::release_counter(std::exchange(counter_, nullptr));
         throw std::runtime_error("Failed to allocate JIT memory for detour.");
     }
     detour_jit_ = std::move(jit);
@@ -84,6 +159,11 @@ void MidHook::unhook() {
     detour_jit_.reset();
     detour_ = nullptr;
     callback_ = nullptr;
+    hook_stats::release_counter(std::exchange(counter_, nullptr));
+}
+
+uint64_t MidHook::call_count() const {
+    return counter_ ? counter_->calls() : 0;
 }
 
 bool MidHook::enable() {
@@ -102,6 +182,7 @@ MidHook::MidHook(MidHook&& other) noexcept
     : callback_(other.callback_),
       detour_jit_(std::move(other.detour_jit_)),
       detour_(other.detour_),
+      counter_(std::exchange(other.counter_, nullptr)),
       inline_hook_(std::move(other.inline_hook_)) {
     // Invalidate the moved-from object so its destructor does nothing.
     other.callback_ = nullptr;
@@ -117,6 +198,8 @@ MidHook& MidHook::operator=(MidHook&& other) noexcept {
         detour_jit_ = std::move(other.detour_jit_);
         detour_ = other.detour_;
         callback_ = other.callback_;
+        hook_stats::release_counter(counter_);
+        counter_ = std::exchange(other.counter_, nullptr);
 
         // Invalidate the moved-from object.
         other.callback_ = nullptr;
@@ -0,0 +1,174 @@
+#include "ur/module_registry.h"
+#include "ur/fork_safety.h"
+#include "ur/maps_parser.h"
+
+#include <link.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ur::module_registry {
+
+namespace {
+
+struct Module {
+    std::string path;
+    std::shared_ptr<elf_parser::ElfParser> parser;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::unordered_map<uintptr_t, Module> modules; // 装载基址 -> 模块
+    unsigned long long loader_subs = 0;
+    bool has_counter = false;
+};
+
+Registry& registry() {
+    // 有意泄漏：静态析构期间仍可能有 Hook 查找符号
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+// fork 前后持有注册表锁（见 ur::fork_safety）
+[[maybe_unused]] const bool g_fork_participant = fork_safety::add_participant({
+    fork_safety::Rank::Modules,
+    [] { registry().mutex.lock(); },
+    [] { registry().mutex.unlock(); },
+});
+
+int read_counters(struct dl_phdr_info* info, size_t size, void* data) {
+    auto* result = static_cast<LoadedModules*>(data);
+    if (size >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+        result->adds = info->dlpi_adds;
+        result->subs = info->dlpi_subs;
+        result->has_counters = true;
+    }
+    return 1; // 计数在每个回调中都相同，只读取第一个
+}
+
+int collect_module(struct dl_phdr_info* info, size_t size, void* data) {
+    auto* result = static_cast<LoadedModules*>(data);
+    if (!result->has_counters) read_counters(info, size, data);
+
+    bool has_load = false;
+    uintptr_t min_vaddr = 0;
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+        const auto& phdr = info->dlpi_phdr[i];
+        if (phdr.p_type != PT_LOAD) continue;
+        if (!has_load || phdr.p_vaddr < min_vaddr) {
+            min_vaddr = phdr.p_vaddr;
+            has_load = true;
+        }
+    }
+    if (has_load) {
+        result->modules.push_back({info->dlpi_addr + min_vaddr, info->dlpi_name ? info->dlpi_name : ""});
+    }
+    return 0;
+}
+
+// 有模块被卸载时丢弃不再装载的条目。调用时不能持有 registry.mutex（见 enumerate_loaded()）
+void sweep_unloaded(Registry& reg) {
+    unsigned long long adds = 0;
+    unsigned long long subs = 0;
+    const bool has_counters = read_loader_counters(adds, subs);
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (has_counters && reg.has_counter && subs == reg.loader_subs) return;
+        if (reg.modules.empty()) {
+            reg.loader_subs = subs;
+            reg.has_counter = has_counters;
+            return;
+        }
+    }
+
+    const LoadedModules current = enumerate_loaded();
+    std::unordered_set<uintptr_t> loaded;
+    loaded.reserve(current.modules.size());
+    for (const auto& module : current.modules) loaded.insert(module.base);
+
+    // 遍历期间其他线程新加入的条目若不在列表中也会被丢弃，下一次 get() 重新解析即可
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto it = reg.modules.begin(); it != reg.modules.end();) {
+        if (loaded.count(it->first) == 0) {
+            it = reg.modules.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    reg.loader_subs = current.subs;
+    reg.has_counter = current.has_counters;
+}
+
+} // anonymous namespace
+
+std::shared_ptr<elf_parser::ElfParser> get(uintptr_t base_address) {
+    if (base_address == 0) return nullptr;
+
+    // 模块路径用于识别基址复用，并决定是否允许回退到磁盘文件
+    auto snapshot = maps_parser::MapsSnapshot::current();
+    const maps_parser::MapEntry* entry = snapshot->find_by_addr(base_address);
+    if (entry == nullptr) {
+        snapshot = maps_parser::MapsSnapshot::refresh();
+        entry = snapshot->find_by_addr(base_address);
+    }
+    const std::string path = entry ? std::string(entry->path) : std::string();
+    const uint64_t file_offset = entry ? entry->offset : 0;
+
+    auto& reg = registry();
+    sweep_unloaded(reg);
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    auto it = reg.modules.find(base_address);
+    if (it != reg.modules.end() && it->second.path == path) {
+        return it->second.parser;
+    }
+
+    std::shared_ptr<elf_parser::ElfParser> parser;
+    if (!path.empty() && path[0] == '/') {
+        parser = std::make_shared<elf_parser::ElfParser>(base_address, path, file_offset);
+    } else {
+        parser = std::make_shared<elf_parser::ElfParser>(base_address);
+    }
+    if (!parser->parse()) {
+        if (it != reg.modules.end()) reg.modules.erase(it);
+        return nullptr;
+    }
+    reg.modules[base_address] = Module{path, parser};
+    return parser;
+}
+
+void invalidate(uintptr_t base_address) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.modules.erase(base_address);
+}
+
+void clear() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.modules.clear();
+}
+
+std::size_t size() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.modules.size();
+}
+
+LoadedModules enumerate_loaded() {
+    LoadedModules result;
+    dl_iterate_phdr(collect_module, &result);
+    return result;
+}
+
+bool read_loader_counters(unsigned long long& adds, unsigned long long& subs) {
+    LoadedModules result;
+    dl_iterate_phdr(read_counters, &result);
+    adds = result.adds;
+    subs = result.subs;
+    return result.has_counters;
+}
+
+} // namespace ur::module_registry
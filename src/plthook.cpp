@@ -1,70 +1,112 @@
 #include "ur/plthook.h"
+#include "ur/exec_pool.h"
+#include "ur/fork_safety.h"
 #include "ur/memory.h"
 #include "ur/maps_parser.h"
 #include "ur/elf_parser.h"
+#include "ur/module_registry.h"
 
 #include <sys/mman.h>
+#include <unistd.h>
 #include <cstring>
 #include <vector>
 #include <algorithm>
+#include <unordered_set>
 
 namespace ur::plthook {
 
 namespace {
 constexpr uint32_t R_AARCH64_JUMP_SLOT_VAL = 1026;
 
-int perms_to_prot(const std::string& perms) {
-    int prot = 0;
-    if (!perms.empty()) {
-        if (perms.size() > 0 && perms[0] == 'r') prot |= PROT_READ;
-        if (perms.size() > 1 && perms[1] == 'w') prot |= PROT_WRITE;
-        if (perms.size() > 2 && perms[2] == 'x') prot |= PROT_EXEC;
-    }
-    return prot;
+// 所有存活 Hook 对象的锁，fork 前逐个加锁（见 ur::fork_safety）
+struct LiveHooks {
+    std::mutex mutex;
+    std::unordered_set<std::mutex*> locks;
+};
+
+LiveHooks& live_hooks() {
+    // 有意泄漏：静态析构期间仍可能有 Hook 被销毁
+    static LiveHooks* instance = new LiveHooks();
+    return *instance;
+}
+
+void add_live_hook(std::mutex* lock) {
+    auto& live = live_hooks();
+    std::lock_guard<std::mutex> guard(live.mutex);
+    live.locks.insert(lock);
+}
+
+void remove_live_hook(std::mutex* lock) {
+    auto& live = live_hooks();
+    std::lock_guard<std::mutex> guard(live.mutex);
+    live.locks.erase(lock);
+}
+
+[[maybe_unused]] const bool g_fork_participant = fork_safety::add_participant({
+    fork_safety::Rank::Registries,
+    [] {
+        auto& live = live_hooks();
+        live.mutex.lock();
+        for (std::mutex* lock : live.locks) lock->lock();
+    },
+    [] {
+        auto& live = live_hooks();
+        for (std::mutex* lock : live.locks) lock->unlock();
+        live.mutex.unlock();
+    },
+});
+
+// fork 前创建的计数 thunk 可能与其他进程共享，不能再改写其目标，需换用新 thunk
+bool is_shared_counter(const hook_stats::CountingThunk& counter) {
+    return counter.code != nullptr && exec_pool::is_inherited(counter.code);
 }
 } // anonymous namespace
 
 Hook::Hook(uintptr_t base_address)
     : base_(base_address) {
-    if (base_ != 0) {
-        elf_ = std::make_unique<elf_parser::ElfParser>(base_);
-        parsed_ = elf_->parse();
-    } else {
-        parsed_ = false;
-    }
+    elf_ = module_registry::get(base_);
+    parsed_ = elf_ != nullptr;
+    add_live_hook(&mutex_);
 }
 
 Hook::Hook(const std::string& so_path) {
     // 尝试通过路径子串匹配找到最小起始地址作为该 so 的基址
-    auto maps = maps_parser::MapsParser::parse();
-    uintptr_t chosen_base = 0;
-    for (const auto& m : maps) {
-        const auto& p = m.get_path();
-        if (!p.empty() && p.find(so_path) != std::string::npos) {
-            if (chosen_base == 0 || m.get_start() < chosen_base) {
-                chosen_base = m.get_start();
+    // 先在共享快照中查找，未找到时库可能是新加载的，刷新快照后重试
+    auto find_base = [&so_path](const maps_parser::MapsSnapshot& snapshot) {
+        uintptr_t base = 0;
+        for (const auto& m : snapshot.entries()) {
+            if (!m.path.empty() && m.path.find(so_path) != std::string_view::npos) {
+                if (base == 0 || m.start < base) {
+                    base = m.start;
+                }
             }
         }
+        return base;
+    };
+    uintptr_t chosen_base = find_base(*maps_parser::MapsSnapshot::current());
+    if (chosen_base == 0) {
+        chosen_base = find_base(*maps_parser::MapsSnapshot::refresh());
     }
     base_ = chosen_base;
-    if (base_ != 0) {
-        elf_ = std::make_unique<elf_parser::ElfParser>(base_);
-        parsed_ = elf_->parse();
-    } else {
-        parsed_ = false;
-    }
+    elf_ = module_registry::get(base_);
+    parsed_ = elf_ != nullptr;
+    add_live_hook(&mutex_);
 }
 
 Hook::~Hook() {
+    remove_live_hook(&mutex_);
     std::lock_guard<std::mutex> lock(mutex_);
-    // 复制键，避免在迭代中修改容器
-    std::vector<std::string> symbols;
-    symbols.reserve(entries_.size());
-    for (const auto& kv : entries_) symbols.push_back(kv.first);
-    for (const auto& s : symbols) {
-        // 尽力恢复，即使失败也继续其他项
-        unhook_symbol(s);
+    // 尽力恢复所有条目：一次批量写回，每个 GOT 页只修改一次保护属性
+    std::vector<GotWrite> writes;
+    writes.reserve(entries_.size());
+    for (const auto& kv : entries_) {
+        writes.push_back({kv.second.got_addr, kv.second.original});
     }
+    write_gots(writes);
+    for (auto& kv : entries_) {
+        hook_stats::release_counting_thunk(kv.second.counter);
+    }
+    entries_.clear();
 }
 
 bool Hook::is_valid() const {
@@ -77,70 +119,30 @@ const Hook::Entry* Hook::get_entry(const std::string& symbol) const {
     return &it->second;
 }
 
-bool Hook::parse_elf() {
-    if (!elf_) {
-        if (base_ == 0) return false;
-        elf_ = std::make_unique<elf_parser::ElfParser>(base_);
-    }
-    if (!parsed_) {
-        parsed_ = elf_->parse();
+void Hook::detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 模块已卸载，不会再有调用经过计数 thunk
+    for (auto& kv : entries_) {
+        hook_stats::release_counting_thunk(kv.second.counter);
     }
-    return parsed_;
+    entries_.clear();
 }
 
-bool Hook::write_got(uintptr_t got_addr, void* value, void** previous) {
-    // 读取旧值
-    void* oldval = nullptr;
-    (void)ur::memory::read(got_addr, &oldval, sizeof(oldval));
-    if (previous) {
-        *previous = oldval;
-    }
-
-    // 记录原始权限
-    ur::memory::MappedRegion region;
-    int restore_prot = PROT_READ; // 默认只读
-    if (ur::memory::find_mapped_region(got_addr, region)) {
-        restore_prot = perms_to_prot(region.perms);
-        if (restore_prot == 0) {
-            // fallback
-            restore_prot = PROT_READ;
-        }
-    }
-
-    // 切换为可写
-    if (!ur::memory::protect(got_addr, sizeof(void*), PROT_READ | PROT_WRITE)) {
-        return false;
-    }
+void Hook::erase_entry(std::unordered_map<std::string, Entry>::iterator it) {
+    hook_stats::release_counting_thunk(it->second.counter);
+    entries_.erase(it);
+}
 
-    // 写入新值
-    if (!ur::memory::write(got_addr, &value, sizeof(value))) {
-        // 尝试恢复权限后返回失败
-        (void)ur::memory::protect(got_addr, sizeof(void*), restore_prot);
-        return false;
+bool Hook::parse_elf() {
+    if (!parsed_) {
+        elf_ = module_registry::get(base_);
+        parsed_ = elf_ != nullptr;
     }
-
-    // 恢复原权限（失败不影响写入结果）
-    (void)ur::memory::protect(got_addr, sizeof(void*), restore_prot);
-    return true;
+    return parsed_;
 }
 
-bool Hook::hook_symbol(const std::string& symbol, void* replacement, void** original_out) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    if (!parse_elf()) return false;
-    if (symbol.empty() || replacement == nullptr) return false;
-
-    // 已存在则覆盖 replacement，返回原始指针
-    auto it_existing = entries_.find(symbol);
-    if (it_existing != entries_.end()) {
-        // 将 GOT 再次写为新的 replacement
-        if (!write_got(it_existing->second.got_addr, replacement, nullptr)) {
-            return false;
-        }
-        it_existing->second.replacement = replacement;
-        if (original_out) *original_out = it_existing->second.original;
-        return true;
-    }
+bool Hook::build_got_index() {
+    if (got_index_built_) return true;
 
     const Elf64_Sym* dynsym = elf_->get_dynamic_symbol_table();
     const char* dynstr = elf_->get_dynamic_string_table();
@@ -151,68 +153,236 @@ bool Hook::hook_symbol(const std::string& symbol, void* replacement, void** orig
     const int rel_type = elf_->get_plt_rel_entry_type(); // DT_REL 或 DT_RELA
     if (rel_loc == 0 || rel_sz == 0) return false;
 
+    // r_offset 是链接时地址，需要加上装载偏移才是 GOT 条目在内存中的地址
+    const uintptr_t load_bias = elf_->get_load_bias();
+    auto add = [&](uint64_t r_info, uint64_t r_offset) {
+        if (ELF64_R_TYPE(r_info) != R_AARCH64_JUMP_SLOT_VAL) return;
+        const Elf64_Sym* s = &dynsym[ELF64_R_SYM(r_info)];
+        std::string_view name(dynstr + s->st_name);
+        if (!name.empty()) {
+            got_index_.emplace(name, load_bias + r_offset);
+        }
+    };
+
     // ARM64 常见为 DT_RELA，但也兼容 DT_REL
     if (rel_type == DT_RELA) {
         const auto* rela = reinterpret_cast<const Elf64_Rela*>(rel_loc);
         const size_t count = rel_sz / sizeof(Elf64_Rela);
+        got_index_.reserve(count);
         for (size_t i = 0; i < count; ++i) {
-            const auto& r = rela[i];
-            const uint32_t rtype = ELF64_R_TYPE(r.r_info);
-            if (rtype != R_AARCH64_JUMP_SLOT_VAL) continue;
-
-            const uint32_t sym_index = ELF64_R_SYM(r.r_info);
-            const Elf64_Sym* s = &dynsym[sym_index];
-            const char* name = dynstr + s->st_name;
-            if (name && symbol == name) {
-                const uintptr_t got_addr = r.r_offset; // 目标 GOT 条目地址（内存绝对地址）
-                void* original = nullptr;
-                if (!write_got(got_addr, replacement, &original)) {
-                    return false;
-                }
-                Entry e;
-                e.symbol = symbol;
-                e.got_addr = got_addr;
-                e.original = original;
-                e.replacement = replacement;
-                entries_.emplace(symbol, e);
-                if (original_out) *original_out = original;
-                return true;
-            }
+            add(rela[i].r_info, rela[i].r_offset);
         }
     } else if (rel_type == DT_REL) {
         const auto* rel = reinterpret_cast<const Elf64_Rel*>(rel_loc);
         const size_t count = rel_sz / sizeof(Elf64_Rel);
+        got_index_.reserve(count);
         for (size_t i = 0; i < count; ++i) {
-            const auto& r = rel[i];
-            const uint32_t rtype = ELF64_R_TYPE(r.r_info);
-            if (rtype != R_AARCH64_JUMP_SLOT_VAL) continue;
-
-            const uint32_t sym_index = ELF64_R_SYM(r.r_info);
-            const Elf64_Sym* s = &dynsym[sym_index];
-            const char* name = dynstr + s->st_name;
-            if (name && symbol == name) {
-                const uintptr_t got_addr = r.r_offset; // 目标 GOT 条目地址（内存绝对地址）
-                void* original = nullptr;
-                if (!write_got(got_addr, replacement, &original)) {
-                    return false;
-                }
-                Entry e;
-                e.symbol = symbol;
-                e.got_addr = got_addr;
-                e.original = original;
-                e.replacement = replacement;
-                entries_.emplace(symbol, e);
-                if (original_out) *original_out = original;
-                return true;
-            }
+            add(rel[i].r_info, rel[i].r_offset);
         }
     } else {
         // 未知类型
         return false;
     }
 
-    // 未找到匹配符号
-    return false;
+    got_index_built_ = true;
+    return true;
+}
+
+uintptr_t Hook::find_got(std::string_view symbol) const {
+    auto it = got_index_.find(symbol);
+    return it == got_index_.end() ? 0 : it->second;
+}
+
+void Hook::write_gots(std::vector<GotWrite>& writes) {
+    if (writes.empty()) return;
+
+    const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    // 稳定排序：同一地址的多次写入保持原有顺序，最后一次生效
+    std::stable_sort(writes.begin(), writes.end(),
+                     [](const GotWrite& a, const GotWrite& b) { return a.got_addr < b.got_addr; });
+
+    // 权限必须是当前的：共享快照可能早于 RELRO 的 mprotect 或其他工具对 GOT 的修改，
+    // 据此跳过 mprotect 会写入只读页，恢复时也会设置错误的权限。每批写入重新读取一次 maps
+    const auto snapshot = maps_parser::MapsSnapshot::refresh();
+
+    // 按页分组：每页只查询一次映射权限、只调用两次 mprotect
+    for (size_t first = 0; first < writes.size();) {
+        const uintptr_t page = writes[first].got_addr & ~(page_size - 1);
+        size_t last = first;
+        while (last < writes.size() && (writes[last].got_addr & ~(page_size - 1)) == page) {
+            ++last;
+        }
+
+        int restore_prot = PROT_READ; // 默认只读
+        if (const auto* entry = snapshot->find_by_addr(page)) {
+            restore_prot = entry->prot;
+            if (restore_prot == 0) restore_prot = PROT_READ;
+        }
+
+        if (restore_prot & PROT_WRITE) {
+            // 未应用 RELRO（或 GOT 本身可写）：直接写入，无需 mprotect
+            for (size_t i = first; i < last; ++i) {
+                writes[i].written = ur::memory::write(writes[i].got_addr, &writes[i].value, sizeof(void*));
+            }
+        } else if (ur::memory::protect(page, page_size, PROT_READ | PROT_WRITE)) {
+            for (size_t i = first; i < last; ++i) {
+                writes[i].written = ur::memory::write(writes[i].got_addr, &writes[i].value, sizeof(void*));
+            }
+            (void)ur::memory::protect(page, page_size, restore_prot);
+        }
+        first = last;
+    }
+}
+
+bool Hook::hook_symbol(const std::string& symbol, void* replacement, void** original_out, bool count_calls) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!parse_elf()) return false;
+    if (symbol.empty() || replacement == nullptr) return false;
+
+    // 已存在则覆盖 replacement，返回原始指针
+    auto it_existing = entries_.find(symbol);
+    if (it_existing != entries_.end()) {
+        auto& entry = it_existing->second;
+        // 已有计数 thunk 时 GOT 保持指向 thunk，写入成功后再切换 thunk 的目标
+        hook_stats::CountingThunk added;
+        if ((count_calls && entry.counter.code == nullptr) || is_shared_counter(entry.counter)) {
+            added = hook_stats::acquire_counting_thunk(hook_stats::HookKind::Plt, entry.got_addr,
+                                                       reinterpret_cast<uintptr_t>(replacement), symbol);
+        }
+        void* value = added.code ? added.code : (entry.counter.code ? entry.counter.code : replacement);
+        std::vector<GotWrite> writes{{entry.got_addr, value}};
+        write_gots(writes);
+        if (!writes[0].written) {
+            hook_stats::release_counting_thunk(added);
+            return false;
+        }
+        if (added.code) {
+            hook_stats::release_counting_thunk(entry.counter);
+            entry.counter = added;
+        } else if (entry.counter.code) hook_stats::set_destination(entry.counter, reinterpret_cast<uintptr_t>(replacement));
+        entry.replacement = replacement;
+        if (original_out) *original_out = entry.original;
+        return true;
+    }
+
+    if (!build_got_index()) return false;
+    const uintptr_t got_addr = find_got(symbol);
+    if (got_addr == 0) {
+        // 未找到匹配符号
+        return false;
+    }
+
+    void* original = nullptr;
+    (void)ur::memory::read(got_addr, &original, sizeof(original));
+    Entry e;
+    e.symbol = symbol;
+    e.got_addr = got_addr;
+    e.original = original;
+    e.replacement = replacement;
+    if (count_calls) {
+        e.counter = hook_stats::acquire_counting_thunk(hook_stats::HookKind::Plt, got_addr,
+                                                       reinterpret_cast<uintptr_t>(replacement), symbol);
+    }
+    std::vector<GotWrite> writes{{got_addr, e.installed()}};
+    write_gots(writes);
+    if (!writes[0].written) {
+        hook_stats::release_counting_thunk(e.counter);
+        return false;
+    }
+    entries_.emplace(symbol, e);
+    if (original_out) *original_out = original;
+    return true;
+}
+
+size_t Hook::hook_symbols(std::span<const SymbolHook> hooks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!parse_elf() || !build_got_index()) return 0;
+
+    // 先解析所有 GOT 地址并读出原值，再统一写入
+    struct Pending {
+        const SymbolHook* request;
+        uintptr_t got_addr;
+        void* original;
+        Entry* existing;                // 已安装的条目，否则为空
+        hook_stats::CountingThunk added; // 本次新建的计数 thunk
+    };
+    std::vector<Pending> pending;
+    std::vector<GotWrite> writes;
+    pending.reserve(hooks.size());
+    writes.reserve(hooks.size());
+
+    for (const auto& hook : hooks) {
+        if (hook.symbol.empty() || hook.replacement == nullptr) continue;
+
+        uintptr_t got_addr = 0;
+        void* original = nullptr;
+        Entry* existing = nullptr;
+        auto it_existing = entries_.find(hook.symbol);
+        if (it_existing != entries_.end()) {
+            existing = &it_existing->second;
+            got_addr = existing->got_addr;
+            original = existing->original;
+        } else {
+            got_addr = find_got(hook.symbol);
+            if (got_addr == 0) continue;
+            (void)ur::memory::read(got_addr, &original, sizeof(original));
+        }
+        pending.push_back({&hook, got_addr, original, existing, {}});
+    }
+
+    // 需要计数但条目还没有 thunk 的项各自新建一个
+    for (size_t i = 0; i < pending.size(); ++i) {
+        auto& p = pending[i];
+        const bool shared_counter = p.existing && is_shared_counter(p.existing->counter);
+        const bool has_counter = p.existing && p.existing->counter.code && !shared_counter;
+        if ((!p.request->count_calls && !shared_counter) || has_counter) continue;
+        p.added = hook_stats::acquire_counting_thunk(hook_stats::HookKind::Plt, p.got_addr,
+                                                     reinterpret_cast<uintptr_t>(p.request->replacement),
+                                                     p.request->symbol);
+    }
+
+    // 预先按地址排序，使 writes[i] 与 pending[i] 一一对应
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const Pending& a, const Pending& b) { return a.got_addr < b.got_addr; });
+    for (const auto& p : pending) {
+        void* value = p.request->replacement;
+        if (p.added.code) value = p.added.code;
+        else if (p.existing && p.existing->counter.code) value = p.existing->counter.code;
+        writes.push_back({p.got_addr, value});
+    }
+
+    write_gots(writes);
+
+    size_t installed = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        auto& p = pending[i];
+        if (!writes[i].written) {
+            hook_stats::release_counting_thunk(p.added);
+            continue;
+        }
+
+        auto& entry = entries_[p.request->symbol];
+        if (entry.got_addr == 0) {
+            entry.symbol = p.request->symbol;
+            entry.got_addr = p.got_addr;
+            entry.original = p.original;
+        }
+        // 同一符号出现多次时按顺序处理，条目跟随最后写入 GOT 的值
+        if (p.added.code) {
+            hook_stats::release_counting_thunk(entry.counter);
+            entry.counter = p.added;
+        } else if (entry.counter.code && writes[i].value == entry.counter.code) {
+            hook_stats::set_destination(entry.counter, reinterpret_cast<uintptr_t>(p.request->replacement));
+        } else {
+            hook_stats::release_counting_thunk(entry.counter);
+        }
+        entry.replacement = p.request->replacement;
+        if (p.request->original_out) *p.request->original_out = entry.original;
+        ++installed;
+    }
+    return installed;
 }
 
 bool Hook::unhook_symbol(const std::string& symbol) {
@@ -222,12 +392,46 @@ bool Hook::unhook_symbol(const std::string& symbol) {
     if (it == entries_.end()) return false;
 
     // 写回原始指针
-    if (!write_got(it->second.got_addr, it->second.original, nullptr)) {
+    std::vector<GotWrite> writes{{it->second.got_addr, it->second.original}};
+    write_gots(writes);
+    if (!writes[0].written) {
         return false;
     }
 
-    entries_.erase(it);
+    erase_entry(it);
     return true;
 }
 
-} // namespace ur::plthook
\ No newline at end of file
+size_t Hook::unhook_symbols(std::span<const std::string> symbols) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<decltype(entries_)::iterator> pending;
+    pending.reserve(symbols.size());
+    for (const auto& symbol : symbols) {
+        auto it = entries_.find(symbol);
+        if (it != entries_.end()) pending.push_back(it);
+    }
+
+    // 与 hook_symbols 相同：预先按地址排序，使 writes[i] 与 pending[i] 一一对应；
+    // 重复的符号指向同一条目，排序后相邻，去重
+    std::sort(pending.begin(), pending.end(),
+              [](const auto& a, const auto& b) { return a->second.got_addr < b->second.got_addr; });
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+    std::vector<GotWrite> writes;
+    writes.reserve(pending.size());
+    for (const auto& it : pending) {
+        writes.push_back({it->second.got_addr, it->second.original});
+    }
+
+    write_gots(writes);
+
+    size_t removed = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (!writes[i].written) continue;
+        erase_entry(pending[i]);
+        ++removed;
+    }
+    return removed;
+}
+
+} // namespace ur::plthook
@@ -3,6 +3,7 @@
 #include <memory>
 #include <new>
 #include <string>
+#include <vector>
 
 extern "C" {
 
@@ -69,4 +70,42 @@ ur_status_t ur_plthook_unhook_symbol(ur_plthook_t* hook, const char* symbol) {
     }
 }
 
+ur_status_t ur_plthook_hook_symbols(ur_plthook_t* hook, const ur_plthook_symbol_hook_t* hooks, size_t count,
+                                    size_t* installed_out) {
+    if (installed_out) *installed_out = 0;
+    if (!hook || !hook->impl || (!hooks && count != 0)) return UR_STATUS_INVALID_ARG;
+    try {
+        std::vector<ur::plthook::Hook::SymbolHook> requests;
+        requests.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            // 无效项与未找到的符号一样被跳过
+            if (!hooks[i].symbol || !hooks[i].replacement) continue;
+            requests.push_back({hooks[i].symbol, hooks[i].replacement, hooks[i].original_out});
+        }
+        size_t installed = hook->impl->hook_symbols(requests);
+        if (installed_out) *installed_out = installed;
+        return installed == count ? UR_STATUS_OK : UR_STATUS_ERROR;
+    } catch (...) {
+        return UR_STATUS_ERROR;
+    }
+}
+
+ur_status_t ur_plthook_unhook_symbols(ur_plthook_t* hook, const char* const* symbols, size_t count,
+                                      size_t* removed_out) {
+    if (removed_out) *removed_out = 0;
+    if (!hook || !hook->impl || (!symbols && count != 0)) return UR_STATUS_INVALID_ARG;
+    try {
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (symbols[i]) names.emplace_back(symbols[i]);
+        }
+        size_t removed = hook->impl->unhook_symbols(names);
+        if (removed_out) *removed_out = removed;
+        return removed == count ? UR_STATUS_OK : UR_STATUS_ERROR;
+    } catch (...) {
+        return UR_STATUS_ERROR;
+    }
+}
+
 } // extern "C"
\ No newline at end of file
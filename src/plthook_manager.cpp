@@ -0,0 +1,297 @@
+#include "ur/plthook_manager.h"
+#include "ur/fork_safety.h"
+#include "ur/module_registry.h"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <system_error>
+#include <thread>
+
+namespace ur::plthook {
+
+namespace {
+
+// 每个工作线程至少处理的模块数；模块较少时线程创建开销大于并行收益
+constexpr size_t kModulesPerWorker = 8;
+
+// 在调用线程和最多 hardware_concurrency - 1 个工作线程上执行 fn(0..count-1)
+template <typename Fn>
+void parallel_for(size_t count, Fn&& fn) {
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const size_t workers = std::min(hardware, count / kModulesPerWorker);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto run = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t t = 1; t < workers; ++t) {
+        try {
+            threads.emplace_back(run);
+        } catch (const std::system_error&) {
+            break; // 无法创建更多线程时由已有线程完成剩余工作
+        }
+    }
+    run();
+    for (auto& thread : threads) thread.join();
+}
+
+using DlopenFn = void* (*)(const char*, int);
+using AndroidDlopenExtFn = void* (*)(const char*, int, const void*);
+
+// bionic 的链接器按调用者的返回地址确定其所属的链接器命名空间。经由代理调用 dlopen 时
+// 调用者会变成 urhook 所在的模块，导致应用或 vendor 库无法打开其命名空间私有的库（或解析到
+// 另一份副本），因此代理取得自身的返回地址，通过链接器导出的 __loader_* 入口原样传递。
+// glibc 不区分调用者命名空间，旧版 Android 也没有这些入口，此时直接转发给 dlopen 本身。
+using LoaderDlopenFn = void* (*)(const char*, int, const void*);
+using LoaderAndroidDlopenExtFn = void* (*)(const char*, int, const void*, const void*);
+
+std::atomic<DlopenFn> g_original_dlopen{nullptr};
+std::atomic<AndroidDlopenExtFn> g_original_android_dlopen_ext{nullptr};
+std::atomic<LoaderDlopenFn> g_loader_dlopen{nullptr};
+std::atomic<LoaderAndroidDlopenExtFn> g_loader_android_dlopen_ext{nullptr};
+
+__attribute__((noinline)) void* dlopen_proxy(const char* filename, int flags) {
+    const void* caller = __builtin_return_address(0);
+    void* handle = nullptr;
+    if (auto loader = g_loader_dlopen.load(std::memory_order_acquire)) {
+        handle = loader(filename, flags, caller);
+    } else if (auto original = g_original_dlopen.load(std::memory_order_acquire)) {
+        handle = original(filename, flags);
+    }
+    if (handle != nullptr) {
+        Manager::instance().refresh();
+    }
+    return handle;
+}
+
+__attribute__((noinline)) void* android_dlopen_ext_proxy(const char* filename, int flags, const void* extinfo) {
+    const void* caller = __builtin_return_address(0);
+    void* handle = nullptr;
+    if (auto loader = g_loader_android_dlopen_ext.load(std::memory_order_acquire)) {
+        handle = loader(filename, flags, extinfo, caller);
+    } else if (auto original = g_original_android_dlopen_ext.load(std::memory_order_acquire)) {
+        handle = original(filename, flags, extinfo);
+    }
+    if (handle != nullptr) {
+        Manager::instance().refresh();
+    }
+    return handle;
+}
+
+} // anonymous namespace
+
+Manager& Manager::instance() {
+    // 有意泄漏：模块内的 GOT 可能在静态析构期间仍被调用，不能在退出时恢复
+    static Manager* instance = [] {
+        auto* manager = new Manager();
+        // fork 前后持有管理器锁，子进程不会继承被其他线程持有的锁（见 ur::fork_safety）
+        fork_safety::add_participant({
+            fork_safety::Rank::Managers,
+            [] { Manager::instance().mutex_.lock(); },
+            [] { Manager::instance().mutex_.unlock(); },
+        });
+        return manager;
+    }();
+    return *instance;
+}
+
+std::vector<Manager::Module*> Manager::sorted_modules_locked() {
+    std::vector<Module*> modules;
+    modules.reserve(modules_.size());
+    for (auto& [base, module] : modules_) modules.push_back(&module);
+    std::sort(modules.begin(), modules.end(),
+              [](const Module* a, const Module* b) { return a->base < b->base; });
+    return modules;
+}
+
+size_t Manager::refresh() {
+    for (;;) {
+        // 枚举模块与解析新模块都不持有 mutex_：bionic 的 dl_iterate_phdr 持有装载器锁，
+        // 经由 dlopen 代理进入时装载器又在同一把锁下运行库的构造函数（见 module_registry::enumerate_loaded()）
+        const auto current = module_registry::enumerate_loaded();
+
+        std::vector<const module_registry::LoadedModule*> added;
+        unsigned long long seen_adds = 0;
+        unsigned long long seen_subs = 0;
+        bool seen_enumerated = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // 装载器计数未变化，说明模块集合与上次相同
+            if (enumerated_ && current.has_counters &&
+                current.adds == loader_adds_ && current.subs == loader_subs_) {
+                return 0;
+            }
+
+            // 丢弃已卸载（或基址被其他库复用）的模块，其 GOT 已不可访问，不能写回
+            std::unordered_map<uintptr_t, const module_registry::LoadedModule*> loaded;
+            loaded.reserve(current.modules.size());
+            for (const auto& module : current.modules) loaded.emplace(module.base, &module);
+            for (auto it = modules_.begin(); it != modules_.end();) {
+                auto found = loaded.find(it->first);
+                if (found == loaded.end() || found->second->path != it->second.path) {
+                    it->second.hook->detach();
+                    it = modules_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            for (const auto& module : current.modules) {
+                if (modules_.find(module.base) == modules_.end()) added.push_back(&module);
+            }
+            seen_adds = loader_adds_;
+            seen_subs = loader_subs_;
+            seen_enumerated = enumerated_;
+        }
+
+        // 解析新模块，各模块互不相关，可并行处理
+        std::vector<std::unique_ptr<Hook>> hooks(added.size());
+        parallel_for(added.size(), [&](size_t i) {
+            hooks[i] = std::make_unique<Hook>(added[i]->base);
+        });
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 其间另一次 refresh() 已提交了更新的模块集合，本次的枚举可能已过期，重新开始
+        if (enumerated_ != seen_enumerated || loader_adds_ != seen_adds || loader_subs_ != seen_subs) {
+            continue;
+        }
+
+        // 在锁内应用已注册的 Hook，解析期间新注册的符号也不会遗漏
+        std::vector<Hook::SymbolHook> requests;
+        requests.reserve(symbols_.size());
+        for (const auto& [symbol, replacement] : symbols_) {
+            requests.push_back({symbol, replacement, nullptr});
+        }
+        if (!requests.empty()) {
+            parallel_for(added.size(), [&](size_t i) {
+                if (hooks[i]->is_valid()) hooks[i]->hook_symbols(requests);
+            });
+        }
+
+        for (size_t i = 0; i < added.size(); ++i) {
+            Module module;
+            module.base = added[i]->base;
+            module.path = added[i]->path;
+            module.hook = std::move(hooks[i]);
+            modules_.emplace(module.base, std::move(module));
+        }
+
+        loader_adds_ = current.adds;
+        loader_subs_ = current.subs;
+        enumerated_ = true;
+        return added.size();
+    }
+}
+
+size_t Manager::hook_symbol(const std::string& symbol, void* replacement, void** original_out) {
+    if (symbol.empty() || replacement == nullptr) return 0;
+
+    bool enumerated;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        enumerated = enumerated_;
+    }
+    if (!enumerated) refresh();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    symbols_[symbol] = replacement;
+
+    // 按基址排序，使 original_out 的来源（第一个被修改的模块）稳定
+    auto modules = sorted_modules_locked();
+    std::vector<void*> originals(modules.size(), nullptr);
+    std::vector<char> patched(modules.size(), 0);
+    parallel_for(modules.size(), [&](size_t i) {
+        Hook& hook = *modules[i]->hook;
+        if (hook.is_valid()) {
+            patched[i] = hook.hook_symbol(symbol, replacement, &originals[i]);
+        }
+    });
+
+    size_t count = 0;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        if (!patched[i]) continue;
+        if (count == 0 && original_out) *original_out = originals[i];
+        ++count;
+    }
+    return count;
+}
+
+bool Manager::unhook_symbol(const std::string& symbol) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (symbols_.erase(symbol) == 0) return false;
+
+    auto modules = sorted_modules_locked();
+    parallel_for(modules.size(), [&](size_t i) {
+        // 只在该模块安装过时才会写回
+        modules[i]->hook->unhook_symbol(symbol);
+    });
+    return true;
+}
+
+bool Manager::enable_auto_apply() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto_apply_) return true;
+    }
+
+    // 原始实现通过 dlsym 解析而非取自某个模块的 GOT，保证所有模块的代理调用同一个实现
+    auto original_dlopen = reinterpret_cast<DlopenFn>(dlsym(RTLD_DEFAULT, "dlopen"));
+    auto original_ext = reinterpret_cast<AndroidDlopenExtFn>(dlsym(RTLD_DEFAULT, "android_dlopen_ext"));
+    if (original_dlopen == nullptr && original_ext == nullptr) return false;
+    g_original_dlopen.store(original_dlopen, std::memory_order_release);
+    g_original_android_dlopen_ext.store(original_ext, std::memory_order_release);
+#if defined(__ANDROID__)
+    g_loader_dlopen.store(reinterpret_cast<LoaderDlopenFn>(dlsym(RTLD_DEFAULT, "__loader_dlopen")),
+                          std::memory_order_release);
+    g_loader_android_dlopen_ext.store(
+        reinterpret_cast<LoaderAndroidDlopenExtFn>(dlsym(RTLD_DEFAULT, "__loader_android_dlopen_ext")),
+        std::memory_order_release);
+#endif
+
+    // 即使当前没有模块导入这些符号，注册后之后加载的模块也会被应用
+    if (original_dlopen) {
+        hook_symbol("dlopen", reinterpret_cast<void*>(&dlopen_proxy));
+    }
+    if (original_ext) {
+        hook_symbol("android_dlopen_ext", reinterpret_cast<void*>(&android_dlopen_ext_proxy));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto_apply_ = true;
+    return true;
+}
+
+void Manager::disable_auto_apply() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!auto_apply_) return;
+        auto_apply_ = false;
+    }
+    unhook_symbol("dlopen");
+    unhook_symbol("android_dlopen_ext");
+    // 代理可能仍在其他线程执行，原始指针保持有效
+}
+
+bool Manager::is_auto_apply_enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return auto_apply_;
+}
+
+size_t Manager::module_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return modules_.size();
+}
+
+} // namespace ur::plthook
@@ -0,0 +1,477 @@
+#include "ur/probe.h"
+#include "ur/inline_hook.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <new>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ur::probe {
+
+using assembler::Register;
+
+namespace {
+
+// 写入端只由所属线程操作：head 与 dropped 由它写，tail 由 drain() 写
+struct alignas(64) Ring {
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> dropped{0};
+    uint32_t thread_id = 0;
+    bool retired = false; // Guarded by the registry mutex
+    Ring* next = nullptr; // Registry list; written under the registry mutex
+    alignas(64) std::atomic<uint64_t> tail{0};
+    Record records[kRingCapacity];
+};
+
+constexpr int32_t kHeadOffset = static_cast<int32_t>(offsetof(Ring, head));
+constexpr int32_t kDroppedOffset = static_cast<int32_t>(offsetof(Ring, dropped));
+constexpr int32_t kTailOffset = static_cast<int32_t>(offsetof(Ring, tail));
+constexpr int32_t kRecordsOffset = static_cast<int32_t>(offsetof(Ring, records));
+static_assert(sizeof(Record) == 64, "Records are indexed with a shift by 6");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free);
+
+// 线程指针哈希到槽位；槽位被其他线程占用的线程始终走慢路径
+struct ThreadSlot {
+    std::atomic<uintptr_t> tag; // TPIDR_EL0 of the owner, 0 when free
+    Ring* ring;
+};
+
+constexpr uint32_t kThreadSlotBits = 10;
+constexpr uintptr_t kClaiming = 1; // Never a thread pointer: marks a slot being filled
+constexpr uint64_t kFibonacciMultiplier = 0x9E3779B97F4A7C15ull;
+
+alignas(64) ThreadSlot g_thread_slots[size_t{1} << kThreadSlotBits];
+
+ThreadSlot& slot_for(uintptr_t thread_pointer) {
+    return g_thread_slots[(thread_pointer * kFibonacciMultiplier) >> (64 - kThreadSlotBits)];
+}
+
+// Register file saved by the slow path.
+struct SlowFrame {
+    uint64_t gpr[31];
+    uint64_t nzcv;
+    __uint128_t simd[32];
+};
+static_assert(sizeof(SlowFrame) % 16 == 0, "SlowFrame must keep SP 16-byte aligned");
+
+// x9-x14 are spilled by the fast path; the slots are indexed by register number - 9.
+constexpr int kFirstScratch = 9;
+constexpr int kScratchCount = 6;
+constexpr uint16_t kFastFrameSize = 64;
+
+struct SiteState {
+    uintptr_t address = 0;
+    size_t count = 0;
+    uint8_t registers[kMaxRegisters] = {};
+};
+
+std::atomic<uint64_t> g_lost{0};
+
+void on_thread_exit(void* value);
+
+// 慢路径可能在内存分配器内部运行（探针放在 malloc 等函数上时），因此它用到的一切
+// 都不经过分配器：环直接 mmap，登记表是侵入式链表，线程退出通过 pthread key 通知
+// （thread_local 的析构函数在首次访问时由 __cxa_thread_atexit 登记，会分配内存）。
+class Registry {
+public:
+    static Registry& instance() {
+        // Intentionally leaked: thread exit may retire rings during static destruction.
+        // Placement new keeps the first call free of allocations as well.
+        alignas(Registry) static unsigned char storage[sizeof(Registry)];
+        static Registry* registry = new (storage) Registry();
+        return *registry;
+    }
+
+    Ring* create() {
+        void* memory = mmap(nullptr, sizeof(Ring), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return nullptr;
+        auto* ring = new (memory) Ring();
+        ring->thread_id = static_cast<uint32_t>(syscall(SYS_gettid));
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring->next = head_;
+        head_ = ring;
+        return ring;
+    }
+
+    pthread_key_t exit_key() const { return exit_key_; }
+
+    void retire(Ring* ring) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring->retired = true;
+    }
+
+    size_t drain(const Consumer& consumer, size_t max_records) {
+        std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+        // 回调运行时不持有 mutex_，新线程的首次命中仍可登记。新环只插入表头，
+        // 环只由 drain() 移除，所以从取到的表头往后遍历不需要持锁。
+        Ring* first = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            first = head_;
+        }
+
+        size_t total = 0;
+        for (Ring* ring = first; ring != nullptr; ring = ring->next) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            while (tail != head && total < max_records) {
+                const size_t index = tail & (kRingCapacity - 1);
+                const size_t count = std::min<uint64_t>({head - tail, kRingCapacity - index, max_records - total});
+                consumer(Batch{ring->thread_id, std::span<const Record>(ring->records + index, count)});
+                tail += count;
+                total += count;
+                ring->tail.store(tail, std::memory_order_release);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Ring** link = &head_; *link != nullptr;) {
+            Ring* ring = *link;
+            if (!ring->retired ||
+                ring->tail.load(std::memory_order_relaxed) != ring->head.load(std::memory_order_relaxed)) {
+                link = &ring->next;
+                continue;
+            }
+            retired_dropped_ += ring->dropped.load(std::memory_order_relaxed);
+            *link = ring->next;
+            ring->~Ring();
+            munmap(ring, sizeof(Ring));
+        }
+        return total;
+    }
+
+    uint64_t dropped() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t total = retired_dropped_;
+        for (const Ring* ring = head_; ring != nullptr; ring = ring->next) {
+            total += ring->dropped.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    Registry() {
+        pthread_key_create(&exit_key_, on_thread_exit);
+    }
+
+    std::mutex mutex_;       // Guards the list, retired flags and retired_dropped_
+    std::mutex drain_mutex_; // Serializes consumers; only drain() frees rings
+    Ring* head_ = nullptr;
+    uint64_t retired_dropped_ = 0;
+    pthread_key_t exit_key_{};
+};
+
+// The calling thread's ring and table slot; released by on_thread_exit().
+struct ThreadRing {
+    Ring* ring = nullptr;
+    ThreadSlot* slot = nullptr;
+};
+
+// 均为平凡类型：访问时不会登记析构函数，线程退出后仍可安全读取
+thread_local ThreadRing t_ring;
+thread_local bool t_exited = false;
+
+void on_thread_exit(void* value) {
+    auto* local = static_cast<ThreadRing*>(value);
+    t_exited = true;
+    if (local->slot != nullptr) local->slot->tag.store(0, std::memory_order_relaxed);
+    if (local->ring != nullptr) Registry::instance().retire(local->ring);
+}
+
+void claim_slot(ThreadRing& local) {
+    const auto thread_pointer = reinterpret_cast<uintptr_t>(__builtin_thread_pointer());
+    ThreadSlot& slot = slot_for(thread_pointer);
+    uintptr_t expected = 0;
+    if (!slot.tag.compare_exchange_strong(expected, kClaiming, std::memory_order_relaxed)) return;
+    // 先写 ring 再写 tag：本线程的信号处理函数也不会看到未填好的槽位
+    slot.ring = local.ring;
+    slot.tag.store(thread_pointer, std::memory_order_release);
+    local.slot = &slot;
+}
+
+void append(Ring& ring, const SiteState& site, const uint64_t* gpr, uint64_t timestamp) {
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= kRingCapacity) {
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    Record& record = ring.records[head & (kRingCapacity - 1)];
+    record.pc = site.address;
+    record.timestamp = timestamp;
+    for (size_t i = 0; i < kMaxRegisters; ++i) {
+        record.registers[i] = i < site.count ? gpr[site.registers[i]] : 0;
+    }
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+// Called by the slow path with the whole register file saved.
+void record_slow(const SlowFrame* frame, const SiteState* site, uint64_t timestamp) {
+    if (t_exited) {
+        g_lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ThreadRing& local = t_ring;
+    if (local.ring == nullptr) {
+        auto& registry = Registry::instance();
+        local.ring = registry.create();
+        if (local.ring == nullptr) {
+            g_lost.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pthread_setspecific(registry.exit_key(), &local);
+    }
+    if (local.slot == nullptr) claim_slot(local);
+    append(*local.ring, *site, frame->gpr, timestamp);
+}
+
+Register gpr(int index) {
+    return static_cast<Register>(static_cast<int>(Register::X0) + index);
+}
+
+Register qreg(int index) {
+    return static_cast<Register>(static_cast<int>(Register::Q0) + index);
+}
+
+void transfer_slow_frame(jit::Jit& jit, bool store) {
+    for (int i = 0; i < 30; i += 2) {
+        const auto offset = static_cast<int32_t>(offsetof(SlowFrame, gpr) + i * sizeof(uint64_t));
+        if (store) jit.stp(gpr(i), gpr(i + 1), Register::SP, offset);
+        else jit.ldp(gpr(i), gpr(i + 1), Register::SP, offset);
+    }
+    const auto lr_offset = static_cast<int32_t>(offsetof(SlowFrame, gpr) + 30 * sizeof(uint64_t));
+    for (int i = 0; i < 32; i += 2) {
+        const auto offset = static_cast<int32_t>(offsetof(SlowFrame, simd) + i * sizeof(__uint128_t));
+        if (store) jit.stp(qreg(i), qreg(i + 1), Register::SP, offset);
+        else jit.ldp(qreg(i), qreg(i + 1), Register::SP, offset);
+    }
+    // x0 is free as a scratch register once saved, and before it is restored.
+    if (store) {
+        jit.str(Register::LR, Register::SP, lr_offset);
+        jit.mrs(Register::X0, assembler::SystemRegister::NZCV);
+        jit.str(Register::X0, Register::SP, offsetof(SlowFrame, nzcv));
+    } else {
+        jit.ldr(Register::X0, Register::SP, offsetof(SlowFrame, nzcv));
+        jit.msr(assembler::SystemRegister::NZCV, Register::X0);
+        jit.ldr(Register::LR, Register::SP, lr_offset);
+        jit.ldp(Register::X0, Register::X1, Register::SP, offsetof(SlowFrame, gpr));
+    }
+}
+
+void transfer_scratch(jit::Jit& jit, bool store) {
+    for (int i = 0; i < kScratchCount; i += 2) {
+        const auto offset = static_cast<int32_t>(i * sizeof(uint64_t));
+        if (store) jit.stp(gpr(kFirstScratch + i), gpr(kFirstScratch + i + 1), Register::SP, offset);
+        else jit.ldp(gpr(kFirstScratch + i), gpr(kFirstScratch + i + 1), Register::SP, offset);
+    }
+}
+
+// The value of the site's `index`-th register, loaded into `temp` when the fast path spilled it.
+Register site_register(jit::Jit& jit, const SiteState& site, size_t index, Register temp) {
+    if (index >= site.count) return Register::ZR;
+    const int reg = site.registers[index];
+    if (reg >= kFirstScratch && reg < kFirstScratch + kScratchCount) {
+        jit.ldr(temp, Register::SP, static_cast<int32_t>((reg - kFirstScratch) * sizeof(uint64_t)));
+        return temp;
+    }
+    return gpr(reg);
+}
+
+/**
+ * Fast path (flags and SIMD untouched, x9-x14 spilled):
+ *
+ *     mrs  x9, cntvct_el0
+ *     mrs  x10, tpidr_el0
+ *     x11 = &g_thread_slots[hash(x10)]
+ *     ldp  x12, x13, [x11]          ; tag, ring
+ *     if x12 != x10 goto slow
+ *     ldr  x10, [x13, #head]
+ *     ldr  x11, [x13, #tail]
+ *     if (x10 - x11) >> kRingBits goto full
+ *     x12 = &ring->records[x10 % kRingCapacity]
+ *     stp  pc, x9 / registers...
+ *     dmb  ishst
+ *     str  x10 + 1, [x13, #head]
+ */
+void emit_detour(jit::Jit& jit, const SiteState& site, uintptr_t trampoline) {
+    jit::Label slow, full, done;
+
+    jit.sub(Register::SP, Register::SP, kFastFrameSize);
+    transfer_scratch(jit, true);
+    jit.mrs(Register::X9, assembler::SystemRegister::CNTVCT_EL0);
+
+    jit.mrs(Register::X10, assembler::SystemRegister::TPIDR_EL0);
+    jit.ldr_constant(Register::X11, kFibonacciMultiplier);
+    jit.mul(Register::X11, Register::X10, Register::X11);
+    jit.lsr(Register::X11, Register::X11, 64 - kThreadSlotBits);
+    jit.ldr_constant(Register::X12, reinterpret_cast<uint64_t>(g_thread_slots));
+    jit.add(Register::X11, Register::X12, Register::X11, 0, std::countr_zero(sizeof(ThreadSlot)));
+    jit.ldp(Register::X12, Register::X13, Register::X11, 0);
+    jit.eor(Register::X12, Register::X12, Register::X10);
+    jit.cbnz(Register::X12, slow);
+
+    // tail 的普通加载即可：记录的写入依赖于下面的分支，不会提前到加载之前
+    jit.ldr(Register::X10, Register::X13, kHeadOffset);
+    jit.ldr(Register::X11, Register::X13, kTailOffset);
+    jit.sub(Register::X12, Register::X10, Register::X11);
+    jit.lsr(Register::X12, Register::X12, kRingBits);
+    jit.cbnz(Register::X12, full);
+
+    jit.and_(Register::X12, Register::X10, kRingCapacity - 1);
+    jit.add(Register::X12, Register::X13, Register::X12, 0, std::countr_zero(sizeof(Record)));
+    jit.ldr_constant(Register::X11, site.address);
+    jit.stp(Register::X11, Register::X9, Register::X12, kRecordsOffset + static_cast<int32_t>(offsetof(Record, pc)));
+    for (size_t i = 0; i < kMaxRegisters; i += 2) {
+        // pc 与时间戳已写入，x9/x11 可作为临时寄存器
+        const Register first = site_register(jit, site, i, Register::X11);
+        const Register second = site_register(jit, site, i + 1, Register::X9);
+        jit.stp(first, second, Register::X12,
+                kRecordsOffset + static_cast<int32_t>(offsetof(Record, registers) + i * sizeof(uint64_t)));
+    }
+    jit.add(Register::X10, Register::X10, 1);
+    jit.dmb(assembler::BarrierOption::ISHST);
+    jit.str(Register::X10, Register::X13, kHeadOffset);
+
+    jit.bind(done);
+    transfer_scratch(jit, false);
+    jit.add(Register::SP, Register::SP, kFastFrameSize);
+    jit.jump(trampoline, Register::X16);
+
+    // 环已满：只有所属线程写 dropped，普通的读改写即可
+    jit.bind(full);
+    jit.ldr(Register::X10, Register::X13, kDroppedOffset);
+    jit.add(Register::X10, Register::X10, 1);
+    jit.str(Register::X10, Register::X13, kDroppedOffset);
+    jit.b(done);
+
+    // Slow path: the first hit of a thread, or a thread whose slot is taken.
+    jit.bind(slow);
+    transfer_scratch(jit, false);
+    jit.add(Register::SP, Register::SP, kFastFrameSize);
+    jit.sub(Register::SP, Register::SP, static_cast<uint16_t>(sizeof(SlowFrame)));
+    transfer_slow_frame(jit, true);
+    jit.mov(Register::X0, Register::SP);
+    jit.ldr_constant(Register::X1, reinterpret_cast<uint64_t>(&site));
+    jit.mrs(Register::X2, assembler::SystemRegister::CNTVCT_EL0);
+    jit.call(reinterpret_cast<uintptr_t>(&record_slow), Register::X16);
+    transfer_slow_frame(jit, false);
+    jit.add(Register::SP, Register::SP, static_cast<uint16_t>(sizeof(SlowFrame)));
+    jit.jump(trampoline, Register::X16);
+}
+
+} // namespace
+
+struct Probe::Site {
+    SiteState state;
+};
+
+Probe::Probe(uintptr_t address, const ProbeOptions& options) : address_(address) {
+    if (address == 0) {
+        throw std::invalid_argument("Probe address must not be null.");
+    }
+    if ((options.register_mask >> 31) != 0 || std::popcount(options.register_mask) > static_cast<int>(kMaxRegisters)) {
+        throw std::invalid_argument("The register mask must select at most 6 of x0-x30.");
+    }
+
+    // Set up the registry here rather than on the first hit, inside probed code
+    Registry::instance();
+
+    site_ = std::make_unique<Site>();
+    site_->state.address = address;
+    for (uint8_t reg = 0; reg <= 30; ++reg) {
+        if (options.register_mask & (1u << reg)) site_->state.registers[site_->state.count++] = reg;
+    }
+
+    // 1. Create the underlying inline hook disabled; the detour continues at its trampoline.
+    inline_hook_ = std::make_unique<ur::inline_hook::Hook>(address, nullptr, false);
+    const uintptr_t trampoline = inline_hook_->get_trampoline();
+    if (trampoline == 0) {
+        throw std::runtime_error("Failed to get trampoline from inline hook.");
+    }
+
+    // 2. JIT-compile the recording detour.
+    detour_jit_ = std::make_unique<ur::jit::Jit>();
+    emit_detour(*detour_jit_, site_->state, trampoline);
+    void* detour = detour_jit_->finalize<void*>();
+    if (detour == nullptr) {
+        throw std::runtime_error("Failed to allocate JIT memory for the probe detour.");
+    }
+
+    // 3. Route the address to the detour.
+    inline_hook_->set_detour(detour);
+    if (!inline_hook_->enable()) {
+        throw std::runtime_error("Failed to enable the probe.");
+    }
+}
+
+// Members are destroyed in reverse order: the address is unhooked before the detour and
+// the site it references are freed.
+Probe::~Probe() = default;
+
+Probe::Probe(Probe&& other) noexcept = default;
+
+Probe& Probe::operator=(Probe&& other) noexcept {
+    if (this != &other) {
+        unhook();
+        address_ = std::exchange(other.address_, 0);
+        site_ = std::move(other.site_);
+        detour_jit_ = std::move(other.detour_jit_);
+        inline_hook_ = std::move(other.inline_hook_);
+    }
+    return *this;
+}
+
+bool Probe::is_valid() const {
+    return inline_hook_ && inline_hook_->is_valid();
+}
+
+void Probe::unhook() {
+    inline_hook_.reset();
+    detour_jit_.reset();
+    site_.reset();
+}
+
+bool Probe::enable() {
+    return inline_hook_ ? inline_hook_->enable() : false;
+}
+
+bool Probe::disable() {
+    return inline_hook_ ? inline_hook_->disable() : false;
+}
+
+size_t drain(const Consumer& consumer, size_t max_records) {
+    return Registry::instance().drain(consumer, max_records);
+}
+
+uint64_t dropped() {
+    return Registry::instance().dropped() + g_lost.load(std::memory_order_relaxed);
+}
+
+uint64_t timer_frequency() {
+#if defined(__aarch64__)
+    uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return frequency;
+#else
+    return 0;
+#endif
+}
+
+uint64_t now() {
+#if defined(__aarch64__)
+    uint64_t count;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(count));
+    return count;
+#else
+    return 0;
+#endif
+}
+
+} // namespace ur::probe
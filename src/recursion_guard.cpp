@@ -0,0 +1,78 @@
+#include "ur/recursion_guard.h"
+
+#include <stdexcept>
+
+namespace ur::recursion_guard {
+
+namespace {
+
+#if !defined(__ANDROID__)
+// initial-exec 模型保证变量位于静态 TLS 块，相对线程指针的偏移在所有线程上相同
+__attribute__((tls_model("initial-exec"))) thread_local uintptr_t t_guard = 0;
+#endif
+
+intptr_t compute_offset() {
+#if defined(__ANDROID__)
+    // bionic 线程控制块中的 TLS_SLOT_APP（第 2 个槽位），bionic 自身不使用
+    return 2 * static_cast<intptr_t>(sizeof(void*));
+#else
+    return reinterpret_cast<intptr_t>(&t_guard) - reinterpret_cast<intptr_t>(__builtin_thread_pointer());
+#endif
+}
+
+uintptr_t* guard_word() {
+    return reinterpret_cast<uintptr_t*>(reinterpret_cast<uintptr_t>(__builtin_thread_pointer()) + thread_offset());
+}
+
+} // namespace
+
+intptr_t thread_offset() {
+    static const intptr_t offset = compute_offset();
+    return offset;
+}
+
+bool active() {
+    return __atomic_load_n(guard_word(), __ATOMIC_RELAXED) != 0;
+}
+
+int32_t emit_guard_base(jit::Jit& jit, assembler::Register base) {
+    jit.mrs(base, assembler::SystemRegister::TPIDR_EL0);
+
+    const intptr_t offset = thread_offset();
+    // LDR/STR (unsigned offset) 或 LDUR/STUR 可以直接编码的偏移
+    if ((offset >= 0 && offset < 4096 * 8 && offset % 8 == 0) || (offset >= -256 && offset < 256)) {
+        return static_cast<int32_t>(offset);
+    }
+
+    const uintptr_t magnitude = offset < 0 ? -static_cast<uintptr_t>(offset) : static_cast<uintptr_t>(offset);
+    if (magnitude >= (uintptr_t{1} << 24)) {
+        throw std::runtime_error("Recursion guard TLS offset is out of range");
+    }
+    const auto low = static_cast<uint16_t>(magnitude & 0xFFF);
+    const auto high = static_cast<uint16_t>(magnitude >> 12);
+    if (high != 0) {
+        if (offset < 0) jit.sub(base, base, high, true);
+        else jit.add(base, base, high, true);
+    }
+    if (low != 0) {
+        if (offset < 0) jit.sub(base, base, low);
+        else jit.add(base, base, low);
+    }
+    return 0;
+}
+
+Scope::Scope() {
+    uintptr_t* word = guard_word();
+    if (__atomic_load_n(word, __ATOMIC_RELAXED) == 0) {
+        __atomic_store_n(word, uintptr_t{1}, __ATOMIC_RELAXED);
+        owner_ = true;
+    }
+}
+
+Scope::~Scope() {
+    if (owner_) {
+        __atomic_store_n(guard_word(), uintptr_t{0}, __ATOMIC_RELAXED);
+    }
+}
+
+} // namespace ur::recursion_guard
@@ -0,0 +1,232 @@
+#include "ur/return_hook.h"
+#include "ur/inline_hook.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+namespace ur::return_hook {
+
+using assembler::Register;
+
+namespace {
+
+constexpr int32_t kFrameSize = static_cast<int32_t>(sizeof(CallFrame));
+static_assert(kFrameSize % 16 == 0, "CallFrame must keep SP 16-byte aligned");
+static_assert(offsetof(CallFrame, return_address) == offsetof(CallFrame, gpr) + 9 * sizeof(uint64_t),
+              "x8 and LR are saved as a pair");
+
+struct HookState {
+    EnterCallback on_enter = nullptr;
+    LeaveCallback on_leave = nullptr;
+    void* user_data = nullptr;
+    uintptr_t exit_thunk = 0; // 0 when there is no exit callback
+};
+
+// 出口回调所需的信息按值保存，Hook 移除后仍在执行的调用也不会访问已释放的状态
+struct ShadowEntry {
+    uintptr_t return_address;
+    uintptr_t sp;
+    uint64_t cookie;
+    LeaveCallback on_leave;
+    void* user_data;
+};
+
+// 平凡类型：thread_local 不需要构造与析构注册
+struct ShadowStack {
+    size_t depth;
+    ShadowEntry entries[ReturnHook::kMaxDepth];
+};
+
+thread_local ShadowStack t_shadow_stack;
+
+std::atomic<uint64_t> g_dropped{0};
+
+// Called by the entry stub; returns the value the stub puts in LR.
+// Entries are never discarded here: the new call may run on another stack (a signal
+// handler on sigaltstack, a coroutine), so its SP says nothing about the entries below it.
+uintptr_t enter_call(CallFrame* frame, const HookState* state) {
+    const uint64_t cookie = state->on_enter ? state->on_enter(frame, state->user_data) : 0;
+    if (state->exit_thunk == 0) return frame->return_address;
+
+    auto& stack = t_shadow_stack;
+    if (stack.depth == ReturnHook::kMaxDepth) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return frame->return_address;
+    }
+    stack.entries[stack.depth++] = {frame->return_address, frame->sp, cookie, state->on_leave, state->user_data};
+    return state->exit_thunk;
+}
+
+// Called by the exit thunk; the thunk returns to frame->return_address.
+// The returning call is the innermost entry with its SP (a tail-call chain shares one SP and
+// unwinds one entry per return). Entries above it belong to calls skipped by longjmp and are dropped.
+void leave_call(CallFrame* frame) {
+    auto& stack = t_shadow_stack;
+    size_t index = stack.depth;
+    while (index > 0 && stack.entries[index - 1].sp != frame->sp) --index;
+    if (index == 0) {
+        // 没有记录就无法知道返回地址
+        std::abort();
+    }
+    const ShadowEntry entry = stack.entries[index - 1];
+    stack.depth = index - 1;
+    frame->return_address = entry.return_address;
+    entry.on_leave(frame, entry.cookie, entry.user_data);
+}
+
+// Saves x0-x8, LR, the entry SP and q0-q7 into a CallFrame at SP.
+// q0-q7 are always saved: enter_call() and leave_call() are ordinary C++ and the compiler
+// may use q registers for them (e.g. to copy a ShadowEntry), which would clobber FP/SIMD
+// arguments on entry and FP results on exit.
+void save_frame(jit::Jit& jit, int32_t frame_size) {
+    jit.sub(Register::SP, Register::SP, static_cast<uint16_t>(frame_size));
+    for (int i = 0; i < 8; i += 2) {
+        jit.stp(static_cast<Register>(i), static_cast<Register>(i + 1), Register::SP,
+                static_cast<int32_t>(offsetof(CallFrame, gpr) + i * sizeof(uint64_t)));
+    }
+    jit.stp(Register::X8, Register::LR, Register::SP, static_cast<int32_t>(offsetof(CallFrame, gpr) + 8 * sizeof(uint64_t)));
+    // x9 是临时寄存器，函数入口与返回时都可以破坏
+    jit.add(Register::X9, Register::SP, static_cast<uint16_t>(frame_size));
+    jit.str(Register::X9, Register::SP, static_cast<int32_t>(offsetof(CallFrame, sp)));
+    for (int i = 0; i < 8; i += 2) {
+        jit.stp(static_cast<Register>(static_cast<int>(Register::Q0) + i),
+                static_cast<Register>(static_cast<int>(Register::Q0) + i + 1), Register::SP,
+                static_cast<int32_t>(offsetof(CallFrame, simd) + i * sizeof(__uint128_t)));
+    }
+}
+
+// Restores what save_frame() saved (LR only when `lr` is set) and pops the frame.
+void restore_frame(jit::Jit& jit, int32_t frame_size, bool lr) {
+    for (int i = 0; i < 8; i += 2) {
+        jit.ldp(static_cast<Register>(static_cast<int>(Register::Q0) + i),
+                static_cast<Register>(static_cast<int>(Register::Q0) + i + 1), Register::SP,
+                static_cast<int32_t>(offsetof(CallFrame, simd) + i * sizeof(__uint128_t)));
+    }
+    for (int i = 0; i < 8; i += 2) {
+        jit.ldp(static_cast<Register>(i), static_cast<Register>(i + 1), Register::SP,
+                static_cast<int32_t>(offsetof(CallFrame, gpr) + i * sizeof(uint64_t)));
+    }
+    const auto x8_offset = static_cast<int32_t>(offsetof(CallFrame, gpr) + 8 * sizeof(uint64_t));
+    if (lr) {
+        jit.ldp(Register::X8, Register::LR, Register::SP, x8_offset);
+    } else {
+        jit.ldr(Register::X8, Register::SP, x8_offset);
+    }
+    jit.add(Register::SP, Register::SP, static_cast<uint16_t>(frame_size));
+}
+
+// The exit thunk is shared by every hook and never freed: calls still in flight
+// when a hook is removed keep returning through it.
+uintptr_t build_exit_thunk() {
+    jit::Jit jit;
+    save_frame(jit, kFrameSize);
+    jit.mov(Register::X0, Register::SP);
+    jit.call(reinterpret_cast<uintptr_t>(&leave_call), Register::X16);
+    restore_frame(jit, kFrameSize, true);
+    jit.ret();
+
+    void* thunk = jit.finalize<void*>();
+    if (thunk == nullptr) {
+        throw std::runtime_error("Failed to allocate JIT memory for the exit thunk.");
+    }
+    jit.release();
+    return reinterpret_cast<uintptr_t>(thunk);
+}
+
+uintptr_t exit_thunk() {
+    static const uintptr_t thunk = build_exit_thunk();
+    return thunk;
+}
+
+} // namespace
+
+struct ReturnHook::State {
+    HookState hook;
+};
+
+ReturnHook::ReturnHook(uintptr_t target, EnterCallback on_enter, LeaveCallback on_leave, void* user_data) {
+    if (target == 0) {
+        throw std::invalid_argument("Target must not be null.");
+    }
+    if (on_enter == nullptr && on_leave == nullptr) {
+        throw std::invalid_argument("At least one of the entry and exit callbacks must be set.");
+    }
+
+    state_ = std::make_unique<State>();
+    state_->hook.on_enter = on_enter;
+    state_->hook.on_leave = on_leave;
+    state_->hook.user_data = user_data;
+    state_->hook.exit_thunk = on_leave ? exit_thunk() : 0;
+
+    // 1. Create the underlying inline hook disabled; the stub continues through its link.
+    inline_hook_ = std::make_unique<ur::inline_hook::Hook>(target, nullptr, false);
+    const auto original = reinterpret_cast<uintptr_t>(inline_hook_->get_original());
+
+    // 2. JIT-compile the entry stub. It does not return: after the entry callback it
+    //    restores the arguments and jumps into the chain with LR replaced.
+    entry_jit_ = std::make_unique<ur::jit::Jit>();
+    save_frame(*entry_jit_, kFrameSize);
+    entry_jit_->mov(Register::X0, Register::SP);
+    entry_jit_->ldr_constant(Register::X1, reinterpret_cast<uintptr_t>(&state_->hook));
+    entry_jit_->call(reinterpret_cast<uintptr_t>(&enter_call), Register::X16);
+    entry_jit_->mov(Register::LR, Register::X0);
+    restore_frame(*entry_jit_, kFrameSize, false);
+    entry_jit_->jump(original, Register::X16);
+
+    void* entry = entry_jit_->finalize<void*>();
+    if (entry == nullptr) {
+        throw std::runtime_error("Failed to allocate JIT memory for the entry stub.");
+    }
+
+    // 3. Route the target to the stub.
+    inline_hook_->set_detour(entry);
+    if (!inline_hook_->enable()) {
+        throw std::runtime_error("Failed to enable the return hook.");
+    }
+}
+
+// Members are destroyed in reverse order: the target is unhooked before the stub and
+// the state it references are freed.
+ReturnHook::~ReturnHook() = default;
+
+ReturnHook::ReturnHook(ReturnHook&& other) noexcept = default;
+
+ReturnHook& ReturnHook::operator=(ReturnHook&& other) noexcept {
+    if (this != &other) {
+        unhook();
+        state_ = std::move(other.state_);
+        entry_jit_ = std::move(other.entry_jit_);
+        inline_hook_ = std::move(other.inline_hook_);
+    }
+    return *this;
+}
+
+bool ReturnHook::is_valid() const {
+    return inline_hook_ && inline_hook_->is_valid();
+}
+
+void ReturnHook::unhook() {
+    inline_hook_.reset();
+    entry_jit_.reset();
+    state_.reset();
+}
+
+bool ReturnHook::enable() {
+    return inline_hook_ ? inline_hook_->enable() : false;
+}
+
+bool ReturnHook::disable() {
+    return inline_hook_ ? inline_hook_->disable() : false;
+}
+
+size_t ReturnHook::depth() {
+    return t_shadow_stack.depth;
+}
+
+uint64_t ReturnHook::dropped() {
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace ur::return_hook
@@ -0,0 +1,786 @@
+#include "ur/scanner.h"
+#include "ur/exec_pool.h"
+#include "ur/maps_parser.h"
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace ur::scanner {
+
+namespace {
+
+// 区域按块切分后并行扫描，块足够大以摊薄调度开销
+constexpr size_t kChunkSize = 1024 * 1024;
+
+// AArch64 指令中出现频率很高的字节（寄存器 0/31、常见操作码高字节等），作为锚点时候选位置过多
+bool is_common_byte(uint8_t byte) {
+    switch (byte) {
+        case 0x00: case 0xFF: case 0x03: case 0x1F: case 0xE0: case 0xE1:
+        case 0x91: case 0x94: case 0x97: case 0xA9: case 0xAA: case 0xB9:
+        case 0xD1: case 0xF9: case 0x52: case 0x54: case 0x14: case 0x17:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 在 [begin, end) 中查找所有完整落在区间内的匹配
+void scan_block(const uint8_t* begin, const uint8_t* end, const Pattern& pattern, std::vector<uintptr_t>& out) {
+    const size_t size = pattern.size();
+    if (static_cast<size_t>(end - begin) < size) return;
+
+    const size_t anchor = pattern.anchor();
+    const uint8_t needle = pattern.bytes()[anchor];
+    // 锚点字节可能出现的范围
+    const uint8_t* p = begin + anchor;
+    const uint8_t* last = end - (size - 1 - anchor);
+
+    auto check = [&](const uint8_t* at) {
+        const uint8_t* candidate = at - anchor;
+        if (pattern.matches(candidate)) {
+            out.push_back(reinterpret_cast<uintptr_t>(candidate));
+        }
+    };
+
+#if defined(__ARM_NEON)
+    const uint8x16_t splat = vdupq_n_u8(needle);
+    for (; last - p >= 16; p += 16) {
+        const uint8x16_t eq = vceqq_u8(vld1q_u8(p), splat);
+        // 每个字节压缩为 4 位，得到 64 位掩码
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        while (bits != 0) {
+            const unsigned lane = static_cast<unsigned>(__builtin_ctzll(bits)) >> 2;
+            check(p + lane);
+            bits &= ~(0xFull << (lane * 4));
+        }
+    }
+#endif
+
+    while (p < last) {
+        const auto* hit = static_cast<const uint8_t*>(memchr(p, needle, static_cast<size_t>(last - p)));
+        if (hit == nullptr) break;
+        check(hit);
+        p = hit + 1;
+    }
+}
+
+using disassembler::InstructionId;
+using Filter = InsnPattern::WordFilter;
+using Operand = InsnPattern::Operand;
+
+// 每条指令编码的必要条件，与 disassembler.cpp 中的解码分支对应（附带区分同组指令的位）。
+// 只用于快速排除：通过过滤的字仍需解码确认。
+std::span<const Filter> filters_for(InstructionId id) {
+    static constexpr Filter kNop[] = {{0xFFFFFFFF, 0xD503201F}};
+    static constexpr Filter kRet[] = {{0xFFFFFFFF, 0xD65F03C0}};
+    static constexpr Filter kB[] = {{0xFC000000, 0x14000000}};
+    static constexpr Filter kBl[] = {{0xFC000000, 0x94000000}};
+    static constexpr Filter kBr[] = {{0xFFFFFC1F, 0xD61F0000}};
+    static constexpr Filter kBlr[] = {{0xFFFFFC1F, 0xD63F0000}};
+    static constexpr Filter kBCond[] = {{0xFE000000, 0x54000000}};
+    static constexpr Filter kCbz[] = {{0x7F000000, 0x34000000}};
+    static constexpr Filter kCbnz[] = {{0x7F000000, 0x35000000}};
+    static constexpr Filter kTbz[] = {{0x7F000000, 0x36000000}};
+    static constexpr Filter kTbnz[] = {{0x7F000000, 0x37000000}};
+    // 立即数 / 移位寄存器两种形式
+    static constexpr Filter kAdd[] = {{0x7F000000, 0x11000000}, {0x7F200000, 0x0B000000}};
+    static constexpr Filter kAdds[] = {{0x7F000000, 0x31000000}, {0x7F200000, 0x2B000000}};
+    static constexpr Filter kSub[] = {{0x7F000000, 0x51000000}, {0x7F200000, 0x4B000000}};
+    static constexpr Filter kSubs[] = {{0x7F000000, 0x71000000}, {0x7F200000, 0x6B000000}};
+    // 移位寄存器 / 立即数两种形式
+    static constexpr Filter kAnd[] = {{0x7F800000, 0x0A000000}, {0x7F800000, 0x12000000}};
+    static constexpr Filter kOrr[] = {{0x7F800000, 0x2A000000}, {0x7F800000, 0x32000000}};
+    static constexpr Filter kEor[] = {{0x7F800000, 0x4A000000}, {0x7F800000, 0x52000000}};
+    static constexpr Filter kAnds[] = {{0x7F800000, 0x6A000000}, {0x7F800000, 0x72000000}};
+    static constexpr Filter kMov[] = {{0x7FA003E0, 0x2A0003E0}}; // ORR Rd, ZR, Rm
+    static constexpr Filter kMovz[] = {{0x7F800000, 0x52800000}};
+    static constexpr Filter kMovn[] = {{0x7F800000, 0x12800000}};
+    static constexpr Filter kMovk[] = {{0x7F800000, 0x72800000}};
+    static constexpr Filter kUbfm[] = {{0x7F800000, 0x53000000}};
+    static constexpr Filter kAdr[] = {{0x9F000000, 0x10000000}};
+    static constexpr Filter kAdrp[] = {{0x9F000000, 0x90000000}};
+    // 无符号偏移 / 寄存器偏移两种形式，size、V 与 opc 区分访问宽度、符号扩展与 SIMD&FP 寄存器
+    static constexpr Filter kLdr[] = {{0xBFC00000, 0xB9400000}, {0xBFE00C00, 0xB8600800}};
+    static constexpr Filter kStr[] = {{0xBFC00000, 0xB9000000}, {0xBFE00C00, 0xB8200800}};
+    static constexpr Filter kLdrb[] = {{0xFFC00000, 0x39400000}, {0xFFE00C00, 0x38600800}};
+    static constexpr Filter kLdrh[] = {{0xFFC00000, 0x79400000}, {0xFFE00C00, 0x78600800}};
+    static constexpr Filter kStrb[] = {{0xFFC00000, 0x39000000}, {0xFFE00C00, 0x38200800}};
+    static constexpr Filter kStrh[] = {{0xFFC00000, 0x79000000}, {0xFFE00C00, 0x78200800}};
+    static constexpr Filter kLdrsb[] = {{0xFF800000, 0x39800000}, {0xFFA00C00, 0x38A00800}};
+    static constexpr Filter kLdrsh[] = {{0xFF800000, 0x79800000}, {0xFFA00C00, 0x78A00800}};
+    static constexpr Filter kLdrsw[] = {{0xFFC00000, 0xB9800000}, {0xFFE00C00, 0xB8A00800}};
+    static constexpr Filter kPrfm[] = {{0xFFC00000, 0xF9800000}, {0xFFE00C00, 0xF8A00800}};
+    static constexpr Filter kLdrFp[] = {{0x3F400000, 0x3D400000}, {0x3F600C00, 0x3C600800}};
+    static constexpr Filter kStrFp[] = {{0x3F400000, 0x3D000000}, {0x3F600C00, 0x3C200800}};
+    // W/X 与 SIMD&FP 两种形式
+    static constexpr Filter kLdrLit[] = {{0xBF000000, 0x18000000}, {0x3F000000, 0x1C000000}};
+    static constexpr Filter kLdrswLit[] = {{0xFF000000, 0x98000000}};
+    static constexpr Filter kPrfmLit[] = {{0xFF000000, 0xD8000000}};
+    static constexpr Filter kLdp[] = {{0x3E400000, 0x28400000}};
+    static constexpr Filter kStp[] = {{0x3E400000, 0x28000000}};
+    static constexpr Filter kFadd[] = {{0x1E20F800, 0x1E202800}};
+    static constexpr Filter kFsub[] = {{0x1E20F800, 0x1E203800}};
+    static constexpr Filter kFmul[] = {{0x1E20F800, 0x1E200800}};
+    static constexpr Filter kFdiv[] = {{0x1E20F800, 0x1E201800}};
+    static constexpr Filter kFpConvert[] = {{0x1F000000, 0x1E000000}};
+    static constexpr Filter kFmov[] = {{0xFFE0FC00, 0x1E204000}};
+    static constexpr Filter kExclusive[] = {{0x3F000000, 0x08000000}};
+
+    switch (id) {
+        case InstructionId::NOP: return kNop;
+        case InstructionId::RET: return kRet;
+        case InstructionId::B: return kB;
+        case InstructionId::BL: return kBl;
+        case InstructionId::BR: return kBr;
+        case InstructionId::BLR: return kBlr;
+        case InstructionId::B_COND: return kBCond;
+        case InstructionId::CBZ: return kCbz;
+        case InstructionId::CBNZ: return kCbnz;
+        case InstructionId::TBZ: return kTbz;
+        case InstructionId::TBNZ: return kTbnz;
+        case InstructionId::ADD: return kAdd;
+        case InstructionId::ADDS: return kAdds;
+        case InstructionId::SUB: return kSub;
+        case InstructionId::SUBS: return kSubs;
+        case InstructionId::AND: return kAnd;
+        case InstructionId::ORR: return kOrr;
+        case InstructionId::EOR: return kEor;
+        case InstructionId::ANDS: return kAnds;
+        case InstructionId::MOV: return kMov;
+        case InstructionId::MOVZ: return kMovz;
+        case InstructionId::MOVN: return kMovn;
+        case InstructionId::MOVK: return kMovk;
+        case InstructionId::UBFM: return kUbfm;
+        case InstructionId::ADR: return kAdr;
+        case InstructionId::ADRP: return kAdrp;
+        case InstructionId::LDR: return kLdr;
+        case InstructionId::STR: return kStr;
+        case InstructionId::LDR_LIT: return kLdrLit;
+        case InstructionId::LDRSW_LIT: return kLdrswLit;
+        case InstructionId::PRFM_LIT: return kPrfmLit;
+        case InstructionId::LDRB: return kLdrb;
+        case InstructionId::LDRH: return kLdrh;
+        case InstructionId::STRB: return kStrb;
+        case InstructionId::STRH: return kStrh;
+        case InstructionId::LDRSB: return kLdrsb;
+        case InstructionId::LDRSH: return kLdrsh;
+        case InstructionId::LDRSW: return kLdrsw;
+        case InstructionId::PRFM: return kPrfm;
+        case InstructionId::LDR_FP: return kLdrFp;
+        case InstructionId::STR_FP: return kStrFp;
+        case InstructionId::LDP: return kLdp;
+        case InstructionId::STP: return kStp;
+        case InstructionId::FADD: return kFadd;
+        case InstructionId::FSUB: return kFsub;
+        case InstructionId::FMUL: return kFmul;
+        case InstructionId::FDIV: return kFdiv;
+        case InstructionId::SCVTF:
+        case InstructionId::FCVTZS: return kFpConvert;
+        case InstructionId::FMOV: return kFmov;
+        case InstructionId::LDXR:
+        case InstructionId::STXR: return kExclusive;
+        default: return {};
+    }
+}
+
+struct Mnemonic {
+    std::string_view name;
+    InstructionId ids[InsnPattern::Step::kMaxIds];
+};
+
+// 文本形式与 disassembler::format() 输出的助记符一致；"ldr" 同时覆盖 LDR (literal)
+constexpr Mnemonic kMnemonics[] = {
+    {"add", {InstructionId::ADD}},     {"adds", {InstructionId::ADDS}},
+    {"sub", {InstructionId::SUB}},     {"subs", {InstructionId::SUBS}},
+    {"and", {InstructionId::AND}},     {"orr", {InstructionId::ORR}},
+    {"eor", {InstructionId::EOR}},     {"ands", {InstructionId::ANDS}},
+    {"mov", {InstructionId::MOV}},     {"movz", {InstructionId::MOVZ}},
+    {"movn", {InstructionId::MOVN}},   {"movk", {InstructionId::MOVK}},
+    {"ubfm", {InstructionId::UBFM}},   {"adr", {InstructionId::ADR}},
+    {"adrp", {InstructionId::ADRP}},   {"b", {InstructionId::B}},
+    {"bl", {InstructionId::BL}},       {"br", {InstructionId::BR}},
+    {"blr", {InstructionId::BLR}},     {"b.cond", {InstructionId::B_COND}},
+    {"cbz", {InstructionId::CBZ}},     {"cbnz", {InstructionId::CBNZ}},
+    {"tbz", {InstructionId::TBZ}},     {"tbnz", {InstructionId::TBNZ}},
+    {"ret", {InstructionId::RET}},     {"nop", {InstructionId::NOP}},
+    {"ldr", {InstructionId::LDR, InstructionId::LDR_LIT, InstructionId::LDR_FP}},
+    {"str", {InstructionId::STR, InstructionId::STR_FP}},
+    {"ldrb", {InstructionId::LDRB}},   {"ldrh", {InstructionId::LDRH}},
+    {"strb", {InstructionId::STRB}},   {"strh", {InstructionId::STRH}},
+    {"ldrsb", {InstructionId::LDRSB}}, {"ldrsh", {InstructionId::LDRSH}},
+    {"ldp", {InstructionId::LDP}},
+    {"stp", {InstructionId::STP}},     {"fmov", {InstructionId::FMOV}},
+    {"fadd", {InstructionId::FADD}},   {"fsub", {InstructionId::FSUB}},
+    {"fmul", {InstructionId::FMUL}},   {"fdiv", {InstructionId::FDIV}},
+    {"scvtf", {InstructionId::SCVTF}}, {"fcvtzs", {InstructionId::FCVTZS}},
+    {"ldxr", {InstructionId::LDXR}},   {"stxr", {InstructionId::STXR}},
+    {"ldrsw", {InstructionId::LDRSW, InstructionId::LDRSW_LIT}},
+    {"prfm", {InstructionId::PRFM, InstructionId::PRFM_LIT}},
+};
+
+constexpr std::string_view kConditionNames[] = {
+    "eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc", "hi", "ls", "ge", "lt", "gt", "le", "al", "nv",
+};
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+    return text;
+}
+
+std::string to_lower(std::string_view text) {
+    std::string result(text);
+    for (char& c : result) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return result;
+}
+
+// 按逗号切分，方括号内的逗号属于内存操作数
+std::vector<std::string_view> split_operands(std::string_view text) {
+    std::vector<std::string_view> operands;
+    int depth = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size()) {
+            if (text[i] == '[') ++depth;
+            if (text[i] == ']') --depth;
+            if (text[i] != ',' || depth != 0) continue;
+        }
+        operands.push_back(trim(text.substr(begin, i - begin)));
+        begin = i + 1;
+    }
+    return operands;
+}
+
+bool parse_integer(std::string_view text, int64_t& value) {
+    bool negative = false;
+    if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+        negative = text.front() == '-';
+        text.remove_prefix(1);
+    }
+    int base = 10;
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        base = 16;
+        text.remove_prefix(2);
+    }
+    uint64_t magnitude = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), magnitude, base);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size()) return false;
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+// 寄存器编号 31 按 disassembler 的约定映射为 SP / WSP
+bool parse_register(std::string_view text, Operand::Kind& kind, assembler::Register& reg) {
+    using assembler::Register;
+    const std::string name = to_lower(text);
+    struct Alias {
+        std::string_view name;
+        Register reg;
+    };
+    static constexpr Alias kAliases[] = {
+        {"sp", Register::SP},   {"xzr", Register::SP},   {"fp", Register::FP}, {"lr", Register::LR},
+        {"wsp", Register::WSP}, {"wzr", Register::WSP},
+    };
+    for (const auto& alias : kAliases) {
+        if (name == alias.name) {
+            kind = Operand::Kind::REG;
+            reg = alias.reg;
+            return true;
+        }
+    }
+    if (name.size() < 2) return false;
+
+    Register first;
+    int limit;
+    switch (name[0]) {
+        case 'x': first = Register::X0; limit = 30; break;
+        case 'w': first = Register::W0; limit = 30; break;
+        case 's': first = Register::S0; limit = 31; break;
+        case 'd': first = Register::D0; limit = 31; break;
+        case 'q': first = Register::Q0; limit = 31; break;
+        default: return false;
+    }
+    if (name.size() == 2 && name[1] == '?') {
+        kind = Operand::Kind::REG_CLASS;
+        reg = first;
+        return true;
+    }
+    int number = 0;
+    auto [end, error] = std::from_chars(name.data() + 1, name.data() + name.size(), number);
+    if (error != std::errc() || end != name.data() + name.size() || number < 0 || number > limit) return false;
+    kind = Operand::Kind::REG;
+    reg = static_cast<Register>(static_cast<int>(first) + number);
+    return true;
+}
+
+Operand parse_operand(std::string_view token, std::string_view text) {
+    auto fail = [&]() {
+        return std::invalid_argument("Invalid operand '" + std::string(token) + "' in pattern: " + std::string(text));
+    };
+
+    Operand operand;
+    if (token == "*" || token == "?") return operand;
+
+    if (token.front() == '[') {
+        if (token.back() == '!') token.remove_suffix(1); // 前变址与有符号偏移不区分
+        if (token.size() < 2 || token.back() != ']') throw fail();
+        auto parts = split_operands(token.substr(1, token.size() - 2));
+        if (parts.empty() || parts.size() > 2) throw fail();
+        operand.kind = Operand::Kind::MEM;
+        if (parts[0] != "*" && parts[0] != "?" && !parse_register(parts[0], operand.base_kind, operand.base)) {
+            throw fail();
+        }
+        if (parts.size() == 2) {
+            std::string_view disp = parts[1];
+            if (!disp.empty() && disp.front() == '#') disp.remove_prefix(1);
+            if (disp != "*" && disp != "?") {
+                int64_t value = 0;
+                if (!parse_integer(disp, value)) throw fail();
+                operand.any_displacement = false;
+                operand.displacement = static_cast<int32_t>(value);
+            }
+        }
+        return operand;
+    }
+
+    std::string_view imm = token.front() == '#' ? token.substr(1) : token;
+    if (imm == "*" || imm == "?") {
+        operand.kind = Operand::Kind::ANY_IMM;
+        return operand;
+    }
+    if (parse_integer(imm, operand.imm)) {
+        operand.kind = Operand::Kind::IMM;
+        return operand;
+    }
+    if (token.front() != '#' && parse_register(token, operand.kind, operand.reg)) return operand;
+    throw fail();
+}
+
+bool register_matches(Operand::Kind kind, assembler::Register expected, assembler::Register actual) {
+    switch (kind) {
+        case Operand::Kind::ANY:
+            return true;
+        case Operand::Kind::REG_CLASS: {
+            const int offset = static_cast<int>(actual) - static_cast<int>(expected);
+            return offset >= 0 && offset <= 32;
+        }
+        default:
+            return actual == expected;
+    }
+}
+
+bool operand_matches(const Operand& expected, const disassembler::DecodedOperand& actual) {
+    using disassembler::OperandType;
+    switch (expected.kind) {
+        case Operand::Kind::ANY:
+            return true;
+        case Operand::Kind::REG_CLASS:
+        case Operand::Kind::REG:
+            return actual.type == OperandType::REGISTER && register_matches(expected.kind, expected.reg, actual.reg);
+        case Operand::Kind::ANY_IMM:
+            return actual.type == OperandType::IMMEDIATE;
+        case Operand::Kind::IMM:
+            return actual.type == OperandType::IMMEDIATE && actual.imm == expected.imm;
+        case Operand::Kind::MEM:
+            return actual.type == OperandType::MEMORY &&
+                   register_matches(expected.base_kind, expected.base, actual.mem.base) &&
+                   (expected.any_displacement || actual.mem.displacement == expected.displacement);
+    }
+    return false;
+}
+
+bool passes_filters(const InsnPattern::Step& step, uint32_t word) {
+    if (step.filter_count == 0) return true;
+    for (uint8_t i = 0; i < step.filter_count; ++i) {
+        if ((word & step.filters[i].mask) == step.filters[i].value) return true;
+    }
+    return false;
+}
+
+// 过滤条件越严格（掩码位数越少的那一项位数越多）候选越少；无过滤的步骤得 0 分
+int selectivity(const InsnPattern::Step& step) {
+    if (step.filter_count == 0) return 0;
+    int weakest = 32;
+    for (uint8_t i = 0; i < step.filter_count; ++i) {
+        weakest = std::min(weakest, std::popcount(step.filters[i].mask));
+    }
+    return weakest * InsnPattern::Step::kMaxFilters - step.filter_count;
+}
+
+void scan_block(const uint8_t* begin, const uint8_t* end, const InsnPattern& pattern, std::vector<uintptr_t>& out) {
+    const uintptr_t aligned = (reinterpret_cast<uintptr_t>(begin) + 3) & ~uintptr_t{3};
+    if (aligned >= reinterpret_cast<uintptr_t>(end)) return;
+    const size_t count = (reinterpret_cast<uintptr_t>(end) - aligned) / 4;
+    const size_t size = pattern.size();
+    if (count < size) return;
+
+    const auto* words = reinterpret_cast<const uint32_t*>(aligned);
+    const size_t anchor = pattern.anchor();
+    const InsnPattern::Step& step = pattern.steps()[anchor];
+    // 锚点指令可能出现的下标范围 [anchor, last)
+    size_t i = anchor;
+    const size_t last = count - size + anchor + 1;
+
+    auto check = [&](size_t at) {
+        const uint32_t* candidate = words + at - anchor;
+        const auto address = reinterpret_cast<uintptr_t>(candidate);
+        if (pattern.matches(address, candidate)) out.push_back(address);
+    };
+
+#if defined(__ARM_NEON)
+    if (step.filter_count != 0) {
+        uint32x4_t masks[InsnPattern::Step::kMaxFilters];
+        uint32x4_t values[InsnPattern::Step::kMaxFilters];
+        for (uint8_t f = 0; f < step.filter_count; ++f) {
+            masks[f] = vdupq_n_u32(step.filters[f].mask);
+            values[f] = vdupq_n_u32(step.filters[f].value);
+        }
+        for (; last - i >= 4; i += 4) {
+            const uint32x4_t v = vld1q_u32(words + i);
+            uint32x4_t hit = vceqq_u32(vandq_u32(v, masks[0]), values[0]);
+            for (uint8_t f = 1; f < step.filter_count; ++f) {
+                hit = vorrq_u32(hit, vceqq_u32(vandq_u32(v, masks[f]), values[f]));
+            }
+            // 每个 32 位结果压缩为 16 位，得到 64 位掩码
+            uint64_t bits = vget_lane_u64(vreinterpret_u64_u16(vmovn_u32(hit)), 0);
+            while (bits != 0) {
+                const unsigned lane = static_cast<unsigned>(__builtin_ctzll(bits)) >> 4;
+                check(i + lane);
+                bits &= ~(0xFFFFull << (lane * 16));
+            }
+        }
+    }
+#endif
+
+    for (; i < last; ++i) {
+        if (passes_filters(step, words[i])) check(i);
+    }
+}
+
+struct Chunk {
+    uintptr_t start;      // 匹配起始地址的下界
+    uintptr_t end;        // 匹配起始地址的上界（不含）
+    uintptr_t region_end; // 可读取的上界
+};
+
+void split_region(uintptr_t start, uintptr_t end, std::vector<Chunk>& chunks) {
+    for (uintptr_t chunk = start; chunk < end; chunk += std::min<uintptr_t>(kChunkSize, end - chunk)) {
+        chunks.push_back({chunk, std::min<uintptr_t>(chunk + kChunkSize, end), end});
+    }
+}
+
+void scan_chunk(const Chunk& chunk, const Pattern& pattern, std::vector<uintptr_t>& out) {
+    // 多读 size - 1 字节，使跨越块边界的匹配归属于起始所在的块
+    const uintptr_t read_end = std::min<uintptr_t>(chunk.region_end, chunk.end + pattern.size() - 1);
+    scan_block(reinterpret_cast<const uint8_t*>(chunk.start), reinterpret_cast<const uint8_t*>(read_end), pattern, out);
+}
+
+void scan_chunk(const Chunk& chunk, const InsnPattern& pattern, std::vector<uintptr_t>& out) {
+    // 区域与块边界都按页对齐，指令字不会跨块；多读 byte_size - 4 字节即可
+    const uintptr_t read_end = std::min<uintptr_t>(chunk.region_end, chunk.end + pattern.byte_size() - 4);
+    scan_block(reinterpret_cast<const uint8_t*>(chunk.start), reinterpret_cast<const uint8_t*>(read_end), pattern, out);
+}
+
+// 从 [start, end) 中去掉内存池的执行视图（已排序）后切块
+void split_region(uintptr_t start, uintptr_t end, const std::vector<exec_pool::Range>& excluded,
+                  std::vector<Chunk>& chunks) {
+    for (const auto& range : excluded) {
+        if (range.end <= start) continue;
+        if (range.start >= end) break;
+        if (range.start > start) split_region(start, range.start, chunks);
+        start = std::max(start, range.end);
+    }
+    if (start < end) split_region(start, end, chunks);
+}
+
+template <typename PatternT>
+std::vector<uintptr_t> scan_regions(const PatternT& pattern, const ScanOptions& options) {
+    // 跳板、Detour Stub 等池内代码复制了被 Hook 函数的开头，不能参与扫描；
+    // 先取池的范围，扫描期间释放的池映射仍在排除之列
+    const auto excluded = exec_pool::executable_ranges();
+    // 扫描直接读取内存，必须使用最新的映射，不能沿用可能已过期的共享快照
+    auto snapshot = maps_parser::MapsSnapshot::refresh();
+
+    std::vector<Chunk> chunks;
+    for (const auto& entry : snapshot->entries()) {
+        if ((entry.prot & (PROT_READ | PROT_EXEC)) != (PROT_READ | PROT_EXEC)) continue;
+        if (!options.module.empty() && entry.path.find(options.module) == std::string_view::npos) continue;
+        split_region(entry.start, entry.end, excluded, chunks);
+    }
+
+    const size_t hardware = std::max(1u, options.threads ? options.threads : std::thread::hardware_concurrency());
+    const size_t workers = std::min(hardware, chunks.size());
+
+    // 块按地址顺序领取，结果按块保存。达到 max_matches 后不再领取新块，
+    // 已扫描的块总是 chunks 的一个前缀，其中的匹配就是地址最小的那些
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> found{0};
+    std::vector<std::vector<uintptr_t>> results(chunks.size());
+    auto run = [&]() {
+        while (!options.max_matches || found.load(std::memory_order_relaxed) < options.max_matches) {
+            const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= chunks.size()) break;
+            scan_chunk(chunks[i], pattern, results[i]);
+            found.fetch_add(results[i].size(), std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    if (workers > 1) threads.reserve(workers - 1);
+    for (size_t t = 1; t < workers; ++t) {
+        try {
+            threads.emplace_back(run);
+        } catch (const std::system_error&) {
+            break; // 无法创建更多线程时由已有线程完成剩余工作
+        }
+    }
+    run();
+    for (auto& thread : threads) thread.join();
+
+    // 块内的匹配已按地址排列，按块顺序拼接即为升序
+    std::vector<uintptr_t> matches;
+    for (auto& out : results) {
+        matches.insert(matches.end(), out.begin(), out.end());
+        if (options.max_matches && matches.size() >= options.max_matches) {
+            matches.resize(options.max_matches);
+            break;
+        }
+    }
+    return matches;
+}
+
+template <typename PatternT>
+inline_hook::Hook hook_unique(const PatternT& pattern, inline_hook::Hook::Callback callback,
+                              const ScanOptions& options, ptrdiff_t offset,
+                              const inline_hook::HookOptions& hook_options) {
+    ScanOptions limited = options;
+    limited.max_matches = 2; // 只需区分“唯一”与“不唯一”
+    auto matches = scan_regions(pattern, limited);
+    if (matches.empty()) {
+        throw std::runtime_error("Pattern not found in executable memory");
+    }
+    if (matches.size() > 1) {
+        throw std::runtime_error("Pattern matches more than one location");
+    }
+    return inline_hook::Hook(matches.front() + offset, callback, true, hook_options);
+}
+
+} // namespace
+
+Pattern::Pattern(std::string_view ida_pattern) {
+    size_t i = 0;
+    while (i < ida_pattern.size()) {
+        const char c = ida_pattern[i];
+        if (c == ' ' || c == '\t') {
+            ++i;
+            continue;
+        }
+        if (c == '?') {
+            bytes_.push_back(0);
+            mask_.push_back(0x00);
+            i += (i + 1 < ida_pattern.size() && ida_pattern[i + 1] == '?') ? 2 : 1;
+        } else {
+            const int high = hex_value(c);
+            const int low = i + 1 < ida_pattern.size() ? hex_value(ida_pattern[i + 1]) : -1;
+            if (high < 0 || low < 0) {
+                throw std::invalid_argument("Invalid byte in pattern: " + std::string(ida_pattern));
+            }
+            bytes_.push_back(static_cast<uint8_t>(high << 4 | low));
+            mask_.push_back(0xFF);
+            i += 2;
+        }
+        if (i < ida_pattern.size() && ida_pattern[i] != ' ' && ida_pattern[i] != '\t') {
+            throw std::invalid_argument("Pattern bytes must be separated by spaces: " + std::string(ida_pattern));
+        }
+    }
+    choose_anchor();
+}
+
+Pattern::Pattern(std::span<const uint8_t> bytes, std::span<const uint8_t> mask)
+    : bytes_(bytes.begin(), bytes.end()) {
+    if (bytes.size() != mask.size()) {
+        throw std::invalid_argument("Pattern bytes and mask must have the same size");
+    }
+    mask_.reserve(mask.size());
+    for (size_t i = 0; i < mask.size(); ++i) {
+        mask_.push_back(mask[i] ? 0xFF : 0x00);
+        if (!mask[i]) bytes_[i] = 0;
+    }
+    choose_anchor();
+}
+
+void Pattern::choose_anchor() {
+    bool found = false;
+    for (size_t i = 0; i < bytes_.size(); ++i) {
+        if (mask_[i] == 0) continue;
+        if (!found) {
+            anchor_ = i;
+            found = true;
+        }
+        if (!is_common_byte(bytes_[i])) {
+            anchor_ = i;
+            return;
+        }
+    }
+    if (!found) {
+        throw std::invalid_argument("Pattern must contain at least one fixed byte");
+    }
+}
+
+bool Pattern::matches(const uint8_t* data) const {
+    for (size_t i = 0; i < bytes_.size(); ++i) {
+        if ((data[i] & mask_[i]) != bytes_[i]) return false;
+    }
+    return true;
+}
+
+InsnPattern::InsnPattern(std::string_view text) {
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find_first_of(";\n", begin);
+        if (end == std::string_view::npos) end = text.size();
+        const std::string_view insn = trim(text.substr(begin, end - begin));
+        begin = end + 1;
+        if (insn.empty()) continue;
+
+        size_t split = 0;
+        while (split < insn.size() && !std::isspace(static_cast<unsigned char>(insn[split]))) ++split;
+        const std::string mnemonic = to_lower(insn.substr(0, split));
+        const std::string_view operands = trim(insn.substr(split));
+
+        Step step;
+        if (mnemonic == "*" || mnemonic == "?") {
+            if (!operands.empty()) {
+                throw std::invalid_argument("Wildcard instruction takes no operands: " + std::string(text));
+            }
+            steps_.push_back(std::move(step));
+            continue;
+        }
+
+        std::string_view name = mnemonic;
+        if (name.size() == 4 && name.starts_with("b.") && name != "b.cond") {
+            // b.eq 等：按条件码精确匹配
+            const auto* found = std::find(std::begin(kConditionNames), std::end(kConditionNames), name.substr(2));
+            if (name.substr(2) == "hs") found = kConditionNames + 2;
+            if (name.substr(2) == "lo") found = kConditionNames + 3;
+            if (found == std::end(kConditionNames)) {
+                throw std::invalid_argument("Unknown condition '" + mnemonic + "' in pattern: " + std::string(text));
+            }
+            step.any_condition = false;
+            step.condition = static_cast<assembler::Condition>(found - kConditionNames);
+            name = "b.cond";
+        }
+        const auto* entry = std::find_if(std::begin(kMnemonics), std::end(kMnemonics),
+                                         [&](const Mnemonic& m) { return m.name == name; });
+        if (entry == std::end(kMnemonics)) {
+            throw std::invalid_argument("Unknown mnemonic '" + mnemonic + "' in pattern: " + std::string(text));
+        }
+        for (InstructionId id : entry->ids) {
+            if (id == InstructionId::INVALID) break;
+            step.ids[step.id_count++] = id;
+            for (const Filter& filter : filters_for(id)) {
+                step.filters[step.filter_count++] = filter;
+            }
+        }
+
+        if (!operands.empty()) {
+            for (std::string_view token : split_operands(operands)) {
+                if (token.empty()) {
+                    throw std::invalid_argument("Empty operand in pattern: " + std::string(text));
+                }
+                step.operands.push_back(parse_operand(token, text));
+                if (step.operands.size() > disassembler::DecodedInsn::kMaxOperands) {
+                    throw std::invalid_argument("Too many operands in pattern: " + std::string(text));
+                }
+            }
+        }
+        steps_.push_back(std::move(step));
+    }
+
+    int best = -1;
+    for (size_t i = 0; i < steps_.size(); ++i) {
+        if (steps_[i].id_count == 0) continue;
+        const int score = selectivity(steps_[i]);
+        if (score > best) {
+            best = score;
+            anchor_ = i;
+        }
+    }
+    if (best < 0) {
+        throw std::invalid_argument("Pattern must contain at least one instruction: " + std::string(text));
+    }
+}
+
+bool InsnPattern::matches(uint64_t address, const uint32_t* words) const {
+    // 先用过滤条件排除所有步骤，再逐条解码，失败的候选通常不需要任何解码
+    for (size_t i = 0; i < steps_.size(); ++i) {
+        if (!passes_filters(steps_[i], words[i])) return false;
+    }
+    for (size_t i = 0; i < steps_.size(); ++i) {
+        const Step& step = steps_[i];
+        if (step.id_count == 0) continue;
+
+        disassembler::DecodedInsn insn;
+        if (!disassembler::decode(address + i * 4, words[i], insn)) return false;
+        if (std::find(step.ids, step.ids + step.id_count, insn.id) == step.ids + step.id_count) return false;
+        if (!step.any_condition && insn.cond != step.condition) return false;
+        if (step.operands.size() > insn.operand_count) return false;
+        for (size_t op = 0; op < step.operands.size(); ++op) {
+            if (!operand_matches(step.operands[op], insn.operands[op])) return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uintptr_t> scan(uintptr_t start, size_t size, const Pattern& pattern) {
+    std::vector<uintptr_t> matches;
+    scan_block(reinterpret_cast<const uint8_t*>(start), reinterpret_cast<const uint8_t*>(start + size), pattern, matches);
+    return matches;
+}
+
+std::vector<uintptr_t> scan(uintptr_t start, size_t size, const InsnPattern& pattern) {
+    std::vector<uintptr_t> matches;
+    scan_block(reinterpret_cast<const uint8_t*>(start), reinterpret_cast<const uint8_t*>(start + size), pattern, matches);
+    return matches;
+}
+
+std::vector<uintptr_t> scan_executable(const Pattern& pattern, const ScanOptions& options) {
+    return scan_regions(pattern, options);
+}
+
+std::vector<uintptr_t> scan_executable(const InsnPattern& pattern, const ScanOptions& options) {
+    return scan_regions(pattern, options);
+}
+
+inline_hook::Hook hook_pattern(const Pattern& pattern, inline_hook::Hook::Callback callback,
+                               const ScanOptions& options, ptrdiff_t offset,
+                               const inline_hook::HookOptions& hook_options) {
+    return hook_unique(pattern, callback, options, offset, hook_options);
+}
+
+inline_hook::Hook hook_pattern(const InsnPattern& pattern, inline_hook::Hook::Callback callback,
+                               const ScanOptions& options, ptrdiff_t offset,
+                               const inline_hook::HookOptions& hook_options) {
+    return hook_unique(pattern, callback, options, offset, hook_options);
+}
+
+} // namespace ur::scanner
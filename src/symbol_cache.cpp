@@ -0,0 +1,233 @@
+#include "ur/symbol_cache.h"
+#include "cache_file.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <vector>
+
+namespace ur::symbol_cache {
+
+namespace {
+
+constexpr char kMagic[8] = {'U', 'R', 'S', 'Y', 'M', 'C', '\0', '\1'};
+constexpr size_t kMaxBuildIdSize = 64;
+
+constexpr uint32_t kOccupied = 1u << 0;
+constexpr uint32_t kPresent = 1u << 1;
+constexpr uint32_t kIfunc = 1u << 2;
+
+// 文件布局：FileHeader | Slot[slot_count] | 字符串池
+struct FileHeader {
+    char magic[8];
+    uint32_t build_id_size;
+    uint8_t build_id[kMaxBuildIdSize];
+    uint32_t slot_count;   // 2 的幂
+    uint32_t entry_count;
+    uint32_t strings_size;
+};
+
+struct Slot {
+    uint32_t hash;
+    uint32_t flags;        // 0 表示空槽
+    uint32_t name_offset;  // 字符串池中的偏移
+    uint32_t name_size;
+    uint64_t value;
+};
+
+const Slot* slots_of(const uint8_t* data) {
+    return reinterpret_cast<const Slot*>(data + sizeof(FileHeader));
+}
+
+const char* strings_of(const uint8_t* data) {
+    const auto* header = reinterpret_cast<const FileHeader*>(data);
+    return reinterpret_cast<const char*>(data + sizeof(FileHeader) + header->slot_count * sizeof(Slot));
+}
+
+uint32_t encode_flags(const Result& result) {
+    return kOccupied | (result.present ? kPresent : 0) | (result.ifunc ? kIfunc : 0);
+}
+
+Result decode(const Slot& slot) {
+    Result result;
+    result.present = (slot.flags & kPresent) != 0;
+    result.ifunc = (slot.flags & kIfunc) != 0;
+    result.value = slot.value;
+    return result;
+}
+
+} // namespace
+
+std::shared_ptr<Cache> Cache::open(const std::string& directory, std::span<const uint8_t> build_id) {
+    if (build_id.empty() || build_id.size() > kMaxBuildIdSize) return nullptr;
+
+    std::shared_ptr<Cache> cache(new Cache());
+    cache->m_build_id.assign(reinterpret_cast<const char*>(build_id.data()), build_id.size());
+    cache->m_path = cache_file::path_for(directory, build_id, ".symcache");
+    cache->map_file();
+    return cache;
+}
+
+Cache::~Cache() {
+    flush();
+    unmap_file();
+}
+
+bool Cache::map_file() {
+    int fd = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return false;
+
+    // 文件可能损坏或属于其他模块，校验失败时忽略，下次 flush() 会重写
+    const auto* data = static_cast<const uint8_t*>(mem);
+    const auto* header = reinterpret_cast<const FileHeader*>(data);
+    const bool valid =
+        memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+        header->build_id_size == m_build_id.size() &&
+        memcmp(header->build_id, m_build_id.data(), m_build_id.size()) == 0 &&
+        header->slot_count != 0 && (header->slot_count & (header->slot_count - 1)) == 0 &&
+        header->entry_count < header->slot_count &&
+        sizeof(FileHeader) + static_cast<uint64_t>(header->slot_count) * sizeof(Slot) + header->strings_size == size;
+    if (!valid) {
+        munmap(mem, size);
+        return false;
+    }
+
+    unmap_file();
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+void Cache::unmap_file() {
+    if (m_data != nullptr) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+bool Cache::lookup_mapped(std::string_view name, uint32_t hash, Result& result) const {
+    if (m_data == nullptr) return false;
+
+    const auto* header = reinterpret_cast<const FileHeader*>(m_data);
+    const Slot* slots = slots_of(m_data);
+    const char* strings = strings_of(m_data);
+    const uint32_t mask = header->slot_count - 1;
+
+    // 探测次数以槽位数为上限，损坏的文件也不会死循环
+    for (uint32_t probe = 0, index = hash & mask; probe < header->slot_count; ++probe, index = (index + 1) & mask) {
+        const Slot& slot = slots[index];
+        if (slot.flags == 0) return false;
+        if (slot.hash == hash && slot.name_size == name.size() &&
+            static_cast<uint64_t>(slot.name_offset) + slot.name_size <= header->strings_size &&
+            memcmp(strings + slot.name_offset, name.data(), name.size()) == 0) {
+            result = decode(slot);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Cache::lookup(std::string_view name, uint32_t hash, Result& result) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (lookup_mapped(name, hash, result)) return true;
+    if (m_pending.empty()) return false;
+
+    auto it = m_pending.find(std::string(name));
+    if (it == m_pending.end()) return false;
+    result = it->second.result;
+    return true;
+}
+
+void Cache::record(std::string_view name, uint32_t hash, const Result& result) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.insert_or_assign(std::string(name), Pending{hash, result});
+}
+
+size_t Cache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = m_pending.size();
+    if (m_data != nullptr) {
+        count += reinterpret_cast<const FileHeader*>(m_data)->entry_count;
+    }
+    return count;
+}
+
+bool Cache::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.empty()) return true;
+
+    // 其他进程可能已经写入了更新的缓存，先合并它
+    map_file();
+
+    struct Item {
+        std::string_view name;
+        uint32_t hash;
+        uint32_t flags;
+        uint64_t value;
+    };
+    std::vector<Item> items;
+    if (m_data != nullptr) {
+        const auto* header = reinterpret_cast<const FileHeader*>(m_data);
+        const Slot* slots = slots_of(m_data);
+        const char* strings = strings_of(m_data);
+        items.reserve(header->entry_count + m_pending.size());
+        for (uint32_t i = 0; i < header->slot_count; ++i) {
+            const Slot& slot = slots[i];
+            if (slot.flags == 0 || static_cast<uint64_t>(slot.name_offset) + slot.name_size > header->strings_size) continue;
+            std::string_view name(strings + slot.name_offset, slot.name_size);
+            if (m_pending.count(std::string(name)) != 0) continue; // 新结果优先
+            items.push_back({name, slot.hash, slot.flags, slot.value});
+        }
+    }
+    for (const auto& [name, pending] : m_pending) {
+        items.push_back({name, pending.hash, encode_flags(pending.result), pending.result.value});
+    }
+
+    // 负载因子不超过 1/2
+    uint32_t slot_count = 16;
+    while (slot_count < items.size() * 2) slot_count <<= 1;
+
+    std::vector<Slot> slots(slot_count, Slot{});
+    std::string strings;
+    for (const auto& item : items) {
+        const uint32_t mask = slot_count - 1;
+        uint32_t index = item.hash & mask;
+        while (slots[index].flags != 0) index = (index + 1) & mask;
+        slots[index] = {item.hash, item.flags, static_cast<uint32_t>(strings.size()),
+                        static_cast<uint32_t>(item.name.size()), item.value};
+        strings.append(item.name);
+    }
+
+    FileHeader header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.build_id_size = static_cast<uint32_t>(m_build_id.size());
+    memcpy(header.build_id, m_build_id.data(), m_build_id.size());
+    header.slot_count = slot_count;
+    header.entry_count = static_cast<uint32_t>(items.size());
+    header.strings_size = static_cast<uint32_t>(strings.size());
+
+    if (!cache_file::replace(m_path, {{&header, sizeof(header)},
+                                      {slots.data(), slots.size() * sizeof(Slot)},
+                                      {strings.data(), strings.size()}})) {
+        return false;
+    }
+
+    m_pending.clear();
+    map_file();
+    return true;
+}
+
+} // namespace ur::symbol_cache
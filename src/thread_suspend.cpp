@@ -0,0 +1,283 @@
+#include "ur/thread_suspend.h"
+#include "ur/fork_safety.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace ur::thread_suspend {
+
+struct ScopedSuspend::Slot {
+    uint32_t tid = 0;
+    ucontext_t* context = nullptr; // Published by the thread's handler before it parks
+};
+
+namespace {
+
+// Only one scope exists at a time, so the handler finds it through globals.
+std::mutex g_scope_mutex;
+ScopedSuspend::Slot* g_slots = nullptr;
+size_t g_capacity = 0;
+
+// Scopes are numbered; the handler only parks for the active one and ignores signals
+// that arrive late from an earlier scope.
+std::atomic<uint32_t> g_active{0};
+std::atomic<uint32_t> g_resumed{0};
+std::atomic<uint32_t> g_parked{0};
+std::atomic<uint32_t> g_in_handler{0};
+uint32_t g_generation = 0;
+struct sigaction g_previous{};
+
+long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const timespec* timeout = nullptr) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op | FUTEX_PRIVATE_FLAG, value, timeout, nullptr, 0);
+}
+
+uint32_t current_tid() {
+    return static_cast<uint32_t>(syscall(SYS_gettid));
+}
+
+void forward_to_previous(int signal, siginfo_t* info, void* context) {
+    if (g_previous.sa_flags & SA_SIGINFO) {
+        if (g_previous.sa_sigaction) g_previous.sa_sigaction(signal, info, context);
+    } else if (g_previous.sa_handler != SIG_IGN && g_previous.sa_handler != SIG_DFL) {
+        g_previous.sa_handler(signal);
+    }
+}
+
+void suspend_handler(int signal, siginfo_t* info, void* context) {
+    g_in_handler.fetch_add(1, std::memory_order_acq_rel);
+    const int saved_errno = errno;
+
+    // Our signals are queued by this process with the scope number and slot index as payload
+    const uint64_t token = reinterpret_cast<uint64_t>(info->si_value.sival_ptr);
+    const auto generation = static_cast<uint32_t>(token >> 32);
+    const auto index = static_cast<uint32_t>(token);
+    if (info->si_code != SI_QUEUE || info->si_pid != getpid()) {
+        forward_to_previous(signal, info, context);
+    } else if (generation != 0 && generation == g_active.load(std::memory_order_acquire) &&
+               index < g_capacity && g_slots[index].tid == current_tid()) {
+        __atomic_store_n(&g_slots[index].context, static_cast<ucontext_t*>(context), __ATOMIC_RELEASE);
+        g_parked.fetch_add(1, std::memory_order_release);
+        futex(&g_parked, FUTEX_WAKE, INT32_MAX);
+
+        // Park until the scope resumes; changes made to the context take effect on return
+        for (;;) {
+            const uint32_t resumed = g_resumed.load(std::memory_order_acquire);
+            if (resumed == generation) break;
+            futex(&g_resumed, FUTEX_WAIT, resumed);
+        }
+    }
+
+    errno = saved_errno;
+    g_in_handler.fetch_sub(1, std::memory_order_release);
+}
+
+// Thread ids of /proc/self/task, read with getdents64 so that listing does not allocate.
+// Calls `fn(tid)` for each; returns false if the directory cannot be read.
+template <typename Fn>
+bool for_each_task(Fn&& fn) {
+    int fd = open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    alignas(8) char buffer[4096];
+    for (;;) {
+        long bytes = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (bytes < 0) {
+            close(fd);
+            return false;
+        }
+        if (bytes == 0) break;
+        for (long offset = 0; offset < bytes;) {
+            auto* entry = reinterpret_cast<dirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+            uint32_t tid = 0;
+            const char* name = entry->d_name;
+            if (*name < '0' || *name > '9') continue;
+            for (; *name >= '0' && *name <= '9'; ++name) {
+                tid = tid * 10 + static_cast<uint32_t>(*name - '0');
+            }
+            fn(tid);
+        }
+    }
+    close(fd);
+    return true;
+}
+
+bool send_signal(uint32_t tid, int signal, uint32_t generation, uint32_t index) {
+    siginfo_t info;
+    std::memset(&info, 0, sizeof(info));
+    info.si_signo = signal;
+    info.si_code = SI_QUEUE;
+    info.si_pid = getpid();
+    info.si_uid = getuid();
+    info.si_value.sival_ptr = reinterpret_cast<void*>((static_cast<uint64_t>(generation) << 32) | index);
+    return syscall(SYS_rt_tgsigqueueinfo, getpid(), tid, signal, &info) == 0;
+}
+
+bool thread_alive(uint32_t tid) {
+    return syscall(SYS_tgkill, getpid(), tid, 0) == 0 || errno != ESRCH;
+}
+
+// Extra slots for threads created while the first round is being stopped.
+constexpr size_t kSpareSlots = 64;
+
+// A fork waits for the active scope to end (see ur::fork_safety).
+[[maybe_unused]] const bool g_fork_participant = fork_safety::add_participant({
+    fork_safety::Rank::Suspend,
+    [] { g_scope_mutex.lock(); },
+    [] { g_scope_mutex.unlock(); },
+});
+
+} // namespace
+
+ScopedSuspend::ScopedSuspend(const SuspendOptions& options)
+    : lock_(g_scope_mutex) {
+    // Size the slot array from a first listing; the later rounds must not allocate.
+    size_t threads = 0;
+    if (!for_each_task([&](uint32_t) { ++threads; })) {
+        throw std::runtime_error("Failed to list /proc/self/task");
+    }
+    capacity_ = threads * 2 + kSpareSlots;
+    slots_ = std::make_unique<Slot[]>(capacity_);
+    signal_ = options.signal;
+
+    struct sigaction action{};
+    action.sa_sigaction = suspend_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+    sigfillset(&action.sa_mask);
+    if (sigaction(signal_, &action, &previous_) != 0) {
+        throw std::runtime_error("Failed to install the thread suspend signal handler");
+    }
+    g_previous = previous_;
+    handler_installed_ = true;
+
+    try {
+        stop_all(options);
+    } catch (...) {
+        resume();
+        throw;
+    }
+}
+
+ScopedSuspend::~ScopedSuspend() {
+    resume();
+}
+
+void ScopedSuspend::stop_all(const SuspendOptions& options) {
+    const uint32_t self = current_tid();
+    if (++g_generation == 0) ++g_generation;
+    const uint32_t generation = g_generation;
+    g_slots = slots_.get();
+    g_capacity = capacity_;
+    g_parked.store(0, std::memory_order_relaxed);
+    g_active.store(generation, std::memory_order_release);
+
+    const auto deadline = std::chrono::steady_clock::now() + options.timeout;
+    size_t used = 0; // Slots handed out, including those of threads that exited
+    uint32_t expected = 0;
+    bool overflow = false;
+
+    for (;;) {
+        // Signal every thread not seen yet
+        size_t fresh = 0;
+        bool listed = for_each_task([&](uint32_t tid) {
+            if (tid == self) return;
+            for (size_t i = 0; i < used; ++i) {
+                if (slots_[i].tid == tid) return;
+            }
+            if (used == capacity_) {
+                overflow = true;
+                return;
+            }
+            slots_[used].tid = tid;
+            if (send_signal(tid, signal_, generation, static_cast<uint32_t>(used))) {
+                ++used;
+                ++expected;
+                ++fresh;
+            } else {
+                slots_[used].tid = 0; // Already exited
+            }
+        });
+        if (!listed) throw std::runtime_error("Failed to list /proc/self/task");
+        if (overflow) throw std::runtime_error("Too many threads were created while suspending");
+
+        // Wait for them to park; threads that exit before handling the signal are dropped
+        for (;;) {
+            const uint32_t parked = g_parked.load(std::memory_order_acquire);
+            if (parked >= expected) break;
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) throw std::runtime_error("Timed out waiting for threads to suspend");
+
+            timespec wait{0, 1000000}; // Wake up every millisecond to look for exited threads
+            futex(&g_parked, FUTEX_WAIT, parked, &wait);
+            for (size_t i = 0; i < used; ++i) {
+                auto& slot = slots_[i];
+                if (slot.tid != 0 && __atomic_load_n(&slot.context, __ATOMIC_ACQUIRE) == nullptr && !thread_alive(slot.tid)) {
+                    slot.tid = 0;
+                    --expected;
+                }
+            }
+        }
+
+        // No new thread showed up: everything but this thread is parked
+        if (fresh == 0) break;
+    }
+
+    // Drop the slots of exited threads. Parked handlers no longer look at their slot.
+    for (size_t i = 0; i < used; ++i) {
+        if (slots_[i].tid != 0 && slots_[i].context != nullptr) {
+            slots_[count_++] = slots_[i];
+        }
+    }
+}
+
+uint32_t ScopedSuspend::thread_id(size_t index) const {
+    return slots_[index].tid;
+}
+
+uintptr_t ScopedSuspend::pc(size_t index) const {
+    return slots_[index].context->uc_mcontext.pc;
+}
+
+void ScopedSuspend::set_pc(size_t index, uintptr_t pc) {
+    slots_[index].context->uc_mcontext.pc = pc;
+}
+
+uintptr_t ScopedSuspend::lr(size_t index) const {
+    return slots_[index].context->uc_mcontext.regs[30];
+}
+
+void ScopedSuspend::set_lr(size_t index, uintptr_t lr) {
+    slots_[index].context->uc_mcontext.regs[30] = lr;
+}
+
+void ScopedSuspend::resume() {
+    if (!handler_installed_) return;
+
+    const uint32_t generation = g_active.load(std::memory_order_relaxed);
+    g_active.store(0, std::memory_order_release);
+    g_resumed.store(generation, std::memory_order_release);
+    futex(&g_resumed, FUTEX_WAKE, INT32_MAX);
+
+    sigaction(signal_, &previous_, nullptr);
+    handler_installed_ = false;
+
+    // Handlers still running may read the slots; wait for them before the slots go away
+    while (g_in_handler.load(std::memory_order_acquire) != 0) {
+        sched_yield();
+    }
+    g_slots = nullptr;
+    g_capacity = 0;
+    count_ = 0;
+}
+
+} // namespace ur::thread_suspend
@@ -0,0 +1,281 @@
+#include "ur/trampoline_cache.h"
+#include "cache_file.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+namespace ur::trampoline_cache {
+
+namespace {
+
+constexpr char kMagic[8] = {'U', 'R', 'T', 'R', 'C', 'C', '\0', '\2'};
+constexpr size_t kMaxBuildIdSize = 64;
+constexpr uint32_t kUsesPreviousWord = 1u << 0;
+
+// 文件布局：FileHeader，之后每个函数一个 EntryHeader，其后是它的各个计划：
+// PlanHeader | uint32_t original[word_count] | Step steps[step_count]
+struct FileHeader {
+    char magic[8];
+    uint32_t build_id_size;
+    uint8_t build_id[kMaxBuildIdSize];
+    uint32_t entry_count;
+};
+
+struct EntryHeader {
+    uint64_t offset;
+    uint32_t limit;
+    uint32_t plan_count;
+};
+
+struct PlanHeader {
+    uint32_t required_size;
+    uint32_t backup_size;
+    uint32_t flags;
+    uint32_t previous_word;
+    uint32_t word_count;
+    uint32_t step_count;
+};
+
+// 按顺序读取文件内容，越界后一直失败
+class Reader {
+public:
+    explicit Reader(const std::vector<uint8_t>& data) : m_data(data) {}
+
+    bool read(void* out, size_t size) {
+        if (size > m_data.size() - m_offset) return false;
+        memcpy(out, m_data.data() + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    size_t remaining() const { return m_data.size() - m_offset; }
+    bool at_end() const { return m_offset == m_data.size(); }
+
+private:
+    const std::vector<uint8_t>& m_data;
+    size_t m_offset = 0;
+};
+
+// 寄存器编号必须是 assembler::Register 中的值：X0-X30/SP/ZR、对应的 W 寄存器，
+// 以及 LDR/STR 可能使用的 S/D/Q 寄存器
+bool is_valid_register(int32_t reg) {
+    const auto in = [reg](int32_t first, int32_t count) { return reg >= first && reg < first + count; };
+    return in(0, 33) || in(64, 33) || in(100, 32) || in(150, 32) || in(200, 32);
+}
+
+// 逐条校验从文件读出的步骤，损坏的记录会让 emit_relocation 生成错误的代码
+bool is_valid_step(const Step& step) {
+    if (step.kind > StepKind::StoreHalf || step.words == 0 || step.words > 2) return false;
+    const bool is_w = step.reg >= 64 && step.reg < 64 + 33;
+    switch (step.kind) {
+        case StepKind::Copy:
+        case StepKind::Jump:
+        case StepKind::Call:
+            return step.reg == -1;
+        case StepKind::BranchCond:
+            return step.reg == -1 && step.extra <= 0xf;
+        case StepKind::Tbz:
+        case StepKind::Tbnz:
+            return is_valid_register(step.reg) && step.extra <= 63;
+        case StepKind::LoadByte:
+        case StepKind::LoadHalf:
+        case StepKind::StoreByte:
+        case StepKind::StoreHalf:
+            return is_w;
+        case StepKind::LoadSignedByte:
+        case StepKind::LoadSignedHalf:
+            return is_w || (step.reg >= 0 && step.reg < 33);
+        default:
+            return is_valid_register(step.reg);
+    }
+}
+
+bool read_file(const std::string& path, std::vector<uint8_t>& data) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    data.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t bytes = ::read(fd, data.data() + done, data.size() - done);
+        if (bytes <= 0) break;
+        done += static_cast<size_t>(bytes);
+    }
+    close(fd);
+    return done == data.size();
+}
+
+void append(std::vector<uint8_t>& out, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+} // namespace
+
+std::shared_ptr<Cache> Cache::open(const std::string& directory, std::span<const uint8_t> build_id) {
+    if (build_id.empty() || build_id.size() > kMaxBuildIdSize) return nullptr;
+
+    std::shared_ptr<Cache> cache(new Cache());
+    cache->m_build_id.assign(reinterpret_cast<const char*>(build_id.data()), build_id.size());
+    cache->m_path = cache_file::path_for(directory, build_id, ".trampcache");
+    cache->load(cache->m_entries);
+    return cache;
+}
+
+Cache::~Cache() {
+    flush();
+}
+
+bool Cache::load(std::unordered_map<uint64_t, Entry>& entries) const {
+    std::vector<uint8_t> data;
+    if (!read_file(m_path, data)) return false;
+
+    // 文件可能损坏或属于其他模块，校验失败时整体忽略，下次 flush() 会重写
+    Reader reader(data);
+    FileHeader header{};
+    if (!reader.read(&header, sizeof(header)) ||
+        memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.build_id_size != m_build_id.size() ||
+        memcmp(header.build_id, m_build_id.data(), m_build_id.size()) != 0) {
+        return false;
+    }
+
+    std::unordered_map<uint64_t, Entry> loaded;
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        EntryHeader entry_header{};
+        if (!reader.read(&entry_header, sizeof(entry_header))) return false;
+        Entry& entry = loaded[entry_header.offset];
+        entry.limit = entry_header.limit;
+        for (uint32_t j = 0; j < entry_header.plan_count; ++j) {
+            PlanHeader plan_header{};
+            if (!reader.read(&plan_header, sizeof(plan_header)) ||
+                plan_header.word_count * sizeof(uint32_t) != plan_header.backup_size ||
+                plan_header.step_count > plan_header.word_count) {
+                return false;
+            }
+            // 先确认剩余数据足够，再按文件中的数量分配内存
+            const size_t payload = plan_header.word_count * sizeof(uint32_t) + plan_header.step_count * sizeof(Step);
+            if (payload > reader.remaining()) return false;
+            Plan& plan = entry.plans.emplace_back();
+            plan.required_size = plan_header.required_size;
+            plan.backup_size = plan_header.backup_size;
+            plan.uses_previous_word = (plan_header.flags & kUsesPreviousWord) != 0;
+            plan.previous_word = plan_header.previous_word;
+            plan.original.resize(plan_header.word_count);
+            plan.steps.resize(plan_header.step_count);
+            if (!reader.read(plan.original.data(), plan.original.size() * sizeof(uint32_t)) ||
+                !reader.read(plan.steps.data(), plan.steps.size() * sizeof(Step)) ||
+                !std::all_of(plan.steps.begin(), plan.steps.end(), is_valid_step)) {
+                return false;
+            }
+        }
+    }
+    if (!reader.at_end()) return false;
+
+    entries = std::move(loaded);
+    return true;
+}
+
+bool Cache::lookup_limit(uint64_t offset, uint32_t& limit) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(offset);
+    if (it == m_entries.end() || it->second.limit == 0) return false;
+    limit = it->second.limit;
+    return true;
+}
+
+void Cache::record_limit(uint64_t offset, uint32_t limit) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[offset].limit = limit;
+    m_dirty = true;
+}
+
+bool Cache::lookup_plan(uint64_t offset, uint32_t required_size, Plan& plan) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(offset);
+    if (it == m_entries.end()) return false;
+    for (const auto& cached : it->second.plans) {
+        if (cached.required_size == required_size) {
+            plan = cached;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Cache::record_plan(uint64_t offset, const Plan& plan) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& plans = m_entries[offset].plans;
+    for (auto& cached : plans) {
+        if (cached.required_size == plan.required_size) {
+            cached = plan;
+            m_dirty = true;
+            return;
+        }
+    }
+    plans.push_back(plan);
+    m_dirty = true;
+}
+
+size_t Cache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+bool Cache::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_dirty) return true;
+
+    // 其他进程可能已经写入了更新的缓存，先合并它；本进程的结果优先
+    std::unordered_map<uint64_t, Entry> merged;
+    load(merged);
+    for (const auto& [offset, entry] : m_entries) {
+        Entry& target = merged[offset];
+        if (entry.limit != 0) target.limit = entry.limit;
+        for (const auto& plan : entry.plans) {
+            auto it = std::find_if(target.plans.begin(), target.plans.end(),
+                                   [&](const Plan& cached) { return cached.required_size == plan.required_size; });
+            if (it != target.plans.end()) {
+                *it = plan;
+            } else {
+                target.plans.push_back(plan);
+            }
+        }
+    }
+
+    FileHeader header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.build_id_size = static_cast<uint32_t>(m_build_id.size());
+    memcpy(header.build_id, m_build_id.data(), m_build_id.size());
+    header.entry_count = static_cast<uint32_t>(merged.size());
+
+    std::vector<uint8_t> out;
+    append(out, &header, sizeof(header));
+    for (const auto& [offset, entry] : merged) {
+        EntryHeader entry_header{offset, entry.limit, static_cast<uint32_t>(entry.plans.size())};
+        append(out, &entry_header, sizeof(entry_header));
+        for (const auto& plan : entry.plans) {
+            PlanHeader plan_header{plan.required_size, plan.backup_size,
+                                   plan.uses_previous_word ? kUsesPreviousWord : 0u, plan.previous_word,
+                                   static_cast<uint32_t>(plan.original.size()), static_cast<uint32_t>(plan.steps.size())};
+            append(out, &plan_header, sizeof(plan_header));
+            append(out, plan.original.data(), plan.original.size() * sizeof(uint32_t));
+            append(out, plan.steps.data(), plan.steps.size() * sizeof(Step));
+        }
+    }
+
+    if (!cache_file::replace(m_path, {{out.data(), out.size()}})) return false;
+
+    m_entries = std::move(merged);
+    m_dirty = false;
+    return true;
+}
+
+} // namespace ur::trampoline_cache
@@ -1,29 +1,259 @@
 #include <ur/vmt_hook.h>
 #include <ur/memory.h>
+#include <ur/maps_parser.h>
 
 #include <sys/mman.h>
+#include <algorithm>
+#include <stdexcept>
+#include <typeinfo>
 #include <utility>
 
-ur::VmtHook::VmtHook(void* instance) {
+namespace {
+    // Offset-to-top and RTTI pointer in front of the address point of an Itanium C++ ABI vtable
+    constexpr std::size_t kVtableHeaderWords = 2;
+
+    // Layout of the Itanium C++ ABI RTTI classes for single and multiple/virtual
+    // inheritance (__si_class_type_info, __vmi_class_type_info); <cxxabi.h> does not
+    // declare them everywhere.
+    struct ClassTypeInfo {
+        const void* vptr;
+        const char* name;
+    };
+
+    struct SiClassTypeInfo : ClassTypeInfo {
+        const ClassTypeInfo* base_type;
+    };
+
+    struct BaseClassTypeInfo {
+        const ClassTypeInfo* base_type;
+        long offset_flags;
+    };
+
+    struct VmiClassTypeInfo : ClassTypeInfo {
+        unsigned int flags;
+        unsigned int base_count;
+        BaseClassTypeInfo base_info[1];
+    };
+
+    constexpr long kVirtualBaseMask = 0x1;
+
+    // Local hierarchies whose type_info objects have the vtables of the two RTTI classes
+    // that describe base classes.
+    struct RttiBase { virtual ~RttiBase() = default; };
+    struct RttiSingle : RttiBase {};
+    struct RttiVirtual : virtual RttiBase {};
+
+    const void* rtti_vptr(const std::type_info& type) {
+        return reinterpret_cast<const ClassTypeInfo*>(&type)->vptr;
+    }
+
+    // Whether the class described by `type` has a virtual base anywhere in its hierarchy.
+    // Its vtables then hold vbase and vcall offsets at negative indices in front of the
+    // offset-to-top word, and nothing says how many.
+    bool has_virtual_base(const ClassTypeInfo* type) {
+        static const void* const si_vptr = rtti_vptr(typeid(RttiSingle));
+        static const void* const vmi_vptr = rtti_vptr(typeid(RttiVirtual));
+        if (!type) return false;
+        if (type->vptr == si_vptr) {
+            return has_virtual_base(static_cast<const SiClassTypeInfo*>(type)->base_type);
+        }
+        if (type->vptr != vmi_vptr) return false;
+        const auto* vmi = static_cast<const VmiClassTypeInfo*>(type);
+        for (unsigned int i = 0; i < vmi->base_count; ++i) {
+            if ((vmi->base_info[i].offset_flags & kVirtualBaseMask) ||
+                has_virtual_base(vmi->base_info[i].base_type)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Number of leading entries of `vmt` that point into executable mappings, without
+    // reading past the end of the mapping that holds the vtable.
+    std::size_t count_vtable_entries(void** vmt) {
+        auto snapshot = ur::maps_parser::MapsSnapshot::current();
+        const auto address = reinterpret_cast<std::uintptr_t>(vmt);
+        const ur::maps_parser::MapEntry* table_map = snapshot->find_by_addr(address);
+        if (!table_map) {
+            snapshot = ur::maps_parser::MapsSnapshot::refresh();
+            table_map = snapshot->find_by_addr(address);
+        }
+        if (!table_map) return 0;
+
+        const std::size_t limit = (table_map->end - address) / sizeof(void*);
+        const ur::maps_parser::MapEntry* code_map = nullptr;
+        std::size_t count = 0;
+        for (; count < limit; ++count) {
+            const auto entry = reinterpret_cast<std::uintptr_t>(vmt[count]);
+            // Methods mostly live in the same module, so the last hit usually matches
+            if (!code_map || !code_map->contains(entry)) {
+                code_map = snapshot->find_by_addr(entry);
+            }
+            if (!code_map || !(code_map->prot & PROT_EXEC)) break;
+        }
+        return count;
+    }
+
+    // Runs `write` with the slots in [first, last] writable. A shadow vtable is ordinary heap
+    // memory; otherwise the covered pages are unprotected once around all the writes.
+    template <typename Fn>
+    void write_vtable(void** first, void** last, bool shadow, Fn&& write) {
+        if (shadow) {
+            write();
+            return;
+        }
+        const auto start = reinterpret_cast<uintptr_t>(first);
+        const std::size_t size = reinterpret_cast<uintptr_t>(last) + sizeof(void*) - start;
+        ur::memory::protect(start, size, PROT_READ | PROT_WRITE);
+        write();
+        ur::memory::protect(start, size, PROT_READ);
+    }
+
+    void store_slot(void** slot, void* function) {
+        // A concurrent virtual call sees either pointer
+        __atomic_store_n(slot, function, __ATOMIC_RELEASE);
+    }
+}
+
+ur::VmtHook::VmtHook(void* instance, VmtMode mode) {
     vmt_address_ = *static_cast<void***>(instance);
+    if (mode != VmtMode::Shadow) return;
+
+    // vmt[-1] is the RTTI pointer; null when the class was compiled without RTTI
+    if (has_virtual_base(static_cast<const ClassTypeInfo*>(vmt_address_[-1]))) {
+        throw std::runtime_error("Shadow vtable is not supported for classes with virtual bases");
+    }
+
+    shadow_size_ = count_vtable_entries(vmt_address_);
+    shadow_ = std::make_shared<void*[]>(kVtableHeaderWords + shadow_size_);
+    std::copy(vmt_address_ - kVtableHeaderWords, vmt_address_ + shadow_size_, shadow_.get());
+
+    original_vmt_ = vmt_address_;
+    vmt_address_ = shadow_.get() + kVtableHeaderWords;
+    instance_vptr_ = static_cast<void**>(instance);
+    __atomic_store_n(reinterpret_cast<void***>(instance_vptr_), vmt_address_, __ATOMIC_RELEASE);
 }
 
 ur::VmtHook::VmtHook(void** vmt_address) : vmt_address_(vmt_address) {}
 
-std::unique_ptr<ur::VmHook> ur::VmtHook::hook_method(std::size_t index, void* hook_function) {
+ur::VmtHook::~VmtHook() {
+    if (!instance_vptr_) return;
+    // Put the original vtable back unless something else has replaced the vptr since
+    void** expected = vmt_address_;
+    __atomic_compare_exchange_n(reinterpret_cast<void***>(instance_vptr_), &expected, original_vmt_,
+                                false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+std::unique_ptr<ur::VmHook> ur::VmtHook::hook_method(std::size_t index, void* hook_function,
+                                                    const VmHookOptions& options) {
+    if (shadow_ && index >= shadow_size_) {
+        return nullptr;
+    }
     void** vmt_entry_address = vmt_address_ + index;
     void* original_function = *vmt_entry_address;
 
-    auto hook = std::unique_ptr<VmHook>(new VmHook(vmt_entry_address, hook_function, original_function));
+    auto hook = std::unique_ptr<VmHook>(new VmHook(vmt_entry_address, hook_function, original_function, shadow_));
+    if (options.count_calls) {
+        hook->counter_ = hook_stats::acquire_counting_thunk(hook_stats::HookKind::Vmt,
+                                                            reinterpret_cast<uintptr_t>(vmt_entry_address),
+                                                            reinterpret_cast<uintptr_t>(hook_function));
+    }
     hook->enable();
     return hook;
 }
 
-ur::VmHook::VmHook(void** vmt_entry_address, void* hook_function, void* original_function)
+ur::VmMethodHooks ur::VmtHook::hook_methods(std::span<const Method> methods, const VmHookOptions& options) {
+    VmMethodHooks hooks;
+    if (methods.empty()) return hooks;
+
+    std::size_t min_index = methods.front().index;
+    std::size_t max_index = methods.front().index;
+    for (const auto& method : methods) {
+        min_index = std::min(min_index, method.index);
+        max_index = std::max(max_index, method.index);
+    }
+    if (shadow_ && max_index >= shadow_size_) {
+        return hooks;
+    }
+
+    // Counting thunks are prepared before the vtable is touched
+    hooks.shadow_ = shadow_;
+    hooks.entries_.resize(methods.size());
+    for (std::size_t i = 0; i < methods.size(); ++i) {
+        auto& entry = hooks.entries_[i];
+        entry.slot = vmt_address_ + methods[i].index;
+        if (options.count_calls) {
+            entry.counter = hook_stats::acquire_counting_thunk(hook_stats::HookKind::Vmt,
+                                                               reinterpret_cast<uintptr_t>(entry.slot),
+                                                               reinterpret_cast<uintptr_t>(methods[i].hook_function));
+        }
+    }
+
+    write_vtable(vmt_address_ + min_index, vmt_address_ + max_index, shadow_ != nullptr, [&]() {
+        for (std::size_t i = 0; i < methods.size(); ++i) {
+            auto& entry = hooks.entries_[i];
+            // Read after the earlier writes, so a repeated index chains
+            entry.original_function = *entry.slot;
+            store_slot(entry.slot, entry.counter.code != nullptr ? entry.counter.code : methods[i].hook_function);
+        }
+    });
+    return hooks;
+}
+
+ur::VmMethodHooks::~VmMethodHooks() {
+    unhook();
+}
+
+ur::VmMethodHooks::VmMethodHooks(VmMethodHooks&& other) noexcept
+    : entries_(std::move(other.entries_)),
+      shadow_(std::move(other.shadow_)) {
+    other.entries_.clear();
+}
+
+ur::VmMethodHooks& ur::VmMethodHooks::operator=(VmMethodHooks&& other) noexcept {
+    if (this != &other) {
+        unhook();
+        entries_ = std::move(other.entries_);
+        shadow_ = std::move(other.shadow_);
+        other.entries_.clear();
+    }
+    return *this;
+}
+
+uint64_t ur::VmMethodHooks::call_count(std::size_t i) const {
+    const auto& counter = entries_[i].counter;
+    return counter.counter ? counter.counter->calls() : 0;
+}
+
+void ur::VmMethodHooks::unhook() {
+    if (entries_.empty()) return;
+
+    void** first = entries_.front().slot;
+    void** last = entries_.front().slot;
+    for (const auto& entry : entries_) {
+        first = std::min(first, entry.slot);
+        last = std::max(last, entry.slot);
+    }
+    // Reverse order undoes chains on a repeated index
+    write_vtable(first, last, shadow_ != nullptr, [&]() {
+        for (auto entry = entries_.rbegin(); entry != entries_.rend(); ++entry) {
+            store_slot(entry->slot, entry->original_function);
+        }
+    });
+    for (auto& entry : entries_) {
+        hook_stats::release_counting_thunk(entry.counter);
+    }
+    entries_.clear();
+    shadow_.reset();
+}
+
+ur::VmHook::VmHook(void** vmt_entry_address, void* hook_function, void* original_function,
+                   std::shared_ptr<void*[]> shadow)
     : vmt_entry_address_(vmt_entry_address),
       hook_function_(hook_function),
       original_function_(original_function),
-      is_enabled_(false) {}
+      is_enabled_(false),
+      shadow_(std::move(shadow)) {}
 
 ur::VmHook::~VmHook() {
     unhook();
@@ -33,7 +263,9 @@ ur::VmHook::VmHook(VmHook&& other) noexcept
     : vmt_entry_address_(std::exchange(other.vmt_entry_address_, nullptr)),
       hook_function_(std::exchange(other.hook_function_, nullptr)),
       original_function_(std::exchange(other.original_function_, nullptr)),
-      is_enabled_(std::exchange(other.is_enabled_, false)) {}
+      is_enabled_(std::exchange(other.is_enabled_, false)),
+      counter_(std::exchange(other.counter_, {})),
+      shadow_(std::move(other.shadow_)) {}
 
 ur::VmHook& ur::VmHook::operator=(VmHook&& other) noexcept {
     if (this != &other) {
@@ -42,6 +274,8 @@ ur::VmHook& ur::VmHook::operator=(VmHook&& other) noexcept {
         hook_function_ = std::exchange(other.hook_function_, nullptr);
         original_function_ = std::exchange(other.original_function_, nullptr);
         is_enabled_ = std::exchange(other.is_enabled_, false);
+        counter_ = std::exchange(other.counter_, {});
+        shadow_ = std::move(other.shadow_);
     }
     return *this;
 }
@@ -53,15 +287,28 @@ void ur::VmHook::unhook() {
     vmt_entry_address_ = nullptr;
     hook_function_ = nullptr;
     original_function_ = nullptr;
+    hook_stats::release_counting_thunk(counter_);
+    shadow_.reset();
+}
+
+uint64_t ur::VmHook::call_count() const {
+    return counter_.counter ? counter_.counter->calls() : 0;
+}
+
+void* ur::VmHook::installed_function() const {
+    return counter_.code != nullptr ? counter_.code : hook_function_;
+}
+
+void ur::VmHook::write_slot(void* function) {
+    write_vtable(vmt_entry_address_, vmt_entry_address_, shadow_ != nullptr,
+                 [&]() { store_slot(vmt_entry_address_, function); });
 }
 
 bool ur::VmHook::enable() {
     if (vmt_entry_address_ == nullptr || is_enabled_) {
         return false;
     }
-    ur::memory::protect(reinterpret_cast<uintptr_t>(vmt_entry_address_), sizeof(void*), PROT_READ | PROT_WRITE);
-    ur::memory::write(reinterpret_cast<uintptr_t>(vmt_entry_address_), &hook_function_, sizeof(void*));
-    ur::memory::protect(reinterpret_cast<uintptr_t>(vmt_entry_address_), sizeof(void*), PROT_READ);
+    write_slot(installed_function());
     is_enabled_ = true;
     return true;
 }
@@ -70,9 +317,7 @@ bool ur::VmHook::disable() {
     if (vmt_entry_address_ == nullptr || !is_enabled_) {
         return false;
     }
-    ur::memory::protect(reinterpret_cast<uintptr_t>(vmt_entry_address_), sizeof(void*), PROT_READ | PROT_WRITE);
-    ur::memory::write(reinterpret_cast<uintptr_t>(vmt_entry_address_), &original_function_, sizeof(void*));
-    ur::memory::protect(reinterpret_cast<uintptr_t>(vmt_entry_address_), sizeof(void*), PROT_READ);
+    write_slot(original_function_);
     is_enabled_ = false;
     return true;
 }
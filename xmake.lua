@@ -3,12 +3,36 @@ add_requires("gtest")
 add_requires("capstone")
 set_languages("c++20")
 
+option("lzma")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Decode .gnu_debugdata (MiniDebugInfo) symbol tables with liblzma")
+option_end()
+
+if has_config("lzma") then
+    add_requires("xz")
+end
+
+option("bench")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Build the google-benchmark based bench target")
+option_end()
+
+if has_config("bench") then
+    add_requires("benchmark")
+end
+
 target("urhook")
     set_kind("static")
     add_files("src/**.cpp")
     add_includedirs("include",{
       public = true
     })
+    if has_config("lzma") then
+        add_packages("xz", {public = true})
+        add_defines("UR_HAVE_LZMA")
+    end
    
 target("tests")
     set_kind("binary")
@@ -19,3 +43,14 @@ target("tests")
     add_links("dl")
     add_ldflags("-rdynamic")
 
+if has_config("bench") then
+    target("bench")
+        set_kind("binary")
+        set_default(false)
+        add_packages("benchmark")
+        add_packages("capstone")
+        add_deps("urhook")
+        add_files("src-bench/*.cpp")
+        add_links("dl")
+        add_ldflags("-rdynamic")
+end